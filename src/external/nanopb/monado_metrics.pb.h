@@ -73,6 +73,13 @@ typedef struct _monado_metrics_SystemPresentInfo {
     uint64_t earliest_present_time_ns;
 } monado_metrics_SystemPresentInfo;
 
+typedef struct _monado_metrics_SystemLatchInfo {
+    int64_t frame_id;
+    uint64_t predicted_display_time_ns;
+    uint64_t when_woke_ns;
+    uint64_t when_latched_ns;
+} monado_metrics_SystemLatchInfo;
+
 typedef struct _monado_metrics_Record {
     pb_size_t which_record;
     union {
@@ -82,6 +89,7 @@ typedef struct _monado_metrics_Record {
         monado_metrics_SystemFrame system_frame;
         monado_metrics_SystemGpuInfo system_gpu_info;
         monado_metrics_SystemPresentInfo system_present_info;
+        monado_metrics_SystemLatchInfo system_latch_info;
     } record;
 } monado_metrics_Record;
 
@@ -97,6 +105,7 @@ extern "C" {
 #define monado_metrics_SystemFrame_init_default  {0, 0, 0, 0, 0, 0}
 #define monado_metrics_SystemGpuInfo_init_default {0, 0, 0, 0}
 #define monado_metrics_SystemPresentInfo_init_default {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}
+#define monado_metrics_SystemLatchInfo_init_default {0, 0, 0, 0}
 #define monado_metrics_Record_init_default       {0, {monado_metrics_Version_init_default}}
 #define monado_metrics_Version_init_zero         {0, 0}
 #define monado_metrics_SessionFrame_init_zero    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}
@@ -104,6 +113,7 @@ extern "C" {
 #define monado_metrics_SystemFrame_init_zero     {0, 0, 0, 0, 0, 0}
 #define monado_metrics_SystemGpuInfo_init_zero   {0, 0, 0, 0}
 #define monado_metrics_SystemPresentInfo_init_zero {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}
+#define monado_metrics_SystemLatchInfo_init_zero {0, 0, 0, 0}
 #define monado_metrics_Record_init_zero          {0, {monado_metrics_Version_init_zero}}
 
 /* Field tags (for use in manual encoding/decoding) */
@@ -152,12 +162,17 @@ extern "C" {
 #define monado_metrics_SystemPresentInfo_present_margin_ns_tag 13
 #define monado_metrics_SystemPresentInfo_actual_present_time_ns_tag 14
 #define monado_metrics_SystemPresentInfo_earliest_present_time_ns_tag 15
+#define monado_metrics_SystemLatchInfo_frame_id_tag 1
+#define monado_metrics_SystemLatchInfo_predicted_display_time_ns_tag 2
+#define monado_metrics_SystemLatchInfo_when_woke_ns_tag 3
+#define monado_metrics_SystemLatchInfo_when_latched_ns_tag 4
 #define monado_metrics_Record_version_tag        1
 #define monado_metrics_Record_session_frame_tag  2
 #define monado_metrics_Record_used_tag           3
 #define monado_metrics_Record_system_frame_tag   4
 #define monado_metrics_Record_system_gpu_info_tag 5
 #define monado_metrics_Record_system_present_info_tag 6
+#define monado_metrics_Record_system_latch_info_tag 7
 
 /* Struct field encoding specification for nanopb */
 #define monado_metrics_Version_FIELDLIST(X, a) \
@@ -229,13 +244,22 @@ X(a, STATIC,   SINGULAR, UINT64,   earliest_present_time_ns,  15)
 #define monado_metrics_SystemPresentInfo_CALLBACK NULL
 #define monado_metrics_SystemPresentInfo_DEFAULT NULL
 
+#define monado_metrics_SystemLatchInfo_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, INT64,    frame_id,          1) \
+X(a, STATIC,   SINGULAR, UINT64,   predicted_display_time_ns,   2) \
+X(a, STATIC,   SINGULAR, UINT64,   when_woke_ns,      3) \
+X(a, STATIC,   SINGULAR, UINT64,   when_latched_ns,   4)
+#define monado_metrics_SystemLatchInfo_CALLBACK NULL
+#define monado_metrics_SystemLatchInfo_DEFAULT NULL
+
 #define monado_metrics_Record_FIELDLIST(X, a) \
 X(a, STATIC,   ONEOF,    MESSAGE,  (record,version,record.version),   1) \
 X(a, STATIC,   ONEOF,    MESSAGE,  (record,session_frame,record.session_frame),   2) \
 X(a, STATIC,   ONEOF,    MESSAGE,  (record,used,record.used),   3) \
 X(a, STATIC,   ONEOF,    MESSAGE,  (record,system_frame,record.system_frame),   4) \
 X(a, STATIC,   ONEOF,    MESSAGE,  (record,system_gpu_info,record.system_gpu_info),   5) \
-X(a, STATIC,   ONEOF,    MESSAGE,  (record,system_present_info,record.system_present_info),   6)
+X(a, STATIC,   ONEOF,    MESSAGE,  (record,system_present_info,record.system_present_info),   6) \
+X(a, STATIC,   ONEOF,    MESSAGE,  (record,system_latch_info,record.system_latch_info),   7)
 #define monado_metrics_Record_CALLBACK NULL
 #define monado_metrics_Record_DEFAULT NULL
 #define monado_metrics_Record_record_version_MSGTYPE monado_metrics_Version
@@ -244,6 +268,7 @@ X(a, STATIC,   ONEOF,    MESSAGE,  (record,system_present_info,record.system_pre
 #define monado_metrics_Record_record_system_frame_MSGTYPE monado_metrics_SystemFrame
 #define monado_metrics_Record_record_system_gpu_info_MSGTYPE monado_metrics_SystemGpuInfo
 #define monado_metrics_Record_record_system_present_info_MSGTYPE monado_metrics_SystemPresentInfo
+#define monado_metrics_Record_record_system_latch_info_MSGTYPE monado_metrics_SystemLatchInfo
 
 extern const pb_msgdesc_t monado_metrics_Version_msg;
 extern const pb_msgdesc_t monado_metrics_SessionFrame_msg;
@@ -251,6 +276,7 @@ extern const pb_msgdesc_t monado_metrics_Used_msg;
 extern const pb_msgdesc_t monado_metrics_SystemFrame_msg;
 extern const pb_msgdesc_t monado_metrics_SystemGpuInfo_msg;
 extern const pb_msgdesc_t monado_metrics_SystemPresentInfo_msg;
+extern const pb_msgdesc_t monado_metrics_SystemLatchInfo_msg;
 extern const pb_msgdesc_t monado_metrics_Record_msg;
 
 /* Defines for backwards compatibility with code written before nanopb-0.4.0 */
@@ -260,6 +286,7 @@ extern const pb_msgdesc_t monado_metrics_Record_msg;
 #define monado_metrics_SystemFrame_fields &monado_metrics_SystemFrame_msg
 #define monado_metrics_SystemGpuInfo_fields &monado_metrics_SystemGpuInfo_msg
 #define monado_metrics_SystemPresentInfo_fields &monado_metrics_SystemPresentInfo_msg
+#define monado_metrics_SystemLatchInfo_fields &monado_metrics_SystemLatchInfo_msg
 #define monado_metrics_Record_fields &monado_metrics_Record_msg
 
 /* Maximum encoded size of messages (where known) */
@@ -267,6 +294,7 @@ extern const pb_msgdesc_t monado_metrics_Record_msg;
 #define monado_metrics_SessionFrame_size         145
 #define monado_metrics_SystemFrame_size          66
 #define monado_metrics_SystemGpuInfo_size        44
+#define monado_metrics_SystemLatchInfo_size      44
 #define monado_metrics_SystemPresentInfo_size    165
 #define monado_metrics_Used_size                 44
 #define monado_metrics_Version_size              12
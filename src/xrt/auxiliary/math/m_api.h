@@ -786,6 +786,23 @@ math_pose_interpolate(const struct xrt_pose *a, const struct xrt_pose *b, float
 void
 math_pose_transform(const struct xrt_pose *transform, const struct xrt_pose *pose, struct xrt_pose *outPose);
 
+/*!
+ * Apply the same rigid-body transformation to @p count poses, the result
+ * matches calling @ref math_pose_transform on each pose. Uses SSE2 or NEON
+ * when available, meant for hand and body joint arrays.
+ *
+ * OK if @p poses and @p out_poses are the same array, but they must not
+ * otherwise overlap. The transform orientation must be normalized.
+ *
+ * @relates xrt_pose
+ * @ingroup aux_math
+ */
+void
+math_pose_transform_batch(const struct xrt_pose *transform,
+                          const struct xrt_pose *poses,
+                          struct xrt_pose *out_poses,
+                          uint32_t count);
+
 /*!
  * Apply a rigid-body transformation to a point.
  *
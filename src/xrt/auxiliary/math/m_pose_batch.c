@@ -0,0 +1,224 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Batched pose transform kernels.
+ *
+ * The transform is the same for every pose in the batch, so it is turned into
+ * a 3x3 rotation matrix for the positions and a 4x4 left multiplication matrix
+ * for the orientations once. After that every pose is two matrix-vector
+ * products, which map directly onto 4-wide vector registers without having to
+ * shuffle the poses into a structure of arrays first.
+ *
+ * @ingroup aux_math
+ */
+
+#include "math/m_api.h"
+
+#include <assert.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define M_POSE_BATCH_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define M_POSE_BATCH_NEON
+#include <arm_neon.h>
+#endif
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+/*!
+ * Columns of the matrices the transform is turned into, padded to four floats
+ * so each column is one vector register.
+ */
+struct transform_matrices
+{
+	//! Rotation matrix columns, last element is zero.
+	float rot[3][4];
+
+	//! Translation, last element is zero.
+	float pos[4];
+
+	//! Columns of the matrix doing `q_transform * q`, in x, y, z, w order.
+	float quat[4][4];
+};
+
+static void
+make_matrices(const struct xrt_pose *transform, struct transform_matrices *m)
+{
+	const float x = transform->orientation.x;
+	const float y = transform->orientation.y;
+	const float z = transform->orientation.z;
+	const float w = transform->orientation.w;
+
+	// Same as Eigen's toRotationMatrix, assumes a unit quaternion.
+	const float tx = 2.0f * x;
+	const float ty = 2.0f * y;
+	const float tz = 2.0f * z;
+	const float twx = tx * w;
+	const float twy = ty * w;
+	const float twz = tz * w;
+	const float txx = tx * x;
+	const float txy = ty * x;
+	const float txz = tz * x;
+	const float tyy = ty * y;
+	const float tyz = tz * y;
+	const float tzz = tz * z;
+
+	// clang-format off
+	m->rot[0][0] = 1.0f - (tyy + tzz); m->rot[0][1] = txy + twz;          m->rot[0][2] = txz - twy;          m->rot[0][3] = 0.0f;
+	m->rot[1][0] = txy - twz;          m->rot[1][1] = 1.0f - (txx + tzz); m->rot[1][2] = tyz + twx;          m->rot[1][3] = 0.0f;
+	m->rot[2][0] = txz + twy;          m->rot[2][1] = tyz - twx;          m->rot[2][2] = 1.0f - (txx + tyy); m->rot[2][3] = 0.0f;
+
+	m->pos[0] = transform->position.x;
+	m->pos[1] = transform->position.y;
+	m->pos[2] = transform->position.z;
+	m->pos[3] = 0.0f;
+
+	// Hamilton product a * b written as the columns multiplied by b.x, b.y, b.z and b.w.
+	m->quat[0][0] =  w; m->quat[0][1] =  z; m->quat[0][2] = -y; m->quat[0][3] = -x;
+	m->quat[1][0] = -z; m->quat[1][1] =  w; m->quat[1][2] =  x; m->quat[1][3] = -y;
+	m->quat[2][0] =  y; m->quat[2][1] = -x; m->quat[2][2] =  w; m->quat[2][3] = -z;
+	m->quat[3][0] =  x; m->quat[3][1] =  y; m->quat[3][2] =  z; m->quat[3][3] =  w;
+	// clang-format on
+}
+
+
+/*
+ *
+ * Kernels.
+ *
+ */
+
+#if defined(M_POSE_BATCH_SSE2)
+
+static void
+transform_batch(const struct transform_matrices *m, const struct xrt_pose *poses, struct xrt_pose *out, uint32_t count)
+{
+	const __m128 r0 = _mm_loadu_ps(m->rot[0]);
+	const __m128 r1 = _mm_loadu_ps(m->rot[1]);
+	const __m128 r2 = _mm_loadu_ps(m->rot[2]);
+	const __m128 t = _mm_loadu_ps(m->pos);
+	const __m128 q0 = _mm_loadu_ps(m->quat[0]);
+	const __m128 q1 = _mm_loadu_ps(m->quat[1]);
+	const __m128 q2 = _mm_loadu_ps(m->quat[2]);
+	const __m128 q3 = _mm_loadu_ps(m->quat[3]);
+
+	for (uint32_t i = 0; i < count; i++) {
+		// Orientation is the first four floats of the pose.
+		const __m128 q = _mm_loadu_ps(&poses[i].orientation.x);
+
+		__m128 o = _mm_mul_ps(q0, _mm_shuffle_ps(q, q, _MM_SHUFFLE(0, 0, 0, 0)));
+		o = _mm_add_ps(o, _mm_mul_ps(q1, _mm_shuffle_ps(q, q, _MM_SHUFFLE(1, 1, 1, 1))));
+		o = _mm_add_ps(o, _mm_mul_ps(q2, _mm_shuffle_ps(q, q, _MM_SHUFFLE(2, 2, 2, 2))));
+		o = _mm_add_ps(o, _mm_mul_ps(q3, _mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 3, 3, 3))));
+
+		__m128 p = _mm_add_ps(t, _mm_mul_ps(r0, _mm_set1_ps(poses[i].position.x)));
+		p = _mm_add_ps(p, _mm_mul_ps(r1, _mm_set1_ps(poses[i].position.y)));
+		p = _mm_add_ps(p, _mm_mul_ps(r2, _mm_set1_ps(poses[i].position.z)));
+
+		// Position is only three floats, storing four would run into the next pose.
+		_mm_storeu_ps(&out[i].orientation.x, o);
+		_mm_storel_pi((__m64 *)&out[i].position.x, p);
+		_mm_store_ss(&out[i].position.z, _mm_movehl_ps(p, p));
+	}
+}
+
+#elif defined(M_POSE_BATCH_NEON)
+
+static void
+transform_batch(const struct transform_matrices *m, const struct xrt_pose *poses, struct xrt_pose *out, uint32_t count)
+{
+	const float32x4_t r0 = vld1q_f32(m->rot[0]);
+	const float32x4_t r1 = vld1q_f32(m->rot[1]);
+	const float32x4_t r2 = vld1q_f32(m->rot[2]);
+	const float32x4_t t = vld1q_f32(m->pos);
+	const float32x4_t q0 = vld1q_f32(m->quat[0]);
+	const float32x4_t q1 = vld1q_f32(m->quat[1]);
+	const float32x4_t q2 = vld1q_f32(m->quat[2]);
+	const float32x4_t q3 = vld1q_f32(m->quat[3]);
+
+	for (uint32_t i = 0; i < count; i++) {
+		const float32x4_t q = vld1q_f32(&poses[i].orientation.x);
+
+		float32x4_t o = vmulq_n_f32(q0, vgetq_lane_f32(q, 0));
+		o = vmlaq_n_f32(o, q1, vgetq_lane_f32(q, 1));
+		o = vmlaq_n_f32(o, q2, vgetq_lane_f32(q, 2));
+		o = vmlaq_n_f32(o, q3, vgetq_lane_f32(q, 3));
+
+		float32x4_t p = vmlaq_n_f32(t, r0, poses[i].position.x);
+		p = vmlaq_n_f32(p, r1, poses[i].position.y);
+		p = vmlaq_n_f32(p, r2, poses[i].position.z);
+
+		// Position is only three floats, storing four would run into the next pose.
+		vst1q_f32(&out[i].orientation.x, o);
+		vst1_f32(&out[i].position.x, vget_low_f32(p));
+		vst1q_lane_f32(&out[i].position.z, p, 2);
+	}
+}
+
+#else
+
+static void
+transform_batch(const struct transform_matrices *m, const struct xrt_pose *poses, struct xrt_pose *out, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		const float q[4] = {
+		    poses[i].orientation.x,
+		    poses[i].orientation.y,
+		    poses[i].orientation.z,
+		    poses[i].orientation.w,
+		};
+		const float p[3] = {
+		    poses[i].position.x,
+		    poses[i].position.y,
+		    poses[i].position.z,
+		};
+
+		float o[4];
+		float r[3];
+		for (int k = 0; k < 4; k++) {
+			o[k] = m->quat[0][k] * q[0] + m->quat[1][k] * q[1] + m->quat[2][k] * q[2] + m->quat[3][k] * q[3];
+		}
+		for (int k = 0; k < 3; k++) {
+			r[k] = m->pos[k] + m->rot[0][k] * p[0] + m->rot[1][k] * p[1] + m->rot[2][k] * p[2];
+		}
+
+		out[i].orientation.x = o[0];
+		out[i].orientation.y = o[1];
+		out[i].orientation.z = o[2];
+		out[i].orientation.w = o[3];
+		out[i].position.x = r[0];
+		out[i].position.y = r[1];
+		out[i].position.z = r[2];
+	}
+}
+
+#endif
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+void
+math_pose_transform_batch(const struct xrt_pose *transform,
+                          const struct xrt_pose *poses,
+                          struct xrt_pose *out_poses,
+                          uint32_t count)
+{
+	assert(transform != NULL);
+	assert(count == 0 || (poses != NULL && out_poses != NULL));
+
+	struct transform_matrices m;
+	make_matrices(transform, &m);
+
+	transform_batch(&m, poses, out_poses, count);
+}
@@ -20,7 +20,6 @@
 #include "util/u_trace_marker.h"
 #include "xrt/xrt_defines.h"
 #include "os/os_threading.h"
-#include "util/u_template_historybuf.hpp"
 
 #include <memory>
 #include <algorithm>
@@ -30,8 +29,8 @@
 #include <stdint.h>
 #include <assert.h>
 #include <mutex>
+#include <atomic>
 
-using namespace xrt::auxiliary::util;
 namespace os = xrt::auxiliary::os;
 
 struct relation_history_entry
@@ -40,19 +39,315 @@ struct relation_history_entry
 	int64_t timestamp;
 };
 
-static constexpr size_t BufLen = 4096;
+//! Must be a power of two.
+static constexpr uint32_t BufLen = 4096;
+static constexpr uint32_t BufMask = BufLen - 1;
 
+//! How many entries back from the newest to look before doing a binary search.
+static constexpr uint32_t NearNewestScan = 8;
+
+//! How many times a reader retries before taking the writer lock.
+static constexpr uint32_t MaxReadTries = 64;
+
+//! How many histories can have their sequence counter in @ref seq_slots.
+static constexpr uint32_t SeqSlotCount = 256;
+
+//! Marks a history that didn't get a slot in @ref seq_slots.
+static constexpr uint32_t NoSeqSlot = UINT32_MAX;
+
+/*!
+ * The sequence counters of the histories live here instead of in the history,
+ * so that a @ref m_relation_history_read_set can check them after the history
+ * has been destroyed. A released slot keeps counting, so a read set that
+ * refers to a previous user of the slot is never current.
+ */
+struct alignas(64) seq_slot
+{
+	std::atomic<uint32_t> seq{0};
+	bool used{false};
+};
+
+static seq_slot seq_slots[SeqSlotCount];
+static os::Mutex seq_slots_mutex;
+
+//! The read set of this thread, if any, see @ref m_relation_history_read_set_begin.
+static thread_local struct m_relation_history_read_set *tl_read_set = nullptr;
+
+/*!
+ * The history is a ring of entries written by one writer at a time, pushes
+ * and clears are serialised with @ref writer_mutex. Readers don't take any
+ * lock, instead @ref seq is used as a sequence lock: it is odd while a writer
+ * is modifying the ring, readers copy out what they need and retry if it was
+ * odd or changed while they were reading.
+ */
 struct m_relation_history
 {
-	HistoryBuffer<struct relation_history_entry, BufLen> impl;
-	mutable os::Mutex mutex;
+	//! The entries, the oldest is at `(head - count) & BufMask`.
+	struct relation_history_entry entries[BufLen];
+
+	//! Total number of pushed entries, the next entry is written at `head & BufMask`.
+	uint64_t head;
+
+	//! Number of valid entries.
+	uint32_t count;
+
+	//! Sequence counter, odd while a writer is modifying the ring, points into @ref seq_slots or at @ref own_seq.
+	std::atomic<uint32_t> *seq;
+
+	//! Used if all of @ref seq_slots were taken.
+	std::atomic<uint32_t> own_seq;
+
+	//! Index into @ref seq_slots or @ref NoSeqSlot.
+	uint32_t slot;
+
+	//! Serialises writers, also taken by readers that fail to get a consistent read.
+	mutable os::Mutex writer_mutex;
+};
+
+/*!
+ * What @ref read_lookup found, filled in from a consistent read.
+ */
+struct relation_history_lookup
+{
+	enum m_relation_history_result result;
+
+	//! Only valid for @ref M_RELATION_HISTORY_RESULT_INTERPOLATED.
+	struct relation_history_entry predecessor;
+
+	//! The entry used for all results but invalid.
+	struct relation_history_entry successor;
 };
 
 
+/*
+ *
+ * Helpers.
+ *
+ */
+
+static inline const struct relation_history_entry &
+entry_at(const struct m_relation_history *rh, uint64_t head, uint32_t count, uint32_t index)
+{
+	return rh->entries[(head - count + index) & BufMask];
+}
+
+static inline void
+write_begin(struct m_relation_history *rh)
+{
+	rh->seq->store(rh->seq->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+static inline void
+write_end(struct m_relation_history *rh)
+{
+	rh->seq->store(rh->seq->load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+static void
+read_set_add(struct m_relation_history_read_set *set, uint32_t slot, uint32_t generation)
+{
+	for (uint32_t i = 0; i < set->count; i++) {
+		if (set->slots[i] == slot) {
+			// Keep the oldest, if it changed in between the set is stale anyway.
+			return;
+		}
+	}
+
+	if (set->count >= M_RELATION_HISTORY_READ_SET_SIZE) {
+		set->untracked = true;
+		return;
+	}
+
+	set->slots[set->count] = slot;
+	set->generations[set->count] = generation;
+	set->count++;
+}
+
+/*!
+ * Records a read of @p rh in the read set of this thread, done before the read
+ * so that a push during the read makes the set stale.
+ */
+static inline void
+track_read(const struct m_relation_history *rh)
+{
+	struct m_relation_history_read_set *set = tl_read_set;
+	if (set == nullptr) {
+		return;
+	}
+
+	if (rh->slot == NoSeqSlot) {
+		set->untracked = true;
+		return;
+	}
+
+	read_set_add(set, rh->slot, rh->seq->load(std::memory_order_acquire));
+}
+
+/*!
+ * Calls @p func until it has been done on a consistent view of the ring, the
+ * function must only read from the ring and tolerate garbage data, since its
+ * result is thrown away if a writer was active. Falls back to taking the
+ * writer lock if it keeps on failing.
+ */
+template <typename Func>
+static void
+read_consistent(const struct m_relation_history *rh, Func &&func)
+{
+	for (uint32_t i = 0; i < MaxReadTries; i++) {
+		uint32_t before = rh->seq->load(std::memory_order_acquire);
+		if ((before & 1) != 0) {
+			continue; // A writer is active.
+		}
+
+		func();
+
+		// Make sure all of the reads in func are done before checking.
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (rh->seq->load(std::memory_order_relaxed) == before) {
+			return;
+		}
+	}
+
+	std::unique_lock<os::Mutex> lock(rh->writer_mutex);
+	func();
+}
+
+/*!
+ * Finds the first entry not older than @p at_timestamp_ns, same as a
+ * std::lower_bound but first looks at the few newest entries since that is
+ * where almost all queries land. Returns @p count if all entries are older.
+ */
+static uint32_t
+find_lower_bound(const struct m_relation_history *rh, uint64_t head, uint32_t count, int64_t at_timestamp_ns)
+{
+	uint32_t index = count;
+	uint32_t scan_end = count > NearNewestScan ? count - NearNewestScan : 0;
+
+	while (index > scan_end && entry_at(rh, head, count, index - 1).timestamp >= at_timestamp_ns) {
+		index--;
+	}
+
+	if (index > scan_end || index == 0) {
+		return index;
+	}
+
+	// Not in the newest entries, binary search the rest.
+	uint32_t low = 0;
+	uint32_t high = index;
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		if (entry_at(rh, head, count, mid).timestamp < at_timestamp_ns) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+static void
+read_lookup(const struct m_relation_history *rh, int64_t at_timestamp_ns, struct relation_history_lookup *out_lookup)
+{
+	uint64_t head = rh->head;
+	uint32_t count = rh->count;
+
+	if (count == 0) {
+		out_lookup->result = M_RELATION_HISTORY_RESULT_INVALID;
+		return;
+	}
+
+	uint32_t index = find_lower_bound(rh, head, count, at_timestamp_ns);
+
+	if (index == count) {
+		// The desired timestamp is after what our buffer contains.
+		out_lookup->result = M_RELATION_HISTORY_RESULT_PREDICTED;
+		out_lookup->successor = entry_at(rh, head, count, count - 1);
+		return;
+	}
+
+	out_lookup->successor = entry_at(rh, head, count, index);
+
+	if (out_lookup->successor.timestamp == at_timestamp_ns) {
+		out_lookup->result = M_RELATION_HISTORY_RESULT_EXACT;
+	} else if (index == 0) {
+		// The desired timestamp is before what our buffer contains.
+		out_lookup->result = M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED;
+	} else {
+		out_lookup->result = M_RELATION_HISTORY_RESULT_INTERPOLATED;
+		out_lookup->predecessor = entry_at(rh, head, count, index - 1);
+	}
+}
+
+static void
+interpolate(const struct relation_history_entry &predecessor,
+            const struct relation_history_entry &successor,
+            int64_t at_timestamp_ns,
+            struct xrt_space_relation *out_relation)
+{
+	int64_t diff_before = at_timestamp_ns - predecessor.timestamp;
+	int64_t diff_after = successor.timestamp - at_timestamp_ns;
+
+	float amount_to_lerp = (float)diff_before / (float)(diff_before + diff_after);
+
+	// Copy intersection of relation flags
+	xrt_space_relation result{};
+	result.relation_flags =
+	    (enum xrt_space_relation_flags)(predecessor.relation.relation_flags & successor.relation.relation_flags);
+	// First-order implementation - lerp between the before and after
+	if (0 != (result.relation_flags & XRT_SPACE_RELATION_POSITION_VALID_BIT)) {
+		result.pose.position =
+		    m_vec3_lerp(predecessor.relation.pose.position, successor.relation.pose.position, amount_to_lerp);
+	}
+	if (0 != (result.relation_flags & XRT_SPACE_RELATION_ORIENTATION_VALID_BIT)) {
+
+		math_quat_slerp(&predecessor.relation.pose.orientation, &successor.relation.pose.orientation,
+		                amount_to_lerp, &result.pose.orientation);
+	}
+
+	//! @todo Does interpolating the velocities make any sense?
+	if (0 != (result.relation_flags & XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT)) {
+		result.angular_velocity = m_vec3_lerp(predecessor.relation.angular_velocity,
+		                                      successor.relation.angular_velocity, amount_to_lerp);
+	}
+	if (0 != (result.relation_flags & XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT)) {
+		result.linear_velocity = m_vec3_lerp(predecessor.relation.linear_velocity,
+		                                     successor.relation.linear_velocity, amount_to_lerp);
+	}
+	*out_relation = result;
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
 void
 m_relation_history_create(struct m_relation_history **rh_ptr)
 {
 	auto ret = std::make_unique<m_relation_history>();
+	ret->head = 0;
+	ret->count = 0;
+	ret->own_seq.store(0);
+	ret->seq = &ret->own_seq;
+	ret->slot = NoSeqSlot;
+
+	{
+		std::unique_lock<os::Mutex> lock(seq_slots_mutex);
+		for (uint32_t i = 0; i < SeqSlotCount; i++) {
+			if (!seq_slots[i].used) {
+				seq_slots[i].used = true;
+				ret->seq = &seq_slots[i].seq;
+				ret->slot = i;
+				break;
+			}
+		}
+	}
+
 	*rh_ptr = ret.release();
 }
 
@@ -60,24 +355,27 @@ bool
 m_relation_history_push(struct m_relation_history *rh, struct xrt_space_relation const *in_relation, int64_t timestamp)
 {
 	XRT_TRACE_MARKER();
-	struct relation_history_entry rhe;
+	std::unique_lock<os::Mutex> lock(rh->writer_mutex);
+
+	// Everything explodes if the timestamps in relation_history aren't monotonically increasing. If we get a
+	// timestamp that's before the most recent timestamp in the buffer, don't put it in the history.
+	if (rh->count > 0 && timestamp <= entry_at(rh, rh->head, rh->count, rh->count - 1).timestamp) {
+		return false;
+	}
+
+	write_begin(rh);
+
+	struct relation_history_entry &rhe = rh->entries[rh->head & BufMask];
 	rhe.relation = *in_relation;
 	rhe.timestamp = timestamp;
-	bool ret = false;
-	std::unique_lock<os::Mutex> lock(rh->mutex);
-	try {
-		// if we aren't empty, we can compare against the latest timestamp.
-		if (rh->impl.empty() || rhe.timestamp > rh->impl.back().timestamp) {
-			// Everything explodes if the timestamps in relation_history aren't monotonically increasing. If
-			// we get a timestamp that's before the most recent timestamp in the buffer, don't put it
-			// in the history.
-			rh->impl.push_back(rhe);
-			ret = true;
-		}
-	} catch (std::exception const &e) {
-		U_LOG_E("Caught exception: %s", e.what());
+	rh->head++;
+	if (rh->count < BufLen) {
+		rh->count++;
 	}
-	return ret;
+
+	write_end(rh);
+
+	return true;
 }
 
 enum m_relation_history_result
@@ -86,98 +384,46 @@ m_relation_history_get(const struct m_relation_history *rh,
                        struct xrt_space_relation *out_relation)
 {
 	XRT_TRACE_MARKER();
-	std::unique_lock<os::Mutex> lock(rh->mutex);
-	try {
-		if (rh->impl.empty() || at_timestamp_ns == 0) {
-			// Do nothing. You push nothing to the buffer you get nothing from the buffer.
-			*out_relation = {};
-			return M_RELATION_HISTORY_RESULT_INVALID;
-		}
-		const auto b = rh->impl.begin();
-		const auto e = rh->impl.end();
-
-		// Find the first element *not less than* our value. the lambda we pass is the comparison
-		// function, to compare against timestamps.
-		const auto it =
-		    std::lower_bound(b, e, at_timestamp_ns, [](const relation_history_entry &rhe, int64_t timestamp) {
-			    return rhe.timestamp < timestamp;
-		    });
-
-		if (it == e) {
-			// lower bound is at the end:
-			// The desired timestamp is after what our buffer contains.
-			// (pose-prediction)
-			// Output flags match the most recent buffer entry.
-			int64_t diff_prediction_ns = static_cast<int64_t>(at_timestamp_ns) - rh->impl.back().timestamp;
-			double delta_s = time_ns_to_s(diff_prediction_ns);
-
-			U_LOG_T("Extrapolating %f s past the back of the buffer!", delta_s);
-
-			m_predict_relation(&rh->impl.back().relation, delta_s, out_relation);
-			return M_RELATION_HISTORY_RESULT_PREDICTED;
-		}
-		if (at_timestamp_ns == it->timestamp) {
-			// exact match:
-			// Flags copied directly along with everything else.
-			U_LOG_T("Exact match in the buffer!");
-			*out_relation = it->relation;
-			return M_RELATION_HISTORY_RESULT_EXACT;
-		}
-		if (it == b) {
-			// lower bound is at the beginning (and it's not an exact match):
-			// The desired timestamp is before what our buffer contains.
-			// (an edge case where somebody asks for a really old pose and we do our best)
-			// Output flags are the same as the input flags for the history entry we use
-			int64_t diff_prediction_ns = static_cast<int64_t>(at_timestamp_ns) - rh->impl.front().timestamp;
-			double delta_s = time_ns_to_s(diff_prediction_ns);
-			U_LOG_T("Extrapolating %f s before the front of the buffer!", delta_s);
-			m_predict_relation(&rh->impl.front().relation, delta_s, out_relation);
-			return M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED;
-		}
-		U_LOG_T("Interpolating within buffer!");
 
-		// We precede *it and follow *(it - 1) (which we know exists because we already handled
-		// the it = begin() case)
-		const auto &predecessor = *(it - 1);
-		const auto &successor = *it;
-
-		// Do the thing.
-		int64_t diff_before = static_cast<int64_t>(at_timestamp_ns) - predecessor.timestamp;
-		int64_t diff_after = static_cast<int64_t>(successor.timestamp) - at_timestamp_ns;
-
-		float amount_to_lerp = (float)diff_before / (float)(diff_before + diff_after);
-
-		// Copy intersection of relation flags
-		xrt_space_relation result{};
-		result.relation_flags = (enum xrt_space_relation_flags)(predecessor.relation.relation_flags &
-		                                                        successor.relation.relation_flags);
-		// First-order implementation - lerp between the before and after
-		if (0 != (result.relation_flags & XRT_SPACE_RELATION_POSITION_VALID_BIT)) {
-			result.pose.position = m_vec3_lerp(predecessor.relation.pose.position,
-			                                   successor.relation.pose.position, amount_to_lerp);
-		}
-		if (0 != (result.relation_flags & XRT_SPACE_RELATION_ORIENTATION_VALID_BIT)) {
-
-			math_quat_slerp(&predecessor.relation.pose.orientation, &successor.relation.pose.orientation,
-			                amount_to_lerp, &result.pose.orientation);
-		}
-
-		//! @todo Does interpolating the velocities make any sense?
-		if (0 != (result.relation_flags & XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT)) {
-			result.angular_velocity = m_vec3_lerp(predecessor.relation.angular_velocity,
-			                                      successor.relation.angular_velocity, amount_to_lerp);
-		}
-		if (0 != (result.relation_flags & XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT)) {
-			result.linear_velocity = m_vec3_lerp(predecessor.relation.linear_velocity,
-			                                     successor.relation.linear_velocity, amount_to_lerp);
-		}
-		*out_relation = result;
-		return M_RELATION_HISTORY_RESULT_INTERPOLATED;
-
-	} catch (std::exception const &e) {
-		U_LOG_E("Caught exception: %s", e.what());
+	if (at_timestamp_ns == 0) {
+		*out_relation = {};
 		return M_RELATION_HISTORY_RESULT_INVALID;
 	}
+
+	track_read(rh);
+
+	// Only copy out the entries needed, the math is done without holding anything.
+	struct relation_history_lookup lookup;
+	read_consistent(rh, [&] { read_lookup(rh, at_timestamp_ns, &lookup); });
+
+	switch (lookup.result) {
+	case M_RELATION_HISTORY_RESULT_INVALID:
+		// Do nothing. You push nothing to the buffer you get nothing from the buffer.
+		*out_relation = {};
+		break;
+	case M_RELATION_HISTORY_RESULT_EXACT:
+		// Flags copied directly along with everything else.
+		U_LOG_T("Exact match in the buffer!");
+		*out_relation = lookup.successor.relation;
+		break;
+	case M_RELATION_HISTORY_RESULT_PREDICTED:
+	case M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED: {
+		// Output flags are the same as the input flags for the history entry we use.
+		int64_t diff_prediction_ns = at_timestamp_ns - lookup.successor.timestamp;
+		double delta_s = time_ns_to_s(diff_prediction_ns);
+
+		U_LOG_T("Extrapolating %f s from the %s of the buffer!", delta_s,
+		        lookup.result == M_RELATION_HISTORY_RESULT_PREDICTED ? "back" : "front");
+
+		m_predict_relation(&lookup.successor.relation, delta_s, out_relation);
+	} break;
+	case M_RELATION_HISTORY_RESULT_INTERPOLATED:
+		U_LOG_T("Interpolating within buffer!");
+		interpolate(lookup.predecessor, lookup.successor, at_timestamp_ns, out_relation);
+		break;
+	}
+
+	return lookup.result;
 }
 
 bool
@@ -232,27 +478,89 @@ m_relation_history_get_latest(const struct m_relation_history *rh,
                               int64_t *out_time_ns,
                               struct xrt_space_relation *out_relation)
 {
-	std::unique_lock<os::Mutex> lock(rh->mutex);
-	if (rh->impl.empty()) {
+	struct relation_history_entry latest = {};
+	uint32_t count = 0;
+
+	track_read(rh);
+
+	read_consistent(rh, [&] {
+		count = rh->count;
+		if (count > 0) {
+			latest = entry_at(rh, rh->head, count, count - 1);
+		}
+	});
+
+	if (count == 0) {
 		return false;
 	}
-	*out_relation = rh->impl.back().relation;
-	*out_time_ns = rh->impl.back().timestamp;
+
+	*out_relation = latest.relation;
+	*out_time_ns = latest.timestamp;
 	return true;
 }
 
 uint32_t
 m_relation_history_get_size(const struct m_relation_history *rh)
 {
-	std::unique_lock<os::Mutex> lock(rh->mutex);
-	return (uint32_t)rh->impl.size();
+	uint32_t count = 0;
+	track_read(rh);
+	read_consistent(rh, [&] { count = rh->count; });
+	return count;
 }
 
 void
 m_relation_history_clear(struct m_relation_history *rh)
 {
-	std::unique_lock<os::Mutex> lock(rh->mutex);
-	rh->impl.clear();
+	std::unique_lock<os::Mutex> lock(rh->writer_mutex);
+
+	write_begin(rh);
+	rh->count = 0;
+	write_end(rh);
+}
+
+void
+m_relation_history_read_set_begin(struct m_relation_history_read_set *set)
+{
+	set->count = 0;
+	set->untracked = false;
+	set->prev = tl_read_set;
+	tl_read_set = set;
+}
+
+void
+m_relation_history_read_set_end(struct m_relation_history_read_set *set)
+{
+	assert(tl_read_set == set);
+	tl_read_set = set->prev;
+
+	// Reads done in a nested set were also done in the outer one.
+	struct m_relation_history_read_set *outer = set->prev;
+	set->prev = nullptr;
+	if (outer == nullptr) {
+		return;
+	}
+
+	outer->untracked |= set->untracked;
+	for (uint32_t i = 0; i < set->count; i++) {
+		read_set_add(outer, set->slots[i], set->generations[i]);
+	}
+}
+
+bool
+m_relation_history_read_set_is_current(const struct m_relation_history_read_set *set)
+{
+	if (set->untracked) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < set->count; i++) {
+		uint32_t generation = seq_slots[set->slots[i]].seq.load(std::memory_order_acquire);
+		if (generation != set->generations[i] || (generation & 1) != 0) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
 void
@@ -263,6 +571,15 @@ m_relation_history_destroy(struct m_relation_history **rh_ptr)
 		// Do nothing, it's likely already been destroyed
 		return;
 	}
+	if (rh->slot != NoSeqSlot) {
+		std::unique_lock<os::Mutex> lock(seq_slots_mutex);
+		seq_slot &slot = seq_slots[rh->slot];
+
+		// Keep counting so read sets that refer to this history are stale.
+		slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 2, std::memory_order_release);
+		slot.used = false;
+	}
+
 	try {
 		delete rh;
 	} catch (std::exception const &e) {
@@ -20,9 +20,10 @@ extern "C" {
 /**
  * @brief Opaque type for storing the history of a space relation in a ring buffer
  *
- * @note Unlike the bare C++ data structure @ref HistoryBuffer this wraps, **this is a thread safe interface**,
- * and is safe for concurrent access from multiple threads.
- * (It is using a simple mutex, not a reader/writer lock, but that is fine until proven to be a bottleneck.)
+ * @note **This is a thread safe interface**, and is safe for concurrent access from multiple threads. Writers are
+ * serialised by a mutex, while readers never block on it in the common case: they use a sequence lock and only copy
+ * out the entries they need, so a driver pushing samples doesn't contend with threads querying the history. Queries
+ * near the newest sample, the common case, don't need to search the whole history.
  *
  * @ingroup aux_util
  */
@@ -123,6 +124,53 @@ m_relation_history_get_size(const struct m_relation_history *rh);
 void
 m_relation_history_clear(struct m_relation_history *rh);
 
+/*!
+ * Maximum number of distinct histories a @ref m_relation_history_read_set
+ * keeps track of.
+ */
+#define M_RELATION_HISTORY_READ_SET_SIZE 8
+
+/*!
+ * The histories read by a thread between @ref m_relation_history_read_set_begin
+ * and @ref m_relation_history_read_set_end, along with their generations at the
+ * time of the read. Lets a cache of relations computed from relation histories,
+ * for instance a device's @ref xrt_device::get_tracked_pose, find out if any of
+ * the histories it used has changed since, without touching the others.
+ */
+struct m_relation_history_read_set
+{
+	//! Number of valid elements in @ref slots and @ref generations.
+	uint32_t count;
+
+	//! Some read could not be tracked, the set is never current.
+	bool untracked;
+
+	uint32_t slots[M_RELATION_HISTORY_READ_SET_SIZE];
+	uint32_t generations[M_RELATION_HISTORY_READ_SET_SIZE];
+
+	//! Set that was active when this one began, internal.
+	struct m_relation_history_read_set *prev;
+};
+
+/*!
+ * Starts recording the histories read by this thread into @p set, sets nest.
+ */
+void
+m_relation_history_read_set_begin(struct m_relation_history_read_set *set);
+
+/*!
+ * Stops recording into @p set, the reads are also added to the enclosing set.
+ */
+void
+m_relation_history_read_set_end(struct m_relation_history_read_set *set);
+
+/*!
+ * Have none of the histories in @p set been pushed to or cleared since they
+ * were read, safe to call after the histories have been destroyed.
+ */
+bool
+m_relation_history_read_set_is_current(const struct m_relation_history_read_set *set);
+
 /*!
  * Destroys an opaque relation_history object.
  *
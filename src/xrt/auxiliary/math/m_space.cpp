@@ -17,6 +17,8 @@
 #include <stdio.h>
 #include <assert.h>
 
+#include <algorithm>
+
 
 /*
  *
@@ -125,32 +127,25 @@ make_valid_pose(flags flags, const struct xrt_pose *in_pose, struct xrt_pose *ou
 	}
 }
 
+/*!
+ * Everything but the pose transform of @ref apply_relation, @p pose is the
+ * already transformed @p body_pose, so the pose can be computed in batches.
+ */
 static void
-apply_relation(const struct xrt_space_relation *a,
-               const struct xrt_space_relation *b,
-               struct xrt_space_relation *out_relation)
+apply_relation_with_pose(const struct xrt_space_relation *a,
+                         const struct xrt_space_relation *b,
+                         const struct xrt_pose &body_pose,
+                         const struct xrt_pose &base_pose,
+                         const struct xrt_pose &pose,
+                         struct xrt_space_relation *out_relation)
 {
 	flags af = get_flags(a);
 	flags bf = get_flags(b);
 
-	struct xrt_pose pose = XRT_POSE_IDENTITY;
 	struct xrt_vec3 linear_velocity = XRT_VEC3_ZERO;
 	struct xrt_vec3 angular_velocity = XRT_VEC3_ZERO;
 
 
-	/*
-	 * Pose.
-	 */
-
-	struct xrt_pose body_pose = XRT_POSE_IDENTITY; // aka valid_a_pose
-	struct xrt_pose base_pose = XRT_POSE_IDENTITY; // aka valid_b_pose
-
-	// If either orientation or position component is not valid, make that component identity so that transforms
-	// work. The flags of the result are determined in nf and not taken from the result of the transform.
-	make_valid_pose(af, &a->pose, &body_pose);
-	make_valid_pose(bf, &b->pose, &base_pose);
-
-
 	// This is a band aid to make 3dof devices work until we have a real solution.
 	// A 3dof device may return a relation with only orientation valid/tracked and no position.
 	//
@@ -180,11 +175,6 @@ apply_relation(const struct xrt_space_relation *a,
 	nf.has_angular_velocity = af.has_angular_velocity && bf.has_angular_velocity;
 
 
-	// Not already valid poses needed to be made valid because the transoformed pose would be undefined otherwise
-	// and we still want e.g. valid positions.
-	math_pose_transform(&base_pose, &body_pose, &pose);
-
-
 	/*
 	 * Linear velocity.
 	 */
@@ -277,6 +267,27 @@ apply_relation(const struct xrt_space_relation *a,
 	*out_relation = tmp;
 }
 
+static void
+apply_relation(const struct xrt_space_relation *a,
+               const struct xrt_space_relation *b,
+               struct xrt_space_relation *out_relation)
+{
+	struct xrt_pose body_pose = XRT_POSE_IDENTITY; // aka valid_a_pose
+	struct xrt_pose base_pose = XRT_POSE_IDENTITY; // aka valid_b_pose
+	struct xrt_pose pose = XRT_POSE_IDENTITY;
+
+	// If either orientation or position component is not valid, make that component identity so that transforms
+	// work. The flags of the result are determined in nf and not taken from the result of the transform.
+	make_valid_pose(get_flags(a), &a->pose, &body_pose);
+	make_valid_pose(get_flags(b), &b->pose, &base_pose);
+
+	// Not already valid poses needed to be made valid because the transoformed pose would be undefined otherwise
+	// and we still want e.g. valid positions.
+	math_pose_transform(&base_pose, &body_pose, &pose);
+
+	apply_relation_with_pose(a, b, body_pose, base_pose, pose, out_relation);
+}
+
 
 /*
  *
@@ -311,6 +322,73 @@ m_relation_chain_resolve(const struct xrt_relation_chain *xrc, struct xrt_space_
 	*out_relation = r;
 }
 
+extern "C" void
+m_relation_chain_resolve_batch(const struct xrt_relation_chain *xrc,
+                               const struct xrt_space_relation *in_relations,
+                               uint32_t count,
+                               struct xrt_space_relation *out_relations)
+{
+	assert(count == 0 || (in_relations != NULL && out_relations != NULL));
+
+	const enum xrt_space_relation_flags pose_flags = (enum xrt_space_relation_flags)(
+	    XRT_SPACE_RELATION_POSITION_VALID_BIT | XRT_SPACE_RELATION_ORIENTATION_VALID_BIT);
+
+	// Nothing to apply, same as resolving a chain of just the relation.
+	if (xrc->step_count == 0) {
+		for (uint32_t i = 0; i < count; i++) {
+			if ((in_relations[i].relation_flags & pose_flags) == 0) {
+				out_relations[i] = XRT_SPACE_RELATION_ZERO;
+				continue;
+			}
+			out_relations[i] = in_relations[i];
+			math_quat_normalize(&out_relations[i].pose.orientation);
+		}
+		return;
+	}
+
+	// The chain is the same for all relations, flatten it once.
+	struct xrt_space_relation base = XRT_SPACE_RELATION_ZERO;
+	m_relation_chain_resolve(xrc, &base);
+	if ((base.relation_flags & pose_flags) == 0) {
+		for (uint32_t i = 0; i < count; i++) {
+			out_relations[i] = XRT_SPACE_RELATION_ZERO;
+		}
+		return;
+	}
+
+	struct xrt_pose base_pose = XRT_POSE_IDENTITY;
+	make_valid_pose(get_flags(&base), &base.pose, &base_pose);
+
+	// Chunked so the scratch space can live on the stack, fits a full hand in one go.
+	constexpr uint32_t chunk_size = 32;
+	struct xrt_pose body_poses[chunk_size];
+	struct xrt_pose poses[chunk_size];
+
+	for (uint32_t start = 0; start < count; start += chunk_size) {
+		const uint32_t num = std::min(count - start, chunk_size);
+		const struct xrt_space_relation *in = &in_relations[start];
+		struct xrt_space_relation *out = &out_relations[start];
+
+		for (uint32_t k = 0; k < num; k++) {
+			make_valid_pose(get_flags(&in[k]), &in[k].pose, &body_poses[k]);
+		}
+
+		math_pose_transform_batch(&base_pose, body_poses, poses, num);
+
+		for (uint32_t k = 0; k < num; k++) {
+			if ((in[k].relation_flags & pose_flags) == 0) {
+				out[k] = XRT_SPACE_RELATION_ZERO;
+				continue;
+			}
+
+			apply_relation_with_pose(&in[k], &base, body_poses[k], base_pose, poses[k], &out[k]);
+
+			// Ensure no errors have crept in.
+			math_quat_normalize(&out[k].pose.orientation);
+		}
+	}
+}
+
 extern "C" void
 m_space_relation_invert(struct xrt_space_relation *relation, struct xrt_space_relation *out_relation)
 {
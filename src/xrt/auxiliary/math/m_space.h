@@ -220,6 +220,23 @@ m_relation_chain_push_inverted_pose_if_not_identity(struct xrt_relation_chain *x
 void
 m_relation_chain_resolve(const struct xrt_relation_chain *xrc, struct xrt_space_relation *out_relation);
 
+/*!
+ * Resolve @p count relations through the same chain, the result for each is
+ * the same as pushing that relation first and then the steps of @p xrc, and
+ * resolving that. The chain is only flattened once and the poses are
+ * transformed with @ref math_pose_transform_batch, meant for joint arrays.
+ *
+ * The input chain is not modified, @p in_relations and @p out_relations may be
+ * the same array.
+ *
+ * @public @memberof xrt_relation_chain
+ */
+void
+m_relation_chain_resolve_batch(const struct xrt_relation_chain *xrc,
+                               const struct xrt_space_relation *in_relations,
+                               uint32_t count,
+                               struct xrt_space_relation *out_relations);
+
 /*!
  * @}
  */
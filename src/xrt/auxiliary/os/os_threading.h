@@ -32,6 +32,14 @@
 #error "OS not supported"
 #endif
 
+#if defined(XRT_OS_LINUX)
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define OS_HAVE_FUTEX
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -439,6 +447,61 @@ os_semaphore_destroy(struct os_semaphore *os)
 }
 
 
+/*
+ *
+ * Futex.
+ *
+ */
+
+#if defined(OS_HAVE_FUTEX) || defined(XRT_DOXYGEN)
+
+/*!
+ * Wait until woken with @ref os_futex_wake_all if @p word still holds
+ * @p expected, the word may live in memory shared between processes. Returns
+ * zero when woken, on a spurious wake up or if the word did not hold
+ * @p expected, so callers must check the word again in a loop. Returns
+ * -ETIMEDOUT when @p timeout_ns passed, a negative timeout waits forever.
+ *
+ * Only available when `OS_HAVE_FUTEX` is defined.
+ *
+ * @ingroup aux_os
+ */
+static inline int
+os_futex_wait(xrt_atomic_s32_t *word, int32_t expected, int64_t timeout_ns)
+{
+	struct timespec relative;
+	struct timespec *timeout = NULL;
+	if (timeout_ns >= 0) {
+		os_ns_to_timespec(timeout_ns, &relative);
+		timeout = &relative;
+	}
+
+	// Not the private variant, the word may be shared with another process.
+	long ret = syscall(SYS_futex, (int32_t *)word, FUTEX_WAIT, expected, timeout, NULL, 0);
+	if (ret < 0 && errno == ETIMEDOUT) {
+		return -ETIMEDOUT;
+	}
+
+	// EAGAIN (word changed) and EINTR are the same as being woken.
+	return 0;
+}
+
+/*!
+ * Wake all waiters on @p word, see @ref os_futex_wait.
+ *
+ * Only available when `OS_HAVE_FUTEX` is defined.
+ *
+ * @ingroup aux_os
+ */
+static inline void
+os_futex_wake_all(xrt_atomic_s32_t *word)
+{
+	syscall(SYS_futex, (int32_t *)word, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+}
+
+#endif
+
+
 /*
  *
  * Fancy helper.
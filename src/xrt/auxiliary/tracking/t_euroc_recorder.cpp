@@ -10,15 +10,20 @@
 #include "t_euroc_recorder.h"
 
 #include "os/os_time.h"
+#include "math/m_api.h"
 #include "util/u_frame.h"
+#include "util/u_frame_pool.h"
 #include "util/u_sink.h"
 #include "util/u_var.h"
 #include "util/u_debug.h"
+#include "util/u_worker.h"
 #include "xrt/xrt_defines.h"
 #include "xrt/xrt_tracking.h"
 
 #include <cassert>
+#include <cstring>
 #include <ctime>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <mutex>
@@ -29,7 +34,13 @@
 #include <opencv2/imgcodecs.hpp>
 
 DEBUG_GET_ONCE_BOOL_OPTION(euroc_recorder_use_jpg, "EUROC_RECORDER_USE_JPG", false)
+DEBUG_GET_ONCE_OPTION(euroc_recorder_image_format, "EUROC_RECORDER_IMAGE_FORMAT", "png")
+DEBUG_GET_ONCE_NUM_OPTION(euroc_recorder_threads, "EUROC_RECORDER_THREADS", 4)
 
+//! Frames being encoded or waiting to be encoded, over all cameras, above this frames are dropped.
+#define MAX_PENDING_FRAMES 48
+
+using std::deque;
 using std::lock_guard;
 using std::mutex;
 using std::ofstream;
@@ -39,6 +50,40 @@ using std::to_string;
 using std::vector;
 using std::filesystem::create_directories;
 
+//! Container and compression used for the saved images.
+enum euroc_recorder_image_format
+{
+	EUROC_RECORDER_IMAGE_FORMAT_PNG,       //!< PNG with the lowest compression level, fast to encode.
+	EUROC_RECORDER_IMAGE_FORMAT_PNG_SMALL, //!< PNG with a higher compression level, smaller but slower.
+	EUROC_RECORDER_IMAGE_FORMAT_JPG,       //!< Lossy JPG.
+	EUROC_RECORDER_IMAGE_FORMAT_RAW,       //!< Uncompressed binary PGM/PPM.
+};
+
+struct euroc_recorder;
+
+//! A single frame to be encoded on the pool, owned by the camera it was pushed to.
+struct euroc_recorder_job
+{
+	struct euroc_recorder *er;
+	struct xrt_frame *frame; //!< Reference released once encoded.
+	int cam_index;
+	uint64_t timestamp;
+	string filename; //!< Name written to the csv.
+	string img_path; //!< Full path of the image file.
+	bool done;       //!< Set when encoding has finished, protected by the camera lock.
+	bool ok;         //!< Whether the image was successfully written.
+};
+
+//! Per camera encoding state.
+struct euroc_recorder_cam
+{
+	//! Protects @ref pending and the camera csv stream.
+	mutex lock{};
+
+	//! Jobs in the order the frames were received, csv rows are emitted in this order.
+	deque<euroc_recorder_job *> pending{};
+};
+
 struct euroc_recorder
 {
 	struct xrt_frame_node node;
@@ -49,13 +94,24 @@ struct euroc_recorder
 	bool recording;                    //!< Whether samples are being recorded
 	struct u_var_button recording_btn; //!< UI button to start/stop `recording`
 
-	bool use_jpg; //! Whether or not we should save images as .jpg files
+	enum euroc_recorder_image_format image_format; //!< How images are encoded to disk.
+
+	// Encoding: frames are handed from the writer sinks to the pool, which
+	// encodes them and emits the csv rows in order.
+	struct u_worker_thread_pool *pool;
+	struct u_worker_group *group;
+	struct euroc_recorder_cam cams[XRT_TRACKING_MAX_SLAM_CAMS];
+
+	xrt_atomic_s32_t pending_frames; //!< Number of frames currently queued or being encoded.
+	xrt_atomic_s32_t encoded_frames; //!< Number of frames written to disk.
+	xrt_atomic_s32_t dropped_frames; //!< Number of frames dropped because the encoders couldn't keep up.
 
 	// Cloner sinks: copy frame to heap for quick release of the original
 	struct xrt_slam_sinks cloner_queues; //!< Queue sinks that write into cloner sinks
 	struct xrt_imu_sink cloner_imu_sink;
 	struct xrt_pose_sink cloner_gt_sink;
 	struct xrt_frame_sink cloner_sinks[XRT_TRACKING_MAX_SLAM_CAMS];
+	struct u_frame_pool *cloner_pool; //!< Clones are recycled through this
 
 	// Writer sinks: write copied frame to disk
 	struct xrt_slam_sinks writer_queues; //!< Queue sinks that write into writer sinks
@@ -149,6 +205,7 @@ euroc_recorder_flush(struct euroc_recorder *er)
 	er->imu_csv->flush();
 	er->gt_csv->flush();
 	for (int i = 0; i < er->cam_count; i++) {
+		lock_guard lock{er->cams[i].lock};
 		er->cams_csv[i]->flush();
 	}
 }
@@ -181,6 +238,120 @@ euroc_recorder_save_gt(xrt_pose_sink *sink, struct xrt_pose_sample *sample)
 	*er->gt_csv << o.w << "," << o.x << "," << o.y << "," << o.z << CSV_EOL;
 }
 
+static const char *
+euroc_recorder_image_format_str(enum euroc_recorder_image_format format)
+{
+	switch (format) {
+	case EUROC_RECORDER_IMAGE_FORMAT_PNG: return "png";
+	case EUROC_RECORDER_IMAGE_FORMAT_PNG_SMALL: return "png_small";
+	case EUROC_RECORDER_IMAGE_FORMAT_JPG: return "jpg";
+	case EUROC_RECORDER_IMAGE_FORMAT_RAW: return "raw";
+	default: return "unknown";
+	}
+}
+
+static enum euroc_recorder_image_format
+euroc_recorder_get_image_format()
+{
+	// Kept for compatibility.
+	if (debug_get_bool_option_euroc_recorder_use_jpg()) {
+		return EUROC_RECORDER_IMAGE_FORMAT_JPG;
+	}
+
+	const char *str = debug_get_option_euroc_recorder_image_format();
+	if (strcmp(str, "png") == 0) {
+		return EUROC_RECORDER_IMAGE_FORMAT_PNG;
+	}
+	if (strcmp(str, "png_small") == 0) {
+		return EUROC_RECORDER_IMAGE_FORMAT_PNG_SMALL;
+	}
+	if (strcmp(str, "jpg") == 0) {
+		return EUROC_RECORDER_IMAGE_FORMAT_JPG;
+	}
+	if (strcmp(str, "raw") == 0) {
+		return EUROC_RECORDER_IMAGE_FORMAT_RAW;
+	}
+
+	U_LOG_W("Unknown EUROC_RECORDER_IMAGE_FORMAT '%s', using png (valid: png, png_small, jpg, raw)", str);
+	return EUROC_RECORDER_IMAGE_FORMAT_PNG;
+}
+
+static const char *
+euroc_recorder_file_extension(enum euroc_recorder_image_format format, enum xrt_format frame_format)
+{
+	switch (format) {
+	case EUROC_RECORDER_IMAGE_FORMAT_JPG: return ".jpg";
+	case EUROC_RECORDER_IMAGE_FORMAT_RAW: return frame_format == XRT_FORMAT_L8 ? ".pgm" : ".ppm";
+	default: return ".png";
+	}
+}
+
+/*!
+ * Emits the csv rows of all finished jobs at the front of the camera queue, so
+ * rows come out in the order the frames were received regardless of which
+ * encoder finishes first.
+ */
+static void
+euroc_recorder_job_done(struct euroc_recorder_job *job, bool ok)
+{
+	euroc_recorder *er = job->er;
+	euroc_recorder_cam &cam = er->cams[job->cam_index];
+
+	lock_guard lock{cam.lock};
+
+	job->done = true;
+	job->ok = ok;
+
+	while (!cam.pending.empty() && cam.pending.front()->done) {
+		euroc_recorder_job *front = cam.pending.front();
+		cam.pending.pop_front();
+
+		if (front->ok) {
+			*er->cams_csv[front->cam_index] << front->timestamp << "," << front->filename << CSV_EOL;
+		}
+
+		delete front;
+	}
+}
+
+static void
+euroc_recorder_encode_task(void *ptr)
+{
+	euroc_recorder_job *job = (euroc_recorder_job *)ptr;
+	euroc_recorder *er = job->er;
+	xrt_frame *frame = job->frame;
+
+	auto img_type = frame->format == XRT_FORMAT_L8 ? CV_8UC1 : CV_8UC3;
+	cv::Mat img{(int)frame->height, (int)frame->width, img_type, frame->data, frame->stride};
+
+	vector<int> params;
+	if (er->image_format == EUROC_RECORDER_IMAGE_FORMAT_PNG) {
+		params = {cv::IMWRITE_PNG_COMPRESSION, 1};
+	} else if (er->image_format == EUROC_RECORDER_IMAGE_FORMAT_PNG_SMALL) {
+		params = {cv::IMWRITE_PNG_COMPRESSION, 3};
+	} else if (er->image_format == EUROC_RECORDER_IMAGE_FORMAT_RAW) {
+		params = {cv::IMWRITE_PXM_BINARY, 1};
+	}
+
+	bool ok = false;
+	try {
+		ok = cv::imwrite(job->img_path, img, params);
+	} catch (const cv::Exception &e) {
+		U_LOG_E("Failed to write '%s': %s", job->img_path.c_str(), e.what());
+	}
+
+	if (ok) {
+		xrt_atomic_s32_inc_return(&er->encoded_frames);
+	} else {
+		U_LOG_E("Failed to write '%s'", job->img_path.c_str());
+	}
+
+	xrt_frame_reference(&job->frame, NULL);
+	euroc_recorder_job_done(job, ok);
+
+	xrt_atomic_s32_dec_return(&er->pending_frames);
+}
+
 static void
 euroc_recorder_save_frame(euroc_recorder *er, struct xrt_frame *frame, int cam_index)
 {
@@ -188,14 +359,28 @@ euroc_recorder_save_frame(euroc_recorder *er, struct xrt_frame *frame, int cam_i
 	uint64_t ts = frame->timestamp;
 
 	assert(frame->format == XRT_FORMAT_L8 || frame->format == XRT_FORMAT_R8G8B8); // Only formats supported
-	auto img_type = frame->format == XRT_FORMAT_L8 ? CV_8UC1 : CV_8UC3;
-	string file_extension = er->use_jpg ? ".jpg" : ".png";
-	string filename = std::to_string(ts) + file_extension;
-	string img_path = er->path + "/mav0/" + cam_name + "/data/" + filename;
-	cv::Mat img{(int)frame->height, (int)frame->width, img_type, frame->data, frame->stride};
-	cv::imwrite(img_path, img);
 
-	*er->cams_csv[cam_index] << ts << "," << filename << CSV_EOL;
+	// Never block the camera queue, drop the frame if the encoders are behind.
+	if (xrt_atomic_s32_inc_return(&er->pending_frames) > MAX_PENDING_FRAMES) {
+		xrt_atomic_s32_dec_return(&er->pending_frames);
+		xrt_atomic_s32_inc_return(&er->dropped_frames);
+		return;
+	}
+
+	euroc_recorder_job *job = new euroc_recorder_job{};
+	job->er = er;
+	job->cam_index = cam_index;
+	job->timestamp = ts;
+	job->filename = std::to_string(ts) + euroc_recorder_file_extension(er->image_format, frame->format);
+	job->img_path = er->path + "/mav0/" + cam_name + "/data/" + job->filename;
+	xrt_frame_reference(&job->frame, frame);
+
+	{
+		lock_guard lock{er->cams[cam_index].lock};
+		er->cams[cam_index].pending.push_back(job);
+	}
+
+	u_worker_group_push(er->group, euroc_recorder_encode_task, job);
 }
 
 #define DEFINE_SAVE_CAM(cam_id)                                                                                        \
@@ -276,7 +461,7 @@ euroc_recorder_receive_frame(euroc_recorder *er, struct xrt_frame *src_frame, in
 
 	// Let's clone the frame so that we can release the src_frame quickly
 	xrt_frame *copy = nullptr;
-	u_frame_clone(src_frame, &copy);
+	u_frame_pool_clone(er->cloner_pool, src_frame, &copy);
 
 	xrt_sink_push_frame(er->writer_queues.cams[cam_index], copy);
 
@@ -322,6 +507,13 @@ extern "C" void
 euroc_recorder_node_destroy(struct xrt_frame_node *node)
 {
 	struct euroc_recorder *er = container_of(node, struct euroc_recorder, node);
+
+	// Finish any in flight encodes before closing the csv files.
+	u_worker_group_wait_all(er->group);
+	u_worker_group_reference(&er->group, NULL);
+	u_worker_thread_pool_reference(&er->pool, NULL);
+	u_frame_pool_reference(&er->cloner_pool, NULL);
+
 	delete er->imu_csv;
 	delete er->gt_csv;
 	for (int i = 0; i < er->cam_count; i++) {
@@ -351,7 +543,15 @@ euroc_recorder_create(struct xrt_frame_context *xfctx, const char *record_path,
 	xfn->destroy = euroc_recorder_node_destroy;
 	xrt_frame_context_add(xfctx, xfn);
 
-	er->use_jpg = debug_get_bool_option_euroc_recorder_use_jpg();
+	er->image_format = euroc_recorder_get_image_format();
+
+	// Nobody waits on the group while recording, the extra thread is only there for a waiter.
+	uint32_t worker_count = (uint32_t)CLAMP(debug_get_num_option_euroc_recorder_threads(), 1, 16);
+	er->pool = u_worker_thread_pool_create(worker_count, worker_count + 1, "EuRoC recorder");
+	er->group = u_worker_group_create(er->pool);
+
+	// Enough to cover the frames in flight to the encoders.
+	er->cloner_pool = u_frame_pool_create(MAX_PENDING_FRAMES + XRT_TRACKING_MAX_SLAM_CAMS);
 
 	// Setup sink pipeline
 
@@ -429,6 +629,9 @@ euroc_recorder_stop(struct xrt_slam_sinks *er_sinks)
 
 	er->path = "";
 	er->recording = false;
+
+	// Get all the images and their csv rows out before flushing.
+	u_worker_group_wait_all(er->group);
 	euroc_recorder_flush(er);
 }
 
@@ -456,4 +659,13 @@ euroc_recorder_add_ui(struct xrt_slam_sinks *er_sinks, void *root, const char *p
 	char tmp[256];
 	(void)snprintf(tmp, sizeof(tmp), "%s%s", prefix, er->recording ? "Stop recording" : "Record EuRoC dataset");
 	u_var_add_button(root, &er->recording_btn, tmp);
+
+	(void)snprintf(tmp, sizeof(tmp), "%sImage format", prefix);
+	u_var_add_ro_text(root, euroc_recorder_image_format_str(er->image_format), tmp);
+	(void)snprintf(tmp, sizeof(tmp), "%sFrames pending encoding", prefix);
+	u_var_add_ro_i32(root, (int32_t *)&er->pending_frames, tmp);
+	(void)snprintf(tmp, sizeof(tmp), "%sFrames encoded", prefix);
+	u_var_add_ro_i32(root, (int32_t *)&er->encoded_frames, tmp);
+	(void)snprintf(tmp, sizeof(tmp), "%sFrames dropped", prefix);
+	u_var_add_ro_i32(root, (int32_t *)&er->dropped_frames, tmp);
 }
@@ -7,22 +7,93 @@
  * @ingroup aux_tracking
  */
 
+#include "xrt/xrt_config_os.h"
+
 #include "util/u_var.h"
 #include "util/u_misc.h"
+#include "util/u_file.h"
 #include "util/u_sink.h"
 #include "util/u_debug.h"
 #include "util/u_frame.h"
 #include "util/u_format.h"
+#include "util/u_worker.h"
 #include "util/u_trace_marker.h"
 
+#include "math/m_api.h"
+
 #include "tracking/t_tracking.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
+#include <inttypes.h>
+
+
+DEBUG_GET_ONCE_NUM_OPTION(hsv_threads, "T_HSV_THREADS", 4)
+DEBUG_GET_ONCE_BOOL_OPTION(hsv_cache, "T_HSV_CACHE", true)
+
 
+/*
+ *
+ * Defines.
+ *
+ */
 
 #define MOD_180(v) ((uint32_t)(v) % 180)
 
+//! How many planes of Y each worker task converts.
+#define Y_PLANES_PER_TASK 16
+
+//! Upper limit of threads used for building, the worker pool has its own limit.
+#define MAX_THREADS 16
+
+//! Bump when the layout of the table or the cache file changes.
+#define CACHE_VERSION 1
+
+//! Sub directory of the config dir where the cached tables are stored.
+#define CACHE_SUBPATH "hsv_cache"
+
+
+/*
+ *
+ * Structs.
+ *
+ */
+
+/*!
+ * A range of Y planes of the large table, built by one worker task.
+ */
+struct large_table_task
+{
+	const struct t_hsv_filter_params *params;
+	struct t_hsv_filter_large_table *t;
+
+	uint32_t y_start;
+	uint32_t y_end;
+};
+
+/*!
+ * Header of a cached large table file, followed by the table.
+ */
+struct cache_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t size;
+	uint64_t key;
+	//! Hash of the table, catches truncated or partially written files.
+	uint64_t data_hash;
+};
+
+static const char cache_magic[8] = {'M', 'N', 'D', 'O', 'H', 'S', 'V', 0};
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
 static inline bool
 check_range(struct t_hsv_filter_color color, uint32_t h, uint32_t s, uint32_t v)
 {
@@ -33,6 +104,211 @@ check_range(struct t_hsv_filter_color color, uint32_t h, uint32_t s, uint32_t v)
 	return !bad;
 }
 
+static inline uint8_t
+classify(const struct t_hsv_filter_params *params, const uint8_t hsv[3])
+{
+	uint32_t h = hsv[0];
+	uint8_t s = hsv[1];
+	uint8_t v = hsv[2];
+
+	bool f0 = check_range(params->color[0], h, s, v);
+	bool f1 = check_range(params->color[1], h, s, v);
+	bool f2 = check_range(params->color[2], h, s, v);
+	bool f3 = s <= params->white.s_max && v >= params->white.v_min;
+
+	return (f0 << 0) | (f1 << 1) | (f2 << 2) | (f3 << 3);
+}
+
+/*!
+ * Converts @p count YUV samples in @p yuv to HSV in place and classifies them
+ * into @p dst, converting them all in one call keeps the conversion identical
+ * to converting the whole YUV cube in one go.
+ */
+static void
+classify_yuv(const struct t_hsv_filter_params *params, uint8_t *yuv, uint32_t count, uint8_t *dst)
+{
+	t_convert_in_place_y8u8v8_to_h8s8v8(count, 1, 0, yuv);
+
+	for (uint32_t i = 0; i < count; i++) {
+		dst[i] = classify(params, &yuv[i * 3]);
+	}
+}
+
+static void
+large_table_task_func(void *ptr)
+{
+	TRACK_TRACE_MARKER();
+
+	struct large_table_task *task = (struct large_table_task *)ptr;
+
+	// One plane of Y, small enough to stay in cache unlike the full 48MiB conversion table.
+	uint8_t *yuv = U_TYPED_ARRAY_CALLOC(uint8_t, 256 * 256 * 3);
+
+	for (uint32_t y = task->y_start; y < task->y_end; y++) {
+		uint8_t *src = yuv;
+		for (uint32_t u = 0; u < 256; u++) {
+			for (uint32_t v = 0; v < 256; v++) {
+				src[0] = y;
+				src[1] = u;
+				src[2] = v;
+				src += 3;
+			}
+		}
+
+		classify_yuv(task->params, yuv, 256 * 256, &task->t->v[y][0][0]);
+	}
+
+	free(yuv);
+}
+
+static void
+build_large_table(const struct t_hsv_filter_params *params, struct t_hsv_filter_large_table *t)
+{
+	TRACK_TRACE_MARKER();
+
+	struct large_table_task tasks[256 / Y_PLANES_PER_TASK];
+	uint32_t task_count = ARRAY_SIZE(tasks);
+
+	for (uint32_t i = 0; i < task_count; i++) {
+		tasks[i].params = params;
+		tasks[i].t = t;
+		tasks[i].y_start = i * Y_PLANES_PER_TASK;
+		tasks[i].y_end = (i + 1) * Y_PLANES_PER_TASK;
+	}
+
+	uint32_t thread_count = (uint32_t)CLAMP(debug_get_num_option_hsv_threads(), 1, MAX_THREADS);
+
+	struct u_worker_thread_pool *pool = NULL;
+	if (thread_count > 1) {
+		pool = u_worker_thread_pool_create(thread_count - 1, thread_count, "HSV table");
+	}
+
+	if (pool != NULL) {
+		struct u_worker_group *group = u_worker_group_create(pool);
+
+		for (uint32_t i = 0; i < task_count; i++) {
+			u_worker_group_push(group, large_table_task_func, &tasks[i]);
+		}
+
+		// Donates this thread to the pool while waiting.
+		u_worker_group_wait_all(group);
+
+		u_worker_group_reference(&group, NULL);
+		u_worker_thread_pool_reference(&pool, NULL);
+	} else {
+		for (uint32_t i = 0; i < task_count; i++) {
+			large_table_task_func(&tasks[i]);
+		}
+	}
+}
+
+
+/*
+ *
+ * Large table cache.
+ *
+ */
+
+static uint64_t
+hash_fnv1a(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+static uint64_t
+compute_cache_key(const struct t_hsv_filter_params *params)
+{
+	uint32_t header[2] = {CACHE_VERSION, sizeof(struct t_hsv_filter_large_table)};
+	uint64_t hash = hash_fnv1a(0xcbf29ce484222325ULL, header, sizeof(header));
+
+	// All members are bytes, so there is no padding to worry about.
+	return hash_fnv1a(hash, params, sizeof(*params));
+}
+
+#ifdef XRT_OS_LINUX
+static FILE *
+open_cache_file(uint64_t key, const char *mode)
+{
+	char filename[64];
+	snprintf(filename, sizeof(filename), "hsv_%016" PRIx64 ".bin", key);
+
+	return u_file_open_file_in_config_dir_subpath(CACHE_SUBPATH, filename, mode);
+}
+
+static bool
+load_cached_table(uint64_t key, struct t_hsv_filter_large_table *t)
+{
+	FILE *file = open_cache_file(key, "rb");
+	if (file == NULL) {
+		return false;
+	}
+
+	struct cache_header header = {0};
+
+	if (fread(&header, sizeof(header), 1, file) != 1 ||                //
+	    memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 || //
+	    header.version != CACHE_VERSION ||                             //
+	    header.size != sizeof(*t) ||                                   //
+	    header.key != key ||                                           //
+	    fread(t, sizeof(*t), 1, file) != 1 ||                          //
+	    hash_fnv1a(0xcbf29ce484222325ULL, t, sizeof(*t)) != header.data_hash) {
+		fclose(file);
+		U_LOG_W("Ignoring invalid HSV table cache file for key %016" PRIx64, key);
+		return false;
+	}
+
+	fclose(file);
+
+	return true;
+}
+
+static void
+store_cached_table(uint64_t key, const struct t_hsv_filter_large_table *t)
+{
+	FILE *file = open_cache_file(key, "wb");
+	if (file == NULL) {
+		return;
+	}
+
+	struct cache_header header = {0};
+	memcpy(header.magic, cache_magic, sizeof(cache_magic));
+	header.version = CACHE_VERSION;
+	header.size = sizeof(*t);
+	header.key = key;
+	header.data_hash = hash_fnv1a(0xcbf29ce484222325ULL, t, sizeof(*t));
+
+	// A partial write is rejected by the data hash when loading.
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(t, sizeof(*t), 1, file);
+	fclose(file);
+}
+#else
+static bool
+load_cached_table(uint64_t key, struct t_hsv_filter_large_table *t)
+{
+	return false;
+}
+
+static void
+store_cached_table(uint64_t key, const struct t_hsv_filter_large_table *t)
+{
+	// Noop
+}
+#endif
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
 void
 t_hsv_build_convert_table(struct t_hsv_filter_params *params, struct t_convert_table *t)
 {
@@ -61,58 +337,50 @@ t_hsv_build_convert_table(struct t_hsv_filter_params *params, struct t_convert_t
 void
 t_hsv_build_large_table(struct t_hsv_filter_params *params, struct t_hsv_filter_large_table *t)
 {
-	struct t_convert_table *temp = U_TYPED_CALLOC(struct t_convert_table);
-	t_convert_make_y8u8v8_to_h8s8v8(temp);
+	bool use_cache = debug_get_bool_option_hsv_cache();
+	uint64_t key = compute_cache_key(params);
 
-	uint8_t *dst = &t->v[0][0][0];
-	for (int y = 0; y < 256; y++) {
-		for (int u = 0; u < 256; u++) {
-			for (int v = 0; v < 256; v++) {
-				uint32_t h = temp->v[y][u][v][0];
-				uint8_t s = temp->v[y][u][v][1];
-				uint8_t v2 = temp->v[y][u][v][2];
+	if (use_cache && load_cached_table(key, t)) {
+		return;
+	}
 
-				bool f0 = check_range(params->color[0], h, s, v2);
-				bool f1 = check_range(params->color[1], h, s, v2);
-				bool f2 = check_range(params->color[2], h, s, v2);
-				bool f3 = s <= params->white.s_max && v2 >= params->white.v_min;
+	build_large_table(params, t);
 
-				*dst = (f0 << 0) | (f1 << 1) | (f2 << 2) | (f3 << 3);
-				dst += 1;
-			}
-		}
+	if (use_cache) {
+		store_cached_table(key, t);
 	}
-
-	free(temp);
 }
 
 void
 t_hsv_build_optimized_table(struct t_hsv_filter_params *params, struct t_hsv_filter_optimized_table *t)
 {
-	struct t_hsv_filter_large_table *temp = U_TYPED_CALLOC(struct t_hsv_filter_large_table);
-	t_hsv_build_large_table(params, temp);
+	TRACK_TRACE_MARKER();
+
+	/*
+	 * Only one sample per cell of the large table is used, so only convert
+	 * those instead of building the whole large table, 32768 instead of
+	 * 16 million conversions.
+	 */
+	uint8_t *yuv = U_TYPED_ARRAY_CALLOC(uint8_t, T_HSV_SIZE * T_HSV_SIZE * T_HSV_SIZE * 3);
+	uint8_t *src = yuv;
 
 	// Half of step, minus one
 	int offset = (T_HSV_STEP / 2) - 1;
 
 	for (int y = 0; y < T_HSV_SIZE; y++) {
-
-		int src_y = y * T_HSV_STEP + offset;
-
 		for (int u = 0; u < T_HSV_SIZE; u++) {
-
-			int src_u = u * T_HSV_STEP + offset;
-			int src_v = offset;
-
 			for (int v = 0; v < T_HSV_SIZE; v++) {
-				t->v[y][u][v] = temp->v[src_y][src_u][src_v];
-
-				src_v += T_HSV_STEP;
+				src[0] = y * T_HSV_STEP + offset;
+				src[1] = u * T_HSV_STEP + offset;
+				src[2] = v * T_HSV_STEP + offset;
+				src += 3;
 			}
 		}
 	}
 
-	free(temp);
+	classify_yuv(params, yuv, T_HSV_SIZE * T_HSV_SIZE * T_HSV_SIZE, &t->v[0][0][0]);
+
+	free(yuv);
 }
 
 
@@ -16,6 +16,7 @@
 #include "util/u_misc.h"
 #include "util/u_sink.h"
 #include "util/u_var.h"
+#include "util/u_json.h"
 #include "util/u_trace_marker.h"
 #include "os/os_threading.h"
 #include "math/m_api.h"
@@ -35,6 +36,8 @@
 #include <opencv2/core/mat.hpp>
 #include <opencv2/core/version.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <deque>
 #include <filesystem>
 #include <fstream>
@@ -393,6 +396,25 @@ struct TrackerSlam
 		struct u_var_timing diff_ui;          //!< Realtime UI for positional error
 		bool override_tracking = false;       //!< Force the tracker to report gt poses instead
 	} gt;
+
+	//! Metrics accumulated over the whole run, written to summary.json for batch evaluation
+	struct
+	{
+		bool write_summary = false;                   //!< Whether to write summary.json on destruction
+		string summary_dir;                           //!< Where to write summary.json
+		Mutex mutex;                                  //!< Frames and poses come from different threads
+		map<timepoint_ns, timepoint_ns> submit_times; //!< When each cam0 frame was submitted, by frame ts
+		vector<double> latencies_ms;                  //!< From frame submission to pose estimation
+		int64_t frame_count = 0;                      //!< Number of cam0 frames submitted
+		int64_t pose_count = 0;                       //!< Number of poses dequeued from the tracker
+		timepoint_ns first_submit_time = 0;           //!< Monotonic time of the first frame submission
+		timepoint_ns last_pose_time = 0;              //!< Monotonic time of the last pose dequeue
+		vector<double> ate_m;                         //!< Positional error wrt ground truth per pose
+		vector<double> rpe_m;                         //!< Error of the positional delta between poses
+		bool has_last = false;                        //!< Whether @ref last_est and @ref last_gt are set
+		xrt_vec3 last_est;                            //!< Last tracked position in ground truth space
+		xrt_vec3 last_gt;                             //!< Ground truth position of @ref last_est
+	} stats;
 };
 
 
@@ -724,6 +746,125 @@ gt_ui_push(TrackerSlam &t, timepoint_ns ts, xrt_pose tracked_pose)
 	t.gt.diff_ui.reference_timing = (1 - a) * t.gt.diff_ui.reference_timing + a * len_mm;
 }
 
+
+/*
+ *
+ * Run statistics functionality
+ *
+ */
+
+static void
+stats_push_frame(TrackerSlam &t, timepoint_ns ts)
+{
+	timepoint_ns now = os_monotonic_get_ns();
+
+	unique_lock lock(t.stats.mutex);
+	if (t.stats.frame_count == 0) {
+		t.stats.first_submit_time = now;
+	}
+	t.stats.frame_count++;
+	t.stats.submit_times[ts] = now;
+}
+
+/*!
+ * Accumulates latency and ground truth errors of a new pose. @p tss are the
+ * pose timestamps from @ref timing_ui_push, its last tracker provided entry is
+ * used as the time the pose was estimated, otherwise the dequeue time is used.
+ */
+static void
+stats_push_pose(TrackerSlam &t, timepoint_ns ts, const xrt_pose &tracked_pose, const vector<timepoint_ns> &tss)
+{
+	timepoint_ns now = os_monotonic_get_ns();
+	timepoint_ns estimated = tss.size() > 2 ? tss[tss.size() - 2] : now;
+
+	unique_lock lock(t.stats.mutex);
+
+	t.stats.pose_count++;
+	t.stats.last_pose_time = now;
+
+	auto it = t.stats.submit_times.find(ts);
+	if (it != t.stats.submit_times.end()) {
+		t.stats.latencies_ms.push_back(double(estimated - it->second) / U_TIME_1MS_IN_NS);
+		t.stats.submit_times.erase(t.stats.submit_times.begin(), std::next(it));
+	}
+
+	if (t.gt.trajectory->empty()) {
+		return;
+	}
+
+	//! @note Same unaligned comparison as the UI, see @ref xr2gt_pose.
+	xrt_vec3 gt = get_gt_pose_at(*t.gt.trajectory, ts).position;
+	xrt_vec3 est = xr2gt_pose(t.gt.origin, tracked_pose).position;
+	t.stats.ate_m.push_back(m_vec3_len(est - gt));
+
+	if (t.stats.has_last) {
+		xrt_vec3 est_delta = est - t.stats.last_est;
+		xrt_vec3 gt_delta = gt - t.stats.last_gt;
+		t.stats.rpe_m.push_back(m_vec3_len(est_delta - gt_delta));
+	}
+	t.stats.has_last = true;
+	t.stats.last_est = est;
+	t.stats.last_gt = gt;
+}
+
+//! Adds count, mean, rmse, median, p90, p99 and max of @p values as an object named @p name.
+static void
+stats_add_summary(cJSON *root, const char *name, vector<double> values)
+{
+	cJSON *obj = cJSON_AddObjectToObject(root, name);
+	cJSON_AddNumberToObject(obj, "count", values.size());
+	if (values.empty()) {
+		return;
+	}
+
+	std::sort(values.begin(), values.end());
+	double sum = 0;
+	double sq_sum = 0;
+	for (double v : values) {
+		sum += v;
+		sq_sum += v * v;
+	}
+
+	auto percentile = [&values](double p) { return values[size_t(p * (values.size() - 1))]; };
+
+	cJSON_AddNumberToObject(obj, "mean", sum / values.size());
+	cJSON_AddNumberToObject(obj, "rmse", std::sqrt(sq_sum / values.size()));
+	cJSON_AddNumberToObject(obj, "median", percentile(0.5));
+	cJSON_AddNumberToObject(obj, "p90", percentile(0.9));
+	cJSON_AddNumberToObject(obj, "p99", percentile(0.99));
+	cJSON_AddNumberToObject(obj, "max", values.back());
+}
+
+//! Writes the run statistics as summary.json into @p dir for batch evaluation tools.
+static void
+stats_write_summary(TrackerSlam &t, const string &dir)
+{
+	unique_lock lock(t.stats.mutex);
+
+	double duration_s = double(t.stats.last_pose_time - t.stats.first_submit_time) / U_TIME_1S_IN_NS;
+	bool has_duration = t.stats.pose_count > 0 && duration_s > 0;
+
+	cJSON *root = cJSON_CreateObject();
+	cJSON_AddNumberToObject(root, "frames", t.stats.frame_count);
+	cJSON_AddNumberToObject(root, "poses", t.stats.pose_count);
+	cJSON_AddNumberToObject(root, "duration_s", has_duration ? duration_s : 0);
+	cJSON_AddNumberToObject(root, "throughput_fps", has_duration ? t.stats.pose_count / duration_s : 0);
+	cJSON_AddBoolToObject(root, "has_gt", !t.gt.trajectory->empty());
+	stats_add_summary(root, "latency_ms", t.stats.latencies_ms);
+	stats_add_summary(root, "ate_m", t.stats.ate_m);
+	stats_add_summary(root, "rpe_m", t.stats.rpe_m);
+
+	char *str = cJSON_Print(root);
+	cJSON_Delete(root);
+
+	create_directories(dir);
+	ofstream file{dir + "/summary.json"};
+	file << str << "\n";
+	cJSON_free(str);
+
+	SLAM_INFO("Wrote run summary to %s/summary.json", dir.c_str());
+}
+
 /*
  *
  * Tracker functionality
@@ -793,6 +934,7 @@ flush_poses(TrackerSlam &t)
 
 		auto tss = timing_ui_push(t, pose, nts);
 		t.slam_times_writer->push(tss);
+		stats_push_pose(t, nts, rel.pose, tss);
 
 		if (t.features.enabled) {
 			vector feat_count = features_ui_push(t, pose, nts);
@@ -1353,6 +1495,10 @@ receive_frame(TrackerSlam &t, struct xrt_frame *frame, uint32_t cam_index)
 	}
 	last_ts = ts;
 
+	if (cam_index == 0) {
+		stats_push_frame(t, ts);
+	}
+
 	// Construct and send the image sample
 	vit_img_sample sample = {};
 	sample.cam_index = cam_index;
@@ -1453,6 +1599,9 @@ t_slam_node_destroy(struct xrt_frame_node *node)
 	if (t.ovr_tracker != NULL) {
 		t_openvr_tracker_destroy(t.ovr_tracker);
 	}
+	if (t.stats.write_summary) {
+		stats_write_summary(t, t.stats.summary_dir);
+	}
 	delete t.gt.trajectory;
 	delete t.slam_times_writer;
 	delete t.slam_features_writer;
@@ -1612,6 +1761,8 @@ t_slam_create(struct xrt_frame_context *xfctx,
 	t.slam_traj_writer = new TrajectoryWriter(dir, "tracking.csv", write_csvs);
 	t.pred_traj_writer = new TrajectoryWriter(dir, "prediction.csv", write_csvs);
 	t.filt_traj_writer = new TrajectoryWriter(dir, "filtering.csv", write_csvs);
+	t.stats.write_summary = write_csvs;
+	t.stats.summary_dir = dir;
 
 	setup_ui(t);
 
@@ -8,10 +8,15 @@
  * @ingroup aux_distortion
  */
 
+#include "xrt/xrt_config_os.h"
+
 #include "util/u_misc.h"
+#include "util/u_file.h"
 #include "util/u_frame.h"
 #include "util/u_debug.h"
 #include "util/u_format.h"
+#include "util/u_worker.h"
+#include "util/u_logging.h"
 #include "util/u_distortion_mesh.h"
 
 #include "math/m_vec2.h"
@@ -19,14 +24,116 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
+#include <inttypes.h>
+
+#ifdef XRT_OS_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 
 
 DEBUG_GET_ONCE_NUM_OPTION(mesh_size, "XRT_MESH_SIZE", 64)
+DEBUG_GET_ONCE_NUM_OPTION(mesh_threads, "XRT_MESH_THREADS", 1)
+DEBUG_GET_ONCE_BOOL_OPTION(mesh_cache, "XRT_MESH_CACHE", true)
+
+
+/*
+ *
+ * Defines.
+ *
+ */
+
+//! How many bands of rows each view is split into for parallel generation.
+#define ROW_BANDS_PER_VIEW 8
+
+//! Upper limit of threads used for generation, the worker pool has its own limit.
+#define MAX_THREADS 16
+
+//! How many points along each axis are probed per view to build the cache key.
+#define CACHE_PROBE_COUNT 9
+
+//! Every this many vertex rows and columns of a loaded mesh are checked against the distortion function.
+#define CACHE_VALIDATE_STRIDE 4
+
+//! How many cached meshes are kept, the least recently used are removed.
+#define CACHE_MAX_FILES 8
+
+//! Bump when the layout of the vertices or the cache file changes.
+#define CACHE_VERSION 2
 
+//! Sub directory of the config dir where the cached meshes are stored.
+#define CACHE_SUBPATH "distortion_cache"
+
+
+/*
+ *
+ * Structs.
+ *
+ */
 
 typedef bool (*func_calc)(struct xrt_device *xdev, uint32_t view, float u, float v, struct xrt_uv_triplet *result);
 
+/*!
+ * Describes the layout of the generated mesh.
+ */
+struct mesh_layout
+{
+	uint32_t view_count;
+	uint32_t cells_cols;
+	uint32_t cells_rows;
+	uint32_t vert_cols;
+	uint32_t vert_rows;
+	uint32_t stride_in_floats;
+	uint32_t float_count;
+};
+
+/*!
+ * A band of vertex rows of a single view, generated by one worker task.
+ */
+struct vertex_task
+{
+	struct xrt_device *xdev;
+	func_calc calc;
+	const struct mesh_layout *layout;
+	float *verts;
+
+	uint32_t view;
+	uint32_t row_start;
+	uint32_t row_end;
+
+	//! Set if the distortion function failed for any vertex in the band.
+	bool failed;
+};
+
+/*!
+ * Header of a cached mesh file, followed by the vertices.
+ */
+struct cache_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t view_count;
+	uint32_t num;
+	uint32_t float_count;
+	uint64_t key;
+	//! Hash of the vertices, catches truncated or partially written files.
+	uint64_t data_hash;
+};
+
+static const char cache_magic[8] = {'X', 'R', 'T', 'M', 'E', 'S', 'H', '\0'};
+
+
+/*
+ *
+ * Vertex generation.
+ *
+ */
+
 static int
 index_for(int row, int col, uint32_t stride, uint32_t offset)
 {
@@ -34,67 +141,456 @@ index_for(int row, int col, uint32_t stride, uint32_t offset)
 }
 
 static void
-run_func(struct xrt_device *xdev, func_calc calc, struct xrt_hmd_parts *target, uint32_t num)
+fill_vertex_rows(struct vertex_task *t)
 {
-	assert(calc != NULL);
+	const struct mesh_layout *l = t->layout;
+	uint32_t vertex_count_per_view = l->vert_rows * l->vert_cols;
 
-	uint32_t view_count = target->view_count;
+	for (uint32_t r = t->row_start; r < t->row_end; r++) {
+		// This goes from 0 to 1.0 inclusive.
+		float v = (float)r / (float)l->cells_rows;
 
-	uint32_t vertex_offsets[XRT_MAX_VIEWS] = {0};
-	uint32_t index_offsets[XRT_MAX_VIEWS] = {0};
+		uint32_t i = (t->view * vertex_count_per_view + r * l->vert_cols) * l->stride_in_floats;
 
-	uint32_t cells_cols = num;
-	uint32_t cells_rows = num;
-	uint32_t vert_cols = cells_cols + 1;
-	uint32_t vert_rows = cells_rows + 1;
+		for (uint32_t c = 0; c < l->vert_cols; c++) {
+			// This goes from 0 to 1.0 inclusive.
+			float u = (float)c / (float)l->cells_cols;
 
-	uint32_t vertex_count_per_view = vert_rows * vert_cols;
-	uint32_t vertex_count = vertex_count_per_view * view_count;
+			// Make the position in the range of [-1, 1]
+			t->verts[i + 0] = u * 2.0f - 1.0f;
+			t->verts[i + 1] = v * 2.0f - 1.0f;
 
-	uint32_t uv_channels_count = 3;
-	uint32_t stride_in_floats = 2 + uv_channels_count * 2;
-	uint32_t float_count = vertex_count * stride_in_floats;
+			if (!t->calc(t->xdev, t->view, u, v, (struct xrt_uv_triplet *)&t->verts[i + 2])) {
+				t->failed = true;
+				return;
+			}
 
-	float *verts = U_TYPED_ARRAY_CALLOC(float, float_count);
+			i += l->stride_in_floats;
+		}
+	}
+}
 
-	// Setup the vertices for all views.
-	uint32_t i = 0;
-	for (uint32_t view = 0; view < view_count; view++) {
-		vertex_offsets[view] = i / stride_in_floats;
+static void
+vertex_task_func(void *ptr)
+{
+	fill_vertex_rows((struct vertex_task *)ptr);
+}
 
-		for (uint32_t r = 0; r < vert_rows; r++) {
-			// This goes from 0 to 1.0 inclusive.
-			float v = (float)r / (float)cells_rows;
+/*!
+ * Evaluates the distortion function for all vertices of all views, split into
+ * bands of rows that are run on a worker pool, returns false on failure.
+ */
+static bool
+fill_vertices(struct xrt_device *xdev, func_calc calc, const struct mesh_layout *layout, float *verts)
+{
+	struct vertex_task tasks[XRT_MAX_VIEWS * ROW_BANDS_PER_VIEW];
+	uint32_t task_count = 0;
+
+	uint32_t band_count = MIN(ROW_BANDS_PER_VIEW, layout->vert_rows);
+	uint32_t rows_per_band = (layout->vert_rows + band_count - 1) / band_count;
+
+	for (uint32_t view = 0; view < layout->view_count; view++) {
+		for (uint32_t row = 0; row < layout->vert_rows; row += rows_per_band) {
+			struct vertex_task *t = &tasks[task_count++];
+			t->xdev = xdev;
+			t->calc = calc;
+			t->layout = layout;
+			t->verts = verts;
+			t->view = view;
+			t->row_start = row;
+			t->row_end = MIN(row + rows_per_band, layout->vert_rows);
+			t->failed = false;
+		}
+	}
 
-			for (uint32_t c = 0; c < vert_cols; c++) {
-				// This goes from 0 to 1.0 inclusive.
-				float u = (float)c / (float)cells_cols;
+	uint32_t thread_count = (uint32_t)CLAMP(debug_get_num_option_mesh_threads(), 1, MAX_THREADS);
+	thread_count = MIN(thread_count, task_count);
+
+	struct u_worker_thread_pool *pool = NULL;
+	if (thread_count > 1) {
+		pool = u_worker_thread_pool_create(thread_count - 1, thread_count, "Distortion mesh");
+	}
+
+	if (pool != NULL) {
+		struct u_worker_group *group = u_worker_group_create(pool);
+
+		for (uint32_t i = 0; i < task_count; i++) {
+			u_worker_group_push(group, vertex_task_func, &tasks[i]);
+		}
+
+		// Donates this thread to the pool while waiting.
+		u_worker_group_wait_all(group);
 
-				// Make the position in the range of [-1, 1]
-				verts[i + 0] = u * 2.0f - 1.0f;
-				verts[i + 1] = v * 2.0f - 1.0f;
+		u_worker_group_reference(&group, NULL);
+		u_worker_thread_pool_reference(&pool, NULL);
+	} else {
+		for (uint32_t i = 0; i < task_count; i++) {
+			fill_vertex_rows(&tasks[i]);
+		}
+	}
+
+	for (uint32_t i = 0; i < task_count; i++) {
+		if (tasks[i].failed) {
+			return false;
+		}
+	}
+
+	return true;
+}
 
-				if (!calc(xdev, view, u, v, (struct xrt_uv_triplet *)&verts[i + 2])) {
-					// bail on error, without updating
-					// distortion.preferred
-					return;
+
+/*
+ *
+ * Mesh cache.
+ *
+ */
+
+static uint64_t
+hash_fnv1a(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/*!
+ * The distortion parameters are private to each driver, so the key is built
+ * by hashing the device name and serial, the mesh size and the output of the
+ * distortion function on a sparse grid of points, returns false if the
+ * function failed. Since the key can't capture everything a loaded mesh is
+ * also checked with @ref validate_cached_vertices.
+ */
+static bool
+compute_cache_key(struct xrt_device *xdev, func_calc calc, const struct mesh_layout *layout, uint64_t *out_key)
+{
+	uint32_t header[4] = {CACHE_VERSION, layout->view_count, layout->cells_cols, layout->stride_in_floats};
+	uint64_t hash = hash_fnv1a(0xcbf29ce484222325ULL, header, sizeof(header));
+	hash = hash_fnv1a(hash, xdev->str, strnlen(xdev->str, sizeof(xdev->str)));
+	hash = hash_fnv1a(hash, xdev->serial, strnlen(xdev->serial, sizeof(xdev->serial)));
+
+	for (uint32_t view = 0; view < layout->view_count; view++) {
+		for (uint32_t r = 0; r < CACHE_PROBE_COUNT; r++) {
+			float v = (float)r / (float)(CACHE_PROBE_COUNT - 1);
+
+			for (uint32_t c = 0; c < CACHE_PROBE_COUNT; c++) {
+				float u = (float)c / (float)(CACHE_PROBE_COUNT - 1);
+
+				struct xrt_uv_triplet result = {0};
+				if (!calc(xdev, view, u, v, &result)) {
+					return false;
 				}
 
-				i += stride_in_floats;
+				hash = hash_fnv1a(hash, &result, sizeof(result));
 			}
 		}
 	}
 
+	*out_key = hash;
+
+	return true;
+}
+
+/*!
+ * Evaluates the distortion function on a grid of vertices offset from the one
+ * used for the key and compares them to the loaded mesh, catches different
+ * distortions that happen to have the same key.
+ */
+static bool
+validate_cached_vertices(struct xrt_device *xdev, func_calc calc, const struct mesh_layout *layout, const float *verts)
+{
+	uint32_t vertex_count_per_view = layout->vert_rows * layout->vert_cols;
+
+	for (uint32_t view = 0; view < layout->view_count; view++) {
+		for (uint32_t r = 1; r < layout->vert_rows; r += CACHE_VALIDATE_STRIDE) {
+			// Same math as fill_vertex_rows so the results are bit exact.
+			float v = (float)r / (float)layout->cells_rows;
+
+			for (uint32_t c = 1; c < layout->vert_cols; c += CACHE_VALIDATE_STRIDE) {
+				float u = (float)c / (float)layout->cells_cols;
+
+				uint32_t i = (view * vertex_count_per_view + r * layout->vert_cols + c) * layout->stride_in_floats;
+
+				struct xrt_uv_triplet result = {0};
+				if (!calc(xdev, view, u, v, &result) || memcmp(&result, &verts[i + 2], sizeof(result)) != 0) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+#ifdef XRT_OS_LINUX
+static void
+get_cache_filename(uint64_t key, char *out_filename, size_t size)
+{
+	snprintf(out_filename, size, "mesh_%016" PRIx64 ".bin", key);
+}
+
+static FILE *
+open_cache_file(uint64_t key, const char *mode)
+{
+	char filename[64];
+	get_cache_filename(key, filename, sizeof(filename));
+
+	return u_file_open_file_in_config_dir_subpath(CACHE_SUBPATH, filename, mode);
+}
+
+/*!
+ * Marks the cache file as recently used, so it is the last to be evicted.
+ */
+static void
+touch_cache_file(uint64_t key)
+{
+	char dir[PATH_MAX];
+	if (u_file_get_path_in_config_dir(CACHE_SUBPATH, dir, sizeof(dir)) <= 0) {
+		return;
+	}
+
+	char filename[64];
+	get_cache_filename(key, filename, sizeof(filename));
+
+	int dir_fd = open(dir, O_RDONLY | O_DIRECTORY);
+	if (dir_fd < 0) {
+		return;
+	}
+
+	utimensat(dir_fd, filename, NULL, 0);
+	close(dir_fd);
+}
+
+/*!
+ * Removes the least recently used cache files until at most
+ * @ref CACHE_MAX_FILES are left.
+ */
+static void
+evict_cache_files(void)
+{
+	char dir_path[PATH_MAX];
+	if (u_file_get_path_in_config_dir(CACHE_SUBPATH, dir_path, sizeof(dir_path)) <= 0) {
+		return;
+	}
+
+	DIR *dir = opendir(dir_path);
+	if (dir == NULL) {
+		return;
+	}
+
+	struct
+	{
+		char name[64];
+		struct timespec mtime;
+	} kept[CACHE_MAX_FILES];
+	uint32_t count = 0;
+
+	/*
+	 * Keeps the newest files sorted newest first, everything that falls
+	 * off the end is older than all of the kept ones and removed.
+	 */
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (strncmp(entry->d_name, "mesh_", 5) != 0 || strlen(entry->d_name) >= sizeof(kept[0].name)) {
+			continue;
+		}
+
+		struct stat st;
+		if (fstatat(dirfd(dir), entry->d_name, &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+			continue;
+		}
+
+		uint32_t pos = count;
+		while (pos > 0 && (kept[pos - 1].mtime.tv_sec < st.st_mtim.tv_sec ||
+		                   (kept[pos - 1].mtime.tv_sec == st.st_mtim.tv_sec &&
+		                    kept[pos - 1].mtime.tv_nsec < st.st_mtim.tv_nsec))) {
+			pos--;
+		}
+
+		if (pos >= CACHE_MAX_FILES) {
+			// Older than all of the kept ones.
+			unlinkat(dirfd(dir), entry->d_name, 0);
+			continue;
+		}
+
+		if (count == CACHE_MAX_FILES) {
+			// The oldest kept one falls off.
+			unlinkat(dirfd(dir), kept[CACHE_MAX_FILES - 1].name, 0);
+			count--;
+		}
+
+		memmove(&kept[pos + 1], &kept[pos], sizeof(kept[0]) * (count - pos));
+		memcpy(kept[pos].name, entry->d_name, strlen(entry->d_name) + 1);
+		kept[pos].mtime = st.st_mtim;
+		count++;
+	}
+
+	closedir(dir);
+}
+
+static bool
+load_cached_vertices(uint64_t key, const struct mesh_layout *layout, uint32_t num, float **out_verts)
+{
+	FILE *file = open_cache_file(key, "rb");
+	if (file == NULL) {
+		return false;
+	}
+
+	struct cache_header header = {0};
+	float *verts = NULL;
+
+	if (fread(&header, sizeof(header), 1, file) != 1 ||                //
+	    memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 || //
+	    header.version != CACHE_VERSION ||                             //
+	    header.key != key ||                                           //
+	    header.view_count != layout->view_count ||                     //
+	    header.num != num ||                                           //
+	    header.float_count != layout->float_count) {
+		goto err_close;
+	}
+
+	verts = U_TYPED_ARRAY_CALLOC(float, layout->float_count);
+	if (fread(verts, sizeof(float), layout->float_count, file) != layout->float_count) {
+		goto err_free;
+	}
+
+	if (hash_fnv1a(0xcbf29ce484222325ULL, verts, sizeof(float) * layout->float_count) != header.data_hash) {
+		goto err_free;
+	}
+
+	fclose(file);
+	*out_verts = verts;
+
+	return true;
+
+err_free:
+	free(verts);
+err_close:
+	fclose(file);
+	U_LOG_W("Ignoring invalid distortion mesh cache file for key %016" PRIx64, key);
+
+	return false;
+}
+
+static void
+store_cached_vertices(uint64_t key, const struct mesh_layout *layout, uint32_t num, const float *verts)
+{
+	FILE *file = open_cache_file(key, "wb");
+	if (file == NULL) {
+		return;
+	}
+
+	struct cache_header header = {0};
+	memcpy(header.magic, cache_magic, sizeof(cache_magic));
+	header.version = CACHE_VERSION;
+	header.view_count = layout->view_count;
+	header.num = num;
+	header.float_count = layout->float_count;
+	header.key = key;
+	header.data_hash = hash_fnv1a(0xcbf29ce484222325ULL, verts, sizeof(float) * layout->float_count);
+
+	// A partial write is rejected by the data hash when loading.
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(verts, sizeof(float), layout->float_count, file);
+	fclose(file);
+
+	evict_cache_files();
+}
+#else
+static bool
+load_cached_vertices(uint64_t key, const struct mesh_layout *layout, uint32_t num, float **out_verts)
+{
+	return false;
+}
+
+static void
+store_cached_vertices(uint64_t key, const struct mesh_layout *layout, uint32_t num, const float *verts)
+{
+	// Noop
+}
+
+static void
+touch_cache_file(uint64_t key)
+{
+	// Noop
+}
+#endif
+
+
+/*
+ *
+ * Mesh generation.
+ *
+ */
+
+static void
+run_func(struct xrt_device *xdev, func_calc calc, struct xrt_hmd_parts *target, uint32_t num, bool use_cache)
+{
+	assert(calc != NULL);
+
+	uint32_t view_count = target->view_count;
+
+	uint32_t index_offsets[XRT_MAX_VIEWS] = {0};
+
+	uint32_t uv_channels_count = 3;
+
+	struct mesh_layout layout = {0};
+	layout.view_count = view_count;
+	layout.cells_cols = num;
+	layout.cells_rows = num;
+	layout.vert_cols = num + 1;
+	layout.vert_rows = num + 1;
+	layout.stride_in_floats = 2 + uv_channels_count * 2;
+
+	uint32_t vertex_count_per_view = layout.vert_rows * layout.vert_cols;
+	uint32_t vertex_count = vertex_count_per_view * view_count;
+	layout.float_count = vertex_count * layout.stride_in_floats;
+
+	uint32_t cells_rows = layout.cells_rows;
+	uint32_t vert_cols = layout.vert_cols;
+
+	uint64_t key = 0;
+	use_cache = use_cache && debug_get_bool_option_mesh_cache() && compute_cache_key(xdev, calc, &layout, &key);
+
+	float *verts = NULL;
+	if (use_cache && load_cached_vertices(key, &layout, num, &verts)) {
+		if (validate_cached_vertices(xdev, calc, &layout, verts)) {
+			touch_cache_file(key);
+		} else {
+			U_LOG_W("Cached distortion mesh for key %016" PRIx64 " doesn't match, regenerating", key);
+			free(verts);
+			verts = NULL;
+		}
+	}
+
+	if (verts == NULL) {
+		verts = U_TYPED_ARRAY_CALLOC(float, layout.float_count);
+
+		if (!fill_vertices(xdev, calc, &layout, verts)) {
+			// bail on error, without updating
+			// distortion.preferred
+			free(verts);
+			return;
+		}
+
+		if (use_cache) {
+			store_cached_vertices(key, &layout, num, verts);
+		}
+	}
+
 	uint32_t index_count_per_view = cells_rows * (vert_cols * 2 + 2);
 	uint32_t index_count_total = index_count_per_view * view_count;
 	int *indices = U_TYPED_ARRAY_CALLOC(int, index_count_total);
 
 	// Set up indices for all views.
-	i = 0;
+	uint32_t i = 0;
 	for (uint32_t view = 0; view < view_count; view++) {
 		index_offsets[view] = i;
 
-		uint32_t off = vertex_offsets[view];
+		uint32_t off = view * vertex_count_per_view;
 
 		for (uint32_t r = 0; r < cells_rows; r++) {
 			// Top vertex row for this cell row, left most vertex.
@@ -113,7 +609,7 @@ run_func(struct xrt_device *xdev, func_calc calc, struct xrt_hmd_parts *target,
 
 	target->distortion.models |= XRT_DISTORTION_MODEL_MESHUV;
 	target->distortion.mesh.vertices = verts;
-	target->distortion.mesh.stride = stride_in_floats * sizeof(float);
+	target->distortion.mesh.stride = layout.stride_in_floats * sizeof(float);
 	target->distortion.mesh.vertex_count = vertex_count;
 	target->distortion.mesh.uv_channels_count = uv_channels_count;
 	target->distortion.mesh.indices = indices;
@@ -438,7 +934,7 @@ u_distortion_mesh_fill_in_none(struct xrt_device *xdev)
 	struct xrt_hmd_parts *target = xdev->hmd;
 
 	// Do the generation.
-	run_func(xdev, u_distortion_mesh_none, target, 1);
+	run_func(xdev, u_distortion_mesh_none, target, 1, false);
 
 	// Make the target mostly usable.
 	target->distortion.models |= XRT_DISTORTION_MODEL_NONE;
@@ -483,5 +979,5 @@ u_distortion_mesh_fill_in_compute(struct xrt_device *xdev)
 
 	uint32_t num = (uint32_t)debug_get_num_option_mesh_size();
 
-	run_func(xdev, calc, target, num);
+	run_func(xdev, calc, target, num, true);
 }
@@ -192,6 +192,14 @@ u_distortion_mesh_none(struct xrt_device *xdev, uint32_t view, float u, float v,
  * xdev->compute_distortion(), populates `xdev->hmd_parts.distortion.mesh` &
  * `xdev->hmd_parts.distortion.models`.
  *
+ * The mesh is generated on a single thread by default, setting
+ * `XRT_MESH_THREADS` higher spreads it over more threads but requires
+ * xdev->compute_distortion() to be safe to call concurrently. Generated meshes
+ * are cached in the config dir, keyed on the device, the mesh size and the
+ * output of the distortion function, and checked against more samples of the
+ * function when loaded. Only the most recently used meshes are kept, set
+ * `XRT_MESH_CACHE=false` to always regenerate.
+ *
  * @relatesalso xrt_device
  * @ingroup aux_distortion
  */
@@ -0,0 +1,580 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Pixel format conversion kernels used by the frame sink converters.
+ * @ingroup aux_util
+ */
+
+#include "util/u_debug.h"
+#include "util/u_format_convert.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define U_FORMAT_CONVERT_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define U_FORMAT_CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(convert_simd, "XRT_CONVERT_SIMD", true)
+
+
+/*
+ *
+ * Scalar functions.
+ *
+ */
+
+static inline int
+clamp_to_byte(int v)
+{
+	if (v < 0) {
+		return 0;
+	}
+	if (v >= 255) {
+		return 255;
+	}
+	return v;
+}
+
+static inline void
+YUV444_to_R8G8B8(int y, int u, int v, uint8_t *dst)
+{
+	int C = y - 16;
+	int D = u - 128;
+	int E = v - 128;
+
+	dst[0] = (uint8_t)clamp_to_byte((298 * C + 409 * E + 128) >> 8);
+	dst[1] = (uint8_t)clamp_to_byte((298 * C - 100 * D - 209 * E + 128) >> 8);
+	dst[2] = (uint8_t)clamp_to_byte((298 * C + 516 * D + 128) >> 8);
+}
+
+static inline void
+L8_to_R8G8B8_row(const uint8_t *src, uint8_t *dst, uint32_t x, uint32_t w)
+{
+	for (; x < w; x++) {
+		dst[x * 3 + 2] = dst[x * 3 + 1] = dst[x * 3 + 0] = src[x];
+	}
+}
+
+static inline void
+YUYV422_to_R8G8B8_row(const uint8_t *src, uint8_t *dst, uint32_t x, uint32_t w)
+{
+	for (; x < w; x += 2) {
+		const uint8_t *s = src + x * 2;
+		uint8_t *d = dst + x * 3;
+		YUV444_to_R8G8B8(s[0], s[1], s[3], d + 0);
+		YUV444_to_R8G8B8(s[2], s[1], s[3], d + 3);
+	}
+}
+
+static inline void
+YUYV422_to_L8_row(const uint8_t *src, uint8_t *dst, uint32_t x, uint32_t w)
+{
+	for (; x < w; x++) {
+		dst[x] = src[x * 2];
+	}
+}
+
+static inline void
+UYVY422_to_R8G8B8_row(const uint8_t *src, uint8_t *dst, uint32_t x, uint32_t w)
+{
+	for (; x < w; x += 2) {
+		const uint8_t *s = src + x * 2;
+		uint8_t *d = dst + x * 3;
+		YUV444_to_R8G8B8(s[1], s[0], s[2], d + 0);
+		YUV444_to_R8G8B8(s[3], s[0], s[2], d + 3);
+	}
+}
+
+static inline void
+YUV888_to_R8G8B8_row(const uint8_t *src, uint8_t *dst, uint32_t x, uint32_t w)
+{
+	for (; x < w; x++) {
+		const uint8_t *s = src + x * 3;
+		YUV444_to_R8G8B8(s[0], s[1], s[2], dst + x * 3);
+	}
+}
+
+static inline void
+BAYER_GR8_to_R8G8B8_row(const uint8_t *src0, const uint8_t *src1, uint8_t *dst, uint32_t x, uint32_t w)
+{
+	for (; x < w; x++) {
+		uint8_t g0 = src0[x * 2 + 0];
+		uint8_t r = src0[x * 2 + 1];
+		uint8_t b = src1[x * 2 + 0];
+		uint8_t g1 = src1[x * 2 + 1];
+
+		dst[x * 3 + 0] = r;
+		dst[x * 3 + 1] = (uint8_t)((g0 + g1) / 2);
+		dst[x * 3 + 2] = b;
+	}
+}
+
+/*!
+ * Defines the image level function for a row function that takes a single
+ * source row, @p IMPL is the suffix of both the function and the row function.
+ */
+#define DEFINE_IMAGE_FUNC(NAME, IMPL)                                                                                  \
+	static void NAME##_##IMPL(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride, uint32_t w,  \
+	                          uint32_t h)                                                                          \
+	{                                                                                                              \
+		for (uint32_t y = 0; y < h; y++) {                                                                     \
+			NAME##_row_##IMPL(src + y * src_stride, dst + y * dst_stride, w);                              \
+		}                                                                                                      \
+	}
+
+#define DEFINE_SCALAR_ROW_FUNC(NAME)                                                                                   \
+	static inline void NAME##_row_scalar(const uint8_t *src, uint8_t *dst, uint32_t w)                             \
+	{                                                                                                              \
+		NAME##_row(src, dst, 0, w);                                                                            \
+	}                                                                                                              \
+	DEFINE_IMAGE_FUNC(NAME, scalar)
+
+DEFINE_SCALAR_ROW_FUNC(L8_to_R8G8B8)
+DEFINE_SCALAR_ROW_FUNC(YUYV422_to_R8G8B8)
+DEFINE_SCALAR_ROW_FUNC(YUYV422_to_L8)
+DEFINE_SCALAR_ROW_FUNC(UYVY422_to_R8G8B8)
+DEFINE_SCALAR_ROW_FUNC(YUV888_to_R8G8B8)
+
+static void
+BAYER_GR8_to_R8G8B8_scalar(
+    const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride, uint32_t w, uint32_t h)
+{
+	for (uint32_t y = 0; y < h; y++) {
+		const uint8_t *src0 = src + (y * 2) * src_stride;
+		const uint8_t *src1 = src + (y * 2 + 1) * src_stride;
+		BAYER_GR8_to_R8G8B8_row(src0, src1, dst + y * dst_stride, 0, w);
+	}
+}
+
+static const struct u_format_convert_funcs scalar_funcs = {
+    .name = "scalar",
+    .l8_to_r8g8b8 = L8_to_R8G8B8_scalar,
+    .yuyv422_to_r8g8b8 = YUYV422_to_R8G8B8_scalar,
+    .yuyv422_to_l8 = YUYV422_to_L8_scalar,
+    .uyvy422_to_r8g8b8 = UYVY422_to_R8G8B8_scalar,
+    .yuv888_to_r8g8b8 = YUV888_to_R8G8B8_scalar,
+    .bayer_gr8_to_r8g8b8 = BAYER_GR8_to_R8G8B8_scalar,
+};
+
+
+/*
+ *
+ * SSE2 functions, all x86-64 CPUs have these.
+ *
+ */
+
+#ifdef U_FORMAT_CONVERT_SSE2
+
+//! Two 16 bit factors for _mm_madd_epi16, @p a multiplies the even lanes.
+#define PAIR(a, b) _mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)(b) << 16) | (uint16_t)(a)))
+
+/*!
+ * Same math as @ref YUV444_to_R8G8B8 for 8 pixels, the inputs are 16 bit
+ * lanes holding 0 to 255, the outputs are not yet clamped to a byte.
+ */
+static inline void
+yuv_to_rgb_8_sse2(__m128i y, __m128i u, __m128i v, __m128i *out_r, __m128i *out_g, __m128i *out_b)
+{
+	const __m128i c = _mm_sub_epi16(y, _mm_set1_epi16(16));
+	const __m128i d = _mm_sub_epi16(u, _mm_set1_epi16(128));
+	const __m128i e = _mm_sub_epi16(v, _mm_set1_epi16(128));
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i round = _mm_set1_epi32(128);
+
+	// Interleave the terms so each madd does two multiplies and the add.
+	__m128i ce_lo = _mm_unpacklo_epi16(c, e);
+	__m128i ce_hi = _mm_unpackhi_epi16(c, e);
+	__m128i cd_lo = _mm_unpacklo_epi16(c, d);
+	__m128i cd_hi = _mm_unpackhi_epi16(c, d);
+	__m128i e1_lo = _mm_unpacklo_epi16(e, one);
+	__m128i e1_hi = _mm_unpackhi_epi16(e, one);
+
+	__m128i r_lo = _mm_add_epi32(_mm_madd_epi16(ce_lo, PAIR(298, 409)), round);
+	__m128i r_hi = _mm_add_epi32(_mm_madd_epi16(ce_hi, PAIR(298, 409)), round);
+	__m128i g_lo = _mm_add_epi32(_mm_madd_epi16(cd_lo, PAIR(298, -100)), _mm_madd_epi16(e1_lo, PAIR(-209, 128)));
+	__m128i g_hi = _mm_add_epi32(_mm_madd_epi16(cd_hi, PAIR(298, -100)), _mm_madd_epi16(e1_hi, PAIR(-209, 128)));
+	__m128i b_lo = _mm_add_epi32(_mm_madd_epi16(cd_lo, PAIR(298, 516)), round);
+	__m128i b_hi = _mm_add_epi32(_mm_madd_epi16(cd_hi, PAIR(298, 516)), round);
+
+	// Results are within +-512 after the shift, so the signed pack is exact.
+	*out_r = _mm_packs_epi32(_mm_srai_epi32(r_lo, 8), _mm_srai_epi32(r_hi, 8));
+	*out_g = _mm_packs_epi32(_mm_srai_epi32(g_lo, 8), _mm_srai_epi32(g_hi, 8));
+	*out_b = _mm_packs_epi32(_mm_srai_epi32(b_lo, 8), _mm_srai_epi32(b_hi, 8));
+}
+
+/*!
+ * Writes 16 pixels of packed RGB, SSE2 has no byte shuffle so this goes
+ * through RGBX and then narrows to 3 bytes per pixel.
+ */
+static inline void
+store_rgb_16_sse2(uint8_t *dst, __m128i r, __m128i g, __m128i b)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i rg_lo = _mm_unpacklo_epi8(r, g);
+	__m128i rg_hi = _mm_unpackhi_epi8(r, g);
+	__m128i bx_lo = _mm_unpacklo_epi8(b, zero);
+	__m128i bx_hi = _mm_unpackhi_epi8(b, zero);
+
+	uint32_t rgbx[16];
+	_mm_storeu_si128((__m128i *)&rgbx[0], _mm_unpacklo_epi16(rg_lo, bx_lo));
+	_mm_storeu_si128((__m128i *)&rgbx[4], _mm_unpackhi_epi16(rg_lo, bx_lo));
+	_mm_storeu_si128((__m128i *)&rgbx[8], _mm_unpacklo_epi16(rg_hi, bx_hi));
+	_mm_storeu_si128((__m128i *)&rgbx[12], _mm_unpackhi_epi16(rg_hi, bx_hi));
+
+	// The X byte is overwritten by the next pixel, only the last one is trimmed.
+	for (int i = 0; i < 15; i++) {
+		memcpy(dst + i * 3, &rgbx[i], 4);
+	}
+	memcpy(dst + 15 * 3, &rgbx[15], 3);
+}
+
+/*!
+ * Splits 8 pixels of packed 4:2:2 into 16 bit Y lanes and U and V lanes that
+ * are duplicated for both pixels of each pair.
+ */
+static inline void
+split_422_sse2(__m128i px, bool y_first, __m128i *out_y, __m128i *out_u, __m128i *out_v)
+{
+	const __m128i low_byte = _mm_set1_epi16(0x00ff);
+	const __m128i low_word = _mm_set1_epi32(0x0000ffff);
+
+	__m128i y = y_first ? _mm_and_si128(px, low_byte) : _mm_srli_epi16(px, 8);
+	__m128i uv = y_first ? _mm_srli_epi16(px, 8) : _mm_and_si128(px, low_byte);
+
+	__m128i u = _mm_and_si128(uv, low_word);
+	__m128i v = _mm_srli_epi32(uv, 16);
+
+	*out_y = y;
+	*out_u = _mm_or_si128(u, _mm_slli_epi32(u, 16));
+	*out_v = _mm_or_si128(v, _mm_slli_epi32(v, 16));
+}
+
+static inline void
+YUV422_to_R8G8B8_row_sse2(const uint8_t *src, uint8_t *dst, uint32_t w, bool y_first)
+{
+	uint32_t x = 0;
+	for (; x + 16 <= w; x += 16) {
+		__m128i y, u, v;
+		__m128i r0, g0, b0, r1, g1, b1;
+
+		split_422_sse2(_mm_loadu_si128((const __m128i *)(src + x * 2)), y_first, &y, &u, &v);
+		yuv_to_rgb_8_sse2(y, u, v, &r0, &g0, &b0);
+		split_422_sse2(_mm_loadu_si128((const __m128i *)(src + x * 2 + 16)), y_first, &y, &u, &v);
+		yuv_to_rgb_8_sse2(y, u, v, &r1, &g1, &b1);
+
+		store_rgb_16_sse2(dst + x * 3, _mm_packus_epi16(r0, r1), _mm_packus_epi16(g0, g1),
+		                  _mm_packus_epi16(b0, b1));
+	}
+
+	if (y_first) {
+		YUYV422_to_R8G8B8_row(src, dst, x, w);
+	} else {
+		UYVY422_to_R8G8B8_row(src, dst, x, w);
+	}
+}
+
+static inline void
+YUYV422_to_R8G8B8_row_sse2(const uint8_t *src, uint8_t *dst, uint32_t w)
+{
+	YUV422_to_R8G8B8_row_sse2(src, dst, w, true);
+}
+
+static inline void
+UYVY422_to_R8G8B8_row_sse2(const uint8_t *src, uint8_t *dst, uint32_t w)
+{
+	YUV422_to_R8G8B8_row_sse2(src, dst, w, false);
+}
+
+static inline void
+YUV888_to_R8G8B8_row_sse2(const uint8_t *src, uint8_t *dst, uint32_t w)
+{
+	uint32_t x = 0;
+	for (; x + 16 <= w; x += 16) {
+		// No cheap 3 channel de-interleave in SSE2, gather into planes.
+		int16_t planes[3][16];
+		for (int i = 0; i < 16; i++) {
+			planes[0][i] = src[(x + i) * 3 + 0];
+			planes[1][i] = src[(x + i) * 3 + 1];
+			planes[2][i] = src[(x + i) * 3 + 2];
+		}
+
+		__m128i r0, g0, b0, r1, g1, b1;
+		yuv_to_rgb_8_sse2(_mm_loadu_si128((const __m128i *)&planes[0][0]),
+		                  _mm_loadu_si128((const __m128i *)&planes[1][0]),
+		                  _mm_loadu_si128((const __m128i *)&planes[2][0]), &r0, &g0, &b0);
+		yuv_to_rgb_8_sse2(_mm_loadu_si128((const __m128i *)&planes[0][8]),
+		                  _mm_loadu_si128((const __m128i *)&planes[1][8]),
+		                  _mm_loadu_si128((const __m128i *)&planes[2][8]), &r1, &g1, &b1);
+
+		store_rgb_16_sse2(dst + x * 3, _mm_packus_epi16(r0, r1), _mm_packus_epi16(g0, g1),
+		                  _mm_packus_epi16(b0, b1));
+	}
+
+	YUV888_to_R8G8B8_row(src, dst, x, w);
+}
+
+static inline void
+L8_to_R8G8B8_row_sse2(const uint8_t *src, uint8_t *dst, uint32_t w)
+{
+	uint32_t x = 0;
+	for (; x + 16 <= w; x += 16) {
+		__m128i l = _mm_loadu_si128((const __m128i *)(src + x));
+		store_rgb_16_sse2(dst + x * 3, l, l, l);
+	}
+
+	L8_to_R8G8B8_row(src, dst, x, w);
+}
+
+static inline void
+YUYV422_to_L8_row_sse2(const uint8_t *src, uint8_t *dst, uint32_t w)
+{
+	const __m128i low_byte = _mm_set1_epi16(0x00ff);
+
+	uint32_t x = 0;
+	for (; x + 16 <= w; x += 16) {
+		__m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + x * 2)), low_byte);
+		__m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + x * 2 + 16)), low_byte);
+		_mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(a, b));
+	}
+
+	YUYV422_to_L8_row(src, dst, x, w);
+}
+
+DEFINE_IMAGE_FUNC(L8_to_R8G8B8, sse2)
+DEFINE_IMAGE_FUNC(YUYV422_to_R8G8B8, sse2)
+DEFINE_IMAGE_FUNC(YUYV422_to_L8, sse2)
+DEFINE_IMAGE_FUNC(UYVY422_to_R8G8B8, sse2)
+DEFINE_IMAGE_FUNC(YUV888_to_R8G8B8, sse2)
+
+static void
+BAYER_GR8_to_R8G8B8_sse2(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride, uint32_t w, uint32_t h)
+{
+	const __m128i low_byte = _mm_set1_epi16(0x00ff);
+
+	for (uint32_t y = 0; y < h; y++) {
+		const uint8_t *src0 = src + (y * 2) * src_stride;
+		const uint8_t *src1 = src + (y * 2 + 1) * src_stride;
+		uint8_t *d = dst + y * dst_stride;
+
+		uint32_t x = 0;
+		for (; x + 16 <= w; x += 16) {
+			__m128i gr0 = _mm_loadu_si128((const __m128i *)(src0 + x * 2));
+			__m128i gr1 = _mm_loadu_si128((const __m128i *)(src0 + x * 2 + 16));
+			__m128i bg0 = _mm_loadu_si128((const __m128i *)(src1 + x * 2));
+			__m128i bg1 = _mm_loadu_si128((const __m128i *)(src1 + x * 2 + 16));
+
+			// Truncating average, _mm_avg_epu8 rounds up which isn't what the scalar code does.
+			__m128i g0 = _mm_srli_epi16(
+			    _mm_add_epi16(_mm_and_si128(gr0, low_byte), _mm_srli_epi16(bg0, 8)), 1);
+			__m128i g1 = _mm_srli_epi16(
+			    _mm_add_epi16(_mm_and_si128(gr1, low_byte), _mm_srli_epi16(bg1, 8)), 1);
+
+			__m128i r = _mm_packus_epi16(_mm_srli_epi16(gr0, 8), _mm_srli_epi16(gr1, 8));
+			__m128i g = _mm_packus_epi16(g0, g1);
+			__m128i b = _mm_packus_epi16(_mm_and_si128(bg0, low_byte), _mm_and_si128(bg1, low_byte));
+
+			store_rgb_16_sse2(d + x * 3, r, g, b);
+		}
+
+		BAYER_GR8_to_R8G8B8_row(src0, src1, d, x, w);
+	}
+}
+
+static const struct u_format_convert_funcs simd_funcs = {
+    .name = "sse2",
+    .l8_to_r8g8b8 = L8_to_R8G8B8_sse2,
+    .yuyv422_to_r8g8b8 = YUYV422_to_R8G8B8_sse2,
+    .yuyv422_to_l8 = YUYV422_to_L8_sse2,
+    .uyvy422_to_r8g8b8 = UYVY422_to_R8G8B8_sse2,
+    .yuv888_to_r8g8b8 = YUV888_to_R8G8B8_sse2,
+    .bayer_gr8_to_r8g8b8 = BAYER_GR8_to_R8G8B8_sse2,
+};
+
+#endif // U_FORMAT_CONVERT_SSE2
+
+
+/*
+ *
+ * NEON functions, all AArch64 CPUs have these.
+ *
+ */
+
+#ifdef U_FORMAT_CONVERT_NEON
+
+/*!
+ * Same math as @ref YUV444_to_R8G8B8 for 8 pixels, including the clamping.
+ */
+static inline uint8x8x3_t
+yuv_to_rgb_8_neon(uint8x8_t y, uint8x8_t u, uint8x8_t v)
+{
+	int16x8_t c = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y)), vdupq_n_s16(16));
+	int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u)), vdupq_n_s16(128));
+	int16x8_t e = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v)), vdupq_n_s16(128));
+
+	int32x4_t base_lo = vmlal_n_s16(vdupq_n_s32(128), vget_low_s16(c), 298);
+	int32x4_t base_hi = vmlal_n_s16(vdupq_n_s32(128), vget_high_s16(c), 298);
+
+	int32x4_t r_lo = vmlal_n_s16(base_lo, vget_low_s16(e), 409);
+	int32x4_t r_hi = vmlal_n_s16(base_hi, vget_high_s16(e), 409);
+	int32x4_t g_lo = vmlal_n_s16(vmlal_n_s16(base_lo, vget_low_s16(d), -100), vget_low_s16(e), -209);
+	int32x4_t g_hi = vmlal_n_s16(vmlal_n_s16(base_hi, vget_high_s16(d), -100), vget_high_s16(e), -209);
+	int32x4_t b_lo = vmlal_n_s16(base_lo, vget_low_s16(d), 516);
+	int32x4_t b_hi = vmlal_n_s16(base_hi, vget_high_s16(d), 516);
+
+	uint8x8x3_t rgb;
+	rgb.val[0] = vqmovun_s16(vcombine_s16(vqshrn_n_s32(r_lo, 8), vqshrn_n_s32(r_hi, 8)));
+	rgb.val[1] = vqmovun_s16(vcombine_s16(vqshrn_n_s32(g_lo, 8), vqshrn_n_s32(g_hi, 8)));
+	rgb.val[2] = vqmovun_s16(vcombine_s16(vqshrn_n_s32(b_lo, 8), vqshrn_n_s32(b_hi, 8)));
+	return rgb;
+}
+
+//! Interleaves the even and odd pixels of 4:2:2 data back into 16 pixels.
+static inline uint8x16x3_t
+zip_rgb_neon(uint8x8x3_t even, uint8x8x3_t odd)
+{
+	uint8x16x3_t rgb;
+	for (int i = 0; i < 3; i++) {
+		uint8x8x2_t z = vzip_u8(even.val[i], odd.val[i]);
+		rgb.val[i] = vcombine_u8(z.val[0], z.val[1]);
+	}
+	return rgb;
+}
+
+static inline void
+YUYV422_to_R8G8B8_row_neon(const uint8_t *src, uint8_t *dst, uint32_t w)
+{
+	uint32_t x = 0;
+	for (; x + 16 <= w; x += 16) {
+		// Y0 U Y1 V
+		uint8x8x4_t px = vld4_u8(src + x * 2);
+		uint8x8x3_t even = yuv_to_rgb_8_neon(px.val[0], px.val[1], px.val[3]);
+		uint8x8x3_t odd = yuv_to_rgb_8_neon(px.val[2], px.val[1], px.val[3]);
+		vst3q_u8(dst + x * 3, zip_rgb_neon(even, odd));
+	}
+
+	YUYV422_to_R8G8B8_row(src, dst, x, w);
+}
+
+static inline void
+UYVY422_to_R8G8B8_row_neon(const uint8_t *src, uint8_t *dst, uint32_t w)
+{
+	uint32_t x = 0;
+	for (; x + 16 <= w; x += 16) {
+		// U Y0 V Y1
+		uint8x8x4_t px = vld4_u8(src + x * 2);
+		uint8x8x3_t even = yuv_to_rgb_8_neon(px.val[1], px.val[0], px.val[2]);
+		uint8x8x3_t odd = yuv_to_rgb_8_neon(px.val[3], px.val[0], px.val[2]);
+		vst3q_u8(dst + x * 3, zip_rgb_neon(even, odd));
+	}
+
+	UYVY422_to_R8G8B8_row(src, dst, x, w);
+}
+
+static inline void
+YUV888_to_R8G8B8_row_neon(const uint8_t *src, uint8_t *dst, uint32_t w)
+{
+	uint32_t x = 0;
+	for (; x + 8 <= w; x += 8) {
+		uint8x8x3_t yuv = vld3_u8(src + x * 3);
+		vst3_u8(dst + x * 3, yuv_to_rgb_8_neon(yuv.val[0], yuv.val[1], yuv.val[2]));
+	}
+
+	YUV888_to_R8G8B8_row(src, dst, x, w);
+}
+
+static inline void
+L8_to_R8G8B8_row_neon(const uint8_t *src, uint8_t *dst, uint32_t w)
+{
+	uint32_t x = 0;
+	for (; x + 16 <= w; x += 16) {
+		uint8x16x3_t rgb;
+		rgb.val[0] = rgb.val[1] = rgb.val[2] = vld1q_u8(src + x);
+		vst3q_u8(dst + x * 3, rgb);
+	}
+
+	L8_to_R8G8B8_row(src, dst, x, w);
+}
+
+static inline void
+YUYV422_to_L8_row_neon(const uint8_t *src, uint8_t *dst, uint32_t w)
+{
+	uint32_t x = 0;
+	for (; x + 16 <= w; x += 16) {
+		vst1q_u8(dst + x, vld2q_u8(src + x * 2).val[0]);
+	}
+
+	YUYV422_to_L8_row(src, dst, x, w);
+}
+
+DEFINE_IMAGE_FUNC(L8_to_R8G8B8, neon)
+DEFINE_IMAGE_FUNC(YUYV422_to_R8G8B8, neon)
+DEFINE_IMAGE_FUNC(YUYV422_to_L8, neon)
+DEFINE_IMAGE_FUNC(UYVY422_to_R8G8B8, neon)
+DEFINE_IMAGE_FUNC(YUV888_to_R8G8B8, neon)
+
+static void
+BAYER_GR8_to_R8G8B8_neon(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride, uint32_t w, uint32_t h)
+{
+	for (uint32_t y = 0; y < h; y++) {
+		const uint8_t *src0 = src + (y * 2) * src_stride;
+		const uint8_t *src1 = src + (y * 2 + 1) * src_stride;
+		uint8_t *d = dst + y * dst_stride;
+
+		uint32_t x = 0;
+		for (; x + 16 <= w; x += 16) {
+			uint8x16x2_t gr = vld2q_u8(src0 + x * 2);
+			uint8x16x2_t bg = vld2q_u8(src1 + x * 2);
+
+			uint8x16x3_t rgb;
+			rgb.val[0] = gr.val[1];
+			rgb.val[1] = vhaddq_u8(gr.val[0], bg.val[1]); // Truncating, same as the scalar code.
+			rgb.val[2] = bg.val[0];
+			vst3q_u8(d + x * 3, rgb);
+		}
+
+		BAYER_GR8_to_R8G8B8_row(src0, src1, d, x, w);
+	}
+}
+
+static const struct u_format_convert_funcs simd_funcs = {
+    .name = "neon",
+    .l8_to_r8g8b8 = L8_to_R8G8B8_neon,
+    .yuyv422_to_r8g8b8 = YUYV422_to_R8G8B8_neon,
+    .yuyv422_to_l8 = YUYV422_to_L8_neon,
+    .uyvy422_to_r8g8b8 = UYVY422_to_R8G8B8_neon,
+    .yuv888_to_r8g8b8 = YUV888_to_R8G8B8_neon,
+    .bayer_gr8_to_r8g8b8 = BAYER_GR8_to_R8G8B8_neon,
+};
+
+#endif // U_FORMAT_CONVERT_NEON
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+const struct u_format_convert_funcs *
+u_format_convert_get_scalar(void)
+{
+	return &scalar_funcs;
+}
+
+const struct u_format_convert_funcs *
+u_format_convert_get_best(void)
+{
+#if defined(U_FORMAT_CONVERT_SSE2) || defined(U_FORMAT_CONVERT_NEON)
+	if (debug_get_bool_option_convert_simd()) {
+		return &simd_funcs;
+	}
+#endif
+	return &scalar_funcs;
+}
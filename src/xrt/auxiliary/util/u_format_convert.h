@@ -0,0 +1,70 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Pixel format conversion kernels used by the frame sink converters.
+ * @ingroup aux_util
+ */
+
+#pragma once
+
+#include "xrt/xrt_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*!
+ * Converts @p height rows of @p width pixels from @p src to @p dst, the rows
+ * of both images may be padded as given by the strides.
+ *
+ * For the Bayer conversion @p width and @p height are of the destination,
+ * every destination row consumes two source rows.
+ *
+ * @ingroup aux_util
+ */
+typedef void (*u_format_convert_func_t)(
+    const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride, uint32_t width, uint32_t height);
+
+/*!
+ * A set of conversion kernels, all implementations produce bit identical
+ * results.
+ *
+ * @ingroup aux_util
+ */
+struct u_format_convert_funcs
+{
+	//! Name of the implementation, for logging.
+	const char *name;
+
+	u_format_convert_func_t l8_to_r8g8b8;
+	u_format_convert_func_t yuyv422_to_r8g8b8;
+	u_format_convert_func_t yuyv422_to_l8;
+	u_format_convert_func_t uyvy422_to_r8g8b8;
+	u_format_convert_func_t yuv888_to_r8g8b8;
+	u_format_convert_func_t bayer_gr8_to_r8g8b8;
+};
+
+/*!
+ * The plain C implementation, always available.
+ *
+ * @ingroup aux_util
+ */
+const struct u_format_convert_funcs *
+u_format_convert_get_scalar(void);
+
+/*!
+ * The fastest implementation for this CPU, SSE2 on x86-64 and NEON on
+ * AArch64. Falls back to @ref u_format_convert_get_scalar if there are no
+ * vector kernels for the CPU or if `XRT_CONVERT_SIMD` is set to false.
+ *
+ * @ingroup aux_util
+ */
+const struct u_format_convert_funcs *
+u_format_convert_get_best(void);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,245 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Recycling allocator for @ref xrt_frame.
+ * @ingroup aux_util
+ */
+
+#include "os/os_threading.h"
+
+#include "util/u_misc.h"
+#include "util/u_format.h"
+#include "util/u_frame_pool.h"
+
+#include <assert.h>
+#include <string.h>
+
+
+struct pool;
+
+struct pool_frame
+{
+	//! Base struct has to come first.
+	struct xrt_frame base;
+
+	//! Pool this frame belongs to, referenced while the frame is in use.
+	struct pool *p;
+
+	//! Next frame in the free list.
+	struct pool_frame *next;
+};
+
+struct pool
+{
+	struct u_frame_pool base;
+
+	//! Protects the free list and the stats.
+	struct os_mutex mutex;
+
+	//! Unused frames, most recently returned first.
+	struct pool_frame *free_list;
+
+	//! Max number of frames in @ref free_list.
+	uint32_t max_free_count;
+
+	struct u_frame_pool_stats stats;
+};
+
+
+/*
+ *
+ * Helper functions.
+ *
+ */
+
+static inline struct pool *
+pool(struct u_frame_pool *ufp)
+{
+	return (struct pool *)ufp;
+}
+
+static void
+free_frame(struct pool_frame *pf)
+{
+	free(pf->base.data);
+	free(pf);
+}
+
+static void
+return_frame(struct xrt_frame *xf)
+{
+	struct pool_frame *pf = (struct pool_frame *)xf;
+	struct pool *p = pf->p;
+
+	assert(xf->reference.count == 0);
+
+	os_mutex_lock(&p->mutex);
+
+	p->stats.in_use--;
+
+	if (p->stats.free < p->max_free_count) {
+		pf->next = p->free_list;
+		p->free_list = pf;
+		p->stats.free++;
+		pf = NULL;
+	} else {
+		p->stats.freed++;
+	}
+
+	os_mutex_unlock(&p->mutex);
+
+	if (pf != NULL) {
+		free_frame(pf);
+	}
+
+	// Might destroy the pool, which frees the frame if it was put on the free list.
+	struct u_frame_pool *ufp = &p->base;
+	u_frame_pool_reference(&ufp, NULL);
+}
+
+/*!
+ * Gets a frame with exactly this layout from the free list or allocates a new
+ * one, everything but the layout and data is zeroed.
+ */
+static struct xrt_frame *
+get_frame(struct pool *p, enum xrt_format f, uint32_t width, uint32_t height, size_t stride, size_t size)
+{
+	struct pool_frame *pf = NULL;
+
+	os_mutex_lock(&p->mutex);
+
+	for (struct pool_frame **it = &p->free_list; *it != NULL; it = &(*it)->next) {
+		struct xrt_frame *xf = &(*it)->base;
+		if (xf->format == f && xf->width == width && xf->height == height && xf->stride == stride &&
+		    xf->size == size) {
+			pf = *it;
+			*it = pf->next;
+			p->stats.free--;
+			break;
+		}
+	}
+
+	if (pf != NULL) {
+		p->stats.reused++;
+	} else {
+		p->stats.allocated++;
+	}
+	p->stats.in_use++;
+
+	os_mutex_unlock(&p->mutex);
+
+	uint8_t *data = NULL;
+	if (pf != NULL) {
+		data = pf->base.data;
+		U_ZERO(pf);
+	} else {
+		pf = U_TYPED_CALLOC(struct pool_frame);
+		data = U_TYPED_ARRAY_CALLOC(uint8_t, size);
+	}
+
+	struct xrt_frame *xf = &pf->base;
+	xf->format = f;
+	xf->width = width;
+	xf->height = height;
+	xf->stride = stride;
+	xf->size = size;
+	xf->data = data;
+	xf->destroy = return_frame;
+
+	// Keep the pool alive while the frame is out.
+	struct u_frame_pool *ufp = NULL;
+	u_frame_pool_reference(&ufp, &p->base);
+	pf->p = p;
+
+	return xf;
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+struct u_frame_pool *
+u_frame_pool_create(uint32_t max_free_count)
+{
+	struct pool *p = U_TYPED_CALLOC(struct pool);
+	p->base.reference.count = 1;
+	p->max_free_count = max_free_count;
+
+	int ret = os_mutex_init(&p->mutex);
+	if (ret != 0) {
+		free(p);
+		return NULL;
+	}
+
+	return &p->base;
+}
+
+void
+u_frame_pool_destroy(struct u_frame_pool *ufp)
+{
+	struct pool *p = pool(ufp);
+	assert(p->base.reference.count == 0);
+	assert(p->stats.in_use == 0);
+
+	while (p->free_list != NULL) {
+		struct pool_frame *pf = p->free_list;
+		p->free_list = pf->next;
+		free_frame(pf);
+	}
+
+	os_mutex_destroy(&p->mutex);
+	free(p);
+}
+
+void
+u_frame_pool_create_frame(struct u_frame_pool *ufp,
+                          enum xrt_format f,
+                          uint32_t width,
+                          uint32_t height,
+                          struct xrt_frame **out_frame)
+{
+	assert(width > 0);
+	assert(height > 0);
+	assert(u_format_is_blocks(f));
+
+	size_t stride = 0;
+	size_t size = 0;
+	u_format_size_for_dimensions(f, width, height, &stride, &size);
+
+	struct xrt_frame *xf = get_frame(pool(ufp), f, width, height, stride, size);
+
+	xrt_frame_reference(out_frame, xf);
+}
+
+void
+u_frame_pool_clone(struct u_frame_pool *ufp, struct xrt_frame *to_copy, struct xrt_frame **out_frame)
+{
+	struct xrt_frame *xf =
+	    get_frame(pool(ufp), to_copy->format, to_copy->width, to_copy->height, to_copy->stride, to_copy->size);
+
+	// Explicitly only copy the fields we want, same as u_frame_clone.
+	xf->stereo_format = to_copy->stereo_format;
+
+	xf->timestamp = to_copy->timestamp;
+	xf->source_timestamp = to_copy->source_timestamp;
+	xf->source_sequence = to_copy->source_sequence;
+	xf->source_id = to_copy->source_id;
+
+	memcpy(xf->data, to_copy->data, xf->size);
+
+	xrt_frame_reference(out_frame, xf);
+}
+
+void
+u_frame_pool_get_stats(struct u_frame_pool *ufp, struct u_frame_pool_stats *out_stats)
+{
+	struct pool *p = pool(ufp);
+
+	os_mutex_lock(&p->mutex);
+	*out_stats = p->stats;
+	os_mutex_unlock(&p->mutex);
+}
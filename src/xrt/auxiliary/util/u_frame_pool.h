@@ -0,0 +1,132 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Recycling allocator for @ref xrt_frame.
+ * @ingroup aux_util
+ */
+
+#pragma once
+
+#include "xrt/xrt_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*!
+ * A pool of frames, frames created from it go back to the pool when their
+ * reference count reaches zero and are handed out again for requests with the
+ * same format, dimensions and layout. Every frame holds a reference to the
+ * pool, so the pool can be unreferenced while frames are still in flight.
+ *
+ * @ingroup aux_util
+ */
+struct u_frame_pool
+{
+	struct xrt_reference reference;
+};
+
+/*!
+ * Allocation statistics of a @ref u_frame_pool.
+ *
+ * @ingroup aux_util
+ */
+struct u_frame_pool_stats
+{
+	uint64_t allocated; //!< Frames that had to be allocated.
+	uint64_t reused;    //!< Frames handed out again from the free list.
+	uint64_t freed;     //!< Frames freed because the free list was full.
+	uint32_t in_use;    //!< Frames currently referenced outside of the pool.
+	uint32_t free;      //!< Frames currently on the free list.
+};
+
+/*!
+ * A good default for the max free count of a pool used by a single producer,
+ * covers the frames typically held by downstream queues.
+ *
+ * @ingroup aux_util
+ */
+#define U_FRAME_POOL_DEFAULT_MAX_FREE_COUNT (8)
+
+/*!
+ * Creates a new frame pool.
+ *
+ * @param max_free_count Maximum number of unused frames kept around for
+ *                       reuse, frames returned beyond that are freed.
+ *
+ * @ingroup aux_util
+ */
+struct u_frame_pool *
+u_frame_pool_create(uint32_t max_free_count);
+
+/*!
+ * Internal function, only called by reference.
+ *
+ * @ingroup aux_util
+ */
+void
+u_frame_pool_destroy(struct u_frame_pool *ufp);
+
+/*!
+ * Standard Monado reference function.
+ *
+ * @ingroup aux_util
+ */
+static inline void
+u_frame_pool_reference(struct u_frame_pool **dst, struct u_frame_pool *src)
+{
+	struct u_frame_pool *old_dst = *dst;
+
+	if (old_dst == src) {
+		return;
+	}
+
+	if (src) {
+		xrt_reference_inc(&src->reference);
+	}
+
+	*dst = src;
+
+	if (old_dst) {
+		if (xrt_reference_dec_and_is_zero(&old_dst->reference)) {
+			u_frame_pool_destroy(old_dst);
+		}
+	}
+}
+
+/*!
+ * Same as @ref u_frame_create_one_off but gets the frame from the pool. All
+ * fields but the format, dimensions, stride, size and data are zeroed, the
+ * contents of the data are undefined.
+ *
+ * @ingroup aux_util
+ */
+void
+u_frame_pool_create_frame(struct u_frame_pool *ufp,
+                          enum xrt_format f,
+                          uint32_t width,
+                          uint32_t height,
+                          struct xrt_frame **out_frame);
+
+/*!
+ * Same as @ref u_frame_clone but gets the frame from the pool.
+ *
+ * @ingroup aux_util
+ */
+void
+u_frame_pool_clone(struct u_frame_pool *ufp, struct xrt_frame *to_copy, struct xrt_frame **out_frame);
+
+/*!
+ * Get the allocation statistics of the pool.
+ *
+ * @ingroup aux_util
+ */
+void
+u_frame_pool_get_stats(struct u_frame_pool *ufp, struct u_frame_pool_stats *out_stats);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -10,6 +10,85 @@
 #include "u_live_stats.h"
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+
+/*
+ *
+ * Histogram structs and helpers.
+ *
+ */
+
+namespace {
+
+/*!
+ * Each power of two range is split into this many linear sub-buckets, the
+ * bucket width is at most 1/32 of the value.
+ */
+constexpr uint32_t kSubBucketBits = 5;
+constexpr uint32_t kSubBucketCount = 1u << kSubBucketBits;
+
+//! Values at or above 2^40ns (about 18 minutes) end up in the last bucket.
+constexpr uint32_t kMaxValueBits = 40;
+constexpr uint64_t kMaxValue = (uint64_t(1) << kMaxValueBits) - 1;
+
+constexpr uint32_t kBucketCount = (kMaxValueBits - kSubBucketBits + 1) * kSubBucketCount;
+
+struct alignas(64) Shard
+{
+	std::atomic<uint64_t> sum;
+	std::atomic<uint64_t> worst;
+	std::atomic<uint64_t> buckets[kBucketCount];
+};
+
+//! Shared by all histograms, only picks which shard a thread uses.
+std::atomic<uint32_t> next_shard_index;
+thread_local uint32_t shard_index = next_shard_index.fetch_add(1, std::memory_order_relaxed);
+
+uint32_t
+bucket_index(uint64_t value)
+{
+	value = std::min(value, kMaxValue);
+	if (value < kSubBucketCount) {
+		return (uint32_t)value;
+	}
+
+	// Index of the highest set bit, at least kSubBucketBits here.
+	uint32_t shift = (uint32_t)std::bit_width(value) - 1 - kSubBucketBits;
+
+	return (shift + 1) * kSubBucketCount + (uint32_t)(value >> shift) - kSubBucketCount;
+}
+
+//! The highest value that ends up in the bucket.
+uint64_t
+bucket_highest_value(uint32_t index)
+{
+	if (index < kSubBucketCount) {
+		return index;
+	}
+
+	uint32_t shift = index / kSubBucketCount - 1;
+	uint64_t sub = index % kSubBucketCount + kSubBucketCount;
+
+	return ((sub + 1) << shift) - 1;
+}
+
+} // namespace
+
+struct u_live_stats_hist
+{
+	//! Small name used for printing.
+	char name[U_LIVE_STATS_NAME_COUNT];
+
+	Shard shards[U_LIVE_STATS_HIST_SHARD_COUNT];
+
+	//! Scratch space used when getting the statistics, so that doesn't allocate.
+	uint64_t merged[kBucketCount];
+};
 
 
 /*
@@ -114,3 +193,118 @@ u_ls_ns_print_and_reset(struct u_live_stats_ns *uls, u_pp_delegate_t dg)
 	print_as_ms(dg, mean);
 	print_as_ms(dg, worst);
 }
+
+extern "C" void
+u_ls_hist_create(const char *name, struct u_live_stats_hist **out_ulh)
+{
+	u_live_stats_hist *ulh = new u_live_stats_hist();
+
+	snprintf(ulh->name, sizeof(ulh->name), "%s", name);
+
+	*out_ulh = ulh;
+}
+
+extern "C" void
+u_ls_hist_destroy(struct u_live_stats_hist **ulh_ptr)
+{
+	u_live_stats_hist *ulh = *ulh_ptr;
+	if (ulh == nullptr) {
+		return;
+	}
+
+	delete ulh;
+	*ulh_ptr = nullptr;
+}
+
+extern "C" void
+u_ls_hist_add(struct u_live_stats_hist *ulh, uint64_t value_ns)
+{
+	Shard &shard = ulh->shards[shard_index % U_LIVE_STATS_HIST_SHARD_COUNT];
+
+	shard.buckets[bucket_index(value_ns)].fetch_add(1, std::memory_order_relaxed);
+	shard.sum.fetch_add(value_ns, std::memory_order_relaxed);
+
+	uint64_t worst = shard.worst.load(std::memory_order_relaxed);
+	while (worst < value_ns && !shard.worst.compare_exchange_weak(worst, value_ns, std::memory_order_relaxed)) {
+		// Retry, worst has been updated with the current value.
+	}
+}
+
+extern "C" void
+u_ls_hist_get_and_reset(struct u_live_stats_hist *ulh,
+                        const double *quantiles,
+                        uint64_t *out_values,
+                        uint32_t quantile_count,
+                        struct u_live_stats_hist_report *out_report)
+{
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	uint64_t worst = 0;
+
+	/*
+	 * Values added while merging end up either in this or the next report,
+	 * so the sum and worst may be very slightly off from the buckets.
+	 */
+	std::memset(ulh->merged, 0, sizeof(ulh->merged));
+	for (Shard &shard : ulh->shards) {
+		for (uint32_t i = 0; i < kBucketCount; i++) {
+			uint64_t c = shard.buckets[i].exchange(0, std::memory_order_relaxed);
+			ulh->merged[i] += c;
+			count += c;
+		}
+		sum += shard.sum.exchange(0, std::memory_order_relaxed);
+		worst = std::max(worst, shard.worst.exchange(0, std::memory_order_relaxed));
+	}
+
+	auto get_quantile = [&](double q) -> uint64_t {
+		if (count == 0) {
+			return 0;
+		}
+
+		uint64_t rank = (uint64_t)std::ceil(std::clamp(q, 0.0, 1.0) * (double)count);
+		rank = std::clamp<uint64_t>(rank, 1, count);
+
+		uint64_t seen = 0;
+		for (uint32_t i = 0; i < kBucketCount; i++) {
+			seen += ulh->merged[i];
+			if (seen >= rank) {
+				return std::min(bucket_highest_value(i), worst);
+			}
+		}
+
+		return worst;
+	};
+
+	for (uint32_t i = 0; i < quantile_count; i++) {
+		out_values[i] = get_quantile(quantiles[i]);
+	}
+
+	out_report->count = count;
+	out_report->mean = count > 0 ? sum / count : 0;
+	out_report->p50 = get_quantile(0.5);
+	out_report->p90 = get_quantile(0.9);
+	out_report->p99 = get_quantile(0.99);
+	out_report->p999 = get_quantile(0.999);
+	out_report->worst = worst;
+}
+
+extern "C" void
+u_ls_hist_print_header(u_pp_delegate_t dg)
+{
+	//       "xxxxYYYYzzzzWWWW M'TTT'###.FFFms M'TTT'###.FFFms M'TTT'###.FFFms M'TTT'###.FFFms M'TTT'###.FFFms"
+	u_pp(dg, "            name             p50             p90             p99           p99.9           worst");
+}
+
+extern "C" void
+u_ls_hist_print_and_reset(struct u_live_stats_hist *ulh, u_pp_delegate_t dg)
+{
+	struct u_live_stats_hist_report report;
+	u_ls_hist_get_and_reset(ulh, NULL, NULL, 0, &report);
+
+	u_pp(dg, "%16s", ulh->name);
+	print_as_ms(dg, report.p50);
+	print_as_ms(dg, report.p90);
+	print_as_ms(dg, report.p99);
+	print_as_ms(dg, report.p999);
+	print_as_ms(dg, report.worst);
+}
@@ -101,6 +101,116 @@ void
 u_ls_ns_print_and_reset(struct u_live_stats_ns *uls, u_pp_delegate_t dg);
 
 
+/*
+ *
+ * Histogram variant.
+ *
+ */
+
+/*!
+ * Number of shards in a @ref u_live_stats_hist, each thread adding values
+ * picks one so threads mostly don't share cache lines.
+ *
+ * @ingroup aux_util
+ */
+#define U_LIVE_STATS_HIST_SHARD_COUNT (4)
+
+/*!
+ * Live statistic tracking of nano-seconds values using a log-linear (HDR
+ * style) histogram, values are bucketed with about 3% precision.
+ *
+ * Unlike @ref u_live_stats_ns it never fills up, adding is O(1) and may be
+ * done from any number of threads at the same time without locking. Getting
+ * the statistics merges the shards and doesn't allocate or sort, but should
+ * only be done from one thread at a time.
+ *
+ * @ingroup aux_util
+ */
+struct u_live_stats_hist;
+
+/*!
+ * Statistics calculated by @ref u_ls_hist_get_and_reset, all values in
+ * nano-seconds except @ref count.
+ *
+ * @ingroup aux_util
+ */
+struct u_live_stats_hist_report
+{
+	//! Number of values added since the last reset.
+	uint64_t count;
+
+	uint64_t mean;
+	uint64_t p50;
+	uint64_t p90;
+	uint64_t p99;
+	uint64_t p999;
+
+	//! Exact, not bucketed.
+	uint64_t worst;
+};
+
+/*!
+ * Create a histogram, @p name is copied and used for printing.
+ *
+ * @public @memberof u_live_stats_hist
+ * @ingroup aux_util
+ */
+void
+u_ls_hist_create(const char *name, struct u_live_stats_hist **out_ulh);
+
+/*!
+ * Destroy a histogram, sets the pointer to NULL.
+ *
+ * @public @memberof u_live_stats_hist
+ * @ingroup aux_util
+ */
+void
+u_ls_hist_destroy(struct u_live_stats_hist **ulh_ptr);
+
+/*!
+ * Add a value, thread safe and lock free.
+ *
+ * @public @memberof u_live_stats_hist
+ * @ingroup aux_util
+ */
+void
+u_ls_hist_add(struct u_live_stats_hist *ulh, uint64_t value_ns);
+
+/*!
+ * Get the statistics of the values added since the last reset, then reset.
+ * The optional @p quantiles (from 0 to 1) are written to @p out_values, for
+ * percentiles not in @ref u_live_stats_hist_report.
+ *
+ * @public @memberof u_live_stats_hist
+ * @ingroup aux_util
+ */
+void
+u_ls_hist_get_and_reset(struct u_live_stats_hist *ulh,
+                        const double *quantiles,
+                        uint64_t *out_values,
+                        uint32_t quantile_count,
+                        struct u_live_stats_hist_report *out_report);
+
+/*!
+ * Prints a header that looks nice before @ref u_ls_hist_print_and_reset,
+ * adding details about columns. Doesn't include any newlines.
+ *
+ * @public @memberof u_live_stats_hist
+ */
+void
+u_ls_hist_print_header(u_pp_delegate_t dg);
+
+/*!
+ * Prints the calculated values and resets the histogram, can be used with
+ * @ref u_ls_hist_print_header to get a nice header to the values. Doesn't
+ * include any newlines.
+ *
+ * @public @memberof u_live_stats_hist
+ */
+void
+u_ls_hist_print_and_reset(struct u_live_stats_hist *ulh, u_pp_delegate_t dg);
+
+
 #ifdef __cplusplus
 }
 #endif
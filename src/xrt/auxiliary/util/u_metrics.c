@@ -7,27 +7,351 @@
  * @ingroup aux_util
  */
 
+#include "os/os_time.h"
 #include "os/os_threading.h"
 
+#include "math/m_api.h"
+
+#include "util/u_misc.h"
+#include "util/u_time.h"
 #include "util/u_metrics.h"
 #include "util/u_debug.h"
+#include "util/u_trace_marker.h"
 
 #include "monado_metrics.pb.h"
 #include "pb_encode.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #define VERSION_MAJOR 1
 #define VERSION_MINOR 1
 
+/*!
+ * Size of the per thread ring of encoded records, must be a power of two. A
+ * record is at most a couple of hundred bytes, so this holds many frames
+ * worth of records between two drains of the writer thread.
+ */
+#define RING_SIZE (64 * 1024)
+
+//! Maximum number of threads that can write records at the same time.
+#define MAX_RINGS 32
+
+//! Size of the buffer the writer thread collects records into before writing them.
+#define WRITE_BUFFER_SIZE (256 * 1024)
+
+//! Maximum size of a single encoded record, including the submessage header.
+#define MAX_RECORD_SIZE (monado_metrics_Record_size + 10)
+
+/*!
+ * Who owns a @ref metrics_ring.
+ */
+enum metrics_ring_state
+{
+	//! Can be given to a new thread.
+	RING_STATE_FREE = 0,
+
+	//! A thread is writing to it.
+	RING_STATE_IN_USE = 1,
+
+	//! The thread exited, the writer thread frees it once drained.
+	RING_STATE_RELEASED = 2,
+};
+
+/*!
+ * Single producer single consumer ring of encoded records, the producer is the
+ * thread writing metrics and the consumer is the writer thread. The positions
+ * are free running and wrap around, only their difference is used.
+ */
+struct metrics_ring
+{
+	//! A @ref metrics_ring_state.
+	xrt_atomic_s32_t state;
+
+	//! Where the producer writes next, only written by the producer.
+	xrt_atomic_s32_t head;
+
+	//! Where the consumer reads next, only written by the consumer.
+	xrt_atomic_s32_t tail;
+
+	//! Records dropped because the ring was full.
+	xrt_atomic_s32_t dropped;
+
+	uint8_t data[RING_SIZE];
+};
+
 static FILE *g_file = NULL;
-static struct os_mutex g_file_mutex;
 static bool g_metrics_initialized = false;
 static bool g_metrics_early_flush = false;
 
+//! Bumped on every init, so threads notice that their ring is from an old file.
+static uint32_t g_generation = 0;
+
+//! Protects registering new rings.
+static struct os_mutex g_rings_mutex;
+static struct metrics_ring *g_rings[MAX_RINGS];
+static xrt_atomic_s32_t g_ring_count;
+
+//! Records dropped because there were no more rings for new threads.
+static xrt_atomic_s32_t g_dropped_no_ring;
+
+//! Records dropped in rings that have since been reused.
+static xrt_atomic_s32_t g_dropped_reused;
+
+//! Number of threads currently pushing a record or releasing a ring.
+static xrt_atomic_s32_t g_producers;
+
+//! Releases the ring of a thread when it exits, the value is from @ref encode_ring_key_value.
+static pthread_key_t g_ring_key;
+static bool g_ring_key_created = false;
+
+static struct os_thread_helper g_writer_thread;
+static uint8_t *g_write_buffer = NULL;
+
+static XRT_THREAD_LOCAL struct metrics_ring *t_ring = NULL;
+static XRT_THREAD_LOCAL uint32_t t_ring_generation = 0;
+
 DEBUG_GET_ONCE_OPTION(metrics_file, "XRT_METRICS_FILE", NULL)
 DEBUG_GET_ONCE_BOOL_OPTION(metrics_early_flush, "XRT_METRICS_EARLY_FLUSH", false)
+DEBUG_GET_ONCE_NUM_OPTION(metrics_flush_ms, "XRT_METRICS_FLUSH_MS", 100)
+
+
+
+/*
+ *
+ * Ring functions.
+ *
+ */
+
+/*!
+ * The thread specific value holds the ring index and the generation, so that
+ * a thread exiting after the file was closed doesn't touch a freed ring.
+ */
+static inline void *
+encode_ring_key_value(uint32_t index)
+{
+	return (void *)(uintptr_t)(((uintptr_t)(g_generation & 0xffffff) << 8) | (index + 1));
+}
+
+static void
+ring_key_destructor(void *value)
+{
+	uintptr_t v = (uintptr_t)value;
+	uint32_t index = (uint32_t)(v & 0xff) - 1;
+	uint32_t generation = (uint32_t)(v >> 8);
+
+	// Keeps u_metrics_close from freeing the rings under us.
+	xrt_atomic_s32_inc_return(&g_producers);
+
+	if (g_metrics_initialized && generation == (g_generation & 0xffffff) && index < MAX_RINGS) {
+		// All of our pushes happened before this, the writer thread frees it once drained.
+		xrt_atomic_s32_store(&g_rings[index]->state, RING_STATE_RELEASED);
+	}
+
+	xrt_atomic_s32_dec_return(&g_producers);
+}
+
+static struct metrics_ring *
+get_or_register_ring(void)
+{
+	if (t_ring != NULL && t_ring_generation == g_generation) {
+		return t_ring;
+	}
+
+	struct metrics_ring *ring = NULL;
+	uint32_t index = 0;
+
+	os_mutex_lock(&g_rings_mutex);
+
+	// Reuse the ring of a thread that has exited.
+	int32_t count = xrt_atomic_s32_load(&g_ring_count);
+	for (int32_t i = 0; i < count; i++) {
+		if (xrt_atomic_s32_load(&g_rings[i]->state) == RING_STATE_FREE) {
+			ring = g_rings[i];
+			index = (uint32_t)i;
+			break;
+		}
+	}
+
+	if (ring == NULL && count < MAX_RINGS) {
+		ring = U_TYPED_CALLOC(struct metrics_ring);
+		index = (uint32_t)count;
+		g_rings[count] = ring;
+
+		// Publish the ring after it has been stored.
+		xrt_atomic_s32_store(&g_ring_count, count + 1);
+	}
+
+	if (ring != NULL) {
+		xrt_atomic_s32_store(&ring->state, RING_STATE_IN_USE);
+	}
+
+	os_mutex_unlock(&g_rings_mutex);
+
+	if (ring != NULL) {
+		pthread_setspecific(g_ring_key, encode_ring_key_value(index));
+	}
+
+	t_ring = ring;
+	t_ring_generation = g_generation;
+
+	return ring;
+}
+
+/*!
+ * Copies the encoded record into the ring of the calling thread, never blocks,
+ * drops the record if the ring is full.
+ */
+static void
+ring_push(const uint8_t *buffer, uint32_t size)
+{
+	struct metrics_ring *ring = get_or_register_ring();
+	if (ring == NULL) {
+		xrt_atomic_s32_inc_return(&g_dropped_no_ring);
+		return;
+	}
+
+	uint32_t head = (uint32_t)ring->head; // Only we write it.
+	uint32_t tail = (uint32_t)xrt_atomic_s32_load(&ring->tail);
+
+	if (RING_SIZE - (head - tail) < size) {
+		xrt_atomic_s32_inc_return(&ring->dropped);
+		return;
+	}
+
+	uint32_t offset = head & (RING_SIZE - 1);
+	uint32_t first = MIN(size, RING_SIZE - offset);
+	memcpy(&ring->data[offset], buffer, first);
+	memcpy(&ring->data[0], buffer + first, size - first);
+
+	// Publish the data, the store is ordered after the copies above.
+	xrt_atomic_s32_store(&ring->head, (int32_t)(head + size));
+}
+
+static void
+write_buffer_flush(uint32_t *fill)
+{
+	if (*fill == 0) {
+		return;
+	}
+
+	fwrite(g_write_buffer, *fill, 1, g_file);
+	*fill = 0;
+}
+
+/*!
+ * Moves everything in the ring into the write buffer, writing the buffer out
+ * to the file whenever it fills up.
+ */
+static void
+ring_drain(struct metrics_ring *ring, uint32_t *fill)
+{
+	uint32_t tail = (uint32_t)ring->tail; // Only we write it.
+	uint32_t head = (uint32_t)xrt_atomic_s32_load(&ring->head);
+
+	while (tail != head) {
+		if (*fill == WRITE_BUFFER_SIZE) {
+			write_buffer_flush(fill);
+		}
+
+		uint32_t offset = tail & (RING_SIZE - 1);
+		uint32_t size = MIN(head - tail, RING_SIZE - offset);
+		size = MIN(size, WRITE_BUFFER_SIZE - *fill);
+
+		memcpy(&g_write_buffer[*fill], &ring->data[offset], size);
+		*fill += size;
+		tail += size;
+	}
+
+	// Hand the space back to the producer, ordered after the copies above.
+	xrt_atomic_s32_store(&ring->tail, (int32_t)tail);
+}
+
+/*!
+ * Frees a ring whose thread has exited, must have been fully drained after
+ * the release was seen.
+ */
+static void
+ring_reclaim(struct metrics_ring *ring)
+{
+	os_mutex_lock(&g_rings_mutex);
+
+	xrt_atomic_s32_store(&g_dropped_reused,
+	                     xrt_atomic_s32_load(&g_dropped_reused) + xrt_atomic_s32_load(&ring->dropped));
+	xrt_atomic_s32_store(&ring->dropped, 0);
+	xrt_atomic_s32_store(&ring->head, 0);
+	xrt_atomic_s32_store(&ring->tail, 0);
+	xrt_atomic_s32_store(&ring->state, RING_STATE_FREE);
+
+	os_mutex_unlock(&g_rings_mutex);
+}
+
+static uint32_t
+get_dropped_count(void)
+{
+	uint32_t dropped = (uint32_t)xrt_atomic_s32_load(&g_dropped_no_ring);
+	dropped += (uint32_t)xrt_atomic_s32_load(&g_dropped_reused);
+
+	int32_t count = xrt_atomic_s32_load(&g_ring_count);
+	for (int32_t i = 0; i < count; i++) {
+		dropped += (uint32_t)xrt_atomic_s32_load(&g_rings[i]->dropped);
+	}
+
+	return dropped;
+}
+
+static void
+drain_all(void)
+{
+	uint32_t fill = 0;
+
+	int32_t count = xrt_atomic_s32_load(&g_ring_count);
+	for (int32_t i = 0; i < count; i++) {
+		struct metrics_ring *ring = g_rings[i];
+
+		// Read before draining, a released ring has no more pushes after this.
+		int32_t state = xrt_atomic_s32_load(&ring->state);
+
+		ring_drain(ring, &fill);
+
+		if (state == RING_STATE_RELEASED) {
+			ring_reclaim(ring);
+		}
+	}
+
+	write_buffer_flush(&fill);
+
+	// Bounds how long records stay in the stdio buffer.
+	fflush(g_file);
+}
+
+static void *
+writer_thread_func(void *ptr)
+{
+	U_TRACE_SET_THREAD_NAME("Metrics writer");
+	os_thread_helper_name(&g_writer_thread, "Metrics writer");
+
+	int64_t period_ns = g_metrics_early_flush ? U_TIME_1MS_IN_NS : //
+	                        debug_get_num_option_metrics_flush_ms() * U_TIME_1MS_IN_NS;
+	uint32_t reported_dropped = 0;
+
+	while (os_thread_helper_is_running(&g_writer_thread)) {
+		os_nanosleep(period_ns);
 
+		drain_all();
+
+		uint32_t dropped = get_dropped_count();
+		if (dropped != reported_dropped) {
+			U_LOG_W("Dropped %u metrics records, the writer can't keep up!", dropped - reported_dropped);
+			reported_dropped = dropped;
+		}
+	}
+
+	// Get everything that was written before the thread was stopped.
+	drain_all();
+
+	return NULL;
+}
 
 
 /*
@@ -39,7 +363,7 @@ DEBUG_GET_ONCE_BOOL_OPTION(metrics_early_flush, "XRT_METRICS_EARLY_FLUSH", false
 static void
 write_record(monado_metrics_Record *r)
 {
-	uint8_t buffer[monado_metrics_Record_size + 10]; // Including submessage
+	uint8_t buffer[MAX_RECORD_SIZE]; // Including submessage
 
 
 	pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
@@ -49,15 +373,14 @@ write_record(monado_metrics_Record *r)
 		return;
 	}
 
-	os_mutex_lock(&g_file_mutex);
+	// Full barrier, u_metrics_close waits for us if it didn't see this.
+	xrt_atomic_s32_inc_return(&g_producers);
 
-	fwrite(buffer, stream.bytes_written, 1, g_file);
-
-	if (g_metrics_early_flush) {
-		fflush(g_file);
+	if (g_metrics_initialized) {
+		ring_push(buffer, (uint32_t)stream.bytes_written);
 	}
 
-	os_mutex_unlock(&g_file_mutex);
+	xrt_atomic_s32_dec_return(&g_producers);
 }
 
 static void
@@ -99,13 +422,28 @@ u_metrics_init(void)
 		return;
 	}
 
-	os_mutex_init(&g_file_mutex);
+	// Never deleted, a thread may exit after the file has been closed.
+	if (!g_ring_key_created) {
+		pthread_key_create(&g_ring_key, ring_key_destructor);
+		g_ring_key_created = true;
+	}
+
+	os_mutex_init(&g_rings_mutex);
+	os_thread_helper_init(&g_writer_thread);
+	g_write_buffer = U_TYPED_ARRAY_CALLOC(uint8_t, WRITE_BUFFER_SIZE);
+	g_ring_count = 0;
+	g_dropped_no_ring = 0;
+	g_dropped_reused = 0;
+	g_generation++;
 
 	g_metrics_initialized = true;
 	g_metrics_early_flush = debug_get_bool_option_metrics_early_flush();
 
+	// Pushed before the thread is started so it is first in the file.
 	write_version(VERSION_MAJOR, VERSION_MINOR);
 
+	os_thread_helper_start(&g_writer_thread, writer_thread_func, NULL);
+
 	U_LOG_I("Opened metrics file: '%s'", str);
 }
 
@@ -118,16 +456,37 @@ u_metrics_close(void)
 
 	U_LOG_I("Closing metrics file: '%s'", debug_get_option_metrics_file());
 
-	// At least try to avoid races.
-	os_mutex_lock(&g_file_mutex);
-	fflush(g_file);
+	/*
+	 * Stop new records and wait for threads in the middle of pushing one,
+	 * the writer thread then drains what is in the rings before exiting.
+	 */
+	g_metrics_initialized = false;
+	xrt_atomic_thread_fence();
+	while (xrt_atomic_s32_load(&g_producers) != 0) {
+		os_nanosleep(U_TIME_1MS_IN_NS / 10);
+	}
+
+	os_thread_helper_destroy(&g_writer_thread);
+
+	uint32_t dropped = get_dropped_count();
+	if (dropped > 0) {
+		U_LOG_W("Dropped %u metrics records in total.", dropped);
+	}
+
 	fclose(g_file);
 	g_file = NULL;
-	os_mutex_unlock(&g_file_mutex);
 
-	os_mutex_destroy(&g_file_mutex);
+	int32_t count = xrt_atomic_s32_load(&g_ring_count);
+	for (int32_t i = 0; i < count; i++) {
+		free(g_rings[i]);
+		g_rings[i] = NULL;
+	}
+	g_ring_count = 0;
 
-	g_metrics_initialized = false;
+	free(g_write_buffer);
+	g_write_buffer = NULL;
+
+	os_mutex_destroy(&g_rings_mutex);
 }
 
 bool
@@ -233,5 +592,25 @@ u_metrics_write_system_present_info(struct u_metrics_system_present_info *umpi)
 #undef COPY
 
 
+	write_record(&record);
+}
+
+void
+u_metrics_write_system_latch_info(struct u_metrics_system_latch_info *umli)
+{
+	if (!g_metrics_initialized) {
+		return;
+	}
+
+	monado_metrics_Record record = monado_metrics_Record_init_default;
+
+	// Select which filed is used.
+	record.which_record = monado_metrics_Record_system_latch_info_tag;
+
+#define COPY(_0, _1, _2, _3, FIELD, _4) (record.record.system_latch_info.FIELD = umli->FIELD);
+	monado_metrics_SystemLatchInfo_FIELDLIST(COPY, 0);
+#undef COPY
+
+
 	write_record(&record);
 }
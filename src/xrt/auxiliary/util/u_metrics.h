@@ -79,6 +79,14 @@ struct u_metrics_system_present_info
 	uint64_t earliest_present_time_ns;
 };
 
+struct u_metrics_system_latch_info
+{
+	int64_t frame_id;
+	uint64_t predicted_display_time_ns;
+	uint64_t when_woke_ns;
+	uint64_t when_latched_ns;
+};
+
 
 void
 u_metrics_init(void);
@@ -104,6 +112,9 @@ u_metrics_write_system_gpu_info(struct u_metrics_system_gpu_info *umgi);
 void
 u_metrics_write_system_present_info(struct u_metrics_system_present_info *umpi);
 
+void
+u_metrics_write_system_latch_info(struct u_metrics_system_latch_info *umli);
+
 
 #ifdef __cplusplus
 }
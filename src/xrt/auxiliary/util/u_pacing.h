@@ -39,6 +39,9 @@ enum u_timing_point
 	//! Began CPU side work for GPU.
 	U_TIMING_POINT_BEGIN,
 
+	//! Sampled the head pose used for the frame, only used by the compositor.
+	U_TIMING_POINT_LATCH,
+
 	//! Began submitting work to the GPU, only used by the compositor.
 	U_TIMING_POINT_SUBMIT_BEGIN,
 
@@ -68,6 +68,10 @@ struct frame
 	//! When the compositor started rendering a frame
 	int64_t when_began_ns;
 
+	//! When the compositor sampled the head pose for the frame. Set in `pc_mark_point` with
+	//! `U_TIMING_POINT_LATCH`.
+	int64_t when_latched_ns;
+
 	//! When the compositor finished rendering a frame
 	int64_t when_submitted_ns;
 
@@ -427,6 +431,23 @@ do_metrics(struct pacing_compositor *pc, struct frame *f)
 	u_metrics_write_system_present_info(&umpi);
 }
 
+static void
+do_latch_metrics(struct pacing_compositor *pc, struct frame *f)
+{
+	if (!u_metrics_is_active()) {
+		return;
+	}
+
+	struct u_metrics_system_latch_info umli = {
+	    .frame_id = f->frame_id,
+	    .predicted_display_time_ns = f->predicted_display_time_ns,
+	    .when_woke_ns = f->when_woke_ns,
+	    .when_latched_ns = f->when_latched_ns,
+	};
+
+	u_metrics_write_system_latch_info(&umli);
+}
+
 static void
 do_tracing(struct pacing_compositor *pc, struct frame *f)
 {
@@ -607,6 +628,11 @@ pc_mark_point(struct u_pacing_compositor *upc, enum u_timing_point point, int64_
 		f->state = STATE_BEGAN;
 		f->when_began_ns = when_ns;
 		break;
+	case U_TIMING_POINT_LATCH:
+		assert(f->state == STATE_BEGAN);
+		f->when_latched_ns = when_ns;
+		do_latch_metrics(pc, f);
+		break;
 	case U_TIMING_POINT_SUBMIT_BEGIN:
 		// No-op
 		break;
@@ -71,6 +71,12 @@ struct frame
 	 */
 	int64_t when_began_ns;
 
+	/*!
+	 * When the compositor sampled the head pose for the frame, zero if it
+	 * never told us. Set in `pc_mark_point` with `U_TIMING_POINT_LATCH`.
+	 */
+	int64_t when_latched_ns;
+
 	/*!
 	 * When the compositor began submitting the work to the GPU, after
 	 * it completed building the command buffers. Set in `pc_mark_point`
@@ -121,7 +127,7 @@ struct fake_timing
 	struct frame frames[FRAME_COUNT];
 
 	//! Live stats we keep track off.
-	struct u_live_stats_ns cpu, draw, submit, gpu, gpu_delay, total_frame;
+	struct u_live_stats_ns cpu, draw, latch, submit, gpu, gpu_delay, total_frame;
 };
 
 
@@ -206,6 +212,8 @@ print_and_reset(struct fake_timing *ft)
 	u_pp(dg, "\n");
 	u_ls_ns_print_and_reset(&ft->draw, dg);
 	u_pp(dg, "\n");
+	u_ls_ns_print_and_reset(&ft->latch, dg);
+	u_pp(dg, "\n");
 	u_ls_ns_print_and_reset(&ft->submit, dg);
 	u_pp(dg, "\n");
 	u_ls_ns_print_and_reset(&ft->gpu, dg);
@@ -233,11 +241,34 @@ calc_frame_stats(struct fake_timing *ft, struct frame *f)
 	full |= u_ls_ns_add(&ft->draw, draw_ns);
 	full |= u_ls_ns_add(&ft->submit, submit_ns);
 
+	// How far ahead of the display time the head pose was sampled.
+	if (f->when_latched_ns != 0) {
+		int64_t latch_ns = f->predicted_display_time_ns - f->when_latched_ns;
+		full |= u_ls_ns_add(&ft->latch, latch_ns);
+	}
+
 	if (full) {
 		print_and_reset(ft);
 	}
 }
 
+static void
+write_latch_metrics(struct frame *f)
+{
+	if (!u_metrics_is_active()) {
+		return;
+	}
+
+	struct u_metrics_system_latch_info umli = {
+	    .frame_id = f->frame_id,
+	    .predicted_display_time_ns = f->predicted_display_time_ns,
+	    .when_woke_ns = f->when_woke_ns,
+	    .when_latched_ns = f->when_latched_ns,
+	};
+
+	u_metrics_write_system_latch_info(&umli);
+}
+
 static void
 calc_gpu_stats(struct fake_timing *ft, struct frame *f, int64_t gpu_start_ns, int64_t gpu_end_ns)
 {
@@ -336,6 +367,10 @@ pc_mark_point(struct u_pacing_compositor *upc, enum u_timing_point point, int64_
 	switch (point) {
 	case U_TIMING_POINT_WAKE_UP: f->when_woke_ns = when_ns; break;
 	case U_TIMING_POINT_BEGIN: f->when_began_ns = when_ns; break;
+	case U_TIMING_POINT_LATCH:
+		f->when_latched_ns = when_ns;
+		write_latch_metrics(f);
+		break;
 	case U_TIMING_POINT_SUBMIT_BEGIN: f->when_submit_began_ns = when_ns; break;
 	case U_TIMING_POINT_SUBMIT_END:
 		f->when_submit_end_ns = when_ns;
@@ -455,6 +490,7 @@ u_pc_fake_create(int64_t estimated_frame_period_ns, int64_t now_ns, struct u_pac
 
 	snprintf(ft->cpu.name, ARRAY_SIZE(ft->cpu.name), "cpu");
 	snprintf(ft->draw.name, ARRAY_SIZE(ft->draw.name), "draw");
+	snprintf(ft->latch.name, ARRAY_SIZE(ft->latch.name), "latch");
 	snprintf(ft->submit.name, ARRAY_SIZE(ft->submit.name), "submit");
 	snprintf(ft->gpu.name, ARRAY_SIZE(ft->gpu.name), "gpu");
 	snprintf(ft->gpu_delay.name, ARRAY_SIZE(ft->gpu_delay.name), "gpu_delay");
@@ -9,6 +9,7 @@
 
 #include "util/u_system.h"
 #include "util/u_session.h"
+#include "util/u_logging.h"
 
 
 /*
@@ -50,6 +51,34 @@ poll_events(struct xrt_session *xs, union xrt_session_event *out_xse)
 	return XRT_SUCCESS;
 }
 
+static xrt_result_t
+set_event_sink(struct xrt_session *xs, struct xrt_session_event_sink *xses)
+{
+	struct u_session *us = u_session(xs);
+	xrt_result_t xret = XRT_SUCCESS;
+
+	os_mutex_lock(&us->events.mutex);
+
+	us->events.forward = xses;
+
+	// Hand over anything already queued, in order.
+	while (xses != NULL && us->events.ptr != NULL) {
+		struct u_session_event *use = us->events.ptr;
+
+		xret = xrt_session_event_sink_push(xses, &use->xse);
+		if (xret != XRT_SUCCESS) {
+			break;
+		}
+
+		us->events.ptr = use->next;
+		free(use);
+	}
+
+	os_mutex_unlock(&us->events.mutex);
+
+	return xret;
+}
+
 static void
 destroy(struct xrt_session *xs)
 {
@@ -76,6 +105,7 @@ u_session_create(struct u_system *usys)
 
 	// xrt_session fields.
 	us->base.poll_events = poll_events;
+	us->base.set_event_sink = set_event_sink;
 	us->base.destroy = destroy;
 
 	// xrt_session_event_sink fields.
@@ -97,11 +127,22 @@ u_session_create(struct u_system *usys)
 void
 u_session_event_push(struct u_session *us, const union xrt_session_event *xse)
 {
+	os_mutex_lock(&us->events.mutex);
+
+	// The lock serializes the producers, the sink sees only one at a time.
+	if (us->events.forward != NULL) {
+		xrt_result_t xret = xrt_session_event_sink_push(us->events.forward, xse);
+		if (xret == XRT_SUCCESS) {
+			os_mutex_unlock(&us->events.mutex);
+			return;
+		}
+
+		U_LOG_E("Failed to forward session event, queueing it instead!");
+	}
+
 	struct u_session_event *use = U_TYPED_CALLOC(struct u_session_event);
 	use->xse = *xse;
 
-	os_mutex_lock(&us->events.mutex);
-
 	// Find the last slot.
 	struct u_session_event **slot = &us->events.ptr;
 	while (*slot != NULL) {
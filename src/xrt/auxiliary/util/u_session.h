@@ -7,6 +7,8 @@
  * @ingroup aux_util
  */
 
+#pragma once
+
 #include "xrt/xrt_session.h"
 #include "os/os_threading.h"
 
@@ -50,6 +52,9 @@ struct u_session
 	{
 		struct os_mutex mutex;
 		struct u_session_event *ptr;
+
+		//! If set events are pushed here instead, see @ref xrt_session::set_event_sink.
+		struct xrt_session_event_sink *forward;
 	} events;
 };
 
@@ -11,6 +11,7 @@
 #include "util/u_misc.h"
 #include "util/u_sink.h"
 #include "util/u_frame.h"
+#include "util/u_frame_pool.h"
 #include "util/u_trace_marker.h"
 
 
@@ -25,6 +26,8 @@ struct u_sink_deinterleaver
 	struct xrt_frame_node node;
 
 	struct xrt_frame_sink *downstream;
+
+	struct u_frame_pool *pool;
 };
 
 
@@ -92,7 +95,7 @@ deinterleave_frame(struct xrt_frame_sink *xfs, struct xrt_frame *xf)
 	const uint8_t *data = xf->data;
 	struct xrt_frame *frame = NULL;
 
-	u_frame_create_one_off(format, w, h, &frame);
+	u_frame_pool_create_frame(de->pool, format, w, h, &frame);
 
 	// Copy directly from original frame.
 	frame->timestamp = xf->timestamp;
@@ -122,6 +125,7 @@ deinterleave_destroy(struct xrt_frame_node *node)
 {
 	struct u_sink_deinterleaver *de = container_of(node, struct u_sink_deinterleaver, node);
 
+	u_frame_pool_reference(&de->pool, NULL);
 	free(de);
 }
 
@@ -143,6 +147,7 @@ u_sink_deinterleaver_create(struct xrt_frame_context *xfctx,
 	de->node.break_apart = deinterleave_break_apart;
 	de->node.destroy = deinterleave_destroy;
 	de->downstream = downstream;
+	de->pool = u_frame_pool_create(U_FRAME_POOL_DEFAULT_MAX_FREE_COUNT);
 
 	xrt_frame_context_add(xfctx, &de->node);
 
@@ -16,8 +16,12 @@
 #include "os/os_time.h"
 
 #include "math/m_space.h"
+#include "math/m_relation_history.h"
 
+#include "util/u_var.h"
 #include "util/u_misc.h"
+#include "util/u_time.h"
+#include "util/u_debug.h"
 #include "util/u_hashmap.h"
 #include "util/u_logging.h"
 #include "util/u_space_overseer.h"
@@ -33,6 +37,58 @@
  *
  */
 
+DEBUG_GET_ONCE_BOOL_OPTION(pose_memo, "U_SPACE_OVERSEER_POSE_MEMO", true)
+
+/*!
+ * Number of entries in the @ref u_pose_memo, must be a power of two.
+ */
+#define U_POSE_MEMO_SIZE 64
+
+/*!
+ * Drivers that don't use a @ref m_relation_history can't tell us when they
+ * have new data, so entries are also only used for this long.
+ */
+#define U_POSE_MEMO_MAX_AGE_NS (2 * U_TIME_1MS_IN_NS)
+
+/*!
+ * A single memoized device relation, guarded by @ref seq used as a sequence
+ * lock: writers claim the entry by making it odd and readers retry, or rather
+ * treat it as a miss, if it was odd or changed while reading.
+ */
+struct u_pose_memo_entry
+{
+	xrt_atomic_s32_t seq;
+
+	struct xrt_device *xdev;
+	enum xrt_input_name name;
+	int64_t at_timestamp_ns;
+
+	//! The relation histories the device read to answer the query.
+	struct m_relation_history_read_set reads;
+
+	//! When the entry was written.
+	int64_t inserted_ns;
+
+	struct xrt_space_relation relation;
+};
+
+/*!
+ * Memoizes @ref xrt_device_get_tracked_pose keyed on device, input name and
+ * timestamp, so that the same query repeated within a frame by different
+ * callers only evaluates the device once. Direct mapped and lock-free, a
+ * collision simply replaces the older entry.
+ */
+struct u_pose_memo
+{
+	struct u_pose_memo_entry entries[U_POSE_MEMO_SIZE];
+
+	//! Toggled from the debug gui.
+	bool enabled;
+
+	xrt_atomic_s32_t hits;
+	xrt_atomic_s32_t misses;
+};
+
 /*!
  * Keeps track of what kind of space it is.
  */
@@ -118,8 +174,40 @@ struct u_space_overseer
 	 * Create independent local and local_floor per application
 	 */
 	bool per_app_local_spaces;
+
+	//! Memoized device relations, shared by all callers.
+	struct u_pose_memo memo;
 };
 
+/*!
+ * Number of device relations that @ref u_pose_cache can hold, a single locate
+ * rarely touches more then a handful of devices.
+ */
+#define U_POSE_CACHE_SIZE 16
+
+/*!
+ * Caches the relations returned by @ref xrt_device_get_tracked_pose during a
+ * single locate call, all of the queries are done at the same timestamp so the
+ * device and input name is enough of a key.
+ */
+struct u_pose_cache
+{
+	uint32_t count;
+
+	struct
+	{
+		struct xrt_device *xdev;
+		enum xrt_input_name name;
+		struct xrt_space_relation relation;
+	} entries[U_POSE_CACHE_SIZE];
+};
+
+/*!
+ * Number of slots in the dedup hash table that fits on the stack, larger
+ * locate calls allocate the table.
+ */
+#define U_DEDUP_STACK_SLOTS 256
+
 
 /*
  *
@@ -304,6 +392,163 @@ notify_ref_space_usage_device(struct u_space_overseer *uso, enum xrt_reference_s
 }
 
 
+/*
+ *
+ * Pose cache functions.
+ *
+ */
+
+static inline uint32_t
+memo_slot(struct xrt_device *xdev, enum xrt_input_name name, int64_t at_timestamp_ns)
+{
+	uint64_t h = (uint64_t)(uintptr_t)xdev;
+	h ^= (uint64_t)name * UINT64_C(0xC2B2AE3D27D4EB4F);
+	h ^= (uint64_t)at_timestamp_ns * UINT64_C(0x9E3779B97F4A7C15);
+
+	return (uint32_t)(h >> 32) & (U_POSE_MEMO_SIZE - 1);
+}
+
+static bool
+memo_lookup(struct u_pose_memo *memo,
+            struct xrt_device *xdev,
+            enum xrt_input_name name,
+            int64_t at_timestamp_ns,
+            int64_t now_ns,
+            struct xrt_space_relation *out_relation)
+{
+	struct u_pose_memo_entry *e = &memo->entries[memo_slot(xdev, name, at_timestamp_ns)];
+
+	int32_t before = xrt_atomic_s32_load(&e->seq);
+	if ((before & 1) != 0) {
+		return false; // Being written, treat as a miss.
+	}
+
+	bool match = e->xdev == xdev &&                       //
+	             e->name == name &&                       //
+	             e->at_timestamp_ns == at_timestamp_ns && //
+	             now_ns - e->inserted_ns <= U_POSE_MEMO_MAX_AGE_NS;
+	struct m_relation_history_read_set reads = e->reads;
+	struct xrt_space_relation relation = e->relation;
+
+	// Make sure all of the reads above are done before checking.
+	xrt_atomic_thread_fence();
+
+	if (!match || xrt_atomic_s32_load(&e->seq) != before) {
+		return false;
+	}
+
+	// Only the histories of this device can make the entry stale.
+	if (!m_relation_history_read_set_is_current(&reads)) {
+		return false;
+	}
+
+	*out_relation = relation;
+
+	return true;
+}
+
+static void
+memo_insert(struct u_pose_memo *memo,
+            struct xrt_device *xdev,
+            enum xrt_input_name name,
+            int64_t at_timestamp_ns,
+            const struct m_relation_history_read_set *reads,
+            int64_t now_ns,
+            const struct xrt_space_relation *relation)
+{
+	struct u_pose_memo_entry *e = &memo->entries[memo_slot(xdev, name, at_timestamp_ns)];
+
+	// Claim the entry, if another thread is writing it just don't cache.
+	int32_t seq = xrt_atomic_s32_load(&e->seq);
+	if ((seq & 1) != 0 || xrt_atomic_s32_cmpxchg(&e->seq, seq, seq + 1) != seq) {
+		return;
+	}
+
+	e->xdev = xdev;
+	e->name = name;
+	e->at_timestamp_ns = at_timestamp_ns;
+	e->reads = *reads;
+	e->inserted_ns = now_ns;
+	e->relation = *relation;
+
+	// Full barrier, makes the writes above visible before the entry is.
+	xrt_atomic_s32_inc_return(&e->seq);
+}
+
+static void
+get_tracked_pose_memoized(struct u_space_overseer *uso,
+                          struct xrt_device *xdev,
+                          enum xrt_input_name name,
+                          int64_t at_timestamp_ns,
+                          struct xrt_space_relation *out_relation)
+{
+	struct u_pose_memo *memo = &uso->memo;
+
+	if (!memo->enabled) {
+		xrt_device_get_tracked_pose(xdev, name, at_timestamp_ns, out_relation);
+		return;
+	}
+
+	int64_t now_ns = (int64_t)os_monotonic_get_ns();
+
+	if (memo_lookup(memo, xdev, name, at_timestamp_ns, now_ns, out_relation)) {
+		xrt_atomic_s32_inc_return(&memo->hits);
+		return;
+	}
+
+	xrt_atomic_s32_inc_return(&memo->misses);
+
+	// Records the generation of each history before it is read, a push during the call makes the entry stale.
+	struct m_relation_history_read_set reads;
+	m_relation_history_read_set_begin(&reads);
+	xrt_device_get_tracked_pose(xdev, name, at_timestamp_ns, out_relation);
+	m_relation_history_read_set_end(&reads);
+
+	if (reads.untracked) {
+		return;
+	}
+
+	memo_insert(memo, xdev, name, at_timestamp_ns, &reads, now_ns, out_relation);
+}
+
+/*!
+ * Get the tracked pose of a device, going through the @p cache which is
+ * optional and then the memo of the overseer. If the cache is full the pose
+ * is not cached.
+ */
+static void
+get_tracked_pose_cached(struct u_space_overseer *uso,
+                        struct u_pose_cache *cache,
+                        struct xrt_device *xdev,
+                        enum xrt_input_name name,
+                        int64_t at_timestamp_ns,
+                        struct xrt_space_relation *out_relation)
+{
+	if (cache == NULL) {
+		get_tracked_pose_memoized(uso, xdev, name, at_timestamp_ns, out_relation);
+		return;
+	}
+
+	for (uint32_t i = 0; i < cache->count; i++) {
+		if (cache->entries[i].xdev == xdev && cache->entries[i].name == name) {
+			*out_relation = cache->entries[i].relation;
+			return;
+		}
+	}
+
+	get_tracked_pose_memoized(uso, xdev, name, at_timestamp_ns, out_relation);
+
+	if (cache->count >= U_POSE_CACHE_SIZE) {
+		return;
+	}
+
+	uint32_t index = cache->count++;
+	cache->entries[index].xdev = xdev;
+	cache->entries[index].name = name;
+	cache->entries[index].relation = *out_relation;
+}
+
+
 /*
  *
  * Graph traversing functions.
@@ -317,7 +562,11 @@ notify_ref_space_usage_device(struct u_space_overseer *uso, enum xrt_reference_s
  * order.
  */
 static void
-push_then_traverse(struct xrt_relation_chain *xrc, struct u_space *space, int64_t at_timestamp_ns)
+push_then_traverse(struct u_space_overseer *uso,
+                   struct xrt_relation_chain *xrc,
+                   struct u_pose_cache *cache,
+                   struct u_space *space,
+                   int64_t at_timestamp_ns)
 {
 	switch (space->type) {
 	case U_SPACE_TYPE_NULL: break; // No-op
@@ -326,7 +575,7 @@ push_then_traverse(struct xrt_relation_chain *xrc, struct u_space *space, int64_
 		assert(space->pose.xname != 0);
 
 		struct xrt_space_relation xsr;
-		xrt_device_get_tracked_pose(space->pose.xdev, space->pose.xname, at_timestamp_ns, &xsr);
+		get_tracked_pose_cached(uso, cache, space->pose.xdev, space->pose.xname, at_timestamp_ns, &xsr);
 		m_relation_chain_push_relation(xrc, &xsr);
 	} break;
 	case U_SPACE_TYPE_OFFSET: m_relation_chain_push_pose_if_not_identity(xrc, &space->offset.pose); break;
@@ -335,7 +584,7 @@ push_then_traverse(struct xrt_relation_chain *xrc, struct u_space *space, int64_
 
 	// Please tail-call optimise this miss compiler.
 	assert(space->next != NULL);
-	push_then_traverse(xrc, space->next, at_timestamp_ns);
+	push_then_traverse(uso, xrc, cache, space->next, at_timestamp_ns);
 }
 
 /*!
@@ -345,7 +594,11 @@ push_then_traverse(struct xrt_relation_chain *xrc, struct u_space *space, int64_
  * the reversed order.
  */
 static void
-traverse_then_push_inverse(struct xrt_relation_chain *xrc, struct u_space *space, int64_t at_timestamp_ns)
+traverse_then_push_inverse(struct u_space_overseer *uso,
+                           struct xrt_relation_chain *xrc,
+                           struct u_pose_cache *cache,
+                           struct u_space *space,
+                           int64_t at_timestamp_ns)
 {
 	// Done traversing.
 	switch (space->type) {
@@ -357,7 +610,7 @@ traverse_then_push_inverse(struct xrt_relation_chain *xrc, struct u_space *space
 
 	// Can't tail-call optimise this one :(
 	assert(space->next != NULL);
-	traverse_then_push_inverse(xrc, space->next, at_timestamp_ns);
+	traverse_then_push_inverse(uso, xrc, cache, space->next, at_timestamp_ns);
 
 	switch (space->type) {
 	case U_SPACE_TYPE_NULL: break; // No-op
@@ -366,7 +619,7 @@ traverse_then_push_inverse(struct xrt_relation_chain *xrc, struct u_space *space
 		assert(space->pose.xname != 0);
 
 		struct xrt_space_relation xsr;
-		xrt_device_get_tracked_pose(space->pose.xdev, space->pose.xname, at_timestamp_ns, &xsr);
+		get_tracked_pose_cached(uso, cache, space->pose.xdev, space->pose.xname, at_timestamp_ns, &xsr);
 		m_relation_chain_push_inverted_relation(xrc, &xsr);
 	} break;
 	case U_SPACE_TYPE_OFFSET: m_relation_chain_push_inverted_pose_if_not_identity(xrc, &space->offset.pose); break;
@@ -385,8 +638,8 @@ build_relation_chain_read_locked(struct u_space_overseer *uso,
 	assert(base != NULL);
 	assert(target != NULL);
 
-	push_then_traverse(xrc, target, at_timestamp_ns);
-	traverse_then_push_inverse(xrc, base, at_timestamp_ns);
+	push_then_traverse(uso, xrc, NULL, target, at_timestamp_ns);
+	traverse_then_push_inverse(uso, xrc, NULL, base, at_timestamp_ns);
 }
 
 static void
@@ -577,14 +830,40 @@ pose_approx(const struct xrt_pose *a, const struct xrt_pose *b)
 	       fabsf(a->position.z - b->position.z) < e;
 }
 
+static uint32_t
+hash_space(const struct xrt_space *xs, uint32_t mask)
+{
+	// Fibonacci hashing, the low bits of the pointer are always the same.
+	uint64_t h = (uint64_t)(uintptr_t)xs * UINT64_C(0x9E3779B97F4A7C15);
+	return (uint32_t)(h >> 32) & mask;
+}
+
+/*!
+ * Returns the index of an earlier entry with the same space and an approx
+ * equal offset or inserts @p space_index into the table and returns -1. The
+ * table is open addressed and only keyed on the space, since the offsets are
+ * compared approximately, colliding entries are checked in the probe sequence.
+ */
 static int32_t
-find_same_space_before(struct xrt_space **spaces, const struct xrt_pose *offsets, uint32_t space_index)
+dedup_find_or_insert(int32_t *table,
+                     uint32_t mask,
+                     struct xrt_space **spaces,
+                     const struct xrt_pose *offsets,
+                     uint32_t space_index)
 {
-	for (int32_t i = 0; i < (int32_t)space_index; i++) {
+	uint32_t slot = hash_space(spaces[space_index], mask);
+
+	while (table[slot] >= 0) {
+		int32_t i = table[slot];
 		if (spaces[i] == spaces[space_index] && pose_approx(&offsets[i], &offsets[space_index])) {
 			return i;
 		}
+
+		slot = (slot + 1) & mask;
 	}
+
+	table[slot] = (int32_t)space_index;
+
 	return -1;
 }
 
@@ -602,20 +881,53 @@ locate_spaces(struct xrt_space_overseer *xso,
 
 	struct u_space *ubase_space = u_space(base_space);
 
+	// All device relations are at the same timestamp, so only query them once.
+	struct u_pose_cache cache;
+	cache.count = 0;
+
+	// At least twice as many slots as spaces keeps the probe sequences short.
+	uint32_t slot_count = 16;
+	while (slot_count < space_count * 2) {
+		slot_count *= 2;
+	}
+
+	int32_t stack_table[U_DEDUP_STACK_SLOTS];
+	int32_t *table = stack_table;
+	if (slot_count > U_DEDUP_STACK_SLOTS) {
+		table = U_TYPED_ARRAY_CALLOC(int32_t, slot_count);
+	}
+	for (uint32_t i = 0; i < slot_count; i++) {
+		table[i] = -1;
+	}
+
+	// Only need the read lock, and only once for all spaces.
+	pthread_rwlock_rdlock(&uso->lock);
+
+	/*
+	 * The base space part of the chain is the same for all spaces, so
+	 * resolve it once and push it as a single step.
+	 */
+	struct xrt_relation_chain base_xrc = {0};
+	traverse_then_push_inverse(uso, &base_xrc, &cache, ubase_space, at_timestamp_ns);
+	m_relation_chain_push_inverted_pose_if_not_identity(&base_xrc, base_offset);
+
+	struct xrt_space_relation base_relation = XRT_SPACE_RELATION_ZERO;
+	if (base_xrc.step_count > 0) {
+		m_relation_chain_resolve(&base_xrc, &base_relation);
+	}
+
 	for (uint32_t i = 0; i < space_count; i++) {
 		// spaces are allowed to be NULL
 		if (spaces[i] == NULL) {
-			out_relations->relation_flags = XRT_SPACE_RELATION_BITMASK_NONE;
+			out_relations[i].relation_flags = XRT_SPACE_RELATION_BITMASK_NONE;
 			continue;
 		}
 
-		// crude optimization: If space ptr is equal to one already located, don't locate again, just copy
-		{
-			int32_t found = find_same_space_before(spaces, offsets, i);
-			if (found >= 0) {
-				out_relations[i] = out_relations[found];
-				continue;
-			}
+		// If space and offset is equal to one already located, don't locate again, just copy.
+		int32_t found = dedup_find_or_insert(table, slot_count - 1, spaces, offsets, i);
+		if (found >= 0) {
+			out_relations[i] = out_relations[found];
+			continue;
 		}
 
 		struct u_space *uspace = u_space(spaces[i]);
@@ -625,16 +937,26 @@ locate_spaces(struct xrt_space_overseer *xso,
 
 		// crude optimization: If locating a space in itself, we don't actually need to locate the space itself.
 		// only the offsets need to be applied.
-		if (spaces[i] != base_space) {
-			build_relation_chain(uso, &xrc, ubase_space, uspace, at_timestamp_ns);
-		}
+		if (uspace == ubase_space) {
+			m_relation_chain_push_inverted_pose_if_not_identity(&xrc, base_offset);
+		} else {
+			push_then_traverse(uso, &xrc, &cache, uspace, at_timestamp_ns);
 
-		m_relation_chain_push_inverted_pose_if_not_identity(&xrc, base_offset);
+			if (base_xrc.step_count > 0) {
+				m_relation_chain_push_relation(&xrc, &base_relation);
+			}
+		}
 
 		// For base_space =~= space (approx equals).
 		special_resolve(&xrc, &out_relations[i]);
 	}
 
+	pthread_rwlock_unlock(&uso->lock);
+
+	if (table != stack_table) {
+		free(table);
+	}
+
 	return XRT_SUCCESS;
 }
 
@@ -1060,6 +1382,8 @@ destroy(struct xrt_space_overseer *xso)
 		xrt_space_reference(xslocalfloor_ptr, NULL);
 	}
 
+	u_var_remove_root(uso);
+
 	pthread_rwlock_destroy(&uso->lock);
 
 	free(uso);
@@ -1105,6 +1429,13 @@ u_space_overseer_create(struct xrt_session_event_sink *broadcast)
 
 	create_and_set_root_space(uso);
 
+	uso->memo.enabled = debug_get_bool_option_pose_memo();
+
+	u_var_add_root(uso, "Space overseer", true);
+	u_var_add_bool(uso, &uso->memo.enabled, "Memoize device poses");
+	u_var_add_ro_i32(uso, (int32_t *)&uso->memo.hits, "Pose memo hits");
+	u_var_add_ro_i32(uso, (int32_t *)&uso->memo.misses, "Pose memo misses");
+
 	return uso;
 }
 
@@ -2,14 +2,612 @@
 // SPDX-License-Identifier: BSL-1.0
 /*!
  * @file
- * @brief  C++ wrappers for workers.
+ * @brief  Work-stealing worker pool and C++ wrappers for workers.
  * @author Jakob Bornecrantz <jakob@collabora.com>
  *
+ * Every worker thread owns a Chase-Lev deque, tasks pushed from a worker go
+ * onto its own deque, tasks pushed from any other thread go onto a shared
+ * injection queue. Idle workers first pop their own deque, then the injection
+ * queue and then steal from the other workers. Threads waiting on a group run
+ * tasks too, so waiting from inside a task does not hold up the pool.
+ *
+ * The deque follows "Correct and Efficient Work-Stealing for Weak Memory
+ * Models" by Lê, Pop, Cohen and Zappa Nardelli.
+ *
  * @ingroup aux_util
  */
 
+#include "util/u_worker.h"
 #include "util/u_worker.hpp"
+#include "util/u_trace_marker.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <assert.h>
+
+
+namespace {
+
+struct group;
+struct pool;
+
+//! Size of the deque of a worker when created, grows as needed.
+constexpr int64_t kInitialDequeSize = 64;
+
+//! How many times a thread looks for work before going to sleep.
+constexpr int kSpinCount = 64;
+
+struct task
+{
+	//! Group this task was submitted from.
+	struct group *g;
+
+	//! Function.
+	u_worker_group_func_t func;
+
+	//! Function data.
+	void *data;
+};
+
+/*!
+ * One element of a deque, stealers read it while the owner might be writing
+ * it, so all of the fields are atomic. A stealer only uses what it read if
+ * it then wins the race for the element.
+ */
+struct slot
+{
+	std::atomic<struct group *> g;
+	std::atomic<u_worker_group_func_t> func;
+	std::atomic<void *> data;
+};
+
+struct ring
+{
+	int64_t size;
+	slot *slots;
+
+	explicit ring(int64_t size_) : size(size_), slots(new slot[size_]) {}
+
+	~ring()
+	{
+		delete[] slots;
+	}
+
+	void
+	put(int64_t i, const task &t)
+	{
+		slot &s = slots[i & (size - 1)];
+		s.g.store(t.g, std::memory_order_relaxed);
+		s.func.store(t.func, std::memory_order_relaxed);
+		s.data.store(t.data, std::memory_order_relaxed);
+	}
+
+	task
+	get(int64_t i) const
+	{
+		const slot &s = slots[i & (size - 1)];
+		return task{
+		    s.g.load(std::memory_order_relaxed),
+		    s.func.load(std::memory_order_relaxed),
+		    s.data.load(std::memory_order_relaxed),
+		};
+	}
+};
+
+/*!
+ * Chase-Lev deque, only the owning worker pushes and takes at the bottom,
+ * everybody else steals from the top.
+ */
+struct deque
+{
+	alignas(64) std::atomic<int64_t> top{0};
+	alignas(64) std::atomic<int64_t> bottom{0};
+	std::atomic<ring *> array;
+
+	//! Rings replaced by bigger ones, stealers might still be reading them.
+	std::vector<ring *> retired;
+
+	deque() : array(new ring(kInitialDequeSize)) {}
+
+	~deque()
+	{
+		delete array.load(std::memory_order_relaxed);
+		for (ring *r : retired) {
+			delete r;
+		}
+	}
+
+	bool
+	empty() const
+	{
+		int64_t b = bottom.load(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_seq_cst);
+		return b <= t;
+	}
+
+	//! Owner only.
+	void
+	push(const task &x)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		ring *a = array.load(std::memory_order_relaxed);
+
+		if (b - t > a->size - 1) {
+			ring *bigger = new ring(a->size * 2);
+			for (int64_t i = t; i < b; i++) {
+				bigger->put(i, a->get(i));
+			}
+			retired.push_back(a);
+			array.store(bigger, std::memory_order_release);
+			a = bigger;
+		}
+
+		a->put(b, x);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	//! Owner only.
+	bool
+	take(task &out)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		ring *a = array.load(std::memory_order_relaxed);
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+
+		if (t > b) {
+			// Empty.
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		out = a->get(b);
+		if (t < b) {
+			// More than one left, no race with stealers.
+			return true;
+		}
+
+		// Last one, race the stealers for it.
+		bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_relaxed);
+
+		return won;
+	}
+
+	//! Any thread, may fail spuriously if racing with another thief.
+	bool
+	steal(task &out)
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+
+		if (t >= b) {
+			return false;
+		}
+
+		ring *a = array.load(std::memory_order_acquire);
+		out = a->get(t);
+
+		return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+};
+
+struct worker
+{
+	//! Pool this thread belongs to.
+	struct pool *p;
+
+	//! Index in the pool, also where stealing starts.
+	uint32_t index;
+
+	//! Tasks pushed from this thread.
+	struct deque deque;
+
+	// Native thread.
+	std::thread thread;
+
+	//! Thread name.
+	char name[64];
+};
+
+struct pool : u_worker_thread_pool
+{
+	//! The worker threads, one deque each.
+	std::vector<worker *> workers;
+
+	//! Tasks pushed from threads that are not workers of this pool.
+	std::deque<task> injected;
+
+	//! Protects @p injected.
+	std::mutex injected_mutex;
+
+	//! Number of tasks in @p injected, lets threads skip the lock.
+	std::atomic<int32_t> injected_count{0};
+
+	//! Idle workers and waiters sleep on this.
+	std::mutex sleep_mutex;
+	std::condition_variable sleep_cond;
+
+	//! Threads sleeping or about to sleep on @p sleep_cond.
+	std::atomic<int32_t> sleeping_count{0};
+
+	//! Threads in @ref u_worker_group_wait_all sleeping on @p sleep_cond.
+	std::atomic<int32_t> waiting_count{0};
+
+	//! Is the pool up and running?
+	std::atomic<bool> running{true};
+
+	//! Prefix to use for thread names.
+	char prefix[32];
+};
+
+struct group : u_worker_group
+{
+	//! Pointer to poll of threads.
+	struct u_worker_thread_pool *uwtp;
+
+	//! Number of tasks that is pending or being worked on in this group.
+	std::atomic<int64_t> current_submitted_tasks_count{0};
+};
+
+//! The worker the current thread is, if any.
+thread_local worker *tls_worker = nullptr;
+
+
+/*
+ *
+ * Helper functions.
+ *
+ */
+
+inline struct group *
+group(struct u_worker_group *uwg)
+{
+	return static_cast<struct group *>(uwg);
+}
+
+inline struct pool *
+pool(struct u_worker_thread_pool *uwtp)
+{
+	return static_cast<struct pool *>(uwtp);
+}
+
+//! Returns the current thread's worker if it belongs to @p p.
+inline worker *
+current_worker(struct pool *p)
+{
+	worker *w = tls_worker;
+	return (w != nullptr && w->p == p) ? w : nullptr;
+}
+
+
+/*
+ *
+ * Internal pool functions.
+ *
+ */
+
+bool
+pool_has_work(struct pool *p)
+{
+	if (p->injected_count.load(std::memory_order_seq_cst) > 0) {
+		return true;
+	}
+
+	for (worker *w : p->workers) {
+		if (!w->deque.empty()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool
+pool_pop_injected(struct pool *p, task &out)
+{
+	if (p->injected_count.load(std::memory_order_relaxed) == 0) {
+		return false;
+	}
+
+	std::unique_lock lock(p->injected_mutex);
+	if (p->injected.empty()) {
+		return false;
+	}
+
+	out = p->injected.front();
+	p->injected.pop_front();
+	p->injected_count.fetch_sub(1, std::memory_order_relaxed);
+
+	return true;
+}
+
+bool
+pool_find_task(struct pool *p, worker *self, task &out)
+{
+	if (self != nullptr && self->deque.take(out)) {
+		return true;
+	}
+
+	if (pool_pop_injected(p, out)) {
+		return true;
+	}
 
+	size_t count = p->workers.size();
+	size_t start = self != nullptr ? self->index + 1 : 0;
+	for (size_t i = 0; i < count; i++) {
+		worker *victim = p->workers[(start + i) % count];
+		if (victim != self && victim->deque.steal(out)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//! Looks for work a few times before giving up, steals can fail spuriously.
+bool
+pool_find_task_spin(struct pool *p, worker *self, task &out)
+{
+	for (int i = 0; i < kSpinCount; i++) {
+		if (pool_find_task(p, self, out)) {
+			return true;
+		}
+
+		if (!pool_has_work(p)) {
+			return false;
+		}
+
+		std::this_thread::yield();
+	}
+
+	return false;
+}
+
+void
+pool_wake_one_if_sleeping(struct pool *p)
+{
+	// Pairs with the increment in the sleepers, one of the two sees the other.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (p->sleeping_count.load(std::memory_order_seq_cst) == 0) {
+		return;
+	}
+
+	// Taking the lock makes sure the sleeper is either waiting or has not checked yet.
+	std::unique_lock lock(p->sleep_mutex);
+	p->sleep_cond.notify_one();
+}
+
+void
+pool_push_task(struct pool *p, const task &t)
+{
+	worker *self = current_worker(p);
+	if (self != nullptr) {
+		self->deque.push(t);
+	} else {
+		std::unique_lock lock(p->injected_mutex);
+		p->injected.push_back(t);
+		p->injected_count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	pool_wake_one_if_sleeping(p);
+}
+
+void
+pool_run_task(struct pool *p, const task &t)
+{
+	t.func(t.data);
+
+	// Only now decrement the task count on the owning group.
+	int64_t left = t.g->current_submitted_tasks_count.fetch_sub(1, std::memory_order_seq_cst) - 1;
+	if (left > 0) {
+		return;
+	}
+
+	/*
+	 * The group might be destroyed as soon as the count hits zero, so only
+	 * touch the pool from here on. The pool is kept alive by the group
+	 * being waited on, or by this being one of its threads.
+	 */
+	if (p->waiting_count.load(std::memory_order_seq_cst) == 0) {
+		return;
+	}
+
+	std::unique_lock lock(p->sleep_mutex);
+	p->sleep_cond.notify_all();
+}
+
+
+/*
+ *
+ * Thread internal functions.
+ *
+ */
+
+void
+run_func(worker *w)
+{
+	struct pool *p = w->p;
+
+	tls_worker = w;
+
+	snprintf(w->name, sizeof(w->name), "%s: Worker", p->prefix);
+	U_TRACE_SET_THREAD_NAME(w->name);
+
+	while (p->running.load(std::memory_order_acquire)) {
+		task t = {};
+		if (pool_find_task_spin(p, w, t)) {
+			pool_run_task(p, t);
+			continue;
+		}
+
+		std::unique_lock lock(p->sleep_mutex);
+		p->sleeping_count.fetch_add(1, std::memory_order_seq_cst);
+		p->sleep_cond.wait(lock, [&] { return !p->running.load() || pool_has_work(p); });
+		p->sleeping_count.fetch_sub(1, std::memory_order_seq_cst);
+	}
+
+	tls_worker = nullptr;
+}
+
+} // namespace
+
+
+/*
+ *
+ * 'Exported' thread pool functions.
+ *
+ */
+
+extern "C" struct u_worker_thread_pool *
+u_worker_thread_pool_create(uint32_t starting_worker_count, uint32_t thread_count, const char *prefix)
+{
+	XRT_TRACE_MARKER();
+
+	assert(starting_worker_count < thread_count);
+	if (starting_worker_count >= thread_count) {
+		return NULL;
+	}
+
+	struct pool *p = new struct pool;
+	p->reference.count = 1;
+	snprintf(p->prefix, sizeof(p->prefix), "%s", prefix);
+
+	// Waiting threads run tasks themselves, so no extra threads are needed for them.
+	p->workers.resize(starting_worker_count);
+	for (uint32_t i = 0; i < starting_worker_count; i++) {
+		p->workers[i] = new worker;
+		p->workers[i]->p = p;
+		p->workers[i]->index = i;
+	}
+
+	// All deques must exist before any thread starts stealing.
+	for (worker *w : p->workers) {
+		w->thread = std::thread(run_func, w);
+	}
+
+	return p;
+}
+
+extern "C" void
+u_worker_thread_pool_destroy(struct u_worker_thread_pool *uwtp)
+{
+	XRT_TRACE_MARKER();
+
+	struct pool *p = pool(uwtp);
+
+	{
+		std::unique_lock lock(p->sleep_mutex);
+		p->running.store(false);
+		p->sleep_cond.notify_all();
+	}
+
+	// Wait for all threads, before freeing any of them as they steal from each other.
+	for (worker *w : p->workers) {
+		w->thread.join();
+	}
+	for (worker *w : p->workers) {
+		delete w;
+	}
+
+	assert(p->injected.empty());
+
+	delete p;
+}
+
+
+/*
+ *
+ * 'Exported' group functions.
+ *
+ */
+
+extern "C" struct u_worker_group *
+u_worker_group_create(struct u_worker_thread_pool *uwtp)
+{
+	XRT_TRACE_MARKER();
+
+	struct group *g = new struct group;
+	g->reference.count = 1;
+	g->uwtp = nullptr;
+	u_worker_thread_pool_reference(&g->uwtp, uwtp);
+
+	return g;
+}
+
+extern "C" void
+u_worker_group_push(struct u_worker_group *uwg, u_worker_group_func_t f, void *data)
+{
+	XRT_TRACE_MARKER();
+
+	struct group *g = group(uwg);
+	struct pool *p = pool(g->uwtp);
+
+	g->current_submitted_tasks_count.fetch_add(1, std::memory_order_seq_cst);
+
+	pool_push_task(p, task{g, f, data});
+}
+
+extern "C" void
+u_worker_group_wait_all(struct u_worker_group *uwg)
+{
+	XRT_TRACE_MARKER();
+
+	struct group *g = group(uwg);
+	struct pool *p = pool(g->uwtp);
+	worker *self = current_worker(p);
+
+	auto done = [&] { return g->current_submitted_tasks_count.load(std::memory_order_seq_cst) == 0; };
+
+	while (!done()) {
+		// Help out, this might run tasks from other groups too.
+		task t = {};
+		if (pool_find_task_spin(p, self, t)) {
+			pool_run_task(p, t);
+			continue;
+		}
+
+		// The rest of the tasks are running on other threads, or about to be pushed by them.
+		std::unique_lock lock(p->sleep_mutex);
+		p->waiting_count.fetch_add(1, std::memory_order_seq_cst);
+		p->sleeping_count.fetch_add(1, std::memory_order_seq_cst);
+		p->sleep_cond.wait(lock, [&] { return done() || pool_has_work(p); });
+		p->sleeping_count.fetch_sub(1, std::memory_order_seq_cst);
+		p->waiting_count.fetch_sub(1, std::memory_order_seq_cst);
+	}
+}
+
+extern "C" void
+u_worker_group_destroy(struct u_worker_group *uwg)
+{
+	XRT_TRACE_MARKER();
+
+	struct group *g = group(uwg);
+	assert(g->reference.count == 0);
+
+	u_worker_group_wait_all(uwg);
+
+	u_worker_thread_pool_reference(&g->uwtp, NULL);
+
+	delete g;
+}
+
+
+/*
+ *
+ * C++ wrappers.
+ *
+ */
 
 void
 xrt::auxiliary::util::TaskCollection::cCallback(void *data_ptr)
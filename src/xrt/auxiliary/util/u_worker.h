@@ -37,11 +37,13 @@ struct u_worker_thread_pool
 /*!
  * Creates a new thread pool to be used by a worker group.
  *
- * @param starting_worker_count How many worker threads can be active at the
- *                              same time without any "donated" threads.
- * @param thread_count          The number of threads to be created in total,
- *                              this is the maximum threads that can be in
- *                              flight at the same time.
+ * @param starting_worker_count How many worker threads are created, threads
+ *                              waiting on a group work on tasks in addition
+ *                              to these.
+ * @param thread_count          The maximum threads that are expected to be in
+ *                              flight at the same time, counting waiting
+ *                              threads, must be greater than
+ *                              @p starting_worker_count.
  * @param prefix                Prefix to used when naming threads, used for
  *                              tracing and debugging.
  *
@@ -119,7 +121,9 @@ struct u_worker_group *
 u_worker_group_create(struct u_worker_thread_pool *uwtp);
 
 /*!
- * Push a new task to worker group.
+ * Push a new task to worker group, never blocks. When called from one of the
+ * pool's threads the task goes on that thread's own queue, where other idle
+ * threads can steal it from.
  *
  * @ingroup aux_util
  */
@@ -128,7 +132,8 @@ u_worker_group_push(struct u_worker_group *uwg, u_worker_group_func_t f, void *d
 
 /*!
  * Wait for all pushed tasks to be completed, "donates" this thread to the
- * shared thread pool.
+ * shared thread pool by running tasks while waiting, which may include tasks
+ * from other groups. Can be called from inside a task.
  *
  * @ingroup aux_util
  */
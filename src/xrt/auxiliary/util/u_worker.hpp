@@ -14,7 +14,9 @@
 
 #include <vector>
 #include <cassert>
+#include <algorithm>
 #include <functional>
+#include <type_traits>
 
 
 namespace xrt::auxiliary::util {
@@ -107,6 +109,10 @@ public:
 
 	friend TaskCollection;
 
+	template <typename Func>
+	friend void
+	parallel_for(SharedThreadGroup const &stg, size_t begin, size_t end, size_t grain, Func &&func);
+
 	// No default constructor.
 	SharedThreadGroup() = delete;
 	// Do not move or copy the shared thread group.
@@ -188,4 +194,50 @@ private:
 	cCallback(void *data_ptr);
 };
 
+/*!
+ * Calls @p func with every index in [@p begin, @p end) on the threads of the
+ * group, in chunks of @p grain indices, and waits for all of them. The calling
+ * thread works on chunks too, so this can be used from inside a task.
+ *
+ * @ingroup aux_util
+ */
+template <typename Func>
+void
+parallel_for(SharedThreadGroup const &stg, size_t begin, size_t end, size_t grain, Func &&func)
+{
+	if (begin >= end) {
+		return;
+	}
+
+	grain = std::max<size_t>(grain, 1);
+
+	struct Chunk
+	{
+		std::remove_reference_t<Func> *func;
+		size_t begin;
+		size_t end;
+
+		static void
+		callback(void *ptr)
+		{
+			Chunk &c = *static_cast<Chunk *>(ptr);
+			for (size_t i = c.begin; i < c.end; i++) {
+				(*c.func)(i);
+			}
+		}
+	};
+
+	std::vector<Chunk> chunks;
+	chunks.reserve((end - begin + grain - 1) / grain);
+	for (size_t i = begin; i < end; i += grain) {
+		chunks.push_back({&func, i, std::min(i + grain, end)});
+	}
+
+	for (Chunk &c : chunks) {
+		u_worker_group_push(stg.mGroup, &Chunk::callback, &c);
+	}
+
+	u_worker_group_wait_all(stg.mGroup);
+}
+
 } // namespace xrt::auxiliary::util
@@ -306,6 +306,7 @@ compositor_layer_commit(struct xrt_compositor *xc, xrt_graphics_sync_handle_t sy
 	u_graphics_sync_unref(&sync_handle);
 
 	// Do the drawing
+	int64_t draw_begin_ns = os_monotonic_get_ns();
 	xrt_result_t xret = comp_renderer_draw(c->r);
 	if (xret != XRT_SUCCESS) {
 		return xret;
@@ -315,6 +316,12 @@ compositor_layer_commit(struct xrt_compositor *xc, xrt_graphics_sync_handle_t sy
 
 	// Record the time of this frame.
 	c->last_frame_time_ns = os_monotonic_get_ns();
+
+	u_ls_hist_add(c->stats.draw_hist, (uint64_t)(c->last_frame_time_ns - draw_begin_ns));
+	if (c->last_frame_time_ns - c->stats.last_report_ns >= U_TIME_1S_IN_NS) {
+		c->stats.last_report_ns = c->last_frame_time_ns;
+		u_ls_hist_get_and_reset(c->stats.draw_hist, NULL, NULL, 0, &c->stats.draw);
+	}
 	c->app_profiling.last_end = c->last_frame_time_ns;
 
 
@@ -427,6 +434,7 @@ compositor_destroy(struct xrt_compositor *xc)
 
 	// Can do this now.
 	u_frame_times_widget_teardown(&c->compositor_frame_times);
+	u_ls_hist_destroy(&c->stats.draw_hist);
 
 	comp_base_fini(&c->base);
 
@@ -950,7 +958,7 @@ compositor_init_render_resources(struct comp_compositor *c)
 		return false;
 	}
 
-	if (!render_resources_init(&c->nr, &c->shaders, get_vk(c), c->xdev)) {
+	if (!render_resources_init(&c->nr, &c->shaders, get_vk(c), c->xdev, c->settings.frames_in_flight)) {
 		return false;
 	}
 
@@ -996,6 +1004,7 @@ comp_main_create_system_compositor(struct xrt_device *xdev,
 	c->frame.waited.id = -1;
 	c->frame.rendering.id = -1;
 	c->xdev = xdev;
+	u_ls_hist_create("draw", &c->stats.draw_hist);
 
 	COMP_DEBUG(c, "Doing init %p", (void *)c);
 
@@ -1133,6 +1142,10 @@ comp_main_create_system_compositor(struct xrt_device *xdev,
 	u_var_add_bool(c, &c->debug.atw_off, "Debug: ATW OFF");
 	u_var_add_bool(c, &c->debug.disable_fast_path, "Debug: Disable fast path");
 	u_var_add_f32_timing(c, c->compositor_frame_times.debug_var, "Frame Times (Compositor)");
+	u_var_add_ro_u64(c, &c->stats.draw.p50, "Draw p50 (ns)");
+	u_var_add_ro_u64(c, &c->stats.draw.p99, "Draw p99 (ns)");
+	u_var_add_ro_u64(c, &c->stats.draw.p999, "Draw p99.9 (ns)");
+	u_var_add_ro_u64(c, &c->stats.draw.worst, "Draw worst (ns)");
 
 	// Only add active views.
 	for (uint32_t i = 0; i < view_count; i++) {
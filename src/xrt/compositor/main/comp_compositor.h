@@ -16,6 +16,7 @@
 #include "util/u_threading.h"
 #include "util/u_index_fifo.h"
 #include "util/u_logging.h"
+#include "util/u_live_stats.h"
 #include "util/u_frame_times_widget.h"
 #include "util/u_native_images_debug.h"
 
@@ -134,6 +135,17 @@ struct comp_compositor
 
 	struct u_frame_times_widget compositor_frame_times;
 
+	//! CPU time spent drawing each frame, reported once a second.
+	struct
+	{
+		struct u_live_stats_hist *draw_hist;
+
+		//! Last report, shown in the debug UI.
+		struct u_live_stats_hist_report draw;
+
+		int64_t last_report_ns;
+	} stats;
+
 	struct
 	{
 		struct comp_frame waited;
@@ -30,6 +30,7 @@
 #include "util/u_frame_times_widget.h"
 
 #include "util/comp_render.h"
+#include "util/comp_layer_accum.h"
 
 #include "main/comp_frame.h"
 #include "main/comp_mirror_to_debug_gui.h"
@@ -87,6 +88,54 @@ enum comp_target_fov_source
 	COMP_TARGET_FOV_SOURCE_DEVICE_VIEWS,
 };
 
+/*!
+ * Max number of client swapchain images a single frame can read from, color
+ * and depth for every view of every layer.
+ */
+#define COMP_RENDERER_MAX_FRAME_IMAGES (RENDER_MAX_LAYERS * XRT_MAX_VIEWS * 2)
+
+// Each frame in flight renders to its own scratch image.
+static_assert(COMP_SCRATCH_NUM_IMAGES > RENDER_MAX_FRAMES_IN_FLIGHT, "Too few scratch images");
+
+/*!
+ * State for a single frame in flight, the GPU resources used when recording it
+ * are in the matching @ref render_frame_resources.
+ *
+ * @ingroup comp_main
+ */
+struct comp_renderer_frame
+{
+	//! Signalled when the GPU has finished the frame.
+	VkFence fence;
+
+	//! The builder below is initialised and images are held, needs retiring.
+	bool in_use;
+
+	//! Has been submitted, @ref fence will be signalled.
+	bool submitted;
+
+	//! Used to report GPU timing for the frame when retired.
+	int64_t frame_id;
+
+	//! Which of @ref rr or @ref crc is used.
+	bool use_compute;
+
+	struct render_gfx rr;
+	struct render_compute crc;
+
+	/*!
+	 * Client swapchain images sampled by this frame, the image use is held
+	 * so that clients wait for the GPU to finish before rendering to them.
+	 */
+	struct
+	{
+		struct xrt_swapchain *xsc;
+		uint32_t index;
+	} images[COMP_RENDERER_MAX_FRAME_IMAGES];
+
+	uint32_t image_count;
+};
+
 /*!
  * Holds associated vulkan objects and state to render with a distortion.
  *
@@ -116,6 +165,15 @@ struct comp_renderer
 		} views[XRT_MAX_VIEWS];
 	} scratch;
 
+	//! Frames in flight, @ref frame_count of them are used.
+	struct comp_renderer_frame frames[RENDER_MAX_FRAMES_IN_FLIGHT];
+
+	//! Same as render_resources::frame_count.
+	uint32_t frame_count;
+
+	//! The frame that will be used for the next draw.
+	uint32_t frame_index;
+
 	//! @}
 
 	//! @name Image-dependent members
@@ -124,9 +182,6 @@ struct comp_renderer
 	//! Index of the current buffer/image
 	int32_t acquired_buffer;
 
-	//! Which buffer was last submitted and has a fence pending.
-	int32_t fenced_buffer;
-
 	/*!
 	 * The render pass used to render to the target, it depends on the
 	 * target's format so will be recreated each time the target changes.
@@ -141,12 +196,7 @@ struct comp_renderer
 	struct render_gfx_target_resources *rtr_array;
 
 	/*!
-	 * Array of fences equal in size to the number of comp_target images.
-	 */
-	VkFence *fences;
-
-	/*!
-	 * The number of renderings/fences we've created: set from comp_target when we use that data.
+	 * The number of renderings we've created: set from comp_target when we use that data.
 	 */
 	uint32_t buffer_count;
 
@@ -353,6 +403,42 @@ calc_pose_data(struct comp_renderer *r,
 	}
 }
 
+/*!
+ * Called after the command buffer has been built, but before it is submitted.
+ * If the frame does timewarp the head pose is sampled again, at the same
+ * predicted display time, and the timewarp transforms in the host coherent
+ * UBOs are rewritten with it. Also tells the target when the pose used for the
+ * frame was sampled, this must only be done once per frame.
+ */
+static void
+do_late_latch(struct comp_renderer *r,
+              const struct render_late_latch *rll,
+              enum comp_target_fov_source fov_source,
+              uint32_t view_count,
+              int64_t latched_ns)
+{
+	COMP_TRACE_MARKER();
+
+	if (rll->view_count > 0) {
+		struct xrt_fov fovs[XRT_MAX_VIEWS];
+		struct xrt_pose world_poses[XRT_MAX_VIEWS];
+		struct xrt_pose eye_poses[XRT_MAX_VIEWS];
+		calc_pose_data(  //
+		    r,           // r
+		    fov_source,  // fov_source
+		    fovs,        // fovs
+		    world_poses, // world_poses
+		    eye_poses,   // eye_poses
+		    view_count); // view_count
+		latched_ns = os_monotonic_get_ns();
+
+		render_late_latch_update(rll, world_poses);
+	}
+
+	// Tell the target when the pose was sampled, for frame timing.
+	comp_target_mark_latch(r->c->target, r->c->frame.rendering.id, latched_ns);
+}
+
 //! @pre comp_target_has_images(r->c->target)
 static void
 renderer_build_rendering_target_resources(struct comp_renderer *r,
@@ -379,17 +465,15 @@ renderer_build_rendering_target_resources(struct comp_renderer *r,
  * Update r->buffer_count before calling.
  */
 static void
-renderer_create_renderings_and_fences(struct comp_renderer *r)
+renderer_create_renderings(struct comp_renderer *r)
 {
-	assert(r->fences == NULL);
+	assert(r->rtr_array == NULL);
 	if (r->buffer_count == 0) {
-		COMP_ERROR(r->c, "Requested 0 command buffers.");
+		COMP_ERROR(r->c, "Requested 0 renderings.");
 		return;
 	}
 
-	COMP_DEBUG(r->c, "Allocating %d Command Buffers.", r->buffer_count);
-
-	struct vk_bundle *vk = &r->c->base.vk;
+	COMP_DEBUG(r->c, "Allocating %d renderings.", r->buffer_count);
 
 	bool use_compute = r->settings->use_compute;
 	if (!use_compute) {
@@ -406,34 +490,11 @@ renderer_create_renderings_and_fences(struct comp_renderer *r)
 			renderer_build_rendering_target_resources(r, &r->rtr_array[i], i);
 		}
 	}
-
-	r->fences = U_TYPED_ARRAY_CALLOC(VkFence, r->buffer_count);
-
-	for (uint32_t i = 0; i < r->buffer_count; i++) {
-		VkFenceCreateInfo fence_info = {
-		    .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-		    .flags = VK_FENCE_CREATE_SIGNALED_BIT,
-		};
-
-		VkResult ret = vk->vkCreateFence( //
-		    vk->device,                   //
-		    &fence_info,                  //
-		    NULL,                         //
-		    &r->fences[i]);               //
-		if (ret != VK_SUCCESS) {
-			COMP_ERROR(r->c, "vkCreateFence: %s", vk_result_string(ret));
-		}
-
-		char buf[] = "Comp Renderer X_XXXX_XXXX";
-		snprintf(buf, ARRAY_SIZE(buf), "Comp Renderer %u", i);
-		VK_NAME_FENCE(vk, r->fences[i], buf);
-	}
 }
 
 static void
-renderer_close_renderings_and_fences(struct comp_renderer *r)
+renderer_close_renderings(struct comp_renderer *r)
 {
-	struct vk_bundle *vk = &r->c->base.vk;
 	// Renderings
 	if (r->buffer_count > 0 && r->rtr_array != NULL) {
 		for (uint32_t i = 0; i < r->buffer_count; i++) {
@@ -447,19 +508,8 @@ renderer_close_renderings_and_fences(struct comp_renderer *r)
 		r->rtr_array = NULL;
 	}
 
-	// Fences
-	if (r->buffer_count > 0 && r->fences != NULL) {
-		for (uint32_t i = 0; i < r->buffer_count; i++) {
-			vk->vkDestroyFence(vk->device, r->fences[i], NULL);
-			r->fences[i] = VK_NULL_HANDLE;
-		}
-		free(r->fences);
-		r->fences = NULL;
-	}
-
 	r->buffer_count = 0;
 	r->acquired_buffer = -1;
-	r->fenced_buffer = -1;
 }
 
 /*!
@@ -501,7 +551,7 @@ renderer_ensure_images_and_renderings(struct comp_renderer *r, bool force_recrea
 	renderer_wait_queue_idle(r);
 
 	// Make we sure we destroy all dependent things before creating new images.
-	renderer_close_renderings_and_fences(r);
+	renderer_close_renderings(r);
 
 	VkImageUsageFlags image_usage = 0;
 	if (r->settings->use_compute) {
@@ -544,13 +594,186 @@ renderer_ensure_images_and_renderings(struct comp_renderer *r, bool force_recrea
 
 	r->buffer_count = r->c->target->image_count;
 
-	renderer_create_renderings_and_fences(r);
+	renderer_create_renderings(r);
 
 	assert(r->buffer_count != 0);
 
 	return true;
 }
 
+static void
+renderer_init_frames(struct comp_renderer *r)
+{
+	struct vk_bundle *vk = &r->c->base.vk;
+
+	r->frame_count = r->c->nr.frame_count;
+	r->frame_index = 0;
+
+	for (uint32_t i = 0; i < r->frame_count; i++) {
+		VkFenceCreateInfo fence_info = {
+		    .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+		};
+
+		VkResult ret = vk->vkCreateFence( //
+		    vk->device,                   //
+		    &fence_info,                  //
+		    NULL,                         //
+		    &r->frames[i].fence);         //
+		if (ret != VK_SUCCESS) {
+			COMP_ERROR(r->c, "vkCreateFence: %s", vk_result_string(ret));
+		}
+
+		char buf[] = "Comp Renderer X_XXXX_XXXX";
+		snprintf(buf, ARRAY_SIZE(buf), "Comp Renderer %u", i);
+		VK_NAME_FENCE(vk, r->frames[i].fence, buf);
+	}
+
+	COMP_DEBUG(r->c, "Rendering with %u frame(s) in flight.", r->frame_count);
+}
+
+/*!
+ * Hold the use of all client swapchain images that the layers of this frame
+ * reads from, @see xrt_swapchain_inc_image_use.
+ */
+static void
+renderer_frame_hold_images(struct comp_renderer_frame *rf, const struct comp_layer *layers, uint32_t layer_count)
+{
+	for (uint32_t i = 0; i < layer_count; i++) {
+		const struct comp_layer *layer = &layers[i];
+		const struct xrt_layer_data *data = &layer->data;
+
+		for (uint32_t k = 0; k < ARRAY_SIZE(layer->sc_array); k++) {
+			struct xrt_swapchain *xsc = layer->sc_array[k];
+			if (xsc == NULL) {
+				continue;
+			}
+
+			uint32_t index = 0;
+			switch (data->type) {
+			case XRT_LAYER_PROJECTION: index = data->proj.v[k].sub.image_index; break;
+			case XRT_LAYER_PROJECTION_DEPTH:
+				index = k < data->view_count ? data->depth.v[k].sub.image_index
+				                             : data->depth.d[k - data->view_count].sub.image_index;
+				break;
+			case XRT_LAYER_QUAD: index = data->quad.sub.image_index; break;
+			case XRT_LAYER_CUBE: index = data->cube.sub.image_index; break;
+			case XRT_LAYER_CYLINDER: index = data->cylinder.sub.image_index; break;
+			case XRT_LAYER_EQUIRECT1: index = data->equirect1.sub.image_index; break;
+			case XRT_LAYER_EQUIRECT2: index = data->equirect2.sub.image_index; break;
+			case XRT_LAYER_PASSTHROUGH: continue;
+			}
+
+			assert(rf->image_count < ARRAY_SIZE(rf->images));
+			rf->images[rf->image_count].xsc = NULL;
+			rf->images[rf->image_count].index = index;
+			xrt_swapchain_reference(&rf->images[rf->image_count].xsc, xsc);
+			xrt_swapchain_inc_image_use(xsc, index);
+			rf->image_count++;
+		}
+	}
+}
+
+/*!
+ * Waits for the GPU to finish the frame if it was submitted, reports its GPU
+ * timing and frees everything it held. Selects the frame's render resources.
+ */
+static void
+renderer_retire_frame(struct comp_renderer *r, uint32_t index)
+{
+	COMP_TRACE_MARKER();
+
+	struct comp_compositor *c = r->c;
+	struct vk_bundle *vk = &c->base.vk;
+	struct comp_renderer_frame *rf = &r->frames[index];
+	VkResult ret;
+
+	if (!rf->in_use) {
+		return;
+	}
+
+	// The builders and the timestamps refer to the frame's resources.
+	render_resources_use_frame(&c->nr, index);
+
+	if (rf->submitted) {
+		ret = vk->vkWaitForFences(vk->device, 1, &rf->fence, VK_TRUE, UINT64_MAX);
+		if (ret != VK_SUCCESS) {
+			COMP_ERROR(c, "vkWaitForFences: %s", vk_result_string(ret));
+		}
+
+		/*
+		 * Get timestamps of GPU work (if available).
+		 */
+
+		uint64_t gpu_start_ns, gpu_end_ns;
+		if (render_resources_get_timestamps(&c->nr, &gpu_start_ns, &gpu_end_ns)) {
+			uint64_t now_ns = os_monotonic_get_ns();
+			comp_target_info_gpu(c->target, rf->frame_id, gpu_start_ns, gpu_end_ns, now_ns);
+		}
+	}
+
+	if (rf->use_compute) {
+		render_compute_fini(&rf->crc);
+	} else {
+		render_gfx_fini(&rf->rr);
+	}
+
+	for (uint32_t i = 0; i < rf->image_count; i++) {
+		xrt_swapchain_dec_image_use(rf->images[i].xsc, rf->images[i].index);
+		xrt_swapchain_reference(&rf->images[i].xsc, NULL);
+	}
+
+	rf->image_count = 0;
+	rf->submitted = false;
+	rf->in_use = false;
+}
+
+//! Retire all frames the GPU has already finished, does not block.
+static void
+renderer_retire_finished_frames(struct comp_renderer *r)
+{
+	struct vk_bundle *vk = &r->c->base.vk;
+
+	for (uint32_t i = 0; i < r->frame_count; i++) {
+		struct comp_renderer_frame *rf = &r->frames[i];
+		if (!rf->submitted || vk->vkGetFenceStatus(vk->device, rf->fence) != VK_SUCCESS) {
+			continue;
+		}
+
+		renderer_retire_frame(r, i);
+	}
+}
+
+/*!
+ * Makes the next frame ready for recording, only blocks if the GPU is still
+ * working on the frame that last used the same resources.
+ */
+static struct comp_renderer_frame *
+renderer_begin_frame(struct comp_renderer *r, bool use_compute)
+{
+	COMP_TRACE_MARKER();
+
+	struct comp_compositor *c = r->c;
+	struct comp_renderer_frame *rf = &r->frames[r->frame_index];
+
+	// Also selects the frame's resources.
+	renderer_retire_frame(r, r->frame_index);
+	render_resources_use_frame(&c->nr, r->frame_index);
+
+	rf->in_use = true;
+	rf->frame_id = c->frame.rendering.id;
+	rf->use_compute = use_compute;
+
+	if (use_compute) {
+		render_compute_init(&rf->crc, &c->nr);
+	} else {
+		render_gfx_init(&rf->rr, &c->nr);
+	}
+
+	renderer_frame_hold_images(rf, c->base.layer_accum.layers, c->base.layer_accum.layer_count);
+
+	return rf;
+}
+
 //! Create renderer and initialize non-image-dependent members
 static void
 renderer_init(struct comp_renderer *r, struct comp_compositor *c, VkExtent2D scratch_extent)
@@ -562,9 +785,10 @@ renderer_init(struct comp_renderer *r, struct comp_compositor *c, VkExtent2D scr
 	r->settings = &c->settings;
 
 	r->acquired_buffer = -1;
-	r->fenced_buffer = -1;
 	r->rtr_array = NULL;
 
+	renderer_init_frames(r);
+
 	// Shared render pass between all scratch images.
 	render_gfx_render_pass_init(                   //
 	    &r->scratch_render_pass,                   // rgrp
@@ -608,26 +832,6 @@ renderer_init(struct comp_renderer *r, struct comp_compositor *c, VkExtent2D scr
 	}
 }
 
-static void
-renderer_wait_for_last_fence(struct comp_renderer *r)
-{
-	COMP_TRACE_MARKER();
-
-	if (r->fenced_buffer < 0) {
-		return;
-	}
-
-	struct vk_bundle *vk = &r->c->base.vk;
-	VkResult ret;
-
-	ret = vk->vkWaitForFences(vk->device, 1, &r->fences[r->fenced_buffer], VK_TRUE, UINT64_MAX);
-	if (ret != VK_SUCCESS) {
-		COMP_ERROR(r->c, "vkWaitForFences: %s", vk_result_string(ret));
-	}
-
-	r->fenced_buffer = -1;
-}
-
 static XRT_CHECK_RESULT VkResult
 renderer_submit_queue(struct comp_renderer *r, VkCommandBuffer cmd, VkPipelineStageFlags pipeline_stage_flag)
 {
@@ -640,16 +844,12 @@ renderer_submit_queue(struct comp_renderer *r, VkCommandBuffer cmd, VkPipelineSt
 	assert(frame_id >= 0);
 
 
-	/*
-	 * Wait for previous frame's work to complete.
-	 */
-
-	// Wait for the last fence, if any.
-	renderer_wait_for_last_fence(r);
-	assert(r->fenced_buffer < 0);
+	// The frame was retired in renderer_begin_frame so its fence is free.
+	struct comp_renderer_frame *rf = &r->frames[r->frame_index];
+	assert(rf->in_use && !rf->submitted);
 
 	assert(r->acquired_buffer >= 0);
-	ret = vk->vkResetFences(vk->device, 1, &r->fences[r->acquired_buffer]);
+	ret = vk->vkResetFences(vk->device, 1, &rf->fence);
 	VK_CHK_AND_RET(ret, "vkResetFences");
 
 
@@ -717,7 +917,7 @@ renderer_submit_queue(struct comp_renderer *r, VkCommandBuffer cmd, VkPipelineSt
 	 * us avoid taking a lot of locks. The queue lock will be taken by
 	 * @ref vk_cmd_submit_locked tho.
 	 */
-	ret = vk_cmd_submit_locked(vk, 1, &comp_submit_info, r->fences[r->acquired_buffer]);
+	ret = vk_cmd_submit_locked(vk, 1, &comp_submit_info, rf->fence);
 
 	// We have now completed the submit, even if we failed.
 	comp_target_mark_submit_end(ct, frame_id, os_monotonic_get_ns());
@@ -725,8 +925,8 @@ renderer_submit_queue(struct comp_renderer *r, VkCommandBuffer cmd, VkPipelineSt
 	// Check after marking as submit complete.
 	VK_CHK_AND_RET(ret, "vk_cmd_submit_locked");
 
-	// This buffer now have a pending fence.
-	r->fenced_buffer = r->acquired_buffer;
+	// This frame now has a pending fence.
+	rf->submitted = true;
 
 	return ret;
 }
@@ -776,7 +976,7 @@ renderer_resize(struct comp_renderer *r)
 	if (!comp_target_check_ready(r->c->target)) {
 		// Can't create images right now.
 		// Just close any existing renderings.
-		renderer_close_renderings_and_fences(r);
+		renderer_close_renderings(r);
 		return;
 	}
 	// Force recreate.
@@ -816,8 +1016,16 @@ renderer_fini(struct comp_renderer *r)
 {
 	struct vk_bundle *vk = &r->c->base.vk;
 
-	// Command buffers
-	renderer_close_renderings_and_fences(r);
+	// Wait for and free all frames in flight.
+	for (uint32_t i = 0; i < r->frame_count; i++) {
+		renderer_retire_frame(r, i);
+
+		vk->vkDestroyFence(vk->device, r->frames[i].fence, NULL);
+		r->frames[i].fence = VK_NULL_HANDLE;
+	}
+
+	// Renderings
+	renderer_close_renderings(r);
 
 	// Do before layer render just in case it holds any references.
 	comp_mirror_fini(&r->mirror_to_debug_gui, vk);
@@ -886,6 +1094,7 @@ dispatch_graphics(struct comp_renderer *r,
 	    world_poses,        // world_poses
 	    eye_poses,          // eye_poses
 	    rr->r->view_count); // view_count
+	int64_t latched_ns = os_monotonic_get_ns();
 
 
 	// The arguments for the dispatch function.
@@ -952,6 +1161,9 @@ dispatch_graphics(struct comp_renderer *r,
 	// Make the command buffer submittable.
 	render_gfx_end(rr);
 
+	// Sample the pose again and patch the timewarp UBOs.
+	do_late_latch(r, &rr->late_latch, fov_source, rr->r->view_count, latched_ns);
+
 	// Everything is ready, submit to the queue.
 	ret = renderer_submit_queue(r, rr->r->cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
 	VK_CHK_AND_RET(ret, "renderer_submit_queue");
@@ -998,6 +1210,7 @@ dispatch_compute(struct comp_renderer *r,
 	    world_poses,         // world_poses
 	    eye_poses,           // eye_poses
 	    crc->r->view_count); // view_count
+	int64_t latched_ns = os_monotonic_get_ns();
 
 	// Target Vulkan resources..
 	VkImage target_image = r->c->target->images[r->acquired_buffer].handle;
@@ -1069,6 +1282,9 @@ dispatch_compute(struct comp_renderer *r,
 	// Make the command buffer submittable.
 	render_compute_end(crc);
 
+	// Sample the pose again and patch the timewarp UBOs.
+	do_late_latch(r, &crc->late_latch, fov_source, crc->r->view_count, latched_ns);
+
 	// Everything is ready, submit to the queue.
 	ret = renderer_submit_queue(r, crc->r->cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 	VK_CHK_AND_RET(ret, "renderer_submit_queue");
@@ -1117,6 +1333,9 @@ comp_renderer_draw(struct comp_renderer *r)
 
 	comp_target_update_timings(ct);
 
+	// Frees resources and reports timing of frames that are done.
+	renderer_retire_finished_frames(r);
+
 	if (r->acquired_buffer < 0) {
 		// Ensures that renderings are created.
 		renderer_acquire_swapchain_image(r);
@@ -1132,19 +1351,18 @@ comp_renderer_draw(struct comp_renderer *r)
 	struct comp_render_scratch_state crss;
 	scratch_get_init(&crss, r, view_count);
 
+	// Only blocks if the GPU hasn't finished with the frame's resources.
 	bool use_compute = r->settings->use_compute;
-	struct render_gfx rr = {0};
-	struct render_compute crc = {0};
+	struct comp_renderer_frame *rf = renderer_begin_frame(r, use_compute);
 
 	VkResult res = VK_SUCCESS;
 	if (use_compute) {
-		render_compute_init(&crc, &c->nr);
-		res = dispatch_compute(r, &crc, &crss, fov_source);
+		res = dispatch_compute(r, &rf->crc, &crss, fov_source);
 	} else {
-		render_gfx_init(&rr, &c->nr);
-		res = dispatch_graphics(r, &rr, &crss, fov_source);
+		res = dispatch_graphics(r, &rf->rr, &crss, fov_source);
 	}
 	if (res != VK_SUCCESS) {
+		renderer_retire_frame(r, r->frame_index);
 		return XRT_ERROR_VULKAN;
 	}
 
@@ -1214,40 +1432,24 @@ comp_renderer_draw(struct comp_renderer *r)
 	}
 
 	/*
-	 * This fixes a lot of validation issues as it makes sure that the
-	 * command buffer has completed and all resources referred by it can
-	 * now be manipulated.
-	 *
-	 * This is done after a swap so isn't time critical.
+	 * With a single frame in flight wait for the GPU here, this is done
+	 * after a swap so isn't time critical. It makes sure that the command
+	 * buffer has completed and all resources referred by it can now be
+	 * manipulated. With more frames the wait is deferred until the frame's
+	 * resources are needed again, in renderer_begin_frame.
 	 */
-	renderer_wait_queue_idle(r);
+	if (r->frame_count == 1) {
+		renderer_wait_queue_idle(r);
+	}
 
 	// Finalize the scratch images, send to debug UI if active.
 	scratch_get_fini(&crss, r, view_count);
 
-	// Check timestamps.
-	if (xret == XRT_SUCCESS) {
-		/*
-		 * Get timestamps of GPU work (if available).
-		 */
-
-		uint64_t gpu_start_ns, gpu_end_ns;
-		if (render_resources_get_timestamps(&c->nr, &gpu_start_ns, &gpu_end_ns)) {
-			uint64_t now_ns = os_monotonic_get_ns();
-			comp_target_info_gpu(ct, frame_id, gpu_start_ns, gpu_end_ns, now_ns);
-		}
-	}
-
+	// Reports GPU timing, this frame included if the GPU is done.
+	renderer_retire_finished_frames(r);
 
-	/*
-	 * Free resources.
-	 */
-
-	if (use_compute) {
-		render_compute_fini(&crc);
-	} else {
-		render_gfx_fini(&rr);
-	}
+	// Next frame uses the next set of resources.
+	r->frame_index = (r->frame_index + 1) % r->frame_count;
 
 
 	/*
@@ -30,6 +30,7 @@ DEBUG_GET_ONCE_BOOL_OPTION(xcb_fullscreen, "XRT_COMPOSITOR_XCB_FULLSCREEN", fals
 DEBUG_GET_ONCE_NUM_OPTION(xcb_display, "XRT_COMPOSITOR_XCB_DISPLAY", -1)
 DEBUG_GET_ONCE_NUM_OPTION(default_framerate, "XRT_COMPOSITOR_DEFAULT_FRAMERATE", 60)
 DEBUG_GET_ONCE_BOOL_OPTION(compute, "XRT_COMPOSITOR_COMPUTE", USE_COMPUTE_DEFAULT)
+DEBUG_GET_ONCE_NUM_OPTION(frames_in_flight, "XRT_COMPOSITOR_FRAMES_IN_FLIGHT", 1)
 // clang-format on
 
 static inline void
@@ -118,6 +119,11 @@ comp_settings_init(struct comp_settings *s, struct xrt_device *xdev)
 	s->preferred.width = xdev->hmd->screens[0].w_pixels;
 	s->preferred.height = xdev->hmd->screens[0].h_pixels;
 	s->nominal_frame_interval_ns = interval_ns;
+
+	// Clamped to the max later by the renderer.
+	long frames_in_flight = debug_get_num_option_frames_in_flight();
+	s->frames_in_flight = frames_in_flight > 1 ? (uint32_t)frames_in_flight : 1;
+
 	s->log_level = debug_get_log_option_log();
 	s->print_modes = debug_get_bool_option_print_modes();
 	s->selected_gpu_index = debug_get_num_option_force_gpu_index();
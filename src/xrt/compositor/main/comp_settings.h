@@ -85,6 +85,9 @@ struct comp_settings
 	//! Nominal frame interval
 	int64_t nominal_frame_interval_ns;
 
+	//! Number of frames the renderer may have queued on the GPU, 1 waits for every frame.
+	uint32_t frames_in_flight;
+
 	//! Vulkan physical device selected by comp_settings_check_vulkan_caps
 	//! may be forced by user
 	int selected_gpu_index;
@@ -35,6 +35,9 @@ enum comp_target_timing_point
 	//! Began CPU side work for GPU.
 	COMP_TARGET_TIMING_POINT_BEGIN,
 
+	//! Sampled the head pose used for rendering the frame.
+	COMP_TARGET_TIMING_POINT_LATCH,
+
 	//! Just before submitting work to the GPU.
 	COMP_TARGET_TIMING_POINT_SUBMIT_BEGIN,
 
@@ -99,7 +102,8 @@ struct comp_target_create_images_info
 struct comp_target_semaphores
 {
 	/*!
-	 * Optional semaphore the target should signal when present is complete.
+	 * Optional semaphore the target should signal when present is complete,
+	 * the target may switch it on every acquire so read it after that.
 	 */
 	VkSemaphore present_complete;
 
@@ -477,6 +481,21 @@ comp_target_mark_begin(struct comp_target *ct, int64_t frame_id, int64_t when_be
 	ct->mark_timing_point(ct, COMP_TARGET_TIMING_POINT_BEGIN, frame_id, when_began_ns);
 }
 
+/*!
+ * Quick helper for marking that the head pose was sampled.
+ * @copydoc comp_target::mark_timing_point
+ *
+ * @public @memberof comp_target
+ * @ingroup comp_main
+ */
+static inline void
+comp_target_mark_latch(struct comp_target *ct, int64_t frame_id, int64_t when_latched_ns)
+{
+	COMP_TRACE_MARKER();
+
+	ct->mark_timing_point(ct, COMP_TARGET_TIMING_POINT_LATCH, frame_id, when_latched_ns);
+}
+
 /*!
  * Quick helper for marking submit began.
  * @copydoc comp_target::mark_timing_point
@@ -559,15 +559,21 @@ create_vblank_event_thread(struct comp_target *ct)
 }
 #endif
 
+static_assert(COMP_TARGET_SWAPCHAIN_PRESENT_SEMAPHORE_COUNT > RENDER_MAX_FRAMES_IN_FLIGHT,
+              "Need one present semaphore more than frames in flight");
+
 static void
 target_fini_semaphores(struct comp_target_swapchain *cts)
 {
 	struct vk_bundle *vk = get_vk(cts);
 
-	if (cts->base.semaphores.present_complete != VK_NULL_HANDLE) {
-		vk->vkDestroySemaphore(vk->device, cts->base.semaphores.present_complete, NULL);
-		cts->base.semaphores.present_complete = VK_NULL_HANDLE;
+	for (uint32_t i = 0; i < ARRAY_SIZE(cts->semaphores.present_complete); i++) {
+		if (cts->semaphores.present_complete[i] != VK_NULL_HANDLE) {
+			vk->vkDestroySemaphore(vk->device, cts->semaphores.present_complete[i], NULL);
+			cts->semaphores.present_complete[i] = VK_NULL_HANDLE;
+		}
 	}
+	cts->base.semaphores.present_complete = VK_NULL_HANDLE;
 
 	if (cts->base.semaphores.render_complete != VK_NULL_HANDLE) {
 		vk->vkDestroySemaphore(vk->device, cts->base.semaphores.render_complete, NULL);
@@ -587,13 +593,18 @@ target_init_semaphores(struct comp_target_swapchain *cts)
 	    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
 	};
 
-	ret = vk->vkCreateSemaphore(vk->device, &info, NULL, &cts->base.semaphores.present_complete);
-	if (ret != VK_SUCCESS) {
-		COMP_ERROR(cts->base.c, "vkCreateSemaphore: %s", vk_result_string(ret));
+	for (uint32_t i = 0; i < ARRAY_SIZE(cts->semaphores.present_complete); i++) {
+		ret = vk->vkCreateSemaphore(vk->device, &info, NULL, &cts->semaphores.present_complete[i]);
+		if (ret != VK_SUCCESS) {
+			COMP_ERROR(cts->base.c, "vkCreateSemaphore: %s", vk_result_string(ret));
+		}
+
+		VK_NAME_SEMAPHORE(vk, cts->semaphores.present_complete[i],
+		                  "comp_target_swapchain semaphore present complete");
 	}
 
-	VK_NAME_SEMAPHORE(vk, cts->base.semaphores.present_complete,
-	                  "comp_target_swapchain semaphore present complete");
+	cts->semaphores.index = 0;
+	cts->base.semaphores.present_complete = cts->semaphores.present_complete[0];
 
 	cts->base.semaphores.render_complete_is_timeline = false;
 	ret = vk->vkCreateSemaphore(vk->device, &info, NULL, &cts->base.semaphores.render_complete);
@@ -846,6 +857,10 @@ comp_target_swapchain_acquire_next_image(struct comp_target *ct, uint32_t *out_i
 		return VK_ERROR_INITIALIZATION_FAILED;
 	}
 
+	// The previous semaphore might still be waited on by a frame in flight.
+	cts->semaphores.index = (cts->semaphores.index + 1) % ARRAY_SIZE(cts->semaphores.present_complete);
+	cts->base.semaphores.present_complete = cts->semaphores.present_complete[cts->semaphores.index];
+
 	return vk->vkAcquireNextImageKHR(          //
 	    vk->device,                            // device
 	    cts->swapchain.handle,                 // swapchain
@@ -979,6 +994,9 @@ comp_target_swapchain_mark_timing_point(struct comp_target *ct,
 	case COMP_TARGET_TIMING_POINT_BEGIN:
 		u_pc_mark_point(cts->upc, U_TIMING_POINT_BEGIN, cts->current_frame_id, when_ns);
 		break;
+	case COMP_TARGET_TIMING_POINT_LATCH:
+		u_pc_mark_point(cts->upc, U_TIMING_POINT_LATCH, cts->current_frame_id, when_ns);
+		break;
 	case COMP_TARGET_TIMING_POINT_SUBMIT_BEGIN:
 		u_pc_mark_point(cts->upc, U_TIMING_POINT_SUBMIT_BEGIN, cts->current_frame_id, when_ns);
 		break;
@@ -28,6 +28,12 @@ extern "C" {
 
 struct u_pacing_compositor;
 
+/*!
+ * Number of present complete semaphores that are cycled through on acquire,
+ * the renderer may have this many minus one frames in flight.
+ */
+#define COMP_TARGET_SWAPCHAIN_PRESENT_SEMAPHORE_COUNT (4)
+
 /*!
  * Wraps and manage VkSwapchainKHR and VkSurfaceKHR, used by @ref comp code.
  *
@@ -68,6 +74,19 @@ struct comp_target_swapchain
 		VkSwapchainKHR handle;
 	} swapchain;
 
+	struct
+	{
+		/*!
+		 * A semaphore can not be signalled by acquire again until the
+		 * submit waiting on it has started, so with frames in flight
+		 * each acquire uses the next one of these.
+		 */
+		VkSemaphore present_complete[COMP_TARGET_SWAPCHAIN_PRESENT_SEMAPHORE_COUNT];
+
+		//! The one in comp_target_semaphores::present_complete.
+		uint32_t index;
+	} semaphores;
+
 	struct
 	{
 		VkSurfaceKHR handle;
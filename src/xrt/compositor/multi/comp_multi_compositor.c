@@ -110,66 +110,52 @@ multi_compositor_push_event(struct multi_compositor *mc, const union xrt_session
 
 /*
  *
- * Wait helper thread.
+ * Scheduling helpers.
  *
  */
 
+/*!
+ * Can the frame in progress replace the scheduled one, need to have the
+ * slot_lock held.
+ */
 static bool
-is_pushed_or_waiting_locked(struct multi_compositor *mc)
-{
-	return mc->wait_thread.waiting ||     //
-	       mc->wait_thread.xcf != NULL || //
-	       mc->wait_thread.xcsem != NULL; //
-}
-
-static void
-wait_fence(struct xrt_compositor_fence **xcf_ptr)
+scheduled_is_free_locked(struct multi_compositor *mc)
 {
-	COMP_TRACE_MARKER();
-	xrt_result_t ret = XRT_SUCCESS;
-
-	// 100ms
-	int64_t timeout_ns = 100 * U_TIME_1MS_IN_NS;
-
-	do {
-		ret = xrt_compositor_fence_wait(*xcf_ptr, timeout_ns);
-		if (ret != XRT_TIMEOUT) {
-			break;
-		}
-
-		U_LOG_W("Waiting on client fence timed out > 100ms!");
-	} while (true);
-
-	xrt_compositor_fence_destroy(xcf_ptr);
-
-	if (ret != XRT_SUCCESS) {
-		U_LOG_E("Fence waiting failed!");
+	// The scheduled slot is clear.
+	if (!mc->scheduled.active) {
+		return true;
 	}
-}
 
-static void
-wait_semaphore(struct xrt_compositor_semaphore **xcsem_ptr, uint64_t value)
-{
-	COMP_TRACE_MARKER();
-	xrt_result_t ret = XRT_SUCCESS;
-
-	// 100ms
-	int64_t timeout_ns = 100 * U_TIME_1MS_IN_NS;
+	int64_t now_ns = os_monotonic_get_ns();
 
-	do {
-		ret = xrt_compositor_semaphore_wait(*xcsem_ptr, value, timeout_ns);
-		if (ret != XRT_TIMEOUT) {
-			break;
-		}
+	// This frame is for the next frame, drop the old one no matter what.
+	if (time_is_within_half_ms(mc->progress.data.display_time_ns, mc->slot_next_frame_display)) {
+		U_LOG_W("%.3fms: Dropping old missed frame in favour for completed new frame", time_ns_to_ms_f(now_ns));
+		return true;
+	}
 
-		U_LOG_W("Waiting on client semaphore value '%" PRIu64 "' timed out > 100ms!", value);
-	} while (true);
+	// Replace the scheduled frame if it's in the past.
+	if (mc->scheduled.data.display_time_ns < now_ns) {
+		U_LOG_T("%.3fms: Replacing frame for time in past in favour of completed new frame",
+		        time_ns_to_ms_f(now_ns));
+		return true;
+	}
 
-	xrt_compositor_semaphore_reference(xcsem_ptr, NULL);
+	U_LOG_D(
+	    "Two frames have completed GPU work and are waiting to be displayed."
+	    "\n\tnext frame: %fms (%" PRIu64
+	    ") (next time for compositor to pick up frame)"
+	    "\n\tprogress: %fms (%" PRIu64
+	    ")  (latest completed frame)"
+	    "\n\tscheduled: %fms (%" PRIu64 ") (oldest waiting frame)",
+	    time_ns_to_ms_f((int64_t)mc->slot_next_frame_display - now_ns),        //
+	    mc->slot_next_frame_display,                                           //
+	    time_ns_to_ms_f((int64_t)mc->progress.data.display_time_ns - now_ns),  //
+	    mc->progress.data.display_time_ns,                                     //
+	    time_ns_to_ms_f((int64_t)mc->scheduled.data.display_time_ns - now_ns), //
+	    mc->scheduled.data.display_time_ns);                                   //
 
-	if (ret != XRT_SUCCESS) {
-		U_LOG_E("Semaphore waiting failed!");
-	}
+	return false;
 }
 
 static void
@@ -177,222 +163,10 @@ wait_for_scheduled_free(struct multi_compositor *mc)
 {
 	COMP_TRACE_MARKER();
 
-	os_mutex_lock(&mc->slot_lock);
-
-	struct multi_compositor volatile *v_mc = mc;
-
 	// Block here if the scheduled slot is not clear.
-	while (v_mc->scheduled.active) {
-		int64_t now_ns = os_monotonic_get_ns();
-
-		// This frame is for the next frame, drop the old one no matter what.
-		if (time_is_within_half_ms(mc->progress.data.display_time_ns, mc->slot_next_frame_display)) {
-			U_LOG_W("%.3fms: Dropping old missed frame in favour for completed new frame",
-			        time_ns_to_ms_f(now_ns));
-			break;
-		}
-
-		// Replace the scheduled frame if it's in the past.
-		if (v_mc->scheduled.data.display_time_ns < now_ns) {
-			U_LOG_T("%.3fms: Replacing frame for time in past in favour of completed new frame",
-			        time_ns_to_ms_f(now_ns));
-			break;
-		}
-
-		U_LOG_D(
-		    "Two frames have completed GPU work and are waiting to be displayed."
-		    "\n\tnext frame: %fms (%" PRIu64
-		    ") (next time for compositor to pick up frame)"
-		    "\n\tprogress: %fms (%" PRIu64
-		    ")  (latest completed frame)"
-		    "\n\tscheduled: %fms (%" PRIu64 ") (oldest waiting frame)",
-		    time_ns_to_ms_f((int64_t)v_mc->slot_next_frame_display - now_ns),        //
-		    v_mc->slot_next_frame_display,                                           //
-		    time_ns_to_ms_f((int64_t)v_mc->progress.data.display_time_ns - now_ns),  //
-		    v_mc->progress.data.display_time_ns,                                     //
-		    time_ns_to_ms_f((int64_t)v_mc->scheduled.data.display_time_ns - now_ns), //
-		    v_mc->scheduled.data.display_time_ns);                                   //
-
-		os_mutex_unlock(&mc->slot_lock);
-
+	while (!multi_compositor_try_schedule_progress(mc)) {
 		os_precise_sleeper_nanosleep(&mc->scheduled_sleeper, U_TIME_1MS_IN_NS);
-
-		os_mutex_lock(&mc->slot_lock);
 	}
-
-	os_mutex_unlock(&mc->slot_lock);
-
-	/*
-	 * Need to take list_and_timing_lock before slot_lock because slot_lock
-	 * is taken in multi_compositor_deliver_any_frames with list_and_timing_lock
-	 * held to stop clients from going away.
-	 */
-	os_mutex_lock(&mc->msc->list_and_timing_lock);
-	os_mutex_lock(&mc->slot_lock);
-	slot_move_and_clear_locked(mc, &mc->scheduled, &mc->progress);
-	os_mutex_unlock(&mc->slot_lock);
-	os_mutex_unlock(&mc->msc->list_and_timing_lock);
-}
-
-static void *
-run_func(void *ptr)
-{
-	struct multi_compositor *mc = (struct multi_compositor *)ptr;
-
-	U_TRACE_SET_THREAD_NAME("Multi Client Module: Waiter");
-	os_thread_helper_name(&mc->wait_thread.oth, "Multi Client Module: Waiter");
-
-	os_thread_helper_lock(&mc->wait_thread.oth);
-
-	// Signal the start function that we are enterting the loop.
-	mc->wait_thread.alive = true;
-	os_thread_helper_signal_locked(&mc->wait_thread.oth);
-
-	/*
-	 * One can view the layer_commit function and the wait thread as a
-	 * producer/consumer pair. This loop is the consumer side of that pair.
-	 * We look for either a fence or a semaphore on each loop, if none are
-	 * found we check if we are running then wait on the conditional
-	 * variable once again waiting to be signalled by the producer.
-	 */
-	while (os_thread_helper_is_running_locked(&mc->wait_thread.oth)) {
-		/*
-		 * Here we wait for the either a semaphore or a fence, if
-		 * neither has been set we wait/sleep here (again).
-		 */
-		if (mc->wait_thread.xcsem == NULL && mc->wait_thread.xcf == NULL) {
-			// Spurious wakeups are handled below.
-			os_thread_helper_wait_locked(&mc->wait_thread.oth);
-			// Fall through here on stopping to clean up and outstanding waits.
-		}
-
-		int64_t frame_id = mc->wait_thread.frame_id;
-		struct xrt_compositor_fence *xcf = mc->wait_thread.xcf;
-		struct xrt_compositor_semaphore *xcsem = mc->wait_thread.xcsem; // No need to ref, a move.
-		uint64_t value = mc->wait_thread.value;
-
-		// Ok to clear these on spurious wakeup as they are empty then anyways.
-		mc->wait_thread.frame_id = 0;
-		mc->wait_thread.xcf = NULL;
-		mc->wait_thread.xcsem = NULL;
-		mc->wait_thread.value = 0;
-
-		// We are being stopped, or a spurious wakeup, loop back and check running.
-		if (xcf == NULL && xcsem == NULL) {
-			continue;
-		}
-
-		// We now know that we should wait.
-		mc->wait_thread.waiting = true;
-
-		os_thread_helper_unlock(&mc->wait_thread.oth);
-
-		if (xcsem != NULL) {
-			wait_semaphore(&xcsem, value);
-		}
-		if (xcf != NULL) {
-			wait_fence(&xcf);
-		}
-
-		// Sample time outside of lock.
-		int64_t now_ns = os_monotonic_get_ns();
-
-		os_mutex_lock(&mc->msc->list_and_timing_lock);
-		u_pa_mark_gpu_done(mc->upa, frame_id, now_ns);
-		os_mutex_unlock(&mc->msc->list_and_timing_lock);
-
-		// Wait for the delivery slot.
-		wait_for_scheduled_free(mc);
-
-		os_thread_helper_lock(&mc->wait_thread.oth);
-
-		/*
-		 * Finally no longer waiting, this must be done after
-		 * wait_for_scheduled_free because it moves the slots/layers
-		 * from progress to scheduled to be picked up by the compositor.
-		 */
-		mc->wait_thread.waiting = false;
-
-		if (mc->wait_thread.blocked) {
-			// Release one thread
-			mc->wait_thread.blocked = false;
-			os_thread_helper_signal_locked(&mc->wait_thread.oth);
-		}
-	}
-
-	os_thread_helper_unlock(&mc->wait_thread.oth);
-
-	return NULL;
-}
-
-static void
-wait_for_wait_thread_locked(struct multi_compositor *mc)
-{
-	// Should we wait for the last frame.
-	if (is_pushed_or_waiting_locked(mc)) {
-		COMP_TRACE_IDENT(blocked);
-
-		// There should only be one thread entering here.
-		assert(mc->wait_thread.blocked == false);
-
-		// OK, wait until the wait thread releases us by setting blocked to false
-		mc->wait_thread.blocked = true;
-		while (mc->wait_thread.blocked) {
-			os_thread_helper_wait_locked(&mc->wait_thread.oth);
-		}
-	}
-}
-
-static void
-wait_for_wait_thread(struct multi_compositor *mc)
-{
-	os_thread_helper_lock(&mc->wait_thread.oth);
-
-	wait_for_wait_thread_locked(mc);
-
-	os_thread_helper_unlock(&mc->wait_thread.oth);
-}
-
-static void
-push_fence_to_wait_thread(struct multi_compositor *mc, int64_t frame_id, struct xrt_compositor_fence *xcf)
-{
-	os_thread_helper_lock(&mc->wait_thread.oth);
-
-	// The function begin_layer should have waited, but just in case.
-	assert(!mc->wait_thread.waiting);
-	wait_for_wait_thread_locked(mc);
-
-	assert(mc->wait_thread.xcf == NULL);
-
-	mc->wait_thread.frame_id = frame_id;
-	mc->wait_thread.xcf = xcf;
-
-	os_thread_helper_signal_locked(&mc->wait_thread.oth);
-
-	os_thread_helper_unlock(&mc->wait_thread.oth);
-}
-
-static void
-push_semaphore_to_wait_thread(struct multi_compositor *mc,
-                              int64_t frame_id,
-                              struct xrt_compositor_semaphore *xcsem,
-                              uint64_t value)
-{
-	os_thread_helper_lock(&mc->wait_thread.oth);
-
-	// The function begin_layer should have waited, but just in case.
-	assert(!mc->wait_thread.waiting);
-	wait_for_wait_thread_locked(mc);
-
-	assert(mc->wait_thread.xcsem == NULL);
-
-	mc->wait_thread.frame_id = frame_id;
-	xrt_compositor_semaphore_reference(&mc->wait_thread.xcsem, xcsem);
-	mc->wait_thread.value = value;
-
-	os_thread_helper_signal_locked(&mc->wait_thread.oth);
-
-	os_thread_helper_unlock(&mc->wait_thread.oth);
 }
 
 
@@ -636,7 +410,7 @@ multi_compositor_layer_begin(struct xrt_compositor *xc, const struct xrt_layer_f
 	 * the GPU for this frame. This should have very little impact on GPU
 	 * utilisation, if any.
 	 */
-	wait_for_wait_thread(mc);
+	multi_waiter_wait_for_client(&mc->msc->waiter, mc);
 
 	assert(mc->progress.layer_count == 0);
 	U_ZERO(&mc->progress);
@@ -776,6 +550,12 @@ multi_compositor_layer_commit(struct xrt_compositor *xc, xrt_graphics_sync_handl
 	struct xrt_compositor_fence *xcf = NULL;
 	int64_t frame_id = mc->progress.data.frame_id;
 
+	// The waiter can poll the sync handle directly, no need to import it.
+	if (xrt_graphics_sync_handle_is_valid(sync_handle) &&
+	    multi_waiter_push_sync_handle(&mc->msc->waiter, mc, frame_id, sync_handle)) {
+		return XRT_SUCCESS;
+	}
+
 	do {
 		if (!xrt_graphics_sync_handle_is_valid(sync_handle)) {
 			break;
@@ -798,7 +578,7 @@ multi_compositor_layer_commit(struct xrt_compositor *xc, xrt_graphics_sync_handl
 	} while (false); // Goto without the labels.
 
 	if (xcf != NULL) {
-		push_fence_to_wait_thread(mc, frame_id, xcf);
+		multi_waiter_push_fence(&mc->msc->waiter, mc, frame_id, xcf);
 	} else {
 		// Assume that the app side compositor waited.
 		int64_t now_ns = os_monotonic_get_ns();
@@ -823,7 +603,7 @@ multi_compositor_layer_commit_with_semaphore(struct xrt_compositor *xc,
 	struct multi_compositor *mc = multi_compositor(xc);
 	int64_t frame_id = mc->progress.data.frame_id;
 
-	push_semaphore_to_wait_thread(mc, frame_id, xcsem, value);
+	multi_waiter_push_semaphore(&mc->msc->waiter, mc, frame_id, xcsem, value);
 
 	return XRT_SUCCESS;
 }
@@ -892,8 +672,8 @@ multi_compositor_destroy(struct xrt_compositor *xc)
 
 	os_mutex_unlock(&mc->msc->list_and_timing_lock);
 
-	// Destroy the wait thread, destroy also stops the thread.
-	os_thread_helper_destroy(&mc->wait_thread.oth);
+	// Drop any frame being waited on, the waiter will not touch us after this.
+	multi_waiter_remove_client(&mc->msc->waiter, mc);
 
 	// We are now off the rendering list, clear slots for any swapchains.
 	os_mutex_lock(&mc->msc->list_and_timing_lock);
@@ -908,6 +688,7 @@ multi_compositor_destroy(struct xrt_compositor *xc)
 	os_precise_sleeper_deinit(&mc->frame_sleeper);
 	os_precise_sleeper_deinit(&mc->scheduled_sleeper);
 
+	os_cond_destroy(&mc->wait.cond);
 	os_mutex_destroy(&mc->slot_lock);
 
 	free(mc);
@@ -926,6 +707,28 @@ log_frame_time_diff(int64_t frame_time_ns, int64_t display_time_ns)
 	U_LOG_W("Frame %s by %.2fms!", late ? "late" : "early", time_ns_to_ms_f(diff_ns));
 }
 
+bool
+multi_compositor_try_schedule_progress(struct multi_compositor *mc)
+{
+	/*
+	 * Need to take list_and_timing_lock before slot_lock because slot_lock
+	 * is taken in multi_compositor_deliver_any_frames with list_and_timing_lock
+	 * held to stop clients from going away.
+	 */
+	os_mutex_lock(&mc->msc->list_and_timing_lock);
+	os_mutex_lock(&mc->slot_lock);
+
+	bool is_free = scheduled_is_free_locked(mc);
+	if (is_free) {
+		slot_move_and_clear_locked(mc, &mc->scheduled, &mc->progress);
+	}
+
+	os_mutex_unlock(&mc->slot_lock);
+	os_mutex_unlock(&mc->msc->list_and_timing_lock);
+
+	return is_free;
+}
+
 void
 multi_compositor_deliver_any_frames(struct multi_compositor *mc, int64_t display_time_ns)
 {
@@ -1001,7 +804,8 @@ multi_compositor_create(struct multi_system_compositor *msc,
 	mc->xsi = *xsi;
 
 	os_mutex_init(&mc->slot_lock);
-	os_thread_helper_init(&mc->wait_thread.oth);
+	os_cond_init(&mc->wait.cond);
+	mc->wait.sync_handle = XRT_GRAPHICS_SYNC_HANDLE_INVALID;
 
 	// Passthrough our formats from the native compositor to the client.
 	mc->base.base.info = msc->xcn->base.info;
@@ -1034,18 +838,6 @@ multi_compositor_create(struct multi_system_compositor *msc,
 
 	os_mutex_unlock(&msc->list_and_timing_lock);
 
-	// Last start the wait thread.
-	os_thread_helper_start(&mc->wait_thread.oth, run_func, mc);
-
-	os_thread_helper_lock(&mc->wait_thread.oth);
-
-	// Wait for the wait thread to fully start.
-	while (!mc->wait_thread.alive) {
-		os_thread_helper_wait_locked(&mc->wait_thread.oth);
-	}
-
-	os_thread_helper_unlock(&mc->wait_thread.oth);
-
 #ifdef XRT_OS_ANDROID
 	mc->current_refresh_rate_hz =
 	    android_custom_surface_get_display_refresh_rate(android_globals_get_vm(), android_globals_get_context());
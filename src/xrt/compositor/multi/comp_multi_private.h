@@ -10,6 +10,7 @@
 #pragma once
 
 #include "xrt/xrt_compiler.h"
+#include "xrt/xrt_config_os.h"
 #include "xrt/xrt_defines.h"
 #include "xrt/xrt_limits.h"
 #include "xrt/xrt_compositor.h"
@@ -40,6 +41,15 @@ extern "C" {
  */
 #define MULTI_MAX_LAYERS XRT_MAX_LAYERS
 
+/*!
+ * Poll the sync files of the clients directly instead of importing them.
+ *
+ * @ingroup comp_multi
+ */
+#if defined(XRT_OS_LINUX) && defined(XRT_GRAPHICS_SYNC_HANDLE_IS_FD)
+#define MULTI_WAITER_USE_EPOLL
+#endif
+
 
 /*
  *
@@ -88,6 +98,64 @@ struct multi_layer_slot
 	bool active;
 };
 
+/*!
+ * Waits for the GPU work of the frames submitted by all @ref multi_compositor
+ * of a @ref multi_system_compositor on a single thread, and once done moves
+ * them to be picked up by the render loop.
+ *
+ * Sync files are polled directly. Timeline semaphores are blocked on by a second
+ * thread, all at once together with a wake semaphore, when the native
+ * compositor's semaphores support it. Imported fences, and semaphores that
+ * don't support it, have nothing to block on so they are checked at a fixed
+ * interval.
+ *
+ * @ingroup comp_multi
+ */
+struct multi_waiter
+{
+	//! The waiter thread.
+	struct os_thread_helper oth;
+
+	//! Protects the list below and multi_compositor::wait of all clients.
+	struct os_mutex lock;
+
+	//! Clients that have pushed a frame to wait on.
+	struct multi_compositor *clients[MULTI_MAX_CLIENTS];
+
+	//! Number of clients in the list.
+	uint32_t client_count;
+
+	//! Set when the threads should exit.
+	bool stop;
+
+#ifdef MULTI_WAITER_USE_EPOLL
+	//! Polls all of the sync files and the wake eventfd.
+	int epoll_fd;
+
+	//! Written to wake the thread up.
+	int wake_fd;
+#else
+	//! Released to wake the thread up.
+	struct os_semaphore wake;
+#endif
+
+	//! Blocks on the timeline semaphores of all clients.
+	struct
+	{
+		//! The semaphore thread, only started if @ref wake supports it.
+		struct os_thread_helper oth;
+
+		//! Signalled from the CPU to wake the semaphore thread up.
+		struct xrt_compositor_semaphore *wake;
+
+		//! Last value @ref wake was signalled to.
+		uint64_t wake_value;
+
+		//! Is the semaphore thread running, if not semaphores are polled.
+		bool active;
+	} sem;
+};
+
 /*!
  * A single compositor for feeding the layers from one session/app into
  * the multi-client-capable system compositor.
@@ -128,8 +196,15 @@ struct multi_compositor
 		bool session_active;
 	} state;
 
+	/*!
+	 * State of the frame pushed to the @ref multi_waiter, protected by
+	 * its multi_waiter::lock.
+	 */
 	struct
 	{
+		//! Sync file to wait for, polled directly by the waiter.
+		xrt_graphics_sync_handle_t sync_handle;
+
 		//! Fence to wait for.
 		struct xrt_compositor_fence *xcf;
 
@@ -139,26 +214,32 @@ struct multi_compositor
 		//! Timeline semaphore value to wait for.
 		uint64_t value;
 
+		//! Has the semaphore thread seen the semaphore reach the value.
+		bool semaphore_signalled;
+
 		//! Frame id of frame being waited on.
 		int64_t frame_id;
 
-		//! The wait thread itself
-		struct os_thread_helper oth;
+		//! When to next warn about the GPU work taking a long time.
+		int64_t warn_ns;
 
-		//! Have we gotten to the loop?
-		bool alive;
+		//! Has the GPU work completed, then only waiting for the scheduled slot.
+		bool gpu_done;
 
-		//! Is the thread waiting, if so the client should block.
+		//! Is the waiter waiting on a frame, if so the client should block.
 		bool waiting;
 
 		/*!
 		 * Is the client thread blocked?
 		 *
 		 * Set to true by the client thread,
-		 * cleared by the wait thread to release the client thread.
+		 * cleared by the waiter to release the client thread.
 		 */
 		bool blocked;
-	} wait_thread;
+
+		//! Signalled by the waiter to release the client thread.
+		struct os_cond cond;
+	} wait;
 
 	//! Lock for all of the slots.
 	struct os_mutex slot_lock;
@@ -250,6 +331,104 @@ multi_compositor_latch_frame_locked(struct multi_compositor *mc, int64_t when_ns
 void
 multi_compositor_retire_delivered_locked(struct multi_compositor *mc, int64_t when_ns);
 
+/*!
+ * Moves the frame in multi_compositor::progress to multi_compositor::scheduled
+ * if the scheduled slot is free, or holds a frame that should be replaced.
+ * Called by the client thread or the waiter, never blocks on the render thread.
+ *
+ * @return False if the scheduled slot is still in use, nothing has been moved.
+ *
+ * @ingroup comp_multi
+ * @private @memberof multi_compositor
+ */
+bool
+multi_compositor_try_schedule_progress(struct multi_compositor *mc);
+
+
+/*
+ *
+ * Waiter.
+ *
+ */
+
+/*!
+ * Init the waiter and start its thread, @p xcn is used to create the semaphore
+ * waking the semaphore thread.
+ *
+ * @ingroup comp_multi
+ * @private @memberof multi_waiter
+ */
+xrt_result_t
+multi_waiter_init(struct multi_waiter *mw, struct xrt_compositor_native *xcn);
+
+/*!
+ * Stop the thread and clean up, all clients must have been removed.
+ *
+ * @ingroup comp_multi
+ * @private @memberof multi_waiter
+ */
+void
+multi_waiter_fini(struct multi_waiter *mw);
+
+/*!
+ * Push the frame in progress of @p mc to the waiter, waiting on a sync file.
+ * The ownership of @p sync_handle is taken if this returns true, returns false
+ * if the handle can not be polled and should be imported as a fence instead.
+ *
+ * @ingroup comp_multi
+ * @private @memberof multi_waiter
+ */
+bool
+multi_waiter_push_sync_handle(struct multi_waiter *mw,
+                              struct multi_compositor *mc,
+                              int64_t frame_id,
+                              xrt_graphics_sync_handle_t sync_handle);
+
+/*!
+ * Push the frame in progress of @p mc to the waiter, the ownership of @p xcf
+ * is taken.
+ *
+ * @ingroup comp_multi
+ * @private @memberof multi_waiter
+ */
+void
+multi_waiter_push_fence(struct multi_waiter *mw,
+                        struct multi_compositor *mc,
+                        int64_t frame_id,
+                        struct xrt_compositor_fence *xcf);
+
+/*!
+ * Push the frame in progress of @p mc to the waiter, @p xcsem is referenced.
+ *
+ * @ingroup comp_multi
+ * @private @memberof multi_waiter
+ */
+void
+multi_waiter_push_semaphore(struct multi_waiter *mw,
+                            struct multi_compositor *mc,
+                            int64_t frame_id,
+                            struct xrt_compositor_semaphore *xcsem,
+                            uint64_t value);
+
+/*!
+ * Block the client thread until the last frame pushed by @p mc has been moved
+ * to the scheduled slot.
+ *
+ * @ingroup comp_multi
+ * @private @memberof multi_waiter
+ */
+void
+multi_waiter_wait_for_client(struct multi_waiter *mw, struct multi_compositor *mc);
+
+/*!
+ * Drop any frame pushed by @p mc, after this the waiter no longer touches it.
+ *
+ * @ingroup comp_multi
+ * @private @memberof multi_waiter
+ */
+void
+multi_waiter_remove_client(struct multi_waiter *mw, struct multi_compositor *mc);
+
 
 /*
  *
@@ -339,6 +518,9 @@ struct multi_system_compositor
 	//! Render loop thread.
 	struct os_thread_helper oth;
 
+	//! Waits on the GPU work of all clients.
+	struct multi_waiter waiter;
+
 	struct
 	{
 		/*!
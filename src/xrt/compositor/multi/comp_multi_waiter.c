@@ -0,0 +1,702 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Single thread waiting on the GPU work of all multi clients.
+ * @ingroup comp_multi
+ */
+
+#include "xrt/xrt_session.h"
+
+#include "os/os_time.h"
+
+#include "util/u_misc.h"
+#include "util/u_time.h"
+#include "util/u_logging.h"
+#include "util/u_handles.h"
+#include "util/u_trace_marker.h"
+
+#include "multi/comp_multi_private.h"
+
+#include <assert.h>
+#include <inttypes.h>
+
+#ifdef MULTI_WAITER_USE_EPOLL
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+
+/*!
+ * How often to check sync objects that can not be blocked on, and clients
+ * waiting for their scheduled slot to free up.
+ */
+#define CHECK_INTERVAL_NS (U_TIME_1MS_IN_NS)
+
+//! How long GPU work can take before we warn about it.
+#define WARN_INTERVAL_NS (100 * U_TIME_1MS_IN_NS)
+
+// All clients and the wake semaphore are waited on at once.
+static_assert(MULTI_MAX_CLIENTS + 1 <= XRT_MAX_COMPOSITOR_SEMAPHORE_WAIT_ANY, "Too many clients to wait on at once");
+
+
+/*
+ *
+ * Wake and sleep helpers.
+ *
+ */
+
+#ifdef MULTI_WAITER_USE_EPOLL
+
+static void
+wake(struct multi_waiter *mw)
+{
+	uint64_t one = 1;
+	ssize_t ret = write(mw->wake_fd, &one, sizeof(one));
+	(void)ret; // Only fails if the counter overflows, the thread is awake then anyways.
+}
+
+static void
+sleep_until_woken(struct multi_waiter *mw, int64_t timeout_ns)
+{
+	struct epoll_event events[8];
+
+	int timeout_ms = timeout_ns < 0 ? -1 : (int)((timeout_ns + U_TIME_1MS_IN_NS - 1) / U_TIME_1MS_IN_NS);
+
+	int ret = epoll_wait(mw->epoll_fd, events, ARRAY_SIZE(events), timeout_ms);
+	if (ret < 0 && errno != EINTR) {
+		U_LOG_E("epoll_wait failed: '%i'", errno);
+	}
+
+	// Sync files are checked again when the lock is held, only the wake eventfd is read here.
+	for (int i = 0; i < ret; i++) {
+		if (events[i].data.fd == mw->wake_fd) {
+			uint64_t count;
+			ssize_t r = read(mw->wake_fd, &count, sizeof(count));
+			(void)r; // Non-blocking, fails if another wait already read it.
+			break;
+		}
+	}
+}
+
+static bool
+is_sync_handle_signalled(xrt_graphics_sync_handle_t sync_handle)
+{
+	struct pollfd pfd = {
+	    .fd = sync_handle,
+	    .events = POLLIN,
+	};
+
+	int ret = poll(&pfd, 1, 0);
+	if (ret < 0) {
+		U_LOG_E("Polling sync file failed: '%i'", errno);
+		return true; // Do not get stuck on it.
+	}
+
+	return ret > 0;
+}
+
+#else
+
+static void
+wake(struct multi_waiter *mw)
+{
+	os_semaphore_release(&mw->wake);
+}
+
+static void
+sleep_until_woken(struct multi_waiter *mw, int64_t timeout_ns)
+{
+	// Zero waits forever.
+	os_semaphore_wait(&mw->wake, timeout_ns < 0 ? 0 : (uint64_t)timeout_ns);
+}
+
+#endif
+
+static void
+wake_semaphore_thread_locked(struct multi_waiter *mw)
+{
+	if (mw->sem.wake == NULL) {
+		return;
+	}
+
+	xrt_result_t xret = xrt_compositor_semaphore_signal(mw->sem.wake, ++mw->sem.wake_value);
+	if (xret != XRT_SUCCESS) {
+		U_LOG_E("Failed to signal the semaphore thread's wake semaphore!");
+	}
+}
+
+
+/*
+ *
+ * Client helpers, all need to have the lock held.
+ *
+ */
+
+static void
+release_sync_objects_locked(struct multi_waiter *mw, struct multi_compositor *mc)
+{
+	if (xrt_graphics_sync_handle_is_valid(mc->wait.sync_handle)) {
+#ifdef MULTI_WAITER_USE_EPOLL
+		epoll_ctl(mw->epoll_fd, EPOLL_CTL_DEL, mc->wait.sync_handle, NULL);
+#endif
+		u_graphics_sync_unref(&mc->wait.sync_handle);
+	}
+
+	if (mc->wait.xcf != NULL) {
+		xrt_compositor_fence_destroy(&mc->wait.xcf);
+	}
+
+	xrt_compositor_semaphore_reference(&mc->wait.xcsem, NULL);
+}
+
+/*!
+ * Checks without blocking if the GPU work has completed, returns false if it
+ * is still going.
+ */
+static bool
+check_gpu_done_locked(struct multi_waiter *mw, struct multi_compositor *mc, int64_t now_ns)
+{
+	xrt_result_t xret = XRT_SUCCESS;
+	const char *what = NULL;
+
+#ifdef MULTI_WAITER_USE_EPOLL
+	if (xrt_graphics_sync_handle_is_valid(mc->wait.sync_handle)) {
+		what = "sync file";
+		xret = is_sync_handle_signalled(mc->wait.sync_handle) ? XRT_SUCCESS : XRT_TIMEOUT;
+	}
+#endif
+	if (mc->wait.xcsem != NULL && mw->sem.active) {
+		what = "semaphore";
+		xret = mc->wait.semaphore_signalled ? XRT_SUCCESS : XRT_TIMEOUT;
+	} else if (mc->wait.xcsem != NULL) {
+		what = "semaphore";
+		xret = xrt_compositor_semaphore_wait(mc->wait.xcsem, mc->wait.value, 0);
+	}
+	if (mc->wait.xcf != NULL) {
+		what = "fence";
+		xret = xrt_compositor_fence_wait(mc->wait.xcf, 0);
+	}
+
+	if (xret == XRT_TIMEOUT) {
+		if (now_ns >= mc->wait.warn_ns) {
+			U_LOG_W("Waiting on client %s for frame %" PRIi64 " timed out > 100ms!", what,
+			        mc->wait.frame_id);
+			mc->wait.warn_ns = now_ns + WARN_INTERVAL_NS;
+		}
+		return false;
+	}
+
+	if (xret != XRT_SUCCESS) {
+		U_LOG_E("Waiting on client %s failed!", what);
+	}
+
+	return true;
+}
+
+/*!
+ * Moves the client's frame along as far as possible, returns true once it has
+ * been scheduled and the client can be removed from the list.
+ */
+static bool
+progress_client_locked(struct multi_waiter *mw, struct multi_compositor *mc, int64_t now_ns)
+{
+	if (!mc->wait.gpu_done) {
+		if (!check_gpu_done_locked(mw, mc, now_ns)) {
+			return false;
+		}
+
+		release_sync_objects_locked(mw, mc);
+		mc->wait.gpu_done = true;
+
+		os_mutex_lock(&mc->msc->list_and_timing_lock);
+		u_pa_mark_gpu_done(mc->upa, mc->wait.frame_id, now_ns);
+		os_mutex_unlock(&mc->msc->list_and_timing_lock);
+	}
+
+	// Wait for the delivery slot.
+	if (!multi_compositor_try_schedule_progress(mc)) {
+		return false;
+	}
+
+	/*
+	 * Finally no longer waiting, this must be done after the frame has
+	 * been moved from progress to scheduled to be picked up by the compositor.
+	 */
+	mc->wait.frame_id = 0;
+	mc->wait.value = 0;
+	mc->wait.semaphore_signalled = false;
+	mc->wait.gpu_done = false;
+	mc->wait.waiting = false;
+
+	if (mc->wait.blocked) {
+		// Release the client thread.
+		mc->wait.blocked = false;
+		os_cond_signal(&mc->wait.cond);
+	}
+
+	return true;
+}
+
+static bool
+needs_checking_locked(struct multi_waiter *mw, struct multi_compositor *mc)
+{
+	if (mc->wait.gpu_done) {
+		return true;
+	}
+
+	// Sync files wake up the thread on their own.
+	if (xrt_graphics_sync_handle_is_valid(mc->wait.sync_handle)) {
+		return false;
+	}
+
+	// So do semaphores, through the semaphore thread.
+	if (mc->wait.xcsem != NULL && mw->sem.active) {
+		return false;
+	}
+
+	return true;
+}
+
+static void
+remove_at_locked(struct multi_waiter *mw, uint32_t index)
+{
+	assert(index < mw->client_count);
+
+	mw->clients[index] = mw->clients[--mw->client_count];
+	mw->clients[mw->client_count] = NULL;
+}
+
+static void
+wait_for_client_locked(struct multi_waiter *mw, struct multi_compositor *mc)
+{
+	// Should we wait for the last frame.
+	if (!mc->wait.waiting) {
+		return;
+	}
+
+	COMP_TRACE_IDENT(blocked);
+
+	// There should only be one thread entering here.
+	assert(mc->wait.blocked == false);
+
+	// OK, wait until the waiter releases us by setting blocked to false.
+	mc->wait.blocked = true;
+	while (mc->wait.blocked) {
+		os_cond_wait(&mc->wait.cond, &mw->lock);
+	}
+}
+
+/*!
+ * Waits for the last frame, then adds the client to the list, the caller
+ * sets the sync object to wait on.
+ */
+static void
+push_locked(struct multi_waiter *mw, struct multi_compositor *mc, int64_t frame_id)
+{
+	// The function begin_layer should have waited, but just in case.
+	assert(!mc->wait.waiting);
+	wait_for_client_locked(mw, mc);
+
+	assert(mw->client_count < ARRAY_SIZE(mw->clients));
+	assert(!xrt_graphics_sync_handle_is_valid(mc->wait.sync_handle));
+	assert(mc->wait.xcf == NULL);
+	assert(mc->wait.xcsem == NULL);
+
+	mc->wait.frame_id = frame_id;
+	mc->wait.warn_ns = os_monotonic_get_ns() + WARN_INTERVAL_NS;
+	mc->wait.semaphore_signalled = false;
+	mc->wait.gpu_done = false;
+	mc->wait.waiting = true;
+
+	mw->clients[mw->client_count++] = mc;
+}
+
+
+/*
+ *
+ * Thread.
+ *
+ */
+
+static void *
+run_func(void *ptr)
+{
+	struct multi_waiter *mw = (struct multi_waiter *)ptr;
+
+	U_TRACE_SET_THREAD_NAME("Multi Client Module: Waiter");
+	os_thread_helper_name(&mw->oth, "Multi Client Module: Waiter");
+
+	os_mutex_lock(&mw->lock);
+
+	while (!mw->stop) {
+		int64_t now_ns = os_monotonic_get_ns();
+		bool needs_checking = false;
+
+		// Backwards so that clients can be removed while iterating.
+		for (uint32_t i = mw->client_count; i > 0; i--) {
+			struct multi_compositor *mc = mw->clients[i - 1];
+
+			if (progress_client_locked(mw, mc, now_ns)) {
+				remove_at_locked(mw, i - 1);
+			} else if (needs_checking_locked(mw, mc)) {
+				needs_checking = true;
+			}
+		}
+
+		int64_t timeout_ns = -1;
+		if (needs_checking) {
+			timeout_ns = CHECK_INTERVAL_NS;
+		} else if (mw->client_count > 0) {
+			timeout_ns = WARN_INTERVAL_NS;
+		}
+
+		os_mutex_unlock(&mw->lock);
+
+		sleep_until_woken(mw, timeout_ns);
+
+		os_mutex_lock(&mw->lock);
+	}
+
+	os_mutex_unlock(&mw->lock);
+
+	return NULL;
+}
+
+/*!
+ * Marks the semaphores that have been signalled, returns true if any was.
+ */
+static bool
+mark_signalled_semaphores_locked(struct multi_waiter *mw)
+{
+	bool any = false;
+
+	// Only the clients still in the list, the others might be gone.
+	for (uint32_t i = 0; i < mw->client_count; i++) {
+		struct multi_compositor *mc = mw->clients[i];
+		if (mc->wait.xcsem == NULL || mc->wait.semaphore_signalled) {
+			continue;
+		}
+
+		xrt_result_t xret = xrt_compositor_semaphore_wait(mc->wait.xcsem, mc->wait.value, 0);
+		if (xret == XRT_TIMEOUT) {
+			continue;
+		}
+
+		// Don't get stuck on errors.
+		if (xret != XRT_SUCCESS) {
+			U_LOG_E("Waiting on client semaphore for frame %" PRIi64 " failed!", mc->wait.frame_id);
+		}
+
+		mc->wait.semaphore_signalled = true;
+		any = true;
+	}
+
+	return any;
+}
+
+static void *
+run_semaphore_func(void *ptr)
+{
+	struct multi_waiter *mw = (struct multi_waiter *)ptr;
+
+	U_TRACE_SET_THREAD_NAME("Multi Client Module: Semaphore Waiter");
+	os_thread_helper_name(&mw->sem.oth, "Multi Client Module: Semaphore Waiter");
+
+	os_mutex_lock(&mw->lock);
+
+	while (!mw->stop) {
+		struct xrt_compositor_semaphore *xcsems[MULTI_MAX_CLIENTS + 1] = {0};
+		uint64_t values[MULTI_MAX_CLIENTS + 1] = {0};
+		uint32_t count = 0;
+
+		// Referenced so that they stay alive while the lock is not held.
+		for (uint32_t i = 0; i < mw->client_count; i++) {
+			struct multi_compositor *mc = mw->clients[i];
+			if (mc->wait.xcsem == NULL || mc->wait.semaphore_signalled) {
+				continue;
+			}
+
+			xrt_compositor_semaphore_reference(&xcsems[count], mc->wait.xcsem);
+			values[count++] = mc->wait.value;
+		}
+
+		// Signalled when a semaphore is pushed or we are stopping, owned by the waiter.
+		xcsems[count] = mw->sem.wake;
+		values[count] = mw->sem.wake_value + 1;
+
+		os_mutex_unlock(&mw->lock);
+
+		// The waiter thread warns about slow clients, so no need to time out.
+		xrt_result_t xret = xrt_compositor_semaphore_wait_any( //
+		    mw->sem.wake,                                      // xcsem
+		    xcsems,                                            // xcsems
+		    values,                                            // values
+		    count + 1,                                         // count
+		    UINT64_MAX);                                       // timeout_ns
+
+		for (uint32_t i = 0; i < count; i++) {
+			xrt_compositor_semaphore_reference(&xcsems[i], NULL);
+		}
+
+		os_mutex_lock(&mw->lock);
+
+		if (xret != XRT_SUCCESS && xret != XRT_TIMEOUT) {
+			// Hand the semaphores back to the waiter thread, which polls them.
+			U_LOG_E("Waiting on the client semaphores failed, polling them instead!");
+			mw->sem.active = false;
+			wake(mw);
+			break;
+		}
+
+		if (mark_signalled_semaphores_locked(mw)) {
+			wake(mw);
+		}
+	}
+
+	os_mutex_unlock(&mw->lock);
+
+	return NULL;
+}
+
+/*!
+ * Creates the wake semaphore and starts the semaphore thread, if the native
+ * compositor's semaphores can't be blocked on together they are polled.
+ */
+static void
+init_semaphore_thread(struct multi_waiter *mw, struct xrt_compositor_native *xcn)
+{
+	xrt_graphics_sync_handle_t handle = XRT_GRAPHICS_SYNC_HANDLE_INVALID;
+	struct xrt_compositor_semaphore *xcsem = NULL;
+
+	if (xcn == NULL || xcn->base.create_semaphore == NULL) {
+		return;
+	}
+
+	// The handle is owned by the semaphore.
+	xrt_result_t xret = xrt_comp_create_semaphore(&xcn->base, &handle, &xcsem);
+	if (xret != XRT_SUCCESS) {
+		U_LOG_I("Could not create a semaphore, polling client semaphores.");
+		return;
+	}
+
+	if (xcsem->wait_any == NULL || xcsem->signal == NULL) {
+		U_LOG_I("Semaphores can't be blocked on together, polling client semaphores.");
+		xrt_compositor_semaphore_reference(&xcsem, NULL);
+		return;
+	}
+
+	if (os_thread_helper_start(&mw->sem.oth, run_semaphore_func, mw) != 0) {
+		U_LOG_E("Failed to start the semaphore thread, polling client semaphores.");
+		xrt_compositor_semaphore_reference(&xcsem, NULL);
+		return;
+	}
+
+	mw->sem.wake = xcsem;
+	mw->sem.active = true;
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+xrt_result_t
+multi_waiter_init(struct multi_waiter *mw, struct xrt_compositor_native *xcn)
+{
+	U_ZERO(mw);
+
+#ifdef MULTI_WAITER_USE_EPOLL
+	mw->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (mw->epoll_fd < 0) {
+		U_LOG_E("epoll_create1 failed: '%i'", errno);
+		return XRT_ERROR_THREADING_INIT_FAILURE;
+	}
+
+	mw->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (mw->wake_fd < 0) {
+		U_LOG_E("eventfd failed: '%i'", errno);
+		close(mw->epoll_fd);
+		return XRT_ERROR_THREADING_INIT_FAILURE;
+	}
+
+	struct epoll_event ev = XRT_STRUCT_INIT;
+	ev.events = EPOLLIN;
+	ev.data.fd = mw->wake_fd;
+	if (epoll_ctl(mw->epoll_fd, EPOLL_CTL_ADD, mw->wake_fd, &ev) < 0) {
+		U_LOG_E("epoll_ctl(wake_fd) failed: '%i'", errno);
+		close(mw->wake_fd);
+		close(mw->epoll_fd);
+		return XRT_ERROR_THREADING_INIT_FAILURE;
+	}
+#else
+	os_semaphore_init(&mw->wake, 0);
+#endif
+
+	os_mutex_init(&mw->lock);
+
+	int ret = os_thread_helper_init(&mw->oth);
+	if (ret < 0) {
+		return XRT_ERROR_THREADING_INIT_FAILURE;
+	}
+
+	ret = os_thread_helper_init(&mw->sem.oth);
+	if (ret < 0) {
+		return XRT_ERROR_THREADING_INIT_FAILURE;
+	}
+
+	// Started before the waiter thread, it reads the state set here.
+	os_mutex_lock(&mw->lock);
+	init_semaphore_thread(mw, xcn);
+	os_mutex_unlock(&mw->lock);
+
+	os_thread_helper_start(&mw->oth, run_func, mw);
+
+	return XRT_SUCCESS;
+}
+
+void
+multi_waiter_fini(struct multi_waiter *mw)
+{
+	// The threads sleep on the wake objects and not the helpers.
+	os_mutex_lock(&mw->lock);
+	mw->stop = true;
+	wake(mw);
+	wake_semaphore_thread_locked(mw);
+	os_mutex_unlock(&mw->lock);
+
+	// Destroy also waits for the threads.
+	os_thread_helper_destroy(&mw->oth);
+	os_thread_helper_destroy(&mw->sem.oth);
+
+	xrt_compositor_semaphore_reference(&mw->sem.wake, NULL);
+
+	assert(mw->client_count == 0);
+
+#ifdef MULTI_WAITER_USE_EPOLL
+	close(mw->wake_fd);
+	close(mw->epoll_fd);
+#else
+	os_semaphore_destroy(&mw->wake);
+#endif
+
+	os_mutex_destroy(&mw->lock);
+}
+
+bool
+multi_waiter_push_sync_handle(struct multi_waiter *mw,
+                              struct multi_compositor *mc,
+                              int64_t frame_id,
+                              xrt_graphics_sync_handle_t sync_handle)
+{
+#ifdef MULTI_WAITER_USE_EPOLL
+	os_mutex_lock(&mw->lock);
+
+	push_locked(mw, mc, frame_id);
+
+	struct epoll_event ev = XRT_STRUCT_INIT;
+	ev.events = EPOLLIN;
+	ev.data.fd = sync_handle;
+	if (epoll_ctl(mw->epoll_fd, EPOLL_CTL_ADD, sync_handle, &ev) < 0) {
+		U_LOG_D("epoll_ctl(sync_handle) failed: '%i', importing instead.", errno);
+
+		// Undo the push, nothing else has seen it while we held the lock.
+		mc->wait.waiting = false;
+		remove_at_locked(mw, mw->client_count - 1);
+
+		os_mutex_unlock(&mw->lock);
+		return false;
+	}
+
+	mc->wait.sync_handle = sync_handle;
+
+	wake(mw);
+
+	os_mutex_unlock(&mw->lock);
+
+	return true;
+#else
+	(void)mw;
+	(void)mc;
+	(void)frame_id;
+	(void)sync_handle;
+
+	return false;
+#endif
+}
+
+void
+multi_waiter_push_fence(struct multi_waiter *mw,
+                        struct multi_compositor *mc,
+                        int64_t frame_id,
+                        struct xrt_compositor_fence *xcf)
+{
+	os_mutex_lock(&mw->lock);
+
+	push_locked(mw, mc, frame_id);
+	mc->wait.xcf = xcf;
+
+	wake(mw);
+
+	os_mutex_unlock(&mw->lock);
+}
+
+void
+multi_waiter_push_semaphore(struct multi_waiter *mw,
+                            struct multi_compositor *mc,
+                            int64_t frame_id,
+                            struct xrt_compositor_semaphore *xcsem,
+                            uint64_t value)
+{
+	os_mutex_lock(&mw->lock);
+
+	push_locked(mw, mc, frame_id);
+	xrt_compositor_semaphore_reference(&mc->wait.xcsem, xcsem);
+	mc->wait.value = value;
+
+	// Only one of the threads needs to know, it wakes the other once signalled.
+	if (mw->sem.active) {
+		wake_semaphore_thread_locked(mw);
+	} else {
+		wake(mw);
+	}
+
+	os_mutex_unlock(&mw->lock);
+}
+
+void
+multi_waiter_wait_for_client(struct multi_waiter *mw, struct multi_compositor *mc)
+{
+	os_mutex_lock(&mw->lock);
+
+	wait_for_client_locked(mw, mc);
+
+	os_mutex_unlock(&mw->lock);
+}
+
+void
+multi_waiter_remove_client(struct multi_waiter *mw, struct multi_compositor *mc)
+{
+	os_mutex_lock(&mw->lock);
+
+	for (uint32_t i = 0; i < mw->client_count; i++) {
+		if (mw->clients[i] != mc) {
+			continue;
+		}
+
+		release_sync_objects_locked(mw, mc);
+		remove_at_locked(mw, i);
+		break;
+	}
+
+	mc->wait.semaphore_signalled = false;
+	mc->wait.gpu_done = false;
+	mc->wait.waiting = false;
+
+	os_mutex_unlock(&mw->lock);
+}
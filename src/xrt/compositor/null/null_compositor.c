@@ -430,15 +430,6 @@ null_compositor_layer_commit(struct xrt_compositor *xc, xrt_graphics_sync_handle
 	int64_t frame_id = c->base.layer_accum.data.frame_id;
 	int64_t display_time_ns = c->base.layer_accum.layers[0].data.timestamp;
 
-	// Default value from monado, overridden by HMD device where possible.
-	struct xrt_vec3 default_eye_relation = {0.063f, 0.f, 0.f};
-	struct xrt_space_relation head_relation = {0};
-
-	struct xrt_fov fovs[2] = {0};
-	struct xrt_pose poses[2] = {0};
-	xrt_device_get_view_poses(c->xdev, &default_eye_relation, display_time_ns, 2, &head_relation, fovs, poses);
-
-
 	/*
 	 * The null compositor doesn't render any frames, but needs to do
 	 * minimal bookkeeping and handling of arguments. If using the null
@@ -458,6 +449,21 @@ null_compositor_layer_commit(struct xrt_compositor *xc, xrt_graphics_sync_handle
 		u_pc_mark_point(c->upc, U_TIMING_POINT_BEGIN, frame_id, now_ns);
 	}
 
+	// Sample the head pose as late as possible, just before the submit.
+	{
+		// Default value from monado, overridden by HMD device where possible.
+		struct xrt_vec3 default_eye_relation = {0.063f, 0.f, 0.f};
+		struct xrt_space_relation head_relation = {0};
+
+		struct xrt_fov fovs[2] = {0};
+		struct xrt_pose poses[2] = {0};
+		xrt_device_get_view_poses(c->xdev, &default_eye_relation, display_time_ns, 2, &head_relation, fovs,
+		                          poses);
+
+		int64_t now_ns = os_monotonic_get_ns();
+		u_pc_mark_point(c->upc, U_TIMING_POINT_LATCH, frame_id, now_ns);
+	}
+
 	// When we are submitting to the GPU.
 	{
 		int64_t now_ns = os_monotonic_get_ns();
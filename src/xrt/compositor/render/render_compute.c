@@ -294,6 +294,7 @@ render_compute_init(struct render_compute *crc, struct render_resources *r)
 
 	struct vk_bundle *vk = r->vk;
 	crc->r = r;
+	U_ZERO(&crc->late_latch);
 
 	for (uint32_t i = 0; i < RENDER_MAX_LAYER_RUNS_COUNT; i++) {
 		ret = vk_create_descriptor_set(             //
@@ -488,6 +489,9 @@ render_compute_projection_timewarp(struct render_compute *crc,
 		data->pre_transforms[i] = r->distortion.uv_to_tanangle[i];
 		data->transforms[i] = time_warp_matrix[i];
 		data->post_transforms[i] = src_norm_rects[i];
+
+		// The transform can be redone with a newer pose before submit.
+		render_late_latch_add_view(&crc->late_latch, i, &src_poses[i], &src_fovs[i], &data->transforms[i]);
 	}
 
 	/*
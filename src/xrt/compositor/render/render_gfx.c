@@ -243,7 +243,8 @@ do_ubo_and_src_alloc_and_write(struct render_gfx *rr,
                                VkImageView src_image_view,
                                VkDescriptorPool descriptor_pool,
                                VkDescriptorSetLayout descriptor_set_layout,
-                               VkDescriptorSet *out_descriptor_set)
+                               VkDescriptorSet *out_descriptor_set,
+                               void **out_ubo_ptr)
 {
 	VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
 	struct render_sub_alloc ubo = XRT_STRUCT_INIT;
@@ -288,6 +289,11 @@ do_ubo_and_src_alloc_and_write(struct render_gfx *rr,
 
 	*out_descriptor_set = descriptor_set;
 
+	if (out_ubo_ptr != NULL) {
+		// Checked to be mapped by the sub-allocation above.
+		*out_ubo_ptr = (uint8_t *)rr->ubo_tracker.mapped + ubo.offset;
+	}
+
 	return VK_SUCCESS;
 }
 
@@ -964,6 +970,9 @@ render_gfx_init(struct render_gfx *rr, struct render_resources *r)
 	// Used to sub-allocate UBOs from, restart from scratch each frame.
 	render_sub_alloc_tracker_init(&rr->ubo_tracker, &r->gfx.shared_ubo);
 
+	// Filled in if the distortion does timewarp.
+	U_ZERO(&rr->late_latch);
+
 	return true;
 }
 
@@ -1142,7 +1151,8 @@ render_gfx_mesh_alloc_and_write(struct render_gfx *rr,
                                 const struct render_gfx_mesh_ubo_data *data,
                                 VkSampler src_sampler,
                                 VkImageView src_image_view,
-                                VkDescriptorSet *out_descriptor_set)
+                                VkDescriptorSet *out_descriptor_set,
+                                struct render_gfx_mesh_ubo_data **out_ubo_ptr)
 {
 	struct render_resources *r = rr->r;
 
@@ -1156,7 +1166,8 @@ render_gfx_mesh_alloc_and_write(struct render_gfx *rr,
 	    src_image_view,                     // src_image_view
 	    r->gfx.ubo_and_src_descriptor_pool, // descriptor_pool
 	    r->mesh.descriptor_set_layout,      // descriptor_set_layout
-	    out_descriptor_set);                // out_descriptor_set
+	    out_descriptor_set,                 // out_descriptor_set
+	    (void **)out_ubo_ptr);              // out_ubo_ptr
 }
 
 void
@@ -1260,7 +1271,8 @@ render_gfx_layer_cylinder_alloc_and_write(struct render_gfx *rr,
 	    src_image_view,                            // src_image_view
 	    r->gfx.ubo_and_src_descriptor_pool,        // descriptor_pool
 	    r->gfx.layer.shared.descriptor_set_layout, // descriptor_set_layout
-	    out_descriptor_set);                       // out_descriptor_set
+	    out_descriptor_set,                        // out_descriptor_set
+	    NULL);                                     // out_ubo_ptr
 }
 
 XRT_CHECK_RESULT VkResult
@@ -1282,7 +1294,8 @@ render_gfx_layer_equirect2_alloc_and_write(struct render_gfx *rr,
 	    src_image_view,                            // src_image_view
 	    r->gfx.ubo_and_src_descriptor_pool,        // descriptor_pool
 	    r->gfx.layer.shared.descriptor_set_layout, // descriptor_set_layout
-	    out_descriptor_set);                       // out_descriptor_set
+	    out_descriptor_set,                        // out_descriptor_set
+	    NULL);                                     // out_ubo_ptr
 }
 
 XRT_CHECK_RESULT VkResult
@@ -1304,7 +1317,8 @@ render_gfx_layer_projection_alloc_and_write(struct render_gfx *rr,
 	    src_image_view,                            // src_image_view
 	    r->gfx.ubo_and_src_descriptor_pool,        // descriptor_pool
 	    r->gfx.layer.shared.descriptor_set_layout, // descriptor_set_layout
-	    out_descriptor_set);                       // out_descriptor_set
+	    out_descriptor_set,                        // out_descriptor_set
+	    NULL);                                     // out_ubo_ptr
 }
 
 XRT_CHECK_RESULT VkResult
@@ -1326,7 +1340,8 @@ render_gfx_layer_quad_alloc_and_write(struct render_gfx *rr,
 	    src_image_view,                            // src_image_view
 	    r->gfx.ubo_and_src_descriptor_pool,        // descriptor_pool
 	    r->gfx.layer.shared.descriptor_set_layout, // descriptor_set_layout
-	    out_descriptor_set);                       // out_descriptor_set
+	    out_descriptor_set,                        // out_descriptor_set
+	    NULL);                                     // out_ubo_ptr
 }
 
 void
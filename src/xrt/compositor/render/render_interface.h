@@ -57,6 +57,13 @@ extern "C" {
  */
 #define RENDER_MAX_LAYERS (XRT_MAX_LAYERS)
 
+/*!
+ * Max number of frames that can be recorded and submitted before the CPU has
+ * to wait for the GPU to finish the oldest one, see
+ * @ref render_frame_resources.
+ */
+#define RENDER_MAX_FRAMES_IN_FLIGHT (3)
+
 /*!
  * Max number of images that can be given at a single time to the layer
  * squasher in a single dispatch.
@@ -122,6 +129,41 @@ render_calc_time_warp_matrix(const struct xrt_pose *src_pose,
 void
 render_calc_uv_to_tangent_lengths_rect(const struct xrt_fov *fov, struct xrt_normalized_rect *out_rect);
 
+/*!
+ * The timewarp transforms written into the UBOs of a frame, together with the
+ * pose and fov each source image was rendered with. This lets the renderer
+ * sample the head pose again after the commands have been built and rewrite
+ * the transforms just before submitting them. The UBOs are host coherent, so
+ * writes made before the submit are seen by the GPU without a flush.
+ */
+struct render_late_latch
+{
+	//! Number of views with a transform, zero if the frame does no timewarp.
+	uint32_t view_count;
+
+	struct xrt_pose src_poses[XRT_MAX_VIEWS];
+	struct xrt_fov src_fovs[XRT_MAX_VIEWS];
+
+	//! Point into the mapped UBO memory, only valid until the frame is submitted.
+	struct xrt_matrix_4x4 *transforms[XRT_MAX_VIEWS];
+};
+
+/*!
+ * Record where the timewarp transform of a view lives and what it warps from.
+ */
+void
+render_late_latch_add_view(struct render_late_latch *rll,
+                           uint32_t view_index,
+                           const struct xrt_pose *src_pose,
+                           const struct xrt_fov *src_fov,
+                           struct xrt_matrix_4x4 *transform);
+
+/*!
+ * Rewrite all recorded timewarp transforms to warp to @p new_poses.
+ */
+void
+render_late_latch_update(const struct render_late_latch *rll, const struct xrt_pose new_poses[XRT_MAX_VIEWS]);
+
 
 /*
  *
@@ -345,8 +387,49 @@ render_sub_alloc_ubo_alloc_and_write(struct vk_bundle *vk,
  *
  */
 
+/*!
+ * The resources that the GPU reads from or writes to while a frame is being
+ * rendered, these can not be touched by the CPU until the frame's fence has
+ * been signalled. So there is one set of these per frame in flight.
+ *
+ * @see render_resources_use_frame
+ */
+struct render_frame_resources
+{
+	//! Pool for @ref cmd, reset at the start of every frame.
+	VkCommandPool cmd_pool;
+
+	//! Command buffer for recording everything.
+	VkCommandBuffer cmd;
+
+	//! Start and end timestamps of the frame.
+	VkQueryPool query_pool;
+
+	//! See render_resources::gfx::ubo_and_src_descriptor_pool.
+	VkDescriptorPool gfx_ubo_and_src_descriptor_pool;
+
+	//! See render_resources::gfx::shared_ubo.
+	struct render_buffer gfx_shared_ubo;
+
+	//! See render_resources::compute::descriptor_pool.
+	VkDescriptorPool compute_descriptor_pool;
+
+	//! See render_resources::compute::layer::ubos.
+	struct render_buffer compute_layer_ubos[RENDER_MAX_LAYER_RUNS_SIZE];
+
+	//! See render_resources::compute::distortion::ubo.
+	struct render_buffer compute_distortion_ubo;
+
+	//! See render_resources::compute::clear::ubo.
+	struct render_buffer compute_clear_ubo;
+};
+
 /*!
  * Holds all pools and static resources for rendering.
+ *
+ * The per frame fields (@ref cmd_pool, @ref cmd, @ref query_pool, the
+ * descriptor pools and the UBOs) refer to the frame selected with
+ * @ref render_resources_use_frame, they are owned by @ref frames.
  */
 struct render_resources
 {
@@ -364,6 +447,20 @@ struct render_resources
 	struct render_shaders *shaders;
 
 
+	/*
+	 * Frames in flight.
+	 */
+
+	//! Per frame resources, @ref frame_count of them are created.
+	struct render_frame_resources frames[RENDER_MAX_FRAMES_IN_FLIGHT];
+
+	//! Number of frames that can be in flight at the same time.
+	uint32_t frame_count;
+
+	//! Which of @ref frames is currently in use.
+	uint32_t frame_index;
+
+
 	/*
 	 * Shared pools and caches.
 	 */
@@ -557,7 +654,8 @@ struct render_resources
 };
 
 /*!
- * Allocate pools and static resources.
+ * Allocate pools and static resources, and @p frame_count sets of per frame
+ * resources, which is clamped to [1, @ref RENDER_MAX_FRAMES_IN_FLIGHT].
  *
  * @ingroup comp_main
  *
@@ -567,7 +665,8 @@ bool
 render_resources_init(struct render_resources *r,
                       struct render_shaders *shaders,
                       struct vk_bundle *vk,
-                      struct xrt_device *xdev);
+                      struct xrt_device *xdev,
+                      uint32_t frame_count);
 
 /*!
  * Free all pools and static resources, does not free the struct itself.
@@ -577,6 +676,17 @@ render_resources_init(struct render_resources *r,
 void
 render_resources_close(struct render_resources *r);
 
+/*!
+ * Make the per frame resources of frame @p index the ones used by the
+ * @ref render_gfx and @ref render_compute cmd buf builders and by
+ * @ref render_resources_get_timestamps. The caller must make sure that the GPU
+ * has finished any work previously submitted with that frame's resources.
+ *
+ * @public @memberof render_resources
+ */
+void
+render_resources_use_frame(struct render_resources *r, uint32_t index);
+
 /*!
  * Creates or recreates the compute distortion textures if necessary.
  */
@@ -594,7 +704,8 @@ render_distortion_images_close(struct render_resources *r);
 
 /*!
  * Returns the timestamps for when the latest GPU work started and stopped that
- * was submitted using @ref render_gfx or @ref render_compute cmd buf builders.
+ * was submitted using @ref render_gfx or @ref render_compute cmd buf builders,
+ * for the frame selected with @ref render_resources_use_frame.
  *
  * Returned in the same time domain as returned by @ref os_monotonic_get_ns .
  * Behaviour for this function is undefined if the GPU has not completed before
@@ -829,6 +940,9 @@ struct render_gfx
 
 	//! The current target we are rendering too, can change during command building.
 	struct render_gfx_target_resources *rtr;
+
+	//! Timewarp transforms of the distortion pass, reset on init.
+	struct render_late_latch late_latch;
 };
 
 /*!
@@ -975,6 +1089,8 @@ render_gfx_end_view(struct render_gfx *rr);
  * descriptor pool of @ref render_resources, both of which will be reset once
  * closed, so don't save any reference to these objects beyond the frame.
  *
+ * @param[out] out_ubo_ptr Optional, the mapped ubo, only valid for the frame.
+ *
  * @public @memberof render_gfx
  */
 XRT_CHECK_RESULT VkResult
@@ -982,7 +1098,8 @@ render_gfx_mesh_alloc_and_write(struct render_gfx *rr,
                                 const struct render_gfx_mesh_ubo_data *data,
                                 VkSampler src_sampler,
                                 VkImageView src_image_view,
-                                VkDescriptorSet *out_descriptor_set);
+                                VkDescriptorSet *out_descriptor_set,
+                                struct render_gfx_mesh_ubo_data **out_ubo_ptr);
 
 /*!
  * Dispatch one mesh shader instance, using the give @p mesh_index as source for
@@ -1116,6 +1233,9 @@ struct render_compute
 	 * @ref render_compute_projection, and @ref render_compute_clear.
 	 */
 	VkDescriptorSet shared_descriptor_set;
+
+	//! Set by @ref render_compute_projection_timewarp, reset on init.
+	struct render_late_latch late_latch;
 };
 
 /*!
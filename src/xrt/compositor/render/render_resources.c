@@ -20,6 +20,7 @@
 
 
 #include <stdio.h>
+#include <assert.h>
 
 
 /*
@@ -499,6 +500,228 @@ teardown_scratch_color_image(struct vk_bundle *vk, struct render_scratch_color_i
 }
 
 
+static bool
+init_frame_resources(struct render_resources *r, struct vk_bundle *vk, struct render_frame_resources *f)
+{
+	VkResult ret;
+
+	VkBufferUsageFlags ubo_usage_flags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	VkMemoryPropertyFlags memory_property_flags =
+	    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+
+	/*
+	 * Command buffer.
+	 */
+
+	VkCommandPoolCreateInfo command_pool_info = {
+	    .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+	    .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+	    .queueFamilyIndex = vk->queue_family_index,
+	};
+
+	ret = vk->vkCreateCommandPool(vk->device, &command_pool_info, NULL, &f->cmd_pool);
+	VK_CHK_WITH_RET(ret, "vkCreateCommandPool", false);
+
+	VK_NAME_COMMAND_POOL(vk, f->cmd_pool, "render_resources command pool");
+
+	VkCommandBufferAllocateInfo cmd_buffer_info = {
+	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+	    .commandPool = f->cmd_pool,
+	    .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+	    .commandBufferCount = 1,
+	};
+
+	ret = vk->vkAllocateCommandBuffers( //
+	    vk->device,                     // device
+	    &cmd_buffer_info,               // pAllocateInfo
+	    &f->cmd);                       // pCommandBuffers
+	VK_CHK_WITH_RET(ret, "vkAllocateCommandBuffers", false);
+
+	VK_NAME_COMMAND_BUFFER(vk, f->cmd, "render_resources command buffer");
+
+
+	/*
+	 * Gfx.
+	 */
+
+	{
+		// Number of layer shader runs (views) times number of layers.
+		const uint32_t layer_shader_count = RENDER_MAX_LAYER_RUNS_COUNT * RENDER_MAX_LAYERS;
+
+		// Two mesh distortion runs.
+		const uint32_t mesh_shader_count = RENDER_MAX_LAYER_RUNS_COUNT;
+
+		struct vk_descriptor_pool_info mesh_pool_info = {
+		    .uniform_per_descriptor_count = 1,
+		    .sampler_per_descriptor_count = 1,
+		    .storage_image_per_descriptor_count = 0,
+		    .storage_buffer_per_descriptor_count = 0,
+		    .descriptor_count = layer_shader_count + mesh_shader_count,
+		    .freeable = false,
+		};
+
+		ret = vk_create_descriptor_pool(         //
+		    vk,                                  // vk_bundle
+		    &mesh_pool_info,                     // info
+		    &f->gfx_ubo_and_src_descriptor_pool); // out_descriptor_pool
+		VK_CHK_WITH_RET(ret, "vk_create_descriptor_pool", false);
+
+		VK_NAME_DESCRIPTOR_POOL(vk, f->gfx_ubo_and_src_descriptor_pool,
+		                        "render_resources ubo and src descriptor pool");
+
+		uint32_t buffer_count = 0;
+
+		// One UBO per layer shader.
+		buffer_count += layer_shader_count;
+
+		// One UBO per mesh shader.
+		buffer_count += RENDER_MAX_LAYER_RUNS_COUNT;
+
+		// We currently use the aligmnent as max UBO size.
+		static_assert(sizeof(struct render_gfx_mesh_ubo_data) <= RENDER_ALWAYS_SAFE_UBO_ALIGNMENT, "MAX");
+
+		// Calculate size.
+		VkDeviceSize size = buffer_count * RENDER_ALWAYS_SAFE_UBO_ALIGNMENT;
+
+		ret = render_buffer_init(  //
+		    vk,                    // vk_bundle
+		    &f->gfx_shared_ubo,    // buffer
+		    ubo_usage_flags,       // usage_flags
+		    memory_property_flags, // memory_property_flags
+		    size);                 // size
+		VK_CHK_WITH_RET(ret, "render_buffer_init", false);
+		VK_NAME_BUFFER(vk, f->gfx_shared_ubo.buffer, "render_resources gfx shared ubo");
+
+		ret = render_buffer_map( //
+		    vk,                  // vk_bundle
+		    &f->gfx_shared_ubo); // buffer
+		VK_CHK_WITH_RET(ret, "render_buffer_map", false);
+	}
+
+
+	/*
+	 * Compute.
+	 */
+
+	const uint32_t compute_descriptor_count = //
+	    1 +                                   // Shared/distortion run(s).
+	    RENDER_MAX_LAYER_RUNS_COUNT;          // Layer shader run(s).
+
+	struct vk_descriptor_pool_info compute_pool_info = {
+	    .uniform_per_descriptor_count = 1,
+	    // layer images
+	    .sampler_per_descriptor_count = r->compute.layer.image_array_size + RENDER_DISTORTION_IMAGES_COUNT,
+	    .storage_image_per_descriptor_count = 1,
+	    .storage_buffer_per_descriptor_count = 0,
+	    .descriptor_count = compute_descriptor_count,
+	    .freeable = false,
+	};
+
+	ret = vk_create_descriptor_pool(  //
+	    vk,                           // vk_bundle
+	    &compute_pool_info,           // info
+	    &f->compute_descriptor_pool); // out_descriptor_pool
+	VK_CHK_WITH_RET(ret, "vk_create_descriptor_pool", false);
+
+	VK_NAME_DESCRIPTOR_POOL(vk, f->compute_descriptor_pool, "render_resources compute descriptor pool");
+
+	size_t layer_ubo_size = sizeof(struct render_compute_layer_ubo_data);
+
+	for (uint32_t i = 0; i < r->view_count; i++) {
+		ret = render_buffer_init(      //
+		    vk,                        // vk_bundle
+		    &f->compute_layer_ubos[i], // buffer
+		    ubo_usage_flags,           // usage_flags
+		    memory_property_flags,     // memory_property_flags
+		    layer_ubo_size);           // size
+		VK_CHK_WITH_RET(ret, "render_buffer_init", false);
+		VK_NAME_BUFFER(vk, f->compute_layer_ubos[i].buffer, "render_resources compute layer ubo");
+
+		ret = render_buffer_map(        //
+		    vk,                         // vk_bundle
+		    &f->compute_layer_ubos[i]); // buffer
+		VK_CHK_WITH_RET(ret, "render_buffer_map", false);
+	}
+
+	size_t distortion_ubo_size = sizeof(struct render_compute_distortion_ubo_data);
+
+	ret = render_buffer_init(       //
+	    vk,                         // vk_bundle
+	    &f->compute_distortion_ubo, // buffer
+	    ubo_usage_flags,            // usage_flags
+	    memory_property_flags,      // memory_property_flags
+	    distortion_ubo_size);       // size
+	VK_CHK_WITH_RET(ret, "render_buffer_init", false);
+	VK_NAME_BUFFER(vk, f->compute_distortion_ubo.buffer, "render_resources compute distortion ubo");
+
+	ret = render_buffer_map(         //
+	    vk,                          // vk_bundle
+	    &f->compute_distortion_ubo); // buffer
+	VK_CHK_WITH_RET(ret, "render_buffer_map", false);
+
+	size_t clear_ubo_size = sizeof(struct render_compute_distortion_ubo_data);
+
+	ret = render_buffer_init(  //
+	    vk,                    // vk_bundle
+	    &f->compute_clear_ubo, // buffer
+	    ubo_usage_flags,       // usage_flags
+	    memory_property_flags, // memory_property_flags
+	    clear_ubo_size);       // size
+	VK_CHK_WITH_RET(ret, "render_buffer_init", false);
+	VK_NAME_BUFFER(vk, f->compute_clear_ubo.buffer, "render_resources compute clear ubo");
+
+	ret = render_buffer_map(    //
+	    vk,                     // vk_bundle
+	    &f->compute_clear_ubo); // buffer
+	VK_CHK_WITH_RET(ret, "render_buffer_map", false);
+
+
+	/*
+	 * Timestamp pool.
+	 */
+
+	VkQueryPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+	    .pNext = NULL,
+	    .flags = 0, // Reserved.
+	    .queryType = VK_QUERY_TYPE_TIMESTAMP,
+	    .queryCount = 2,         // Start & end
+	    .pipelineStatistics = 0, // Not used.
+	};
+
+	vk->vkCreateQueryPool( //
+	    vk->device,        // device
+	    &poolInfo,         // pCreateInfo
+	    NULL,              // pAllocator
+	    &f->query_pool);   // pQueryPool
+
+	VK_NAME_QUERY_POOL(vk, f->query_pool, "render_resources query pool");
+
+	return true;
+}
+
+static void
+close_frame_resources(struct render_resources *r, struct vk_bundle *vk, struct render_frame_resources *f)
+{
+	D(QueryPool, f->query_pool);
+
+	render_buffer_close(vk, &f->compute_clear_ubo);
+	render_buffer_close(vk, &f->compute_distortion_ubo);
+	for (uint32_t i = 0; i < r->view_count; i++) {
+		render_buffer_close(vk, &f->compute_layer_ubos[i]);
+	}
+	D(DescriptorPool, f->compute_descriptor_pool);
+
+	render_buffer_close(vk, &f->gfx_shared_ubo);
+	D(DescriptorPool, f->gfx_ubo_and_src_descriptor_pool);
+
+	// Frees the command buffer as well.
+	D(CommandPool, f->cmd_pool);
+	f->cmd = VK_NULL_HANDLE;
+}
+
+
 /*
  *
  * 'Exported' renderer functions.
@@ -509,7 +732,8 @@ bool
 render_resources_init(struct render_resources *r,
                       struct render_shaders *shaders,
                       struct vk_bundle *vk,
-                      struct xrt_device *xdev)
+                      struct xrt_device *xdev,
+                      uint32_t frame_count)
 {
 	VkResult ret;
 	bool bret;
@@ -527,6 +751,7 @@ render_resources_init(struct render_resources *r,
 	 */
 
 	r->view_count = xdev->hmd->view_count;
+	r->frame_count = CLAMP(frame_count, 1, RENDER_MAX_FRAMES_IN_FLIGHT);
 	r->mesh.src_binding = 0;
 	r->mesh.ubo_binding = 1;
 	struct xrt_hmd_parts *parts = xdev->hmd;
@@ -594,16 +819,20 @@ render_resources_init(struct render_resources *r,
 
 	VK_NAME_COMMAND_POOL(vk, r->distortion_pool.pool, "render_resources distortion command pool");
 
-	VkCommandPoolCreateInfo command_pool_info = {
-	    .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-	    .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
-	    .queueFamilyIndex = vk->queue_family_index,
-	};
 
-	ret = vk->vkCreateCommandPool(vk->device, &command_pool_info, NULL, &r->cmd_pool);
-	VK_CHK_WITH_RET(ret, "vkCreateCommandPool", false);
 
-	VK_NAME_COMMAND_POOL(vk, r->cmd_pool, "render_resources command pool");
+	/*
+	 * Per frame resources, the first one is also used for the mock upload.
+	 */
+
+	for (uint32_t i = 0; i < r->frame_count; i++) {
+		bret = init_frame_resources(r, vk, &r->frames[i]);
+		if (!bret) {
+			return false;
+		}
+	}
+
+	render_resources_use_frame(r, 0);
 
 
 	/*
@@ -675,85 +904,6 @@ render_resources_init(struct render_resources *r,
 
 	VK_NAME_PIPELINE_CACHE(vk, r->pipeline_cache, "render_resources pipeline cache");
 
-	VkCommandBufferAllocateInfo cmd_buffer_info = {
-	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-	    .commandPool = r->cmd_pool,
-	    .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-	    .commandBufferCount = 1,
-	};
-
-	ret = vk->vkAllocateCommandBuffers( //
-	    vk->device,                     // device
-	    &cmd_buffer_info,               // pAllocateInfo
-	    &r->cmd);                       // pCommandBuffers
-	VK_CHK_WITH_RET(ret, "vkAllocateCommandBuffers", false);
-
-	VK_NAME_COMMAND_BUFFER(vk, r->cmd, "render_resources command buffer");
-
-
-	/*
-	 * Gfx.
-	 */
-
-	{
-		// Number of layer shader runs (views) times number of layers.
-		const uint32_t layer_shader_count = RENDER_MAX_LAYER_RUNS_COUNT * RENDER_MAX_LAYERS;
-
-		// Two mesh distortion runs.
-		const uint32_t mesh_shader_count = RENDER_MAX_LAYER_RUNS_COUNT;
-
-		struct vk_descriptor_pool_info mesh_pool_info = {
-		    .uniform_per_descriptor_count = 1,
-		    .sampler_per_descriptor_count = 1,
-		    .storage_image_per_descriptor_count = 0,
-		    .storage_buffer_per_descriptor_count = 0,
-		    .descriptor_count = layer_shader_count + mesh_shader_count,
-		    .freeable = false,
-		};
-
-		ret = vk_create_descriptor_pool(          //
-		    vk,                                   // vk_bundle
-		    &mesh_pool_info,                      // info
-		    &r->gfx.ubo_and_src_descriptor_pool); // out_descriptor_pool
-		VK_CHK_WITH_RET(ret, "vk_create_descriptor_pool", false);
-
-		VK_NAME_DESCRIPTOR_POOL(vk, r->gfx.ubo_and_src_descriptor_pool,
-		                        "render_resources ubo and src descriptor pool");
-
-		VkBufferUsageFlags usage_flags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-		VkMemoryPropertyFlags memory_property_flags = //
-		    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |    //
-		    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;      //
-
-		uint32_t buffer_count = 0;
-
-		// One UBO per layer shader.
-		buffer_count += layer_shader_count;
-
-		// One UBO per mesh shader.
-		buffer_count += RENDER_MAX_LAYER_RUNS_COUNT;
-
-		// We currently use the aligmnent as max UBO size.
-		static_assert(sizeof(struct render_gfx_mesh_ubo_data) <= RENDER_ALWAYS_SAFE_UBO_ALIGNMENT, "MAX");
-
-		// Calculate size.
-		VkDeviceSize size = buffer_count * RENDER_ALWAYS_SAFE_UBO_ALIGNMENT;
-
-		ret = render_buffer_init(  //
-		    vk,                    // vk_bundle
-		    &r->gfx.shared_ubo,    // buffer
-		    usage_flags,           // usage_flags
-		    memory_property_flags, // memory_property_flags
-		    size);                 // size
-		VK_CHK_WITH_RET(ret, "render_buffer_init", false);
-		VK_NAME_BUFFER(vk, r->gfx.shared_ubo.buffer, "render_resources gfx shared ubo");
-
-		ret = render_buffer_map( //
-		    vk,                  // vk_bundle
-		    &r->gfx.shared_ubo); // buffer
-		VK_CHK_WITH_RET(ret, "render_buffer_map", false);
-	}
-
 
 	/*
 	 * Gfx layer.
@@ -821,36 +971,6 @@ render_resources_init(struct render_resources *r,
 	}
 
 
-	/*
-	 * Compute static.
-	 */
-
-	VkBufferUsageFlags ubo_usage_flags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-	VkMemoryPropertyFlags memory_property_flags =
-	    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-
-	const uint32_t compute_descriptor_count = //
-	    1 +                                   // Shared/distortion run(s).
-	    RENDER_MAX_LAYER_RUNS_COUNT;          // Layer shader run(s).
-
-	struct vk_descriptor_pool_info compute_pool_info = {
-	    .uniform_per_descriptor_count = 1,
-	    // layer images
-	    .sampler_per_descriptor_count = r->compute.layer.image_array_size + RENDER_DISTORTION_IMAGES_COUNT,
-	    .storage_image_per_descriptor_count = 1,
-	    .storage_buffer_per_descriptor_count = 0,
-	    .descriptor_count = compute_descriptor_count,
-	    .freeable = false,
-	};
-
-	ret = vk_create_descriptor_pool(  //
-	    vk,                           // vk_bundle
-	    &compute_pool_info,           // info
-	    &r->compute.descriptor_pool); // out_descriptor_pool
-	VK_CHK_WITH_RET(ret, "vk_create_descriptor_pool", false);
-
-	VK_NAME_DESCRIPTOR_POOL(vk, r->compute.descriptor_pool, "render_resources compute descriptor pool");
-
 	/*
 	 * Layer pipeline
 	 */
@@ -912,24 +1032,6 @@ render_resources_init(struct render_resources *r,
 
 	VK_NAME_PIPELINE(vk, r->compute.layer.timewarp_pipeline, "render_resources compute layer timewarp pipeline");
 
-	size_t layer_ubo_size = sizeof(struct render_compute_layer_ubo_data);
-
-	for (uint32_t i = 0; i < r->view_count; i++) {
-		ret = render_buffer_init(      //
-		    vk,                        // vk_bundle
-		    &r->compute.layer.ubos[i], // buffer
-		    ubo_usage_flags,           // usage_flags
-		    memory_property_flags,     // memory_property_flags
-		    layer_ubo_size);           // size
-		VK_CHK_WITH_RET(ret, "render_buffer_init", false);
-		VK_NAME_BUFFER(vk, r->compute.layer.ubos[i].buffer, "render_resources compute layer ubo");
-
-		ret = render_buffer_map(        //
-		    vk,                         // vk_bundle
-		    &r->compute.layer.ubos[i]); // buffer
-		VK_CHK_WITH_RET(ret, "render_buffer_map", false);
-	}
-
 
 	/*
 	 * Distortion pipeline
@@ -989,21 +1091,6 @@ render_resources_init(struct render_resources *r,
 	VK_NAME_PIPELINE(vk, r->compute.distortion.timewarp_pipeline,
 	                 "render_resources compute distortion timewarp pipeline");
 
-	size_t distortion_ubo_size = sizeof(struct render_compute_distortion_ubo_data);
-
-	ret = render_buffer_init(       //
-	    vk,                         // vk_bundle
-	    &r->compute.distortion.ubo, // buffer
-	    ubo_usage_flags,            // usage_flags
-	    memory_property_flags,      // memory_property_flags
-	    distortion_ubo_size);       // size
-	VK_CHK_WITH_RET(ret, "render_buffer_init", false);
-	VK_NAME_BUFFER(vk, r->compute.distortion.ubo.buffer, "render_resources compute distortion ubo");
-	ret = render_buffer_map(         //
-	    vk,                          // vk_bundle
-	    &r->compute.distortion.ubo); // buffer
-	VK_CHK_WITH_RET(ret, "render_buffer_map", false);
-
 
 	/*
 	 * Clear pipeline.
@@ -1020,22 +1107,6 @@ render_resources_init(struct render_resources *r,
 
 	VK_NAME_PIPELINE(vk, r->compute.clear.pipeline, "render_resources compute clear pipeline");
 
-	size_t clear_ubo_size = sizeof(struct render_compute_distortion_ubo_data);
-
-	ret = render_buffer_init(  //
-	    vk,                    // vk_bundle
-	    &r->compute.clear.ubo, // buffer
-	    ubo_usage_flags,       // usage_flags
-	    memory_property_flags, // memory_property_flags
-	    clear_ubo_size);       // size
-	VK_CHK_WITH_RET(ret, "render_buffer_init", false);
-	VK_NAME_BUFFER(vk, r->compute.clear.ubo.buffer, "render_resources compute clear ubo");
-
-	ret = render_buffer_map(    //
-	    vk,                     // vk_bundle
-	    &r->compute.clear.ubo); // buffer
-	VK_CHK_WITH_RET(ret, "render_buffer_map", false);
-
 
 	/*
 	 * Compute distortion textures, not created until later.
@@ -1052,27 +1123,6 @@ render_resources_init(struct render_resources *r,
 	}
 
 
-	/*
-	 * Timestamp pool.
-	 */
-
-	VkQueryPoolCreateInfo poolInfo = {
-	    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
-	    .pNext = NULL,
-	    .flags = 0, // Reserved.
-	    .queryType = VK_QUERY_TYPE_TIMESTAMP,
-	    .queryCount = 2,         // Start & end
-	    .pipelineStatistics = 0, // Not used.
-	};
-
-	vk->vkCreateQueryPool( //
-	    vk->device,        // device
-	    &poolInfo,         // pCreateInfo
-	    NULL,              // pAllocator
-	    &r->query_pool);   // pQueryPool
-
-	VK_NAME_QUERY_POOL(vk, r->query_pool, "render_resources query pool");
-
 	/*
 	 * Done
 	 */
@@ -1101,24 +1151,18 @@ render_resources_close(struct render_resources *r)
 	D(Image, r->mock.color.image);
 	DF(Memory, r->mock.color.memory);
 
-	render_buffer_close(vk, &r->gfx.shared_ubo);
-	D(DescriptorPool, r->gfx.ubo_and_src_descriptor_pool);
-
 	D(DescriptorSetLayout, r->gfx.layer.shared.descriptor_set_layout);
 	D(PipelineLayout, r->gfx.layer.shared.pipeline_layout);
 
 	D(DescriptorSetLayout, r->mesh.descriptor_set_layout);
 	D(PipelineLayout, r->mesh.pipeline_layout);
 	D(PipelineCache, r->pipeline_cache);
-	D(QueryPool, r->query_pool);
 	render_buffer_close(vk, &r->mesh.vbo);
 	render_buffer_close(vk, &r->mesh.ibo);
 	for (uint32_t i = 0; i < r->view_count; ++i) {
 		render_buffer_close(vk, &r->mesh.ubos[i]);
 	}
 
-	D(DescriptorPool, r->compute.descriptor_pool);
-
 	D(DescriptorSetLayout, r->compute.layer.descriptor_set_layout);
 	D(Pipeline, r->compute.layer.non_timewarp_pipeline);
 	D(Pipeline, r->compute.layer.timewarp_pipeline);
@@ -1132,19 +1176,38 @@ render_resources_close(struct render_resources *r)
 	D(Pipeline, r->compute.clear.pipeline);
 
 	render_distortion_images_close(r);
-	render_buffer_close(vk, &r->compute.clear.ubo);
-	for (uint32_t i = 0; i < r->view_count; i++) {
-		render_buffer_close(vk, &r->compute.layer.ubos[i]);
+
+	for (uint32_t i = 0; i < r->frame_count; i++) {
+		close_frame_resources(r, vk, &r->frames[i]);
 	}
-	render_buffer_close(vk, &r->compute.distortion.ubo);
 
 	vk_cmd_pool_destroy(vk, &r->distortion_pool);
-	D(CommandPool, r->cmd_pool);
 
 	// Finally forget about the vk bundle. We do not own it!
 	r->vk = NULL;
 }
 
+void
+render_resources_use_frame(struct render_resources *r, uint32_t index)
+{
+	assert(index < r->frame_count);
+
+	struct render_frame_resources *f = &r->frames[index];
+
+	r->frame_index = index;
+	r->cmd_pool = f->cmd_pool;
+	r->cmd = f->cmd;
+	r->query_pool = f->query_pool;
+	r->gfx.ubo_and_src_descriptor_pool = f->gfx_ubo_and_src_descriptor_pool;
+	r->gfx.shared_ubo = f->gfx_shared_ubo;
+	r->compute.descriptor_pool = f->compute_descriptor_pool;
+	for (uint32_t i = 0; i < r->view_count; i++) {
+		r->compute.layer.ubos[i] = f->compute_layer_ubos[i];
+	}
+	r->compute.distortion.ubo = f->compute_distortion_ubo;
+	r->compute.clear.ubo = f->compute_clear_ubo;
+}
+
 bool
 render_resources_get_timestamps(struct render_resources *r, uint64_t *out_gpu_start_ns, uint64_t *out_gpu_end_ns)
 {
@@ -12,6 +12,8 @@
 
 #include "render/render_interface.h"
 
+#include <assert.h>
+
 
 /*!
  * Create a simplified projection matrix for timewarp.
@@ -123,6 +125,39 @@ render_calc_time_warp_matrix(const struct xrt_pose *src_pose,
 	}
 }
 
+void
+render_late_latch_add_view(struct render_late_latch *rll,
+                           uint32_t view_index,
+                           const struct xrt_pose *src_pose,
+                           const struct xrt_fov *src_fov,
+                           struct xrt_matrix_4x4 *transform)
+{
+	assert(view_index < XRT_MAX_VIEWS);
+
+	rll->src_poses[view_index] = *src_pose;
+	rll->src_fovs[view_index] = *src_fov;
+	rll->transforms[view_index] = transform;
+	if (rll->view_count < view_index + 1) {
+		rll->view_count = view_index + 1;
+	}
+}
+
+void
+render_late_latch_update(const struct render_late_latch *rll, const struct xrt_pose new_poses[XRT_MAX_VIEWS])
+{
+	for (uint32_t i = 0; i < rll->view_count; i++) {
+		if (rll->transforms[i] == NULL) {
+			continue;
+		}
+
+		render_calc_time_warp_matrix( //
+		    &rll->src_poses[i],       //
+		    &rll->src_fovs[i],        //
+		    &new_poses[i],            //
+		    rll->transforms[i]);      //
+	}
+}
+
 void
 render_calc_uv_to_tangent_lengths_rect(const struct xrt_fov *fov, struct xrt_normalized_rect *out_rect)
 {
@@ -710,14 +710,26 @@ do_mesh(struct render_gfx *rr,
 			    &data.transform);         //
 		}
 
+		struct render_gfx_mesh_ubo_data *ubo_ptr = NULL;
 		ret = render_gfx_mesh_alloc_and_write( //
 		    rr,                                //
 		    &data,                             //
 		    md->views[i].src_sampler,          //
 		    md->views[i].src_image_view,       //
-		    &ms.descriptor_sets[i]);           //
+		    &ms.descriptor_sets[i],            //
+		    &ubo_ptr);                         //
 		VK_CHK_WITH_GOTO(ret, "render_gfx_mesh_alloc", err_no_memory);
 
+		// The transform can be redone with a newer pose before submit.
+		if (do_timewarp) {
+			render_late_latch_add_view( //
+			    &rr->late_latch,        //
+			    i,                      //
+			    &md->views[i].src_pose, //
+			    &md->views[i].src_fov,  //
+			    &ubo_ptr->transform);   //
+		}
+
 		VK_NAME_DESCRIPTOR_SET(vk, ms.descriptor_sets[i], "render_gfx mesh descriptor sets");
 	}
 
@@ -72,6 +72,9 @@ swapchain_inc_image_use(struct xrt_swapchain *xsc, uint32_t index)
 
 	os_mutex_lock(&sc->images[index].use_mutex);
 	sc->images[index].use_count++;
+	if (sc->use_mirror != NULL) {
+		xrt_atomic_s32_store(&sc->use_mirror[index], (int32_t)sc->images[index].use_count);
+	}
 	os_mutex_unlock(&sc->images[index].use_mutex);
 
 	SWAPCHAIN_TRACE_END(swapchain_inc_image_use);
@@ -93,9 +96,16 @@ swapchain_dec_image_use(struct xrt_swapchain *xsc, uint32_t index)
 	assert(sc->images[index].use_count > 0 && "use count already 0");
 
 	sc->images[index].use_count--;
+	if (sc->use_mirror != NULL) {
+		xrt_atomic_s32_store(&sc->use_mirror[index], (int32_t)sc->images[index].use_count);
+	}
 	if (sc->images[index].use_count == 0) {
-		os_mutex_unlock(&sc->images[index].use_mutex);
 		pthread_cond_broadcast(&sc->images[index].use_cond);
+#ifdef OS_HAVE_FUTEX
+		if (sc->use_mirror != NULL) {
+			os_futex_wake_all(&sc->use_mirror[index]);
+		}
+#endif
 	}
 
 	os_mutex_unlock(&sc->images[index].use_mutex);
@@ -214,6 +224,31 @@ swapchain_release_image(struct xrt_swapchain *xsc, uint32_t index)
 	return XRT_ERROR_NO_IMAGE_AVAILABLE;
 }
 
+static xrt_result_t
+swapchain_set_use_mirror(struct xrt_swapchain *xsc, xrt_atomic_s32_t *use_counts)
+{
+	struct comp_swapchain *sc = comp_swapchain(xsc);
+	uint32_t image_count = sc->base.base.image_count;
+
+	VK_TRACE(sc->vk, "%p SET_USE_MIRROR %p", (void *)sc, (void *)use_counts);
+
+	// Take all of the locks so no counter changes while switching.
+	for (uint32_t i = 0; i < image_count; i++) {
+		os_mutex_lock(&sc->images[i].use_mutex);
+	}
+
+	sc->use_mirror = use_counts;
+	for (uint32_t i = 0; use_counts != NULL && i < image_count; i++) {
+		xrt_atomic_s32_store(&use_counts[i], (int32_t)sc->images[i].use_count);
+	}
+
+	for (uint32_t i = 0; i < image_count; i++) {
+		os_mutex_unlock(&sc->images[i].use_mutex);
+	}
+
+	return XRT_SUCCESS;
+}
+
 
 /*
  *
@@ -234,6 +269,7 @@ set_common_fields(struct comp_swapchain *sc,
 	sc->base.base.dec_image_use = swapchain_dec_image_use;
 	sc->base.base.wait_image = swapchain_wait_image;
 	sc->base.base.release_image = swapchain_release_image;
+	sc->base.base.set_use_mirror = swapchain_set_use_mirror;
 	sc->base.base.image_count = image_count;
 	sc->base.limited_unique_id = u_limited_unique_id_get();
 	sc->real_destroy = destroy_func;
@@ -104,6 +104,13 @@ struct comp_swapchain
 	 */
 	struct u_index_fifo fifo;
 
+	/*!
+	 * Optional mirror of the image use counters, see
+	 * @ref xrt_swapchain::set_use_mirror. Written with all image use
+	 * mutexes held and read with the mutex of the image being changed.
+	 */
+	xrt_atomic_s32_t *use_mirror;
+
 	//! Virtual real destroy function.
 	comp_swapchain_destroy_func_t real_destroy;
 };
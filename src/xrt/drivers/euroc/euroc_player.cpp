@@ -16,6 +16,7 @@
 #include "util/u_time.h"
 #include "util/u_var.h"
 #include "util/u_sink.h"
+#include "util/u_worker.h"
 #include "tracking/t_frame_cv_mat_wrapper.hpp"
 #include "math/m_api.h"
 #include "math/m_filter_fifo.h"
@@ -25,11 +26,13 @@
 
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <stdint.h>
 #include <stdio.h>
 #include <fstream>
 #include <future>
+#include <mutex>
 #include <thread>
 
 //! @see euroc_player_playback_config
@@ -47,6 +50,8 @@ DEBUG_GET_ONCE_BOOL_OPTION(send_all_imus_first, "EUROC_SEND_ALL_IMUS_FIRST", fal
 DEBUG_GET_ONCE_BOOL_OPTION(use_source_ts, "EUROC_USE_SOURCE_TS", false)
 DEBUG_GET_ONCE_BOOL_OPTION(play_from_start, "EUROC_PLAY_FROM_START", false)
 DEBUG_GET_ONCE_BOOL_OPTION(print_progress, "EUROC_PRINT_PROGRESS", false)
+DEBUG_GET_ONCE_NUM_OPTION(prefetch_frames, "EUROC_PREFETCH_FRAMES", 16)
+DEBUG_GET_ONCE_NUM_OPTION(decode_threads, "EUROC_DECODE_THREADS", 4)
 
 #define EUROC_PLAYER_STR "Euroc Player"
 
@@ -54,10 +59,13 @@ DEBUG_GET_ONCE_BOOL_OPTION(print_progress, "EUROC_PRINT_PROGRESS", false)
 #define EUROC_MAX_CAMS XRT_TRACKING_MAX_SLAM_CAMS
 
 using std::async;
+using std::condition_variable;
 using std::find_if;
 using std::ifstream;
 using std::is_same_v;
 using std::launch;
+using std::mutex;
+using std::unique_lock;
 using std::max_element;
 using std::pair;
 using std::stof;
@@ -71,6 +79,33 @@ using imu_samples = vector<xrt_imu_sample>;
 using img_samples = vector<img_sample>;
 using gt_trajectory = vector<xrt_pose_sample>;
 
+/*!
+ * Decoded images of all cameras for one frame number, slots are reused round
+ * robin by the prefetcher. The cv::Mat storage is recycled once downstream
+ * has released all frames wrapping it.
+ */
+struct euroc_prefetch_slot
+{
+	struct euroc_player *ep;
+	uint64_t seq;                         //!< Frame number held by this slot, index in `imgs[i]`
+	bool ready;                           //!< Whether @ref out holds the images of @ref seq
+	vector<uchar> file_buf;               //!< Reused buffer for the encoded file contents
+	cv::Mat decoded[EUROC_MAX_CAMS];      //!< Reused decode targets
+	cv::Mat scaled[EUROC_MAX_CAMS];       //!< Reused resize targets
+	cv::Mat out[EUROC_MAX_CAMS];          //!< Either `decoded` or `scaled`, what gets pushed
+};
+
+//! Decodes frames ahead of the streaming thread on a worker pool.
+struct euroc_prefetcher
+{
+	struct u_worker_thread_pool *pool = nullptr;
+	struct u_worker_group *group = nullptr;
+	vector<euroc_prefetch_slot> slots;
+
+	mutex lock;              //!< Protects `ready` in the slots
+	condition_variable cond; //!< Signalled when a slot becomes ready
+};
+
 enum euroc_player_ui_state
 {
 	UNINITIALIZED = 0,
@@ -114,6 +149,8 @@ struct euroc_player
 	vector<img_samples> *imgs; //!< List of all image names to read from the dataset per camera
 	gt_trajectory *gt;         //!< List of all groundtruth poses read from the dataset
 
+	struct euroc_prefetcher *prefetcher; //!< Decode-ahead state, null if prefetching is disabled
+
 	// Timestamp correction fields (can be disabled through `use_source_ts`)
 	timepoint_ns base_ts;   //!< First sample timestamp, stream timestamps are relative to this
 	timepoint_ns start_ts;  //!< When did the dataset started to be played
@@ -421,29 +458,59 @@ euroc_player_mapped_playback_ts(struct euroc_player *ep, timepoint_ns ts)
 	return euroc_player_mapped_ts(ep, ts);
 }
 
+//! Drops @p mat if a pushed frame still references its storage, otherwise it gets reused.
 static void
-euroc_player_load_next_frame(struct euroc_player *ep, int cam_index, struct xrt_frame *&xf)
+euroc_player_recycle_mat(cv::Mat &mat)
 {
-	using xrt::auxiliary::tracking::FrameMat;
-	img_sample sample = ep->imgs->at(cam_index).at(ep->img_seq);
-	ep->playback.scale = CLAMP(ep->playback.scale, 1.0 / 16, 4);
+	if (mat.u != nullptr && mat.u->refcount > 1) {
+		mat.release();
+	}
+}
 
+//! Reads and decodes @p img_name into @p out, applying the playback color and scale options.
+static void
+euroc_player_decode_image(struct euroc_player *ep,
+                          const string &img_name,
+                          vector<uchar> &file_buf,
+                          cv::Mat &decoded,
+                          cv::Mat &scaled,
+                          cv::Mat &out)
+{
 	// Load will be influenced by these playback options
 	bool allow_color = ep->playback.color;
-	float scale = ep->playback.scale;
+	float scale = CLAMP(ep->playback.scale, 1.0 / 16, 4);
+
+	ifstream fin{img_name, std::ios::binary | std::ios::ate};
+	EUROC_ASSERT(fin.is_open(), "Unable to open image %s", img_name.c_str());
+	file_buf.resize(fin.tellg());
+	fin.seekg(0);
+	fin.read((char *)file_buf.data(), file_buf.size());
+
+	// Release our own reference first, so only pushed frames keep the storage alive.
+	out.release();
+	euroc_player_recycle_mat(decoded);
 
-	// Load image from disk
-	timepoint_ns timestamp = euroc_player_mapped_playback_ts(ep, sample.first);
-	string img_name = sample.second;
-	EUROC_TRACE(ep, "cam%d img t = %ld filename = %s", cam_index, timestamp, img_name.c_str());
 	cv::ImreadModes read_mode = allow_color ? cv::IMREAD_ANYCOLOR : cv::IMREAD_GRAYSCALE;
-	cv::Mat img = cv::imread(img_name, read_mode); // If colored, reads in BGR order
+	cv::imdecode(file_buf, read_mode, &decoded); // If colored, decodes in BGR order
+	EUROC_ASSERT(!decoded.empty(), "Unable to decode image %s", img_name.c_str());
 
 	if (scale != 1.0) {
-		cv::Mat tmp;
-		cv::resize(img, tmp, cv::Size(), scale, scale);
-		img = tmp;
+		euroc_player_recycle_mat(scaled);
+		cv::resize(decoded, scaled, cv::Size(), scale, scale);
+		out = scaled;
+	} else {
+		out = decoded;
 	}
+}
+
+//! Wraps the decoded image of frame `img_seq` into @p xf.
+static void
+euroc_player_wrap_frame(struct euroc_player *ep, int cam_index, const cv::Mat &img, struct xrt_frame *&xf)
+{
+	using xrt::auxiliary::tracking::FrameMat;
+	img_sample sample = ep->imgs->at(cam_index).at(ep->img_seq);
+	timepoint_ns timestamp = euroc_player_mapped_playback_ts(ep, sample.first);
+	EUROC_TRACE(ep, "cam%d img t = %ld filename = %s", cam_index, timestamp, sample.second.c_str());
 
 	// Create xrt_frame, it will be freed by FrameMat destructor
 	EUROC_ASSERT(xf == NULL || xf->reference.count > 0, "Must be given a valid or NULL frame ptr");
@@ -461,14 +528,137 @@ euroc_player_load_next_frame(struct euroc_player *ep, int cam_index, struct xrt_
 	xf->source_id = ep->base.source_id;
 }
 
+static void
+euroc_player_load_next_frame(struct euroc_player *ep, int cam_index, struct xrt_frame *&xf)
+{
+	const string &img_name = ep->imgs->at(cam_index).at(ep->img_seq).second;
+
+	vector<uchar> file_buf;
+	cv::Mat decoded;
+	cv::Mat scaled;
+	cv::Mat img;
+	euroc_player_decode_image(ep, img_name, file_buf, decoded, scaled, img);
+
+	euroc_player_wrap_frame(ep, cam_index, img, xf);
+}
+
+
+/*
+ *
+ * Prefetching.
+ *
+ */
+
+static void
+euroc_player_prefetch_task(void *ptr)
+{
+	struct euroc_prefetch_slot *slot = (struct euroc_prefetch_slot *)ptr;
+	struct euroc_player *ep = slot->ep;
+
+	for (int i = 0; i < ep->playback.cam_count; i++) {
+		const string &img_name = ep->imgs->at(i).at(slot->seq).second;
+		euroc_player_decode_image(ep, img_name, slot->file_buf, slot->decoded[i], slot->scaled[i],
+		                          slot->out[i]);
+	}
+
+	unique_lock lock{ep->prefetcher->lock};
+	slot->ready = true;
+	ep->prefetcher->cond.notify_all();
+}
+
+//! Queues frame @p seq for decoding into its slot, the slot must not be in use.
+static void
+euroc_player_prefetch_submit(struct euroc_player *ep, uint64_t seq)
+{
+	if (seq >= ep->imgs->at(0).size()) {
+		return;
+	}
+
+	struct euroc_prefetcher *pf = ep->prefetcher;
+	struct euroc_prefetch_slot &slot = pf->slots[seq % pf->slots.size()];
+
+	{
+		unique_lock lock{pf->lock};
+		slot.seq = seq;
+		slot.ready = false;
+	}
+
+	u_worker_group_push(pf->group, euroc_player_prefetch_task, &slot);
+}
+
+static void
+euroc_player_prefetch_start(struct euroc_player *ep)
+{
+	if (ep->playback.prefetch_frames <= 0) {
+		return;
+	}
+
+	uint32_t worker_count = (uint32_t)CLAMP(debug_get_num_option_decode_threads(), 1, 16);
+
+	struct euroc_prefetcher *pf = new euroc_prefetcher{};
+	// The streaming thread only waits on the group when stopping, the extra thread is for that.
+	pf->pool = u_worker_thread_pool_create(worker_count, worker_count + 1, "EuRoC decode");
+	pf->group = u_worker_group_create(pf->pool);
+	pf->slots.resize(ep->playback.prefetch_frames);
+	for (euroc_prefetch_slot &slot : pf->slots) {
+		slot.ep = ep;
+	}
+	ep->prefetcher = pf;
+
+	for (uint64_t i = 0; i < pf->slots.size(); i++) {
+		euroc_player_prefetch_submit(ep, ep->img_seq + i);
+	}
+}
+
+static void
+euroc_player_prefetch_stop(struct euroc_player *ep)
+{
+	struct euroc_prefetcher *pf = ep->prefetcher;
+	if (pf == nullptr) {
+		return;
+	}
+
+	u_worker_group_wait_all(pf->group);
+	u_worker_group_reference(&pf->group, NULL);
+	u_worker_thread_pool_reference(&pf->pool, NULL);
+
+	ep->prefetcher = nullptr;
+	delete pf;
+}
+
+//! Wraps the prefetched images of frame `img_seq`, waiting for them to be decoded if needed.
+static void
+euroc_player_take_prefetched_frames(struct euroc_player *ep, vector<xrt_frame *> &xfs)
+{
+	struct euroc_prefetcher *pf = ep->prefetcher;
+	struct euroc_prefetch_slot &slot = pf->slots[ep->img_seq % pf->slots.size()];
+
+	{
+		unique_lock lock{pf->lock};
+		pf->cond.wait(lock, [&] { return slot.seq == ep->img_seq && slot.ready; });
+	}
+
+	for (size_t i = 0; i < xfs.size(); i++) {
+		euroc_player_wrap_frame(ep, (int)i, slot.out[i], xfs[i]);
+	}
+
+	// The frames hold their own references, the slot can be reused right away.
+	euroc_player_prefetch_submit(ep, ep->img_seq + pf->slots.size());
+}
+
 static void
 euroc_player_push_next_frame(struct euroc_player *ep)
 {
 	int cam_count = ep->playback.cam_count;
+	ep->playback.scale = CLAMP(ep->playback.scale, 1.0 / 16, 4);
 
 	vector<xrt_frame *> xfs(cam_count, nullptr);
-	for (int i = 0; i < cam_count; i++) {
-		euroc_player_load_next_frame(ep, i, xfs[i]);
+	if (ep->prefetcher != nullptr) {
+		euroc_player_take_prefetched_frames(ep, xfs);
+	} else {
+		for (int i = 0; i < cam_count; i++) {
+			euroc_player_load_next_frame(ep, i, xfs[i]);
+		}
 	}
 
 	// TODO: Some SLAM systems expect synced frames, but that's not an
@@ -575,6 +765,23 @@ euroc_player_get_stream_set(struct euroc_player *ep)
 	return make_tuple(samples, sample_seq, push_next_sample, sleep_until_next_sample);
 }
 
+/*!
+ * In max speed mode, holds the next frame back until all IMU samples up to its
+ * timestamp have been pushed, so the tracker sees samples in dataset order
+ * instead of whatever order the two streaming threads happen to run in.
+ */
+static void
+euroc_player_wait_for_imus(struct euroc_player *ep)
+{
+	timepoint_ns frame_ts = euroc_player_get_next_euroc_ts<img_samples>(ep);
+
+	while (ep->is_running && ep->imu_seq < ep->imus->size() &&
+	       ep->imus->at(ep->imu_seq).timestamp_ns <= frame_ts) {
+		constexpr int64_t IMU_POLL_INTERVAL_NS = U_TIME_1MS_IN_NS / 10;
+		os_nanosleep(IMU_POLL_INTERVAL_NS);
+	}
+}
+
 template <typename SamplesType>
 static void
 euroc_player_stream_samples(struct euroc_player *ep)
@@ -591,6 +798,8 @@ euroc_player_stream_samples(struct euroc_player *ep)
 
 		if (!ep->playback.max_speed) {
 			sleep_until_next_sample(ep);
+		} else if constexpr (is_same_v<SamplesType, img_samples>) {
+			euroc_player_wait_for_imus(ep);
 		}
 
 		push_next_sample(ep);
@@ -608,6 +817,7 @@ euroc_player_stream(void *ptr)
 	ep->base_ts = MIN(ep->imgs->at(0).at(0).first, ep->imus->at(0).timestamp_ns);
 	ep->start_ts = os_monotonic_get_ts();
 	euroc_player_user_skip(ep);
+	euroc_player_prefetch_start(ep);
 
 	// Push all IMU samples now if requested
 	if (ep->playback.send_all_imus_first) {
@@ -631,6 +841,7 @@ euroc_player_stream(void *ptr)
 	serve_imgs.get();
 	serve_imus.get();
 
+	euroc_player_prefetch_stop(ep);
 	ep->is_running = false;
 
 	EUROC_INFO(ep, "Euroc dataset playback finished");
@@ -909,6 +1120,7 @@ euroc_player_setup_gui(struct euroc_player *ep)
 	u_var_add_f64(ep, &ep->playback.speed, "Speed");
 	u_var_add_bool(ep, &ep->playback.send_all_imus_first, "Send all IMU samples first");
 	u_var_add_bool(ep, &ep->playback.use_source_ts, "Use original timestamps");
+	u_var_add_ro_i32(ep, &ep->playback.prefetch_frames, "Frames to decode ahead");
 
 	u_var_add_gui_header(ep, NULL, "Streams");
 	u_var_add_ro_ff_vec3_f32(ep, ep->gyro_ff, "Gyroscope");
@@ -945,6 +1157,7 @@ euroc_player_fill_default_config_for(struct euroc_player_config *config, const c
 	playback.use_source_ts = debug_get_bool_option_use_source_ts();
 	playback.play_from_start = debug_get_bool_option_play_from_start();
 	playback.print_progress = debug_get_bool_option_print_progress();
+	playback.prefetch_frames = (int)debug_get_num_option_prefetch_frames();
 
 	config->log_level = debug_get_log_option_euroc_log();
 	config->dataset = dataset;
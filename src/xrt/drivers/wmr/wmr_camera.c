@@ -22,6 +22,7 @@
 #include "util/u_var.h"
 #include "util/u_sink.h"
 #include "util/u_frame.h"
+#include "util/u_frame_pool.h"
 #include "util/u_trace_marker.h"
 
 #include "wmr_config.h"
@@ -108,6 +109,9 @@ struct wmr_camera
 
 	struct libusb_transfer *xfers[NUM_XFERS];
 
+	//! Full frames, go back to the pool once all the ROI frames made from them are released.
+	struct u_frame_pool *frame_pool;
+
 	struct wmr_camera_expgain
 	{
 		bool manual_control; //!< Whether to control exp/gain manually or with aeg
@@ -299,7 +303,7 @@ img_xfer_cb(struct libusb_transfer *xfer)
 	struct xrt_frame *xf = NULL;
 
 	/* There's always one extra line of pixels with exposure info */
-	u_frame_create_one_off(XRT_FORMAT_L8, cam->frame_width, cam->frame_height + 1, &xf);
+	u_frame_pool_create_frame(cam->frame_pool, XRT_FORMAT_L8, cam->frame_width, cam->frame_height + 1, &xf);
 
 	const uint8_t *src = xfer->buffer;
 
@@ -426,6 +430,7 @@ wmr_camera_open(struct wmr_camera_open_config *config)
 	cam->tcam_count = config->tcam_count;
 	cam->slam_cam_count = config->slam_cam_count;
 	cam->log_level = config->log_level;
+	cam->frame_pool = u_frame_pool_create(U_FRAME_POOL_DEFAULT_MAX_FREE_COUNT);
 
 	for (int i = 0; i < cam->tcam_count; i++) {
 		cam->tcam_confs[i] = *config->tcam_confs[i];
@@ -570,6 +575,9 @@ wmr_camera_free(struct wmr_camera *cam)
 	u_sink_debug_destroy(&cam->debug_sinks[WMR_DEBUG_SINK_SLAM]);
 	u_sink_debug_destroy(&cam->debug_sinks[WMR_DEBUG_SINK_CONTROLLER]);
 
+	// Frames still held downstream keep the pool alive.
+	u_frame_pool_reference(&cam->frame_pool, NULL);
+
 	free(cam);
 }
 
@@ -604,6 +604,19 @@ struct xrt_swapchain
 	 * See xrReleaseSwapchainImage, state tracker needs to track index.
 	 */
 	xrt_result_t (*release_image)(struct xrt_swapchain *xsc, uint32_t index);
+
+	/*!
+	 * Optional, mirror the use counter of every image into @p use_counts,
+	 * which has @ref image_count elements and may live in memory shared
+	 * with another process. The mirror is updated whenever a use counter
+	 * changes and on Linux every futex waiter on a counter is woken when it
+	 * drops to zero, this lets a process wait for an image without asking
+	 * the owner of the swapchain. Pass NULL to stop mirroring.
+	 *
+	 * @param xsc        Self pointer
+	 * @param use_counts Array of counters to mirror into, or NULL.
+	 */
+	xrt_result_t (*set_use_mirror)(struct xrt_swapchain *xsc, xrt_atomic_s32_t *use_counts);
 };
 
 /*!
@@ -717,6 +730,23 @@ xrt_swapchain_release_image(struct xrt_swapchain *xsc, uint32_t index)
 	return xsc->release_image(xsc, index);
 }
 
+/*!
+ * @copydoc xrt_swapchain::set_use_mirror
+ *
+ * Helper for calling through the function pointer.
+ *
+ * @public @memberof xrt_swapchain
+ */
+static inline xrt_result_t
+xrt_swapchain_set_use_mirror(struct xrt_swapchain *xsc, xrt_atomic_s32_t *use_counts)
+{
+	if (xsc->set_use_mirror == NULL) {
+		return XRT_ERROR_NOT_IMPLEMENTED;
+	}
+
+	return xsc->set_use_mirror(xsc, use_counts);
+}
+
 
 /*
  *
@@ -796,6 +826,23 @@ struct xrt_compositor_semaphore
 	 */
 	xrt_result_t (*wait)(struct xrt_compositor_semaphore *xcsem, uint64_t value, uint64_t timeout_ns);
 
+	/*!
+	 * Optional, does a CPU side wait until any of @p xcsems reaches its value
+	 * in @p values. All of them must have been created by the same compositor
+	 * as @p xcsem, which is only used to dispatch the call. At most
+	 * @ref XRT_MAX_COMPOSITOR_SEMAPHORE_WAIT_ANY semaphores can be waited on.
+	 */
+	xrt_result_t (*wait_any)(struct xrt_compositor_semaphore *xcsem,
+	                         struct xrt_compositor_semaphore **xcsems,
+	                         const uint64_t *values,
+	                         uint32_t count,
+	                         uint64_t timeout_ns);
+
+	/*!
+	 * Optional, signals the semaphore to the given value from the CPU.
+	 */
+	xrt_result_t (*signal)(struct xrt_compositor_semaphore *xcsem, uint64_t value);
+
 	/*!
 	 * Destroys the semaphore.
 	 */
@@ -848,6 +895,44 @@ xrt_compositor_semaphore_wait(struct xrt_compositor_semaphore *xcsem, uint64_t v
 	return xcsem->wait(xcsem, value, timeout);
 }
 
+/*!
+ * @copydoc xrt_compositor_semaphore::wait_any
+ *
+ * Helper for calling through the function pointer.
+ *
+ * @public @memberof xrt_compositor_semaphore
+ */
+static inline xrt_result_t
+xrt_compositor_semaphore_wait_any(struct xrt_compositor_semaphore *xcsem,
+                                  struct xrt_compositor_semaphore **xcsems,
+                                  const uint64_t *values,
+                                  uint32_t count,
+                                  uint64_t timeout_ns)
+{
+	if (xcsem->wait_any == NULL) {
+		return XRT_ERROR_NOT_IMPLEMENTED;
+	}
+
+	return xcsem->wait_any(xcsem, xcsems, values, count, timeout_ns);
+}
+
+/*!
+ * @copydoc xrt_compositor_semaphore::signal
+ *
+ * Helper for calling through the function pointer.
+ *
+ * @public @memberof xrt_compositor_semaphore
+ */
+static inline xrt_result_t
+xrt_compositor_semaphore_signal(struct xrt_compositor_semaphore *xcsem, uint64_t value)
+{
+	if (xcsem->signal == NULL) {
+		return XRT_ERROR_NOT_IMPLEMENTED;
+	}
+
+	return xcsem->signal(xcsem, value);
+}
+
 
 /*
  *
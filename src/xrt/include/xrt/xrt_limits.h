@@ -53,6 +53,12 @@
  */
 #define XRT_MAX_LAYERS 128
 
+/*!
+ * Max number of semaphores that can be waited on at once with
+ * @ref xrt_compositor_semaphore::wait_any, artificial limit.
+ */
+#define XRT_MAX_COMPOSITOR_SEMAPHORE_WAIT_ANY 128
+
 /*!
  * @}
  */
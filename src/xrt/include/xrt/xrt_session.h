@@ -253,6 +253,17 @@ struct xrt_session
 	 */
 	xrt_result_t (*poll_events)(struct xrt_session *xs, union xrt_session_event *out_xse);
 
+	/*!
+	 * Optional, forward every event pushed to this session to @p xses
+	 * instead of queueing it for @ref poll_events. Events that are already
+	 * queued are forwarded first, and calls to @p xses are serialized so
+	 * it sees a single producer. Pass NULL to go back to queueing.
+	 *
+	 * @param xs   Pointer to self
+	 * @param xses Sink to forward events to, or NULL.
+	 */
+	xrt_result_t (*set_event_sink)(struct xrt_session *xs, struct xrt_session_event_sink *xses);
+
 	/*!
 	 * Destroy the session, must be destroyed after the native compositor.
 	 *
@@ -276,6 +287,23 @@ xrt_session_poll_events(struct xrt_session *xs, union xrt_session_event *out_xse
 	return xs->poll_events(xs, out_xse);
 }
 
+/*!
+ * @copydoc xrt_session::set_event_sink
+ *
+ * Helper for calling through the function pointer.
+ *
+ * @public @memberof xrt_session
+ */
+XRT_CHECK_RESULT static inline xrt_result_t
+xrt_session_set_event_sink(struct xrt_session *xs, struct xrt_session_event_sink *xses)
+{
+	if (xs->set_event_sink == NULL) {
+		return XRT_ERROR_NOT_IMPLEMENTED;
+	}
+
+	return xs->set_event_sink(xs, xses);
+}
+
 /*!
  * Destroy an xrt_session - helper function.
  *
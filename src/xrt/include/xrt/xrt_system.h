@@ -320,6 +320,17 @@ struct xrt_system_devices
 	 */
 	xrt_result_t (*feature_dec)(struct xrt_system_devices *xsysd, enum xrt_device_feature_type type);
 
+	/*!
+	 * Update the inputs of all devices in @ref xdevs, optional. Lets
+	 * implementations that have a cost per update, like IPC, do them all
+	 * at once, when NULL each device is updated in turn.
+	 *
+	 * Code consuming this interface should use @ref xrt_system_devices_update_inputs.
+	 *
+	 * @param xsysd Pointer to self
+	 */
+	xrt_result_t (*update_inputs)(struct xrt_system_devices *xsysd);
+
 	/*!
 	 * Destroy all the devices that are owned by this system devices.
 	 *
@@ -369,6 +380,35 @@ xrt_system_devices_feature_dec(struct xrt_system_devices *xsysd, enum xrt_device
 	return xsysd->feature_dec(xsysd, type);
 }
 
+/*!
+ * @copydoc xrt_system_devices::update_inputs
+ *
+ * Helper for calling through the function pointer, falls back to calling
+ * @ref xrt_device_update_inputs on each device, stopping at the first error.
+ *
+ * @public @memberof xrt_system_devices
+ */
+static inline xrt_result_t
+xrt_system_devices_update_inputs(struct xrt_system_devices *xsysd)
+{
+	if (xsysd->update_inputs != NULL) {
+		return xsysd->update_inputs(xsysd);
+	}
+
+	for (size_t i = 0; i < xsysd->xdev_count; i++) {
+		if (xsysd->xdevs[i] == NULL) {
+			continue;
+		}
+
+		xrt_result_t xret = xrt_device_update_inputs(xsysd->xdevs[i]);
+		if (xret != XRT_SUCCESS) {
+			return xret;
+		}
+	}
+
+	return XRT_SUCCESS;
+}
+
 /*!
  * Destroy an xrt_system_devices and owned devices - helper function.
  *
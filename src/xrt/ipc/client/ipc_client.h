@@ -149,18 +149,42 @@
 struct xrt_compositor_native;
 
 
+/*!
+ * An extra channel to the service, each is served by its own thread in the
+ * service so a call waiting on one does not stall calls made on the others.
+ */
+struct ipc_client_channel
+{
+	struct ipc_message_channel imc;
+
+	//! Held for the whole call made on this channel.
+	struct os_mutex mutex;
+};
+
 /*!
  * Connection.
  */
 struct ipc_connection
 {
+	//! Main channel, used for setup and for calls with variable length data.
 	struct ipc_message_channel imc;
 
 	struct ipc_shared_memory *ism;
 	xrt_shmem_handle_t ism_handle;
 
+	//! Index of this client, used to find per client state in @ref ism.
+	uint32_t client_index;
+
+	//! Protects the main channel.
 	struct os_mutex mutex;
 
+	//! Extra channels, only written during init and fini.
+	struct ipc_client_channel channels[IPC_MAX_CLIENT_CHANNELS];
+	uint32_t channel_count;
+
+	//! Spreads out threads that find all channels busy.
+	xrt_atomic_s32_t next_channel;
+
 #ifdef XRT_OS_ANDROID
 	struct ipc_client_android *ica;
 #endif // XRT_OS_ANDROID
@@ -188,6 +212,20 @@ struct ipc_client_xdev
  *
  */
 
+/*!
+ * Picks a channel for a single call and locks it, a free channel is preferred
+ * so that concurrent calls from different threads do not wait on each other.
+ * Unlock the returned mutex once the reply has been received.
+ *
+ * @param ipc_c       IPC connection
+ * @param[out] out_imc Channel to send the call on.
+ *
+ * @ingroup ipc_client
+ */
+struct os_mutex *
+ipc_client_connection_acquire_channel(struct ipc_connection *ipc_c, struct ipc_message_channel **out_imc);
+
+
 /*!
  * Convenience helper to go from a xdev to @ref ipc_client_xdev.
  *
@@ -199,6 +237,39 @@ ipc_client_xdev(struct xrt_device *xdev)
 	return (struct ipc_client_xdev *)xdev;
 }
 
+/*!
+ * Update the inputs of the device, if the server is publishing device state
+ * the inputs are read from shared memory, otherwise a call is made.
+ *
+ * @public @memberof ipc_client_xdev
+ */
+xrt_result_t
+ipc_client_xdev_update_inputs(struct ipc_client_xdev *icx);
+
+/*!
+ * Update the inputs of several devices, all devices that can't be read from
+ * the published state are updated with a single call. All of @p xdevs must be
+ * @ref ipc_client_xdev on @p ipc_c, NULL entries are skipped.
+ *
+ * @return The first error of any device, the others are still updated.
+ * @ingroup ipc_client
+ */
+xrt_result_t
+ipc_client_xdev_update_inputs_batch(struct ipc_connection *ipc_c, struct xrt_device **xdevs, size_t xdev_count);
+
+/*!
+ * Get the tracked pose of the device, if the server has published a recent
+ * enough relation for the input it is predicted to @p at_timestamp_ns without
+ * doing a call, otherwise a call is made.
+ *
+ * @public @memberof ipc_client_xdev
+ */
+void
+ipc_client_xdev_get_tracked_pose(struct ipc_client_xdev *icx,
+                                 enum xrt_input_name name,
+                                 int64_t at_timestamp_ns,
+                                 struct xrt_space_relation *out_relation);
+
 /*!
  * Create an IPC client system compositor.
  *
@@ -15,10 +15,12 @@
 
 
 #include "os/os_time.h"
+#include "os/os_threading.h"
 
 #include "util/u_misc.h"
 #include "util/u_wait.h"
 #include "util/u_handles.h"
+#include "util/u_index_fifo.h"
 #include "util/u_trace_marker.h"
 #include "util/u_limited_unique_id.h"
 
@@ -97,6 +99,15 @@ struct ipc_client_swapchain
 	struct ipc_client_compositor *icc;
 
 	uint32_t id;
+
+	/*!
+	 * Acquire and release are bookkeeping only, so they are done here
+	 * without telling the server, always gives out the oldest image.
+	 */
+	struct u_index_fifo fifo;
+
+	//! Image use state mirrored by the server, used to wait without a round trip.
+	struct ipc_shared_swapchain *iss;
 };
 
 /*!
@@ -182,13 +193,61 @@ ipc_compositor_swapchain_destroy(struct xrt_swapchain *xsc)
 	free(xsc);
 }
 
+#ifdef OS_HAVE_FUTEX
+/*!
+ * Wait on the use counter mirrored by the server, it wakes us when the
+ * counter drops to zero.
+ */
+static xrt_result_t
+swapchain_wait_image_futex(struct ipc_shared_swapchain *iss, int64_t timeout_ns, uint32_t index)
+{
+	xrt_atomic_s32_t *word = &iss->use_counts[index];
+	int64_t start_ns = os_monotonic_get_ns();
+
+	while (true) {
+		int32_t use_count = xrt_atomic_s32_load(word);
+		if (use_count == 0) {
+			return XRT_SUCCESS;
+		}
+
+		// Negative waits forever.
+		int64_t left_ns = -1;
+		if (timeout_ns != XRT_INFINITE_DURATION) {
+			int64_t waited_ns = os_monotonic_get_ns() - start_ns;
+			if (waited_ns >= timeout_ns) {
+				return XRT_TIMEOUT;
+			}
+			left_ns = timeout_ns - waited_ns;
+		}
+
+		// Returns early if the counter has already changed, timeouts are checked above.
+		os_futex_wait(word, use_count, left_ns);
+	}
+}
+#endif
+
 static xrt_result_t
 ipc_compositor_swapchain_wait_image(struct xrt_swapchain *xsc, int64_t timeout_ns, uint32_t index)
 {
+	IPC_TRACE_MARKER();
+
 	struct ipc_client_swapchain *ics = ipc_client_swapchain(xsc);
 	struct ipc_client_compositor *icc = ics->icc;
+	struct ipc_shared_swapchain *iss = ics->iss;
 	xrt_result_t xret;
 
+	if (index < xsc->image_count && xrt_atomic_s32_load(&iss->mirrored) != 0) {
+		// Common case, the compositor is already done with the image.
+		if (xrt_atomic_s32_load(&iss->use_counts[index]) == 0) {
+			return XRT_SUCCESS;
+		}
+
+#ifdef OS_HAVE_FUTEX
+		return swapchain_wait_image_futex(iss, timeout_ns, index);
+#endif
+	}
+
+	// Not mirrored or no way to sleep on the counter, let the server wait.
 	xret = ipc_call_swapchain_wait_image(icc->ipc_c, ics->id, timeout_ns, index);
 	IPC_CHK_ALWAYS_RET(icc->ipc_c, xret, "ipc_call_swapchain_wait_image");
 }
@@ -197,22 +256,39 @@ static xrt_result_t
 ipc_compositor_swapchain_acquire_image(struct xrt_swapchain *xsc, uint32_t *out_index)
 {
 	struct ipc_client_swapchain *ics = ipc_client_swapchain(xsc);
-	struct ipc_client_compositor *icc = ics->icc;
-	xrt_result_t xret;
 
-	xret = ipc_call_swapchain_acquire_image(icc->ipc_c, ics->id, out_index);
-	IPC_CHK_ALWAYS_RET(icc->ipc_c, xret, "ipc_call_swapchain_acquire_image");
+	// Returns negative on empty fifo.
+	int res = u_index_fifo_pop(&ics->fifo, out_index);
+	if (res >= 0) {
+		return XRT_SUCCESS;
+	}
+	return XRT_ERROR_NO_IMAGE_AVAILABLE;
 }
 
 static xrt_result_t
 ipc_compositor_swapchain_release_image(struct xrt_swapchain *xsc, uint32_t index)
 {
 	struct ipc_client_swapchain *ics = ipc_client_swapchain(xsc);
-	struct ipc_client_compositor *icc = ics->icc;
-	xrt_result_t xret;
 
-	xret = ipc_call_swapchain_release_image(icc->ipc_c, ics->id, index);
-	IPC_CHK_ALWAYS_RET(icc->ipc_c, xret, "ipc_call_swapchain_release_image");
+	int res = u_index_fifo_push(&ics->fifo, index);
+	if (res >= 0) {
+		return XRT_SUCCESS;
+	}
+	// FIFO full
+	return XRT_ERROR_NO_IMAGE_AVAILABLE;
+}
+
+static void
+swapchain_init_bookkeeping(struct ipc_client_swapchain *ics)
+{
+	struct ipc_connection *ipc_c = ics->icc->ipc_c;
+
+	// Prime the fifo, same as the server side swapchain.
+	for (uint32_t i = 0; i < ics->base.base.image_count; i++) {
+		u_index_fifo_push(&ics->fifo, i);
+	}
+
+	ics->iss = &ipc_c->ism->swapchains[ipc_c->client_index][ics->id];
 }
 
 
@@ -300,6 +376,7 @@ swapchain_server_create(struct ipc_client_compositor *icc,
 	ics->base.limited_unique_id = u_limited_unique_id_get();
 	ics->icc = icc;
 	ics->id = handle;
+	swapchain_init_bookkeeping(ics);
 
 	for (uint32_t i = 0; i < image_count; i++) {
 		ics->base.images[i].handle = remote_handles[i];
@@ -357,6 +434,7 @@ swapchain_server_import(struct ipc_client_compositor *icc,
 	ics->base.limited_unique_id = u_limited_unique_id_get();
 	ics->icc = icc;
 	ics->id = id;
+	swapchain_init_bookkeeping(ics);
 
 	// The handles were copied in the IPC call so we can reuse them here.
 	for (uint32_t i = 0; i < image_count; i++) {
@@ -567,6 +645,20 @@ ipc_compositor_begin_frame(struct xrt_compositor *xc, int64_t frame_id)
 	IPC_CHK_ALWAYS_RET(icc->ipc_c, xret, "ipc_call_compositor_begin_frame");
 }
 
+/*!
+ * The next layer entry to write, the server only copies the ones that the
+ * commit says were written so nothing past the count is ever touched.
+ */
+static inline struct ipc_layer_entry *
+get_layer_entry(struct ipc_client_compositor *icc)
+{
+	struct ipc_shared_memory *ism = icc->ipc_c->ism;
+
+	assert(icc->layers.layer_count < IPC_MAX_LAYERS);
+
+	return &ism->layers[icc->ipc_c->client_index][icc->layers.layer_count];
+}
+
 static xrt_result_t
 ipc_compositor_layer_begin(struct xrt_compositor *xc, const struct xrt_layer_frame_data *data)
 {
@@ -590,9 +682,7 @@ ipc_compositor_layer_projection(struct xrt_compositor *xc,
 
 	assert(data->type == XRT_LAYER_PROJECTION);
 
-	struct ipc_shared_memory *ism = icc->ipc_c->ism;
-	struct ipc_layer_slot *slot = &ism->slots[icc->layers.slot_id];
-	struct ipc_layer_entry *layer = &slot->layers[icc->layers.layer_count];
+	struct ipc_layer_entry *layer = get_layer_entry(icc);
 	layer->xdev_id = 0; //! @todo Real id.
 	layer->data = *data;
 	for (uint32_t i = 0; i < data->view_count; ++i) {
@@ -616,9 +706,7 @@ ipc_compositor_layer_projection_depth(struct xrt_compositor *xc,
 
 	assert(data->type == XRT_LAYER_PROJECTION_DEPTH);
 
-	struct ipc_shared_memory *ism = icc->ipc_c->ism;
-	struct ipc_layer_slot *slot = &ism->slots[icc->layers.slot_id];
-	struct ipc_layer_entry *layer = &slot->layers[icc->layers.layer_count];
+	struct ipc_layer_entry *layer = get_layer_entry(icc);
 	struct ipc_client_swapchain *xscn[XRT_MAX_VIEWS];
 	struct ipc_client_swapchain *d_xscn[XRT_MAX_VIEWS];
 	for (uint32_t i = 0; i < data->view_count; ++i) {
@@ -650,9 +738,7 @@ handle_layer(struct xrt_compositor *xc,
 
 	assert(data->type == type);
 
-	struct ipc_shared_memory *ism = icc->ipc_c->ism;
-	struct ipc_layer_slot *slot = &ism->slots[icc->layers.slot_id];
-	struct ipc_layer_entry *layer = &slot->layers[icc->layers.layer_count];
+	struct ipc_layer_entry *layer = get_layer_entry(icc);
 	struct ipc_client_swapchain *ics = ipc_client_swapchain(xsc);
 
 	layer->xdev_id = 0; //! @todo Real id.
@@ -720,9 +806,7 @@ ipc_compositor_layer_passthrough(struct xrt_compositor *xc, struct xrt_device *x
 
 	assert(data->type == XRT_LAYER_PASSTHROUGH);
 
-	struct ipc_shared_memory *ism = icc->ipc_c->ism;
-	struct ipc_layer_slot *slot = &ism->slots[icc->layers.slot_id];
-	struct ipc_layer_entry *layer = &slot->layers[icc->layers.layer_count];
+	struct ipc_layer_entry *layer = get_layer_entry(icc);
 
 	layer->xdev_id = 0; //! @todo Real id.
 	layer->data = *data;
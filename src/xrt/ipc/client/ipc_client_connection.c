@@ -55,6 +55,7 @@
 #endif // XRT_OS_ANDROID
 
 DEBUG_GET_ONCE_BOOL_OPTION(ipc_ignore_version, "IPC_IGNORE_VERSION", false)
+DEBUG_GET_ONCE_NUM_OPTION(ipc_extra_channels, "IPC_EXTRA_CHANNELS", 2)
 
 #ifdef XRT_OS_ANDROID
 
@@ -319,7 +320,7 @@ ipc_client_describe_client(struct ipc_connection *ipc_c, const struct xrt_applic
 	desc.info = *a_info;
 	desc.pid = pid; // Extra info.
 
-	xrt_result_t xret = ipc_call_instance_describe_client(ipc_c, &desc);
+	xrt_result_t xret = ipc_call_instance_describe_client(ipc_c, &desc, &ipc_c->client_index);
 	if (xret != XRT_SUCCESS) {
 		IPC_ERROR(ipc_c, "Failed to set instance description!");
 		return xret;
@@ -328,6 +329,40 @@ ipc_client_describe_client(struct ipc_connection *ipc_c, const struct xrt_applic
 	return XRT_SUCCESS;
 }
 
+static void
+ipc_client_open_channels(struct ipc_connection *ipc_c)
+{
+	long count = debug_get_num_option_ipc_extra_channels();
+	if (count > IPC_MAX_CLIENT_CHANNELS) {
+		count = IPC_MAX_CLIENT_CHANNELS;
+	}
+
+	for (long i = 0; i < count; i++) {
+		xrt_ipc_handle_t handle = XRT_IPC_HANDLE_INVALID;
+
+		xrt_result_t xret = ipc_call_instance_open_channel(ipc_c, &handle, 1);
+		if (xret == XRT_ERROR_NOT_IMPLEMENTED) {
+			return; // Not supported by the service on this platform.
+		}
+		if (xret != XRT_SUCCESS || !xrt_ipc_handle_is_valid(handle)) {
+			// Not fatal, calls are just spread over fewer channels.
+			IPC_WARN(ipc_c, "Failed to open extra channel, using %u.", ipc_c->channel_count);
+			return;
+		}
+
+		struct ipc_client_channel *ch = &ipc_c->channels[ipc_c->channel_count];
+		if (os_mutex_init(&ch->mutex) != 0) {
+			xrt_ipc_handle_close(handle);
+			IPC_ERROR(ipc_c, "Failed to init mutex!");
+			return;
+		}
+
+		ch->imc.ipc_handle = handle;
+		ch->imc.log_level = ipc_c->imc.log_level;
+		ipc_c->channel_count++;
+	}
+}
+
 
 /*
  *
@@ -335,6 +370,37 @@ ipc_client_describe_client(struct ipc_connection *ipc_c, const struct xrt_applic
  *
  */
 
+struct os_mutex *
+ipc_client_connection_acquire_channel(struct ipc_connection *ipc_c, struct ipc_message_channel **out_imc)
+{
+	// Fast path, the main channel is free.
+	if (os_mutex_trylock(&ipc_c->mutex) == 0) {
+		*out_imc = &ipc_c->imc;
+		return &ipc_c->mutex;
+	}
+
+	for (uint32_t i = 0; i < ipc_c->channel_count; i++) {
+		struct ipc_client_channel *ch = &ipc_c->channels[i];
+		if (os_mutex_trylock(&ch->mutex) == 0) {
+			*out_imc = &ch->imc;
+			return &ch->mutex;
+		}
+	}
+
+	// Everything is busy, wait on one, round robin to not pile up on the main channel.
+	uint32_t index = (uint32_t)xrt_atomic_s32_inc_return(&ipc_c->next_channel) % (ipc_c->channel_count + 1);
+	if (index == ipc_c->channel_count) {
+		os_mutex_lock(&ipc_c->mutex);
+		*out_imc = &ipc_c->imc;
+		return &ipc_c->mutex;
+	}
+
+	struct ipc_client_channel *ch = &ipc_c->channels[index];
+	os_mutex_lock(&ch->mutex);
+	*out_imc = &ch->imc;
+	return &ch->mutex;
+}
+
 xrt_result_t
 ipc_client_connection_init(struct ipc_connection *ipc_c,
                            enum u_logging_level log_level,
@@ -390,12 +456,14 @@ ipc_client_connection_init(struct ipc_connection *ipc_c,
 		goto err_fini; // Already logged.
 	}
 
-	// Do this last.
 	xret = ipc_client_describe_client(ipc_c, &i_info->app_info);
 	if (xret != XRT_SUCCESS) {
 		goto err_fini; // Already logged.
 	}
 
+	// Do this last, the extra channels are optional.
+	ipc_client_open_channels(ipc_c);
+
 	return XRT_SUCCESS;
 
 err_fini:
@@ -410,6 +478,12 @@ ipc_client_connection_fini(struct ipc_connection *ipc_c)
 	if (ipc_c->ism_handle != XRT_SHMEM_HANDLE_INVALID) {
 		/// @todo how to tear down the shared memory?
 	}
+	for (uint32_t i = 0; i < ipc_c->channel_count; i++) {
+		ipc_message_channel_close(&ipc_c->channels[i].imc);
+		os_mutex_destroy(&ipc_c->channels[i].mutex);
+	}
+	ipc_c->channel_count = 0;
+
 	ipc_message_channel_close(&ipc_c->imc);
 	os_mutex_destroy(&ipc_c->mutex);
 
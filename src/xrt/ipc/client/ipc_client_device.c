@@ -66,7 +66,6 @@ ipc_client_device_destroy(struct xrt_device *xdev)
 	u_var_remove_root(icd);
 
 	// We do not own these, so don't free them.
-	icd->base.inputs = NULL;
 	icd->base.outputs = NULL;
 
 	// Free this device with the helper.
@@ -76,10 +75,7 @@ ipc_client_device_destroy(struct xrt_device *xdev)
 static xrt_result_t
 ipc_client_device_update_inputs(struct xrt_device *xdev)
 {
-	ipc_client_device_t *icd = ipc_client_device(xdev);
-
-	xrt_result_t xret = ipc_call_device_update_input(icd->ipc_c, icd->device_id);
-	IPC_CHK_ALWAYS_RET(icd->ipc_c, xret, "ipc_call_device_update_input");
+	return ipc_client_xdev_update_inputs(ipc_client_xdev(xdev));
 }
 
 static void
@@ -88,15 +84,7 @@ ipc_client_device_get_tracked_pose(struct xrt_device *xdev,
                                    int64_t at_timestamp_ns,
                                    struct xrt_space_relation *out_relation)
 {
-	ipc_client_device_t *icd = ipc_client_device(xdev);
-
-	xrt_result_t xret = ipc_call_device_get_tracked_pose( //
-	    icd->ipc_c,                                       //
-	    icd->device_id,                                   //
-	    name,                                             //
-	    at_timestamp_ns,                                  //
-	    out_relation);                                    //
-	IPC_CHK_ONLY_PRINT(icd->ipc_c, xret, "ipc_call_device_get_tracked_pose");
+	ipc_client_xdev_get_tracked_pose(ipc_client_xdev(xdev), name, at_timestamp_ns, out_relation);
 }
 
 static void
@@ -211,7 +199,7 @@ ipc_client_device_create(struct ipc_connection *ipc_c, struct xrt_tracking_origi
 
 	// Allocate and setup the basics.
 	enum u_device_alloc_flags flags = (enum u_device_alloc_flags)(U_DEVICE_ALLOC_HMD);
-	ipc_client_device_t *icd = U_DEVICE_ALLOCATE(ipc_client_device_t, flags, 0, 0);
+	ipc_client_device_t *icd = U_DEVICE_ALLOCATE(ipc_client_device_t, flags, isdev->input_count, 0);
 	icd->ipc_c = ipc_c;
 	icd->base.update_inputs = ipc_client_device_update_inputs;
 	icd->base.get_tracked_pose = ipc_client_device_get_tracked_pose;
@@ -233,10 +221,10 @@ ipc_client_device_create(struct ipc_connection *ipc_c, struct xrt_tracking_origi
 	snprintf(icd->base.str, XRT_DEVICE_NAME_LEN, "%s", isdev->str);
 	snprintf(icd->base.serial, XRT_DEVICE_NAME_LEN, "%s", isdev->serial);
 
-	// Setup inputs, by pointing directly to the shared memory.
-	assert(isdev->input_count > 0);
-	icd->base.inputs = &ism->inputs[isdev->first_input_index];
-	icd->base.input_count = isdev->input_count;
+	// Inputs are copied out of the shared memory on update.
+	assert(icd->base.input_count > 0);
+	size_t size = sizeof(struct xrt_input) * isdev->input_count;
+	memcpy(icd->base.inputs, &ism->inputs[isdev->first_input_index], size);
 
 	// Setup outputs, if any point directly into the shared memory.
 	icd->base.output_count = isdev->output_count;
@@ -133,7 +133,6 @@ ipc_client_hmd_destroy(struct xrt_device *xdev)
 	u_var_remove_root(ich);
 
 	// We do not own these, so don't free them.
-	ich->base.inputs = NULL;
 	ich->base.outputs = NULL;
 
 	// Free this device with the helper.
@@ -143,10 +142,7 @@ ipc_client_hmd_destroy(struct xrt_device *xdev)
 static xrt_result_t
 ipc_client_hmd_update_inputs(struct xrt_device *xdev)
 {
-	ipc_client_hmd_t *ich = ipc_client_hmd(xdev);
-
-	xrt_result_t xret = ipc_call_device_update_input(ich->ipc_c, ich->device_id);
-	IPC_CHK_ALWAYS_RET(ich->ipc_c, xret, "ipc_call_device_update_input");
+	return ipc_client_xdev_update_inputs(ipc_client_xdev(xdev));
 }
 
 static void
@@ -155,16 +151,7 @@ ipc_client_hmd_get_tracked_pose(struct xrt_device *xdev,
                                 int64_t at_timestamp_ns,
                                 struct xrt_space_relation *out_relation)
 {
-	ipc_client_hmd_t *ich = ipc_client_hmd(xdev);
-	xrt_result_t xret;
-
-	xret = ipc_call_device_get_tracked_pose( //
-	    ich->ipc_c,                          //
-	    ich->device_id,                      //
-	    name,                                //
-	    at_timestamp_ns,                     //
-	    out_relation);                       //
-	IPC_CHK_ONLY_PRINT(ich->ipc_c, xret, "ipc_call_device_get_tracked_pose");
+	ipc_client_xdev_get_tracked_pose(ipc_client_xdev(xdev), name, at_timestamp_ns, out_relation);
 }
 
 static void
@@ -324,7 +311,7 @@ ipc_client_hmd_create(struct ipc_connection *ipc_c, struct xrt_tracking_origin *
 
 
 	enum u_device_alloc_flags flags = (enum u_device_alloc_flags)(U_DEVICE_ALLOC_HMD);
-	ipc_client_hmd_t *ich = U_DEVICE_ALLOCATE(ipc_client_hmd_t, flags, 0, 0);
+	ipc_client_hmd_t *ich = U_DEVICE_ALLOCATE(ipc_client_hmd_t, flags, isdev->input_count, 0);
 	ich->ipc_c = ipc_c;
 	ich->device_id = device_id;
 	ich->base.update_inputs = ipc_client_hmd_update_inputs;
@@ -345,10 +332,10 @@ ipc_client_hmd_create(struct ipc_connection *ipc_c, struct xrt_tracking_origin *
 	snprintf(ich->base.str, XRT_DEVICE_NAME_LEN, "%s", isdev->str);
 	snprintf(ich->base.serial, XRT_DEVICE_NAME_LEN, "%s", isdev->serial);
 
-	// Setup inputs, by pointing directly to the shared memory.
-	assert(isdev->input_count > 0);
-	ich->base.inputs = &ism->inputs[isdev->first_input_index];
-	ich->base.input_count = isdev->input_count;
+	// Inputs are copied out of the shared memory on update.
+	assert(ich->base.input_count > 0);
+	size_t size = sizeof(struct xrt_input) * isdev->input_count;
+	memcpy(ich->base.inputs, &ism->inputs[isdev->first_input_index], size);
 
 #if 0
 	// Setup info.
@@ -10,6 +10,8 @@
 #include "xrt/xrt_defines.h"
 #include "xrt/xrt_session.h"
 
+#include "shared/ipc_protocol.h"
+#include "client/ipc_client.h"
 #include "ipc_client_generated.h"
 
 
@@ -46,13 +48,63 @@ ipc_session(struct xrt_session *xs)
  *
  */
 
+/*!
+ * Take the oldest event out of the ring the server forwards our events to,
+ * returns false if the ring is empty.
+ */
+static bool
+pop_ring_event(struct ipc_shared_event_ring *ring, union xrt_session_event *out_xse)
+{
+	while (true) {
+		uint32_t read_index = (uint32_t)xrt_atomic_s32_load(&ring->read_index);
+		uint32_t write_index = (uint32_t)xrt_atomic_s32_load(&ring->write_index);
+		if (read_index == write_index) {
+			return false;
+		}
+
+		/*
+		 * The server does not reuse the slot until the read index moves
+		 * past it, so the copy is good if we are the ones moving it.
+		 * Only needed if the app polls from more than one thread.
+		 */
+		*out_xse = ring->events[read_index % IPC_EVENT_QUEUE_SIZE];
+
+		int32_t old = (int32_t)read_index;
+		if (xrt_atomic_s32_cmpxchg(&ring->read_index, old, (int32_t)(read_index + 1)) == old) {
+			return true;
+		}
+	}
+}
+
 static xrt_result_t
 ipc_client_session_poll_events(struct xrt_session *xs, union xrt_session_event *out_xse)
 {
 	struct ipc_client_session *ics = ipc_session(xs);
+	struct ipc_connection *ipc_c = ics->ipc_c;
+	struct ipc_shared_event_ring *ring = &ipc_c->ism->events[ipc_c->client_index];
 	xrt_result_t xret;
 
-	xret = ipc_call_session_poll_events(ics->ipc_c, out_xse);
+	if (xrt_atomic_s32_load(&ring->active) != 0) {
+		/*
+		 * Load the overflow flag before looking at the ring, any event
+		 * the server put in the ring before setting it is then visible
+		 * and is older than the ones it held back.
+		 */
+		bool overflow = xrt_atomic_s32_load(&ring->overflow) != 0;
+
+		if (pop_ring_event(ring, out_xse)) {
+			return XRT_SUCCESS;
+		}
+
+		// The common case, no event and nothing held back.
+		if (!overflow) {
+			U_ZERO(out_xse);
+			out_xse->type = XRT_SESSION_EVENT_NONE;
+			return XRT_SUCCESS;
+		}
+	}
+
+	xret = ipc_call_session_poll_events(ipc_c, out_xse);
 	IPC_CHK_ALWAYS_RET(ics->ipc_c, xret, "ipc_call_session_poll_events");
 }
 
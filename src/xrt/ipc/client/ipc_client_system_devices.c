@@ -87,6 +87,14 @@ ipc_client_system_devices_feature_dec(struct xrt_system_devices *xsysd, enum xrt
 	IPC_CHK_ALWAYS_RET(usysd->ipc_c, xret, "ipc_call_system_devices_end_feature");
 }
 
+static xrt_result_t
+ipc_client_system_devices_update_inputs(struct xrt_system_devices *xsysd)
+{
+	struct ipc_client_system_devices *usysd = ipc_system_devices(xsysd);
+
+	return ipc_client_xdev_update_inputs_batch(usysd->ipc_c, xsysd->xdevs, xsysd->xdev_count);
+}
+
 
 static void
 ipc_client_system_devices_destroy(struct xrt_system_devices *xsysd)
@@ -113,6 +121,7 @@ ipc_client_system_devices_create(struct ipc_connection *ipc_c)
 	icsd->base.base.destroy = ipc_client_system_devices_destroy;
 	icsd->base.base.feature_inc = ipc_client_system_devices_feature_inc;
 	icsd->base.base.feature_dec = ipc_client_system_devices_feature_dec;
+	icsd->base.base.update_inputs = ipc_client_system_devices_update_inputs;
 	icsd->ipc_c = ipc_c;
 
 	return &icsd->base.base;
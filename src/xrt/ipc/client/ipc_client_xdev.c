@@ -0,0 +1,331 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Shared functions for IPC client @ref xrt_device.
+ * @ingroup ipc_client
+ */
+
+#include "xrt/xrt_device.h"
+
+#include "math/m_predict.h"
+
+#include "util/u_misc.h"
+#include "util/u_time.h"
+
+#include "client/ipc_client.h"
+#include "ipc_client_generated.h"
+
+#include <string.h>
+#include <assert.h>
+
+
+/*
+ *
+ * Defines.
+ *
+ */
+
+/*!
+ * How many times a reader retries when the server is writing the state, the
+ * write side is only a couple of small copies so this is plenty.
+ */
+#define MAX_READ_TRIES 16
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+static inline bool
+is_publisher_running(struct ipc_shared_memory *ism)
+{
+	return xrt_atomic_s32_load(&ism->publisher.running) != 0;
+}
+
+/*!
+ * Sets a flag in the shared memory, only writes when not already set so the
+ * cache line isn't bounced between clients that read the same device.
+ */
+static inline void
+set_flag(xrt_atomic_s32_t *flag)
+{
+	if (xrt_atomic_s32_load(flag) == 0) {
+		xrt_atomic_s32_store(flag, 1);
+	}
+}
+
+/*!
+ * The order of the pose input among the pose inputs of the device, which is
+ * how the publisher indexes @ref ipc_shared_publisher::poses_wanted.
+ */
+static int32_t
+find_pose_index(struct ipc_client_xdev *icx, enum xrt_input_name name)
+{
+	int32_t pose_index = 0;
+
+	for (uint32_t i = 0; i < icx->base.input_count && pose_index < IPC_SHARED_MAX_DEVICE_RELATIONS; i++) {
+		enum xrt_input_name input_name = icx->base.inputs[i].name;
+		if (XRT_GET_INPUT_TYPE(input_name) != XRT_INPUT_TYPE_POSE) {
+			continue;
+		}
+
+		if (input_name == name) {
+			return pose_index;
+		}
+
+		pose_index++;
+	}
+
+	return -1;
+}
+
+/*!
+ * Copies the published inputs and state of the device, returns false if a
+ * consistent copy could not be made.
+ */
+static bool
+read_published(struct ipc_client_xdev *icx,
+               struct xrt_input *out_inputs,
+               struct ipc_shared_device_state *out_state)
+{
+	struct ipc_shared_memory *ism = icx->ipc_c->ism;
+	struct ipc_shared_device *isdev = &ism->isdevs[icx->device_id];
+	struct ipc_shared_device_state *state = &ism->publisher.states[icx->device_id];
+	const struct xrt_input *src = &ism->publisher.inputs[isdev->first_input_index];
+
+	for (uint32_t i = 0; i < MAX_READ_TRIES; i++) {
+		int32_t before = xrt_atomic_s32_load(&state->seq);
+		if ((before & 1) != 0) {
+			continue; // Server is writing.
+		}
+
+		if (out_inputs != NULL) {
+			memcpy(out_inputs, src, sizeof(struct xrt_input) * isdev->input_count);
+		}
+		memcpy(out_state, (const void *)state, sizeof(*out_state));
+
+		// Make sure all of the reads above are done before checking.
+		xrt_atomic_thread_fence();
+
+		int32_t after = xrt_atomic_s32_load(&state->seq);
+		if (before == after) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool
+is_io_active(struct ipc_client_xdev *icx, const struct ipc_shared_device_state *state)
+{
+	struct ipc_shared_memory *ism = icx->ipc_c->ism;
+
+	return state->io_active && ism->publisher.client_io_active[icx->ipc_c->client_index];
+}
+
+/*!
+ * Mirrors what the server does in ipc_handle_device_update_input when the IO
+ * of the client or device has been turned off.
+ */
+static void
+suppress_inputs(struct xrt_input *inputs, uint32_t input_count)
+{
+	for (uint32_t i = 0; i < input_count; i++) {
+		enum xrt_input_name name = inputs[i].name;
+		bool active = inputs[i].active;
+
+		U_ZERO(&inputs[i]);
+		inputs[i].name = name;
+
+		// Special case the rotation of the head.
+		if (name == XRT_INPUT_GENERIC_HEAD_POSE) {
+			inputs[i].active = active;
+		}
+	}
+}
+
+static void
+copy_inputs_from_shm(struct ipc_client_xdev *icx)
+{
+	struct ipc_shared_memory *ism = icx->ipc_c->ism;
+	struct ipc_shared_device *isdev = &ism->isdevs[icx->device_id];
+
+	memcpy(icx->base.inputs, &ism->inputs[isdev->first_input_index],
+	       sizeof(struct xrt_input) * isdev->input_count);
+}
+
+static xrt_result_t
+update_inputs_with_call(struct ipc_client_xdev *icx)
+{
+	xrt_result_t xret = ipc_call_device_update_input(icx->ipc_c, icx->device_id);
+	IPC_CHK_AND_RET(icx->ipc_c, xret, "ipc_call_device_update_input");
+
+	// The server has written the inputs to the shared memory.
+	copy_inputs_from_shm(icx);
+
+	return XRT_SUCCESS;
+}
+
+/*!
+ * Tries to update the inputs from the published state, returns false if the
+ * device needs to be updated with a call.
+ */
+static bool
+update_inputs_from_published(struct ipc_client_xdev *icx)
+{
+	struct ipc_shared_memory *ism = icx->ipc_c->ism;
+	struct ipc_shared_device_state state;
+
+	if (!is_publisher_running(ism)) {
+		return false;
+	}
+
+	// Have the publisher update the inputs of this device from now on.
+	set_flag(&ism->publisher.inputs_wanted[icx->device_id]);
+
+	// A failed read is overwritten by the call, so read straight into the inputs.
+	if (!read_published(icx, icx->base.inputs, &state) || !state.inputs_valid) {
+		return false;
+	}
+
+	if (!is_io_active(icx, &state)) {
+		suppress_inputs(icx->base.inputs, icx->base.input_count);
+	}
+
+	// Validate poses against the published inputs on the server.
+	set_flag(&ism->publisher.client_inputs_published[icx->ipc_c->client_index][icx->device_id]);
+
+	return true;
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
+xrt_result_t
+ipc_client_xdev_update_inputs(struct ipc_client_xdev *icx)
+{
+	if (update_inputs_from_published(icx)) {
+		return XRT_SUCCESS;
+	}
+
+	return update_inputs_with_call(icx);
+}
+
+xrt_result_t
+ipc_client_xdev_update_inputs_batch(struct ipc_connection *ipc_c, struct xrt_device **xdevs, size_t xdev_count)
+{
+	struct ipc_client_xdev *icxs[XRT_SYSTEM_MAX_DEVICES];
+	struct ipc_device_id_list devices = {0};
+	struct ipc_device_result_list results = {0};
+
+	assert(xdev_count <= XRT_SYSTEM_MAX_DEVICES);
+
+	// Only the devices that couldn't be read from the published state need a call.
+	for (size_t i = 0; i < xdev_count; i++) {
+		if (xdevs[i] == NULL) {
+			continue;
+		}
+
+		struct ipc_client_xdev *icx = ipc_client_xdev(xdevs[i]);
+		if (update_inputs_from_published(icx)) {
+			continue;
+		}
+
+		icxs[devices.id_count] = icx;
+		devices.ids[devices.id_count++] = icx->device_id;
+	}
+
+	if (devices.id_count == 0) {
+		return XRT_SUCCESS;
+	}
+
+	xrt_result_t xret = ipc_call_device_update_input_batch(ipc_c, &devices, &results);
+	IPC_CHK_AND_RET(ipc_c, xret, "ipc_call_device_update_input_batch");
+
+	if (results.result_count != devices.id_count) {
+		IPC_ERROR(ipc_c, "Got %u results for %u devices", results.result_count, devices.id_count);
+		return XRT_ERROR_IPC_FAILURE;
+	}
+
+	// Return the first error, but still copy the inputs of the other devices.
+	xrt_result_t first_error = XRT_SUCCESS;
+	for (uint32_t i = 0; i < devices.id_count; i++) {
+		xrt_result_t device_xret = results.results[i];
+		if (device_xret != XRT_SUCCESS) {
+			IPC_ERROR(ipc_c, "Failed to update inputs of device %u", devices.ids[i]);
+			if (first_error == XRT_SUCCESS) {
+				first_error = device_xret;
+			}
+			continue;
+		}
+
+		// The server has written the inputs to the shared memory.
+		copy_inputs_from_shm(icxs[i]);
+	}
+
+	return first_error;
+}
+
+void
+ipc_client_xdev_get_tracked_pose(struct ipc_client_xdev *icx,
+                                 enum xrt_input_name name,
+                                 int64_t at_timestamp_ns,
+                                 struct xrt_space_relation *out_relation)
+{
+	struct ipc_shared_memory *ism = icx->ipc_c->ism;
+	struct ipc_shared_device_state state;
+
+	// Only pose inputs the publisher can sample, it has room for so many.
+	int32_t pose_index = find_pose_index(icx, name);
+	bool use_published = pose_index >= 0 && is_publisher_running(ism);
+
+	// Have the publisher sample this pose from now on.
+	if (use_published) {
+		set_flag(&ism->publisher.poses_wanted[icx->device_id][pose_index]);
+	}
+
+	/*
+	 * The server decides what a disabled pose returns, so only use the
+	 * published state when the IO is active, the call handles the rest.
+	 */
+	if (use_published && read_published(icx, NULL, &state) && is_io_active(icx, &state)) {
+		for (uint32_t i = 0; i < state.relation_count; i++) {
+			const struct ipc_shared_relation *rel = &state.relations[i];
+			if (rel->name != name) {
+				continue;
+			}
+
+			// Predict over the real delta, apps ask for the predicted display time.
+			int64_t delta_ns = at_timestamp_ns - rel->timestamp_ns;
+			if (delta_ns > IPC_SHARED_MAX_RELATION_PREDICTION_NS ||
+			    delta_ns < -IPC_SHARED_MAX_RELATION_PREDICTION_NS) {
+				break;
+			}
+
+			if (delta_ns == 0) {
+				*out_relation = rel->relation;
+				return;
+			}
+
+			double delta_s = time_ns_to_s(delta_ns);
+			m_predict_relation(&rel->relation, delta_s, out_relation);
+			return;
+		}
+	}
+
+	xrt_result_t xret = ipc_call_device_get_tracked_pose( //
+	    icx->ipc_c,                                       //
+	    icx->device_id,                                   //
+	    name,                                             //
+	    at_timestamp_ns,                                  //
+	    out_relation);                                    //
+	IPC_CHK_ONLY_PRINT(icx->ipc_c, xret, "ipc_call_device_get_tracked_pose");
+}
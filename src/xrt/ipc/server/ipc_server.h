@@ -19,6 +19,7 @@
 #include "os/os_threading.h"
 
 #include "util/u_logging.h"
+#include "util/u_live_stats.h"
 
 #include "shared/ipc_protocol.h"
 #include "shared/ipc_message_channel.h"
@@ -50,12 +51,12 @@ extern "C" {
  */
 
 #define IPC_MAX_CLIENT_SEMAPHORES 8
-#define IPC_MAX_CLIENT_SWAPCHAINS (XRT_MAX_LAYERS * 2)
 #define IPC_MAX_CLIENT_SPACES 128
 
 struct xrt_instance;
 struct xrt_compositor;
 struct xrt_compositor_native;
+struct u_session_event;
 
 
 /*!
@@ -73,6 +74,48 @@ struct ipc_swapchain_data
 	bool active;
 };
 
+/*!
+ * An extra channel opened by a client, served by its own thread so that a
+ * call blocking on one channel does not stall the client's other channels.
+ *
+ * @ingroup ipc_server
+ */
+struct ipc_client_channel_state
+{
+	//! The client this channel belongs to.
+	volatile struct ipc_client_state *ics;
+
+	//! Server end of the channel.
+	struct ipc_message_channel imc;
+
+	//! Client end, closed once it has been sent to the client.
+	xrt_ipc_handle_t client_handle;
+
+	struct os_thread thread;
+};
+
+/*!
+ * Receives the session events of a client and writes them into its
+ * @ref ipc_shared_event_ring, events that do not fit are queued here until
+ * the client polls for them.
+ *
+ * @ingroup ipc_server
+ * @implements xrt_session_event_sink
+ */
+struct ipc_client_event_sink
+{
+	struct xrt_session_event_sink base;
+
+	//! The ring in the shared memory, NULL if the session can not forward events.
+	struct ipc_shared_event_ring *ring;
+
+	//! Protects @ref overflow, the session serializes the pushes.
+	struct os_mutex mutex;
+
+	//! Events that did not fit in the ring, oldest first.
+	struct u_session_event *overflow;
+};
+
 /*!
  * Holds the state for a single client.
  *
@@ -107,6 +150,9 @@ struct ipc_client_state
 	//! Ptrs to the semaphores.
 	struct xrt_compositor_semaphore *xcsems[IPC_MAX_CLIENT_SEMAPHORES];
 
+	//! Layers copied out of the shared memory during a layer sync.
+	struct ipc_layer_entry layers[IPC_MAX_LAYERS];
+
 	struct
 	{
 		uint32_t root;
@@ -138,8 +184,27 @@ struct ipc_client_state
 	//! Socket fd used for client comms
 	struct ipc_message_channel imc;
 
+	//! Extra channels opened by the client, see @ref ipc_client_channel_state.
+	struct ipc_client_channel_state channels[IPC_MAX_CLIENT_CHANNELS];
+	uint32_t channel_count;
+
+	//! Set on shutdown, no more channels can be opened.
+	bool channels_closed;
+
+	//! Serializes calls across all channels, except calls that may block.
+	struct os_mutex dispatch_lock;
+
+	//! Calls that may block currently running without @ref dispatch_lock, protected by it.
+	uint32_t blocking_call_count;
+
+	//! Signalled when @ref blocking_call_count drops to zero.
+	struct os_cond blocking_call_cond;
+
 	struct ipc_app_state client_state;
 
+	//! Forwards the session events into the shared memory.
+	struct ipc_client_event_sink event_sink;
+
 	int server_thread_index;
 };
 
@@ -350,6 +415,12 @@ struct ipc_server
 	struct ipc_shared_memory *ism;
 	xrt_shmem_handle_t ism_handle;
 
+	//! Thread publishing device inputs and poses to @ref ipc_shared_publisher.
+	struct os_thread_helper publisher;
+
+	//! Number of clients with an active session, the publisher idles at zero, protected by @ref publisher.
+	uint32_t publisher_session_count;
+
 	struct ipc_server_mainloop ml;
 
 	// Is the mainloop supposed to run.
@@ -367,6 +438,18 @@ struct ipc_server
 	//! Generator for IDs.
 	uint32_t id_generator;
 
+	//! Latency of calls, reported by the mainloop.
+	struct
+	{
+		//! Time to serve non-blocking calls, added to by all client threads.
+		struct u_live_stats_hist *call_hist;
+
+		//! Last report, shown in the debug UI.
+		struct u_live_stats_hist_report call;
+
+		int64_t last_report_ns;
+	} stats;
+
 	struct
 	{
 		int active_client_index;
@@ -440,6 +523,37 @@ ipc_server_client_thread(void *_ics);
 void
 ipc_server_client_destroy_session_and_compositor(volatile struct ipc_client_state *ics);
 
+/*!
+ * Start forwarding the session events of this client into its event ring in
+ * the shared memory, the session must have been created.
+ */
+void
+ipc_server_client_start_events(volatile struct ipc_client_state *ics);
+
+/*!
+ * Pop an event for this client that did not fit in its event ring, or one
+ * from the session if the events are not forwarded.
+ */
+xrt_result_t
+ipc_server_client_poll_event(volatile struct ipc_client_state *ics, union xrt_session_event *out_xse);
+
+/*!
+ * Wait until no call that may block is running for this client, the calls
+ * use the compositor and swapchains without holding the dispatch lock so they
+ * must not be destroyed under them. Must be called with the dispatch lock held.
+ */
+void
+ipc_server_client_wait_for_blocking_calls_locked(volatile struct ipc_client_state *ics);
+
+/*!
+ * Open an extra channel for this client and start a thread serving it.
+ *
+ * @param ics            Client state.
+ * @param[out] out_handle Client end of the channel, to be sent to the client.
+ */
+xrt_result_t
+ipc_server_client_open_channel(volatile struct ipc_client_state *ics, xrt_ipc_handle_t *out_handle);
+
 /*!
  * @defgroup ipc_server_internals Server Internals
  * @brief These are only called by the platform-specific mainloop polling code.
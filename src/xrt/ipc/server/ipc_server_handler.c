@@ -15,6 +15,7 @@
 #include "util/u_visibility_mask.h"
 #include "util/u_trace_marker.h"
 
+#include "shared/ipc_utils.h"
 #include "server/ipc_server.h"
 #include "ipc_server_generated.h"
 
@@ -100,6 +101,38 @@ set_swapchain_info(volatile struct ipc_client_state *ics,
 	ics->swapchain_data[index].height = info->height;
 	ics->swapchain_data[index].format = info->format;
 	ics->swapchain_data[index].image_count = xsc->image_count;
+
+	/*
+	 * Mirror the image use counters into shared memory, so the client can
+	 * wait for images without a round trip. Acquire and release are done
+	 * by the client on its own, if the swapchain can not be mirrored it
+	 * still calls us for waits.
+	 */
+	struct ipc_shared_swapchain *iss = &ics->server->ism->swapchains[ics->server_thread_index][index];
+	xrt_atomic_s32_store(&iss->mirrored, 0);
+
+	xrt_result_t xret = xrt_swapchain_set_use_mirror(xsc, iss->use_counts);
+	if (xret == XRT_SUCCESS) {
+		xrt_atomic_s32_store(&iss->mirrored, 1);
+	} else {
+		IPC_TRACE(ics->server, "Swapchain %u does not support mirroring image use.", index);
+	}
+}
+
+static void
+drop_swapchain(volatile struct ipc_client_state *ics, uint32_t index)
+{
+	// Cast away volatile.
+	struct xrt_swapchain **xsc_ptr = (struct xrt_swapchain **)&ics->xscs[index];
+
+	// The compositor might hold the swapchain after we drop it, stop mirroring first.
+	if (*xsc_ptr != NULL) {
+		xrt_swapchain_set_use_mirror(*xsc_ptr, NULL);
+	}
+
+	// Drop our reference, does NULL checking.
+	xrt_swapchain_reference(xsc_ptr, NULL);
+	ics->swapchain_data[index].active = false;
 }
 
 static xrt_result_t
@@ -296,9 +329,31 @@ ipc_handle_instance_get_shm_fd(volatile struct ipc_client_state *ics,
 	return XRT_SUCCESS;
 }
 
+xrt_result_t
+ipc_handle_instance_open_channel(volatile struct ipc_client_state *ics,
+                                 uint32_t max_handle_capacity,
+                                 xrt_ipc_handle_t *out_handles,
+                                 uint32_t *out_handle_count)
+{
+	IPC_TRACE_MARKER();
+
+	assert(max_handle_capacity >= 1);
+
+	xrt_result_t xret = ipc_server_client_open_channel(ics, &out_handles[0]);
+	if (xret != XRT_SUCCESS) {
+		*out_handle_count = 0;
+		return xret;
+	}
+
+	*out_handle_count = 1;
+
+	return XRT_SUCCESS;
+}
+
 xrt_result_t
 ipc_handle_instance_describe_client(volatile struct ipc_client_state *ics,
-                                    const struct ipc_client_description *client_desc)
+                                    const struct ipc_client_description *client_desc,
+                                    uint32_t *out_client_index)
 {
 	ics->client_state.info = client_desc->info;
 	ics->client_state.pid = client_desc->pid;
@@ -338,6 +393,9 @@ ipc_handle_instance_describe_client(volatile struct ipc_client_state *ics,
 	// Log the pretty message.
 	IPC_INFO(ics->server, "%s", sink.buffer);
 
+	// Used by the client to find its state in the shared memory.
+	*out_client_index = (uint32_t)ics->server_thread_index;
+
 	return XRT_SUCCESS;
 }
 
@@ -381,6 +439,9 @@ ipc_handle_session_create(volatile struct ipc_client_state *ics,
 	ics->xs = xs;
 	ics->xc = &xcn->base;
 
+	// Lets the client poll events without a round trip.
+	ipc_server_client_start_events(ics);
+
 	xrt_syscomp_set_state(ics->server->xsysc, ics->xc, ics->client_state.session_visible,
 	                      ics->client_state.session_focused);
 	xrt_syscomp_set_z_order(ics->server->xsysc, ics->xc, ics->client_state.z_order);
@@ -396,7 +457,7 @@ ipc_handle_session_poll_events(volatile struct ipc_client_state *ics, union xrt_
 		return XRT_ERROR_IPC_SESSION_NOT_CREATED;
 	}
 
-	return xrt_session_poll_events(ics->xs, out_xse);
+	return ipc_server_client_poll_event(ics, out_xse);
 }
 
 xrt_result_t
@@ -456,6 +517,9 @@ ipc_handle_session_destroy(volatile struct ipc_client_state *ics)
 		return XRT_ERROR_IPC_SESSION_NOT_CREATED;
 	}
 
+	// Blocking calls on other channels use the compositor.
+	ipc_server_client_wait_for_blocking_calls_locked(ics);
+
 	ipc_server_client_destroy_session_and_compositor(ics);
 
 	return XRT_SUCCESS;
@@ -1246,12 +1310,15 @@ _update_passthrough_layer(struct xrt_compositor *xc,
 }
 
 static bool
-_update_layers(volatile struct ipc_client_state *ics, struct xrt_compositor *xc, struct ipc_layer_slot *slot)
+_update_layers(volatile struct ipc_client_state *ics,
+               struct xrt_compositor *xc,
+               struct ipc_layer_entry *layers,
+               uint32_t layer_count)
 {
 	IPC_TRACE_MARKER();
 
-	for (uint32_t i = 0; i < slot->layer_count; i++) {
-		volatile struct ipc_layer_entry *layer = &slot->layers[i];
+	for (uint32_t i = 0; i < layer_count; i++) {
+		volatile struct ipc_layer_entry *layer = &layers[i];
 
 		switch (layer->data.type) {
 		case XRT_LAYER_PROJECTION:
@@ -1301,6 +1368,32 @@ _update_layers(volatile struct ipc_client_state *ics, struct xrt_compositor *xc,
 	return true;
 }
 
+/*!
+ * Copies the slot header and the layers the client wrote out of the shared
+ * memory, only the layers actually submitted are copied.
+ */
+static xrt_result_t
+_copy_layer_slot(volatile struct ipc_client_state *ics, uint32_t slot_id, struct ipc_layer_slot *out_slot)
+{
+	if (slot_id >= IPC_MAX_SLOTS) {
+		IPC_ERROR(ics->server, "Invalid slot_id %u!", slot_id);
+		return XRT_ERROR_IPC_FAILURE;
+	}
+
+	struct ipc_shared_memory *ism = ics->server->ism;
+	uint32_t client_index = (uint32_t)ics->server_thread_index;
+
+	// Cast away volatile.
+	struct ipc_layer_entry *layers = (struct ipc_layer_entry *)ics->layers;
+
+	if (!ipc_layer_slot_copy(&ism->slots[slot_id], ism->layers[client_index], out_slot, layers)) {
+		IPC_ERROR(ics->server, "Invalid layer_count %u!", out_slot->layer_count);
+		return XRT_ERROR_IPC_FAILURE;
+	}
+
+	return XRT_SUCCESS;
+}
+
 xrt_result_t
 ipc_handle_compositor_layer_sync(volatile struct ipc_client_state *ics,
                                  uint32_t slot_id,
@@ -1314,8 +1407,6 @@ ipc_handle_compositor_layer_sync(volatile struct ipc_client_state *ics,
 		return XRT_ERROR_IPC_SESSION_NOT_CREATED;
 	}
 
-	struct ipc_shared_memory *ism = ics->server->ism;
-	struct ipc_layer_slot *slot = &ism->slots[slot_id];
 	xrt_graphics_sync_handle_t sync_handle = XRT_GRAPHICS_SYNC_HANDLE_INVALID;
 
 	// If we have one or more save the first handle.
@@ -1331,7 +1422,12 @@ ipc_handle_compositor_layer_sync(volatile struct ipc_client_state *ics,
 	}
 
 	// Copy current slot data.
-	struct ipc_layer_slot copy = *slot;
+	struct ipc_layer_slot copy;
+	xrt_result_t xret = _copy_layer_slot(ics, slot_id, &copy);
+	if (xret != XRT_SUCCESS) {
+		u_graphics_sync_unref(&sync_handle);
+		return xret;
+	}
 
 
 	/*
@@ -1340,7 +1436,8 @@ ipc_handle_compositor_layer_sync(volatile struct ipc_client_state *ics,
 
 	xrt_comp_layer_begin(ics->xc, &copy.data);
 
-	_update_layers(ics, ics->xc, &copy);
+	// Cast away volatile.
+	_update_layers(ics, ics->xc, (struct ipc_layer_entry *)ics->layers, copy.layer_count);
 
 	xrt_comp_layer_commit(ics->xc, sync_handle);
 
@@ -1382,12 +1479,12 @@ ipc_handle_compositor_layer_sync_with_semaphore(volatile struct ipc_client_state
 
 	struct xrt_compositor_semaphore *xcsem = ics->xcsems[semaphore_id];
 
-	struct ipc_shared_memory *ism = ics->server->ism;
-	struct ipc_layer_slot *slot = &ism->slots[slot_id];
-
 	// Copy current slot data.
-	struct ipc_layer_slot copy = *slot;
-
+	struct ipc_layer_slot copy;
+	xrt_result_t xret = _copy_layer_slot(ics, slot_id, &copy);
+	if (xret != XRT_SUCCESS) {
+		return xret;
+	}
 
 
 	/*
@@ -1396,7 +1493,8 @@ ipc_handle_compositor_layer_sync_with_semaphore(volatile struct ipc_client_state
 
 	xrt_comp_layer_begin(ics->xc, &copy.data);
 
-	_update_layers(ics, ics->xc, &copy);
+	// Cast away volatile.
+	_update_layers(ics, ics->xc, (struct ipc_layer_entry *)ics->layers, copy.layer_count);
 
 	xrt_comp_layer_commit_with_semaphore(ics->xc, xcsem, semaphore_value);
 
@@ -1758,11 +1856,12 @@ ipc_handle_swapchain_destroy(volatile struct ipc_client_state *ics, uint32_t id)
 		return XRT_ERROR_IPC_SESSION_NOT_CREATED;
 	}
 
+	// A wait on another channel might be using it.
+	ipc_server_client_wait_for_blocking_calls_locked(ics);
+
 	ics->swapchain_count--;
 
-	// Drop our reference, does NULL checking. Cast away volatile.
-	xrt_swapchain_reference((struct xrt_swapchain **)&ics->xscs[id], NULL);
-	ics->swapchain_data[id].active = false;
+	drop_swapchain(ics, id);
 
 	return XRT_SUCCESS;
 }
@@ -1846,11 +1945,9 @@ ipc_handle_compositor_semaphore_destroy(volatile struct ipc_client_state *ics, u
  *
  */
 
-xrt_result_t
-ipc_handle_device_update_input(volatile struct ipc_client_state *ics, uint32_t id)
+static xrt_result_t
+update_device_input(volatile struct ipc_client_state *ics, uint32_t device_id)
 {
-	// To make the code a bit more readable.
-	uint32_t device_id = id;
 	struct ipc_shared_memory *ism = ics->server->ism;
 	struct ipc_device *idev = get_idev(ics, device_id);
 	struct xrt_device *xdev = idev->xdev;
@@ -1863,6 +1960,9 @@ ipc_handle_device_update_input(volatile struct ipc_client_state *ics, uint32_t i
 		return xret;
 	}
 
+	// The client reads this copy now, see find_input.
+	xrt_atomic_s32_store(&ism->publisher.client_inputs_published[ics->server_thread_index][device_id], 0);
+
 	// Copy data into the shared memory.
 	struct xrt_input *src = xdev->inputs;
 	struct xrt_input *dst = &ism->inputs[isdev->first_input_index];
@@ -1884,7 +1984,45 @@ ipc_handle_device_update_input(volatile struct ipc_client_state *ics, uint32_t i
 		}
 	}
 
-	// Reply.
+	return XRT_SUCCESS;
+}
+
+xrt_result_t
+ipc_handle_device_update_input(volatile struct ipc_client_state *ics, uint32_t id)
+{
+	return update_device_input(ics, id);
+}
+
+xrt_result_t
+ipc_handle_device_update_input_batch(volatile struct ipc_client_state *ics,
+                                     const struct ipc_device_id_list *devices,
+                                     struct ipc_device_result_list *out_results)
+{
+	struct ipc_shared_memory *ism = ics->server->ism;
+
+	if (devices->id_count > ARRAY_SIZE(devices->ids)) {
+		IPC_ERROR(ics->server, "Invalid device count: %u", devices->id_count);
+		return XRT_ERROR_IPC_FAILURE;
+	}
+
+	/*
+	 * Errors are per device so that one failing device doesn't stop the
+	 * others from being updated, the client decides what to do with them.
+	 */
+	for (uint32_t i = 0; i < devices->id_count; i++) {
+		uint32_t device_id = devices->ids[i];
+
+		if (device_id >= ism->isdev_count) {
+			IPC_ERROR(ics->server, "Invalid device id: %u", device_id);
+			out_results->results[i] = XRT_ERROR_IPC_FAILURE;
+			continue;
+		}
+
+		out_results->results[i] = update_device_input(ics, device_id);
+	}
+
+	out_results->result_count = devices->id_count;
+
 	return XRT_SUCCESS;
 }
 
@@ -1895,6 +2033,11 @@ find_input(volatile struct ipc_client_state *ics, uint32_t device_id, enum xrt_i
 	struct ipc_shared_device *isdev = &ism->isdevs[device_id];
 	struct xrt_input *io = &ism->inputs[isdev->first_input_index];
 
+	// Check against the same copy of the inputs the client last got.
+	if (xrt_atomic_s32_load(&ism->publisher.client_inputs_published[ics->server_thread_index][device_id]) != 0) {
+		io = &ism->publisher.inputs[isdev->first_input_index];
+	}
+
 	for (uint32_t i = 0; i < isdev->input_count; i++) {
 		if (io[i].name == name) {
 			return &io[i];
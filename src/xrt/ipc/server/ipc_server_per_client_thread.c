@@ -8,7 +8,10 @@
  * @ingroup ipc_server
  */
 
+#include "os/os_time.h"
+
 #include "util/u_misc.h"
+#include "util/u_session.h"
 #include "util/u_trace_marker.h"
 
 #include "shared/ipc_utils.h"
@@ -21,6 +24,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/epoll.h>
@@ -29,6 +33,92 @@
 #endif // XRT_OS_WINDOWS
 
 
+/*
+ *
+ * Event sink functions.
+ *
+ */
+
+static inline struct ipc_client_event_sink *
+ipc_client_event_sink(struct xrt_session_event_sink *xses)
+{
+	return (struct ipc_client_event_sink *)xses;
+}
+
+static xrt_result_t
+event_sink_push(struct xrt_session_event_sink *xses, const union xrt_session_event *xse)
+{
+	struct ipc_client_event_sink *ices = ipc_client_event_sink(xses);
+	struct ipc_shared_event_ring *ring = ices->ring;
+
+	os_mutex_lock(&ices->mutex);
+
+	uint32_t write_index = (uint32_t)xrt_atomic_s32_load(&ring->write_index);
+	uint32_t read_index = (uint32_t)xrt_atomic_s32_load(&ring->read_index);
+
+	// Keep the order, once an event is held back all after it are too.
+	if (ices->overflow == NULL && write_index - read_index < IPC_EVENT_QUEUE_SIZE) {
+		ring->events[write_index % IPC_EVENT_QUEUE_SIZE] = *xse;
+
+		// Publishes the event to the client.
+		xrt_atomic_s32_store(&ring->write_index, (int32_t)(write_index + 1));
+
+		os_mutex_unlock(&ices->mutex);
+
+		return XRT_SUCCESS;
+	}
+
+	struct u_session_event *use = U_TYPED_CALLOC(struct u_session_event);
+	use->xse = *xse;
+
+	// Find the last slot.
+	struct u_session_event **slot = &ices->overflow;
+	while (*slot != NULL) {
+		slot = &(*slot)->next;
+	}
+
+	*slot = use;
+
+	// Set after the event is reachable, the client polls when it sees this.
+	xrt_atomic_s32_store(&ring->overflow, 1);
+
+	os_mutex_unlock(&ices->mutex);
+
+	return XRT_SUCCESS;
+}
+
+static void
+stop_events(volatile struct ipc_client_state *ics)
+{
+	// Cast away volatile.
+	struct ipc_client_event_sink *ices = (struct ipc_client_event_sink *)&ics->event_sink;
+
+	if (ices->ring == NULL) {
+		return;
+	}
+
+	xrt_atomic_s32_store(&ices->ring->active, 0);
+
+	// Any event pushed after this is queued on the session, which is about to go.
+	xrt_result_t xret = xrt_session_set_event_sink(ics->xs, NULL);
+	if (xret != XRT_SUCCESS) {
+		IPC_ERROR(ics->server, "Failed to stop forwarding session events!");
+	}
+
+	os_mutex_lock(&ices->mutex);
+
+	while (ices->overflow != NULL) {
+		struct u_session_event *use = ices->overflow;
+		ices->overflow = use->next;
+		free(use);
+	}
+
+	ices->ring = NULL;
+
+	os_mutex_unlock(&ices->mutex);
+}
+
+
 /*
  *
  * Helper functions.
@@ -107,6 +197,55 @@ common_shutdown(volatile struct ipc_client_state *ics)
 	}
 
 	ipc_server_deactivate_session(ics);
+
+	os_mutex_destroy((struct os_mutex *)&ics->event_sink.mutex);
+	os_cond_destroy((struct os_cond *)&ics->blocking_call_cond);
+	os_mutex_destroy((struct os_mutex *)&ics->dispatch_lock);
+}
+
+static xrt_result_t
+dispatch(volatile struct ipc_client_state *ics, struct ipc_message_channel *imc, ipc_command_t *ipc_command)
+{
+	// Calls that may block run unlocked so they don't stall the other channels.
+	bool blocking = ipc_command_is_blocking(*ipc_command);
+	int64_t then_ns = os_monotonic_get_ns();
+
+	// Counted so destroys wait for them, see ipc_server_client_wait_for_blocking_calls_locked.
+	os_mutex_lock((struct os_mutex *)&ics->dispatch_lock);
+	if (blocking) {
+		ics->blocking_call_count++;
+		os_mutex_unlock((struct os_mutex *)&ics->dispatch_lock);
+	}
+
+	IPC_TRACE_BEGIN(ipc_dispatch);
+	xrt_result_t result = ipc_dispatch(ics, imc, ipc_command);
+	IPC_TRACE_END(ipc_dispatch);
+
+	if (blocking) {
+		os_mutex_lock((struct os_mutex *)&ics->dispatch_lock);
+		if (--ics->blocking_call_count == 0) {
+			os_cond_signal((struct os_cond *)&ics->blocking_call_cond);
+		}
+		os_mutex_unlock((struct os_mutex *)&ics->dispatch_lock);
+	} else {
+		// The client has the other end of a new channel now, drop ours.
+		if (*ipc_command == IPC_INSTANCE_OPEN_CHANNEL && ics->channel_count > 0) {
+			// Cast away volatile.
+			struct ipc_client_channel_state *ch =
+			    (struct ipc_client_channel_state *)&ics->channels[ics->channel_count - 1];
+			if (xrt_ipc_handle_is_valid(ch->client_handle)) {
+				xrt_ipc_handle_close(ch->client_handle);
+				ch->client_handle = XRT_IPC_HANDLE_INVALID;
+			}
+		}
+
+		os_mutex_unlock((struct os_mutex *)&ics->dispatch_lock);
+
+		// Blocking calls would only measure how long they waited, skip them.
+		u_ls_hist_add(ics->server->stats.call_hist, (uint64_t)(os_monotonic_get_ns() - then_ns));
+	}
+
+	return result;
 }
 
 
@@ -119,9 +258,8 @@ common_shutdown(volatile struct ipc_client_state *ics)
 #ifndef XRT_OS_WINDOWS // Linux & Android
 
 static int
-setup_epoll(volatile struct ipc_client_state *ics)
+setup_epoll(volatile struct ipc_client_state *ics, int listen_socket)
 {
-	int listen_socket = ics->imc.ipc_handle;
 	assert(listen_socket >= 0);
 
 	int ret = epoll_create1(EPOLL_CLOEXEC);
@@ -144,15 +282,15 @@ setup_epoll(volatile struct ipc_client_state *ics)
 	return epoll_fd;
 }
 
+/*!
+ * Reads and dispatches calls from one channel of the client until it
+ * disconnects or the server stops, used for both the main and extra channels.
+ */
 static void
-client_loop(volatile struct ipc_client_state *ics)
+channel_loop(volatile struct ipc_client_state *ics, struct ipc_message_channel *imc)
 {
-	U_TRACE_SET_THREAD_NAME("IPC Client");
-
-	IPC_INFO(ics->server, "Client %u connected", ics->client_state.id);
-
 	// Claim the client fd.
-	int epoll_fd = setup_epoll(ics);
+	int epoll_fd = setup_epoll(ics, imc->ipc_handle);
 	if (epoll_fd < 0) {
 		return;
 	}
@@ -186,7 +324,7 @@ client_loop(volatile struct ipc_client_state *ics)
 
 		// Peek the first 4 bytes to get the command type
 		enum ipc_command cmd;
-		ssize_t len = recv(ics->imc.ipc_handle, &cmd, sizeof(cmd), MSG_PEEK);
+		ssize_t len = recv(imc->ipc_handle, &cmd, sizeof(cmd), MSG_PEEK);
 		if (len != sizeof(cmd)) {
 			IPC_ERROR(ics->server, "Invalid command received.");
 			break;
@@ -201,7 +339,7 @@ client_loop(volatile struct ipc_client_state *ics)
 		// Read the whole command now that we know its size
 		uint8_t buf[IPC_BUF_SIZE] = {0};
 
-		len = recv(ics->imc.ipc_handle, &buf, cmd_size, 0);
+		len = recv(imc->ipc_handle, &buf, cmd_size, 0);
 		if (len != (ssize_t)cmd_size) {
 			IPC_ERROR(ics->server, "Invalid packet received, disconnecting client.");
 			break;
@@ -210,10 +348,7 @@ client_loop(volatile struct ipc_client_state *ics)
 		// Check the first 4 bytes of the message and dispatch.
 		ipc_command_t *ipc_command = (ipc_command_t *)buf;
 
-		IPC_TRACE_BEGIN(ipc_dispatch);
-		xrt_result_t result = ipc_dispatch(ics, ipc_command);
-		IPC_TRACE_END(ipc_dispatch);
-
+		xrt_result_t result = dispatch(ics, imc, ipc_command);
 		if (result != XRT_SUCCESS) {
 			IPC_ERROR(ics->server, "During packet handling, disconnecting client.");
 			break;
@@ -222,6 +357,60 @@ client_loop(volatile struct ipc_client_state *ics)
 
 	close(epoll_fd);
 	epoll_fd = -1;
+}
+
+static void *
+channel_thread(void *ptr)
+{
+	struct ipc_client_channel_state *ch = (struct ipc_client_channel_state *)ptr;
+
+	U_TRACE_SET_THREAD_NAME("IPC Channel");
+
+	channel_loop(ch->ics, &ch->imc);
+
+	return NULL;
+}
+
+static void
+close_channels(volatile struct ipc_client_state *ics)
+{
+	// After this no new channels can be opened, and the count is stable.
+	os_mutex_lock((struct os_mutex *)&ics->dispatch_lock);
+	ics->channels_closed = true;
+	uint32_t count = ics->channel_count;
+	os_mutex_unlock((struct os_mutex *)&ics->dispatch_lock);
+
+	for (uint32_t i = 0; i < count; i++) {
+		// Cast away volatile.
+		struct ipc_client_channel_state *ch = (struct ipc_client_channel_state *)&ics->channels[i];
+
+		// Wakes the thread up, it sees a hang up and exits.
+		shutdown(ch->imc.ipc_handle, SHUT_RDWR);
+		os_thread_join(&ch->thread);
+		os_thread_destroy(&ch->thread);
+
+		ipc_message_channel_close(&ch->imc);
+		if (xrt_ipc_handle_is_valid(ch->client_handle)) {
+			xrt_ipc_handle_close(ch->client_handle);
+			ch->client_handle = XRT_IPC_HANDLE_INVALID;
+		}
+	}
+
+	ics->channel_count = 0;
+}
+
+static void
+client_loop(volatile struct ipc_client_state *ics)
+{
+	U_TRACE_SET_THREAD_NAME("IPC Client");
+
+	IPC_INFO(ics->server, "Client %u connected", ics->client_state.id);
+
+	// Cast away volatile.
+	channel_loop(ics, (struct ipc_message_channel *)&ics->imc);
+
+	// The channels use the client state, stop them before tearing it down.
+	close_channels(ics);
 
 	// Following code is same for all platforms.
 	common_shutdown(ics);
@@ -293,10 +482,8 @@ client_loop(volatile struct ipc_client_state *ics)
 			break;
 		}
 
-		IPC_TRACE_BEGIN(ipc_dispatch);
-		xrt_result_t result = ipc_dispatch(ics, cmd_ptr);
-		IPC_TRACE_END(ipc_dispatch);
-
+		// Cast away volatile.
+		xrt_result_t result = dispatch(ics, (struct ipc_message_channel *)&ics->imc, cmd_ptr);
 		if (result != XRT_SUCCESS) {
 			IPC_ERROR(ics->server, "During packet handling, disconnecting client.");
 			break;
@@ -326,6 +513,11 @@ ipc_server_client_destroy_session_and_compositor(volatile struct ipc_client_stat
 
 	// Destroy all swapchains now.
 	for (uint32_t j = 0; j < IPC_MAX_CLIENT_SWAPCHAINS; j++) {
+		// The compositor might hold the swapchain after we drop it, stop mirroring first.
+		if (ics->xscs[j] != NULL) {
+			xrt_swapchain_set_use_mirror(ics->xscs[j], NULL);
+		}
+
 		// Drop our reference, does NULL checking. Cast away volatile.
 		xrt_swapchain_reference((struct xrt_swapchain **)&ics->xscs[j], NULL);
 		ics->swapchain_data[j].active = false;
@@ -343,15 +535,147 @@ ipc_server_client_destroy_session_and_compositor(volatile struct ipc_client_stat
 	// Cast away volatile.
 	xrt_comp_destroy((struct xrt_compositor **)&ics->xc);
 
+	// Stop before the session goes away.
+	stop_events(ics);
+
 	// Cast away volatile.
 	xrt_session_destroy((struct xrt_session **)&ics->xs);
 }
 
+void
+ipc_server_client_start_events(volatile struct ipc_client_state *ics)
+{
+	// Cast away volatile.
+	struct ipc_client_event_sink *ices = (struct ipc_client_event_sink *)&ics->event_sink;
+	struct ipc_shared_event_ring *ring = &ics->server->ism->events[ics->server_thread_index];
+
+	assert(ics->xs != NULL);
+	assert(ices->ring == NULL);
+
+	// The client does not look at the ring until it is active.
+	xrt_atomic_s32_store(&ring->active, 0);
+	xrt_atomic_s32_store(&ring->overflow, 0);
+	xrt_atomic_s32_store(&ring->write_index, 0);
+	xrt_atomic_s32_store(&ring->read_index, 0);
+
+	ices->base.push_event = event_sink_push;
+	ices->ring = ring;
+
+	xrt_result_t xret = xrt_session_set_event_sink(ics->xs, &ices->base);
+	if (xret != XRT_SUCCESS) {
+		IPC_INFO(ics->server, "Session can not forward events, client will poll them.");
+		ices->ring = NULL;
+		return;
+	}
+
+	xrt_atomic_s32_store(&ring->active, 1);
+}
+
+xrt_result_t
+ipc_server_client_poll_event(volatile struct ipc_client_state *ics, union xrt_session_event *out_xse)
+{
+	// Cast away volatile.
+	struct ipc_client_event_sink *ices = (struct ipc_client_event_sink *)&ics->event_sink;
+
+	if (ices->ring == NULL) {
+		return xrt_session_poll_events(ics->xs, out_xse);
+	}
+
+	U_ZERO(out_xse);
+	out_xse->type = XRT_SESSION_EVENT_NONE;
+
+	os_mutex_lock(&ices->mutex);
+
+	struct u_session_event *use = ices->overflow;
+	if (use != NULL) {
+		*out_xse = use->xse;
+		ices->overflow = use->next;
+		free(use);
+	}
+
+	// Cleared under the lock, so a concurrent push sets it again after this.
+	if (ices->overflow == NULL) {
+		xrt_atomic_s32_store(&ices->ring->overflow, 0);
+	}
+
+	os_mutex_unlock(&ices->mutex);
+
+	// Events the session failed to forward are still queued on it.
+	if (out_xse->type == XRT_SESSION_EVENT_NONE) {
+		return xrt_session_poll_events(ics->xs, out_xse);
+	}
+
+	return XRT_SUCCESS;
+}
+
+void
+ipc_server_client_wait_for_blocking_calls_locked(volatile struct ipc_client_state *ics)
+{
+	while (ics->blocking_call_count > 0) {
+		// Cast away volatile.
+		os_cond_wait((struct os_cond *)&ics->blocking_call_cond, (struct os_mutex *)&ics->dispatch_lock);
+	}
+}
+
+xrt_result_t
+ipc_server_client_open_channel(volatile struct ipc_client_state *ics, xrt_ipc_handle_t *out_handle)
+{
+#ifndef XRT_OS_WINDOWS
+	// Called from dispatch with the dispatch lock held.
+	if (ics->channels_closed || ics->channel_count >= IPC_MAX_CLIENT_CHANNELS) {
+		IPC_WARN(ics->server, "Can not open more channels for client %u.", ics->client_state.id);
+		return XRT_ERROR_IPC_FAILURE;
+	}
+
+	int fds[2] = {-1, -1};
+	int ret = socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds);
+	if (ret < 0) {
+		IPC_ERROR(ics->server, "socketpair failed: '%s'.", strerror(errno));
+		return XRT_ERROR_IPC_FAILURE;
+	}
+
+	// Cast away volatile.
+	struct ipc_client_channel_state *ch = (struct ipc_client_channel_state *)&ics->channels[ics->channel_count];
+	U_ZERO(ch);
+	ch->ics = ics;
+	ch->imc.ipc_handle = fds[0];
+	ch->imc.log_level = ics->imc.log_level;
+	ch->client_handle = fds[1];
+
+	ret = os_thread_init(&ch->thread);
+	if (ret == 0) {
+		ret = os_thread_start(&ch->thread, channel_thread, ch);
+	}
+	if (ret != 0) {
+		IPC_ERROR(ics->server, "Failed to start channel thread.");
+		os_thread_destroy(&ch->thread);
+		close(fds[0]);
+		close(fds[1]);
+		return XRT_ERROR_IPC_FAILURE;
+	}
+
+	ics->channel_count++;
+	*out_handle = fds[1];
+
+	return XRT_SUCCESS;
+#else
+	(void)ics;
+	(void)out_handle;
+
+	return XRT_ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
 void *
 ipc_server_client_thread(void *_ics)
 {
 	volatile struct ipc_client_state *ics = (volatile struct ipc_client_state *)_ics;
 
+	// Destroyed in common_shutdown.
+	os_mutex_init((struct os_mutex *)&ics->dispatch_lock);
+	os_cond_init((struct os_cond *)&ics->blocking_call_cond);
+	os_mutex_init((struct os_mutex *)&ics->event_sink.mutex);
+
 	client_loop(ics);
 
 	return NULL;
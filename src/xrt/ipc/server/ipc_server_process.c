@@ -20,6 +20,7 @@
 #include "os/os_time.h"
 #include "util/u_var.h"
 #include "util/u_misc.h"
+#include "util/u_time.h"
 #include "util/u_debug.h"
 #include "util/u_trace_marker.h"
 #include "util/u_verify.h"
@@ -56,8 +57,16 @@
  */
 
 DEBUG_GET_ONCE_BOOL_OPTION(exit_on_disconnect, "IPC_EXIT_ON_DISCONNECT", false)
+DEBUG_GET_ONCE_BOOL_OPTION(device_publisher, "IPC_DEVICE_PUBLISHER", true)
+DEBUG_GET_ONCE_NUM_OPTION(device_publisher_hz, "IPC_DEVICE_PUBLISHER_HZ", 500)
 DEBUG_GET_ONCE_LOG_OPTION(ipc_log, "IPC_LOG", U_LOGGING_INFO)
 
+/*!
+ * How often the publisher forgets which devices and pose inputs clients read,
+ * anything not read again within this period stops being sampled.
+ */
+#define PUBLISHER_INTEREST_PERIOD_NS (U_TIME_1S_IN_NS)
+
 
 /*
  *
@@ -124,6 +133,208 @@ teardown_idevs(struct ipc_server *s)
 }
 
 
+/*
+ *
+ * Device publisher functions.
+ *
+ */
+
+/*!
+ * What clients have read from the published states, one period is kept so
+ * clients have a whole period to mark their reads again after being cleared.
+ */
+struct publisher_interest
+{
+	bool inputs[XRT_SYSTEM_MAX_DEVICES];
+	bool poses[XRT_SYSTEM_MAX_DEVICES][IPC_SHARED_MAX_DEVICE_RELATIONS];
+
+	//! Was anything published for the device last time, used to retract it.
+	bool published[XRT_SYSTEM_MAX_DEVICES];
+};
+
+static inline bool
+is_wanted(bool kept, xrt_atomic_s32_t *flag)
+{
+	return kept || xrt_atomic_s32_load(flag) != 0;
+}
+
+static void
+decay_interest(struct ipc_shared_memory *ism, struct publisher_interest *pi)
+{
+	for (uint32_t i = 0; i < XRT_SYSTEM_MAX_DEVICES; i++) {
+		pi->inputs[i] = xrt_atomic_s32_load(&ism->publisher.inputs_wanted[i]) != 0;
+		xrt_atomic_s32_store(&ism->publisher.inputs_wanted[i], 0);
+
+		for (uint32_t k = 0; k < IPC_SHARED_MAX_DEVICE_RELATIONS; k++) {
+			pi->poses[i][k] = xrt_atomic_s32_load(&ism->publisher.poses_wanted[i][k]) != 0;
+			xrt_atomic_s32_store(&ism->publisher.poses_wanted[i][k], 0);
+		}
+	}
+}
+
+static void
+publish_device(struct ipc_server *s, struct publisher_interest *pi, uint32_t device_id, int64_t now_ns)
+{
+	struct ipc_shared_memory *ism = s->ism;
+	struct ipc_shared_device *isdev = &ism->isdevs[device_id];
+	struct ipc_shared_device_state *state = &ism->publisher.states[device_id];
+	struct ipc_device *idev = &s->idevs[device_id];
+	struct xrt_device *xdev = idev->xdev;
+
+	bool inputs_valid = is_wanted(pi->inputs[device_id], &ism->publisher.inputs_wanted[device_id]);
+	if (inputs_valid) {
+		xrt_result_t xret = xrt_device_update_inputs(xdev);
+		inputs_valid = xret == XRT_SUCCESS;
+	}
+
+	// Sample the poses before taking the lock, keeps the write side short.
+	struct ipc_shared_relation relations[IPC_SHARED_MAX_DEVICE_RELATIONS];
+	uint32_t relation_count = 0;
+	uint32_t pose_index = 0;
+
+	for (uint32_t i = 0; i < xdev->input_count && pose_index < IPC_SHARED_MAX_DEVICE_RELATIONS; i++) {
+		struct xrt_input *input = &xdev->inputs[i];
+
+		if (XRT_GET_INPUT_TYPE(input->name) != XRT_INPUT_TYPE_POSE) {
+			continue;
+		}
+
+		// Same order as the client uses to mark the pose as wanted.
+		uint32_t k = pose_index++;
+		if (!input->active || !is_wanted(pi->poses[device_id][k], &ism->publisher.poses_wanted[device_id][k])) {
+			continue;
+		}
+
+		struct ipc_shared_relation *rel = &relations[relation_count++];
+		rel->name = input->name;
+		rel->timestamp_ns = now_ns;
+		xrt_device_get_tracked_pose(xdev, input->name, now_ns, &rel->relation);
+	}
+
+	// Nothing read and nothing left to retract, don't touch the state.
+	bool publish = inputs_valid || relation_count > 0;
+	if (!publish && !pi->published[device_id]) {
+		return;
+	}
+	pi->published[device_id] = publish;
+
+	// Odd, readers will retry until we are done.
+	xrt_atomic_s32_inc_return(&state->seq);
+
+	if (inputs_valid) {
+		memcpy(&ism->publisher.inputs[isdev->first_input_index], xdev->inputs,
+		       sizeof(struct xrt_input) * isdev->input_count);
+	}
+	memcpy(state->relations, relations, sizeof(struct ipc_shared_relation) * relation_count);
+	state->relation_count = relation_count;
+	state->inputs_valid = inputs_valid;
+	state->io_active = idev->io_active;
+	state->timestamp_ns = now_ns;
+
+	// Even again, the state is consistent.
+	xrt_atomic_s32_inc_return(&state->seq);
+}
+
+static void *
+publisher_thread(void *ptr)
+{
+	struct ipc_server *s = (struct ipc_server *)ptr;
+	struct ipc_shared_memory *ism = s->ism;
+	int64_t period_ns = ism->publisher.period_ns;
+	struct publisher_interest pi = {0};
+	int64_t next_decay_ns = 0;
+
+	U_TRACE_SET_THREAD_NAME("IPC Device Publisher");
+	os_thread_helper_name(&s->publisher, "IPC Device Publisher");
+
+	os_thread_helper_lock(&s->publisher);
+
+	while (os_thread_helper_is_running_locked(&s->publisher)) {
+		// Nobody to publish for, don't poll the devices.
+		if (s->publisher_session_count == 0) {
+			// Clients go back to the calls.
+			xrt_atomic_s32_cmpxchg(&ism->publisher.running, 1, 0);
+
+			os_thread_helper_wait_locked(&s->publisher);
+			continue;
+		}
+
+		os_thread_helper_unlock(&s->publisher);
+
+		int64_t now_ns = os_monotonic_get_ns();
+
+		if (now_ns >= next_decay_ns) {
+			decay_interest(ism, &pi);
+			next_decay_ns = now_ns + PUBLISHER_INTEREST_PERIOD_NS;
+		}
+
+		for (uint32_t i = 0; i < ism->isdev_count; i++) {
+			publish_device(s, &pi, i, now_ns);
+		}
+
+		// Tell clients that the states can be used.
+		xrt_atomic_s32_cmpxchg(&ism->publisher.running, 0, 1);
+
+		int64_t then_ns = now_ns + period_ns;
+		now_ns = os_monotonic_get_ns();
+		if (then_ns > now_ns) {
+			os_nanosleep(then_ns - now_ns);
+		}
+
+		os_thread_helper_lock(&s->publisher);
+	}
+
+	os_thread_helper_unlock(&s->publisher);
+
+	// Clients go back to the calls.
+	xrt_atomic_s32_cmpxchg(&ism->publisher.running, 1, 0);
+
+	return NULL;
+}
+
+/*!
+ * Called with the global state lock held when a session becomes active or
+ * inactive, wakes the publisher up when the first session becomes active.
+ */
+static void
+publisher_session_changed_locked(struct ipc_server *s, int32_t change)
+{
+	os_thread_helper_lock(&s->publisher);
+
+	assert(change > 0 || s->publisher_session_count > 0);
+	s->publisher_session_count += change;
+
+	if (s->publisher_session_count == 1 && change > 0) {
+		os_thread_helper_signal_locked(&s->publisher);
+	}
+
+	os_thread_helper_unlock(&s->publisher);
+}
+
+static int
+init_publisher(struct ipc_server *s)
+{
+	int ret = os_thread_helper_init(&s->publisher);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (!debug_get_bool_option_device_publisher()) {
+		IPC_INFO(s, "Device publisher disabled, clients will update inputs with calls.");
+		return 0;
+	}
+
+	int64_t hz = debug_get_num_option_device_publisher_hz();
+	if (hz <= 0) {
+		hz = 500;
+	}
+
+	s->ism->publisher.period_ns = U_TIME_1S_IN_NS / hz;
+
+	return os_thread_helper_start(&s->publisher, publisher_thread, s);
+}
+
+
 /*
  *
  * Static functions.
@@ -194,6 +405,11 @@ teardown_all(struct ipc_server *s)
 {
 	u_var_remove_root(s);
 
+	// Stop before the devices go away.
+	if (s->publisher.initialized) {
+		os_thread_helper_destroy(&s->publisher);
+	}
+
 	xrt_syscomp_destroy(&s->xsysc);
 
 	teardown_idevs(s);
@@ -210,6 +426,8 @@ teardown_all(struct ipc_server *s)
 
 	ipc_shmem_destroy(&s->ism_handle, (void **)&s->ism, sizeof(struct ipc_shared_memory));
 
+	u_ls_hist_destroy(&s->stats.call_hist);
+
 	// Destroyed last.
 	os_mutex_destroy(&s->global_state.lock);
 }
@@ -478,6 +696,10 @@ init_all(struct ipc_server *s, enum u_logging_level log_level)
 		return ret;
 	}
 
+	// Never fails, needed before any client thread is started.
+	u_ls_hist_create("calls", &s->stats.call_hist);
+	s->stats.last_report_ns = os_monotonic_get_ns();
+
 	s->process = u_process_create_if_not_running();
 
 	if (!s->process) {
@@ -525,6 +747,13 @@ init_all(struct ipc_server *s, enum u_logging_level log_level)
 		return ret;
 	}
 
+	ret = init_publisher(s);
+	if (ret < 0) {
+		IPC_ERROR(s, "Failed to start device publisher!");
+		teardown_all(s);
+		return ret;
+	}
+
 	ret = ipc_server_mainloop_init(&s->ml);
 	if (ret < 0) {
 		IPC_ERROR(s, "Failed to init ipc main loop!");
@@ -539,10 +768,38 @@ init_all(struct ipc_server *s, enum u_logging_level log_level)
 	u_var_add_log_level(s, &s->log_level, "Log level");
 	u_var_add_bool(s, &s->exit_on_disconnect, "exit_on_disconnect");
 	u_var_add_bool(s, (bool *)&s->running, "running");
+	u_var_add_ro_u64(s, &s->stats.call.count, "Calls (last second)");
+	u_var_add_ro_u64(s, &s->stats.call.mean, "Call mean (ns)");
+	u_var_add_ro_u64(s, &s->stats.call.p50, "Call p50 (ns)");
+	u_var_add_ro_u64(s, &s->stats.call.p90, "Call p90 (ns)");
+	u_var_add_ro_u64(s, &s->stats.call.p99, "Call p99 (ns)");
+	u_var_add_ro_u64(s, &s->stats.call.p999, "Call p99.9 (ns)");
+	u_var_add_ro_u64(s, &s->stats.call.worst, "Call worst (ns)");
 
 	return 0;
 }
 
+static void
+report_stats(struct ipc_server *s)
+{
+	int64_t now_ns = os_monotonic_get_ns();
+	if (now_ns - s->stats.last_report_ns < U_TIME_1S_IN_NS) {
+		return;
+	}
+	s->stats.last_report_ns = now_ns;
+
+	struct u_live_stats_hist_report *r = &s->stats.call;
+	u_ls_hist_get_and_reset(s->stats.call_hist, NULL, NULL, 0, r);
+	if (r->count == 0) {
+		return;
+	}
+
+	IPC_DEBUG(s, "Calls: %" PRIu64 " p50: %.3fms p90: %.3fms p99: %.3fms p99.9: %.3fms worst: %.3fms", r->count,
+	          time_ns_to_ms_f((int64_t)r->p50), time_ns_to_ms_f((int64_t)r->p90),
+	          time_ns_to_ms_f((int64_t)r->p99), time_ns_to_ms_f((int64_t)r->p999),
+	          time_ns_to_ms_f((int64_t)r->worst));
+}
+
 static int
 main_loop(struct ipc_server *s)
 {
@@ -551,6 +808,8 @@ main_loop(struct ipc_server *s)
 
 		// Check polling.
 		ipc_server_mainloop_poll(s, &s->ml);
+
+		report_stats(s);
 	}
 
 	return 0;
@@ -790,6 +1049,7 @@ toggle_io_client_locked(struct ipc_server *s, uint32_t client_id)
 	}
 
 	ics->io_active = !ics->io_active;
+	s->ism->publisher.client_io_active[ics->server_thread_index] = ics->io_active;
 
 	return XRT_SUCCESS;
 }
@@ -846,6 +1106,10 @@ ipc_server_activate_session(volatile struct ipc_client_state *ics)
 	// Multiple threads could call this at the same time.
 	os_mutex_lock(&s->global_state.lock);
 
+	if (!ics->client_state.session_active) {
+		publisher_session_changed_locked(s, 1);
+	}
+
 	ics->client_state.session_active = true;
 
 	if (ics->client_state.session_overlay) {
@@ -873,6 +1137,10 @@ ipc_server_deactivate_session(volatile struct ipc_client_state *ics)
 	// Multiple threads could call this at the same time.
 	os_mutex_lock(&s->global_state.lock);
 
+	if (ics->client_state.session_active) {
+		publisher_session_changed_locked(s, -1);
+	}
+
 	ics->client_state.session_active = false;
 
 	update_server_state_locked(s);
@@ -965,6 +1233,12 @@ ipc_server_handle_client_connected(struct ipc_server *vs, xrt_ipc_handle_t ipc_h
 	ics->server = vs;
 	ics->server_thread_index = cs_index;
 	ics->io_active = true;
+	vs->ism->publisher.client_io_active[cs_index] = true;
+
+	// The new client has not read any published inputs yet.
+	for (uint32_t i = 0; i < XRT_SYSTEM_MAX_DEVICES; i++) {
+		xrt_atomic_s32_store(&vs->ism->publisher.client_inputs_published[cs_index][i], 0);
+	}
 
 	os_thread_start(&it->thread, ipc_server_client_thread, (void *)ics);
 
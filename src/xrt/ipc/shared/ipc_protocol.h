@@ -36,12 +36,22 @@
 #define IPC_MAX_LAYERS XRT_MAX_LAYERS
 #define IPC_MAX_SLOTS 128
 #define IPC_MAX_CLIENTS 8
+#define IPC_MAX_CLIENT_CHANNELS 4 // Extra channels a client can open, on top of the main one.
+#define IPC_MAX_CLIENT_SWAPCHAINS (XRT_MAX_LAYERS * 2)
 #define IPC_MAX_RAW_VIEWS 32 // Max views that we can get, artificial limit.
 #define IPC_EVENT_QUEUE_SIZE 32
 
 #define IPC_SHARED_MAX_INPUTS 1024
 #define IPC_SHARED_MAX_OUTPUTS 128
 #define IPC_SHARED_MAX_BINDINGS 64
+#define IPC_SHARED_MAX_DEVICE_RELATIONS 8
+
+/*!
+ * How far from the time a published relation was sampled at a client may
+ * predict it, using the velocities of the relation, before it has to ask the
+ * server for it. Covers the predicted display time apps locate spaces at.
+ */
+#define IPC_SHARED_MAX_RELATION_PREDICTION_NS (50 * 1000 * 1000)
 
 // example: v21.0.0-560-g586d33b5
 #define IPC_VERSION_NAME_LEN 64
@@ -140,6 +150,148 @@ struct ipc_shared_device
 	bool battery_status_supported;
 };
 
+/*!
+ * A tracked relation of a pose input, published by the server.
+ *
+ * @ingroup ipc
+ */
+struct ipc_shared_relation
+{
+	//! Which pose input this is the relation of.
+	enum xrt_input_name name;
+
+	//! The time the relation was sampled at.
+	int64_t timestamp_ns;
+
+	//! Pose and velocities at @ref timestamp_ns, clients predict from this.
+	struct xrt_space_relation relation;
+};
+
+/*!
+ * State of a single device written by the server's device publisher thread.
+ *
+ * Guarded by @ref seq used as a sequence lock: the server increments it
+ * before and after writing, so it is odd while a write is in progress. A
+ * reader copies the data out and retries if @ref seq was odd or changed.
+ * The inputs of the device live in @ref ipc_shared_publisher::inputs at
+ * @ref ipc_shared_device::first_input_index and are covered by the same lock.
+ *
+ * @ingroup ipc
+ */
+struct ipc_shared_device_state
+{
+	//! Sequence counter, odd while the server is writing.
+	xrt_atomic_s32_t seq;
+
+	//! When this state was published.
+	int64_t timestamp_ns;
+
+	//! Is the IO of this device active, see @ref ipc_device::io_active.
+	bool io_active;
+
+	//! Are the published inputs of this device current, only when a client reads them.
+	bool inputs_valid;
+
+	//! Number of elements in @ref relations that are valid.
+	uint32_t relation_count;
+
+	//! Latest relation of each active pose input of the device that a client reads.
+	struct ipc_shared_relation relations[IPC_SHARED_MAX_DEVICE_RELATIONS];
+};
+
+/*!
+ * Device inputs and poses published by the server, read directly by clients.
+ *
+ * @ingroup ipc
+ */
+struct ipc_shared_publisher
+{
+	//! Non-zero while the publisher thread is publishing and @ref states is valid.
+	xrt_atomic_s32_t running;
+
+	//! Period at which the states are published.
+	int64_t period_ns;
+
+	//! Is the IO of a client active, indexed by the client index.
+	bool client_io_active[IPC_MAX_CLIENTS];
+
+	/*!
+	 * Set to non-zero by clients when they read the published inputs of a
+	 * device, indexed by device id. The publisher only updates the inputs of
+	 * devices that have been read recently, it clears these periodically.
+	 */
+	xrt_atomic_s32_t inputs_wanted[XRT_SYSTEM_MAX_DEVICES];
+
+	/*!
+	 * Same as @ref inputs_wanted but for the relations, indexed by device id
+	 * and then by the order of the pose input among the device's pose inputs.
+	 */
+	xrt_atomic_s32_t poses_wanted[XRT_SYSTEM_MAX_DEVICES][IPC_SHARED_MAX_DEVICE_RELATIONS];
+
+	/*!
+	 * Did the client get the inputs of the device from the published state
+	 * the last time it updated them, indexed by client index and device id.
+	 * Set by the client, cleared by the server when the client updates the
+	 * inputs with a call, tells the server which copy the client is using.
+	 */
+	xrt_atomic_s32_t client_inputs_published[IPC_MAX_CLIENTS][XRT_SYSTEM_MAX_DEVICES];
+
+	//! Per device state, indexed by device id.
+	struct ipc_shared_device_state states[XRT_SYSTEM_MAX_DEVICES];
+
+	//! Published copy of all device inputs, laid out as @ref ipc_shared_memory::inputs.
+	struct xrt_input inputs[IPC_SHARED_MAX_INPUTS];
+};
+
+/*!
+ * Image use state of a single client swapchain, written by the server.
+ *
+ * Acquire and release are pure bookkeeping that the client does on its own,
+ * this lets it also wait for an image that the compositor no longer uses
+ * without a round trip. The server mirrors the use counter of every image
+ * here, see @ref xrt_swapchain::set_use_mirror, and on Linux wakes futex
+ * waiters on a counter when it drops to zero.
+ *
+ * @ingroup ipc
+ */
+struct ipc_shared_swapchain
+{
+	//! Non-zero while @ref use_counts is kept up to date by the server.
+	xrt_atomic_s32_t mirrored;
+
+	//! Use counter of each image, an image is free to write when zero.
+	xrt_atomic_s32_t use_counts[XRT_MAX_SWAPCHAIN_IMAGES];
+};
+
+/*!
+ * Session events of a single client, a single producer single consumer ring.
+ *
+ * The server writes an event into the slot of @ref write_index and then
+ * increments it, the client copies the slot of @ref read_index out and then
+ * increments that. Both only ever grow, the slot is the index modulo
+ * @ref IPC_EVENT_QUEUE_SIZE. Events that do not fit are kept by the server
+ * and @ref overflow is set, the client polls them over IPC once it has
+ * emptied the ring.
+ *
+ * @ingroup ipc
+ */
+struct ipc_shared_event_ring
+{
+	//! Non-zero while the server forwards the session events here.
+	xrt_atomic_s32_t active;
+
+	//! Non-zero while the server holds events that did not fit.
+	xrt_atomic_s32_t overflow;
+
+	//! Only written by the server.
+	xrt_atomic_s32_t write_index;
+
+	//! Only written by the client.
+	xrt_atomic_s32_t read_index;
+
+	union xrt_session_event events[IPC_EVENT_QUEUE_SIZE];
+};
+
 /*!
  * Data for a single composition layer.
  *
@@ -167,7 +319,9 @@ struct ipc_layer_entry
 };
 
 /*!
- * Render state for a single client, including all layers.
+ * Render state for a single client submission, the layers themselves are
+ * written to the client's @ref ipc_shared_memory::layers, only the first
+ * @p layer_count of them are read by the server.
  *
  * @ingroup ipc
  */
@@ -175,7 +329,6 @@ struct ipc_layer_slot
 {
 	struct xrt_layer_frame_data data;
 	uint32_t layer_count;
-	struct ipc_layer_entry layers[IPC_MAX_LAYERS];
 };
 
 /*!
@@ -277,8 +430,20 @@ struct ipc_shared_memory
 	struct xrt_binding_input_pair input_pairs[IPC_SHARED_MAX_INPUTS];
 	struct xrt_binding_output_pair output_pairs[IPC_SHARED_MAX_OUTPUTS];
 
+	//! Device state published without requiring a round trip.
+	struct ipc_shared_publisher publisher;
+
+	//! Image use state of client swapchains, indexed by client index and swapchain id.
+	struct ipc_shared_swapchain swapchains[IPC_MAX_CLIENTS][IPC_MAX_CLIENT_SWAPCHAINS];
+
+	//! Session events of each client, indexed by client index.
+	struct ipc_shared_event_ring events[IPC_MAX_CLIENTS];
+
 	struct ipc_layer_slot slots[IPC_MAX_SLOTS];
 
+	//! Layers submitted with a slot, indexed by client index.
+	struct ipc_layer_entry layers[IPC_MAX_CLIENTS][IPC_MAX_LAYERS];
+
 	uint64_t startup_timestamp;
 };
 
@@ -297,6 +462,24 @@ struct ipc_client_list
 	uint32_t id_count;
 };
 
+/*!
+ * A set of device ids, used to update the inputs of several devices in one call.
+ */
+struct ipc_device_id_list
+{
+	uint32_t ids[XRT_SYSTEM_MAX_DEVICES];
+	uint32_t id_count;
+};
+
+/*!
+ * Per device results, in the same order as the matching @ref ipc_device_id_list.
+ */
+struct ipc_device_result_list
+{
+	xrt_result_t results[XRT_SYSTEM_MAX_DEVICES];
+	uint32_t result_count;
+};
+
 /*!
  * State for a connected application.
  *
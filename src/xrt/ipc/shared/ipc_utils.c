@@ -10,6 +10,7 @@
  */
 
 #include "ipc_utils.h"
+#include "ipc_protocol.h"
 
 #include "util/u_logging.h"
 #include "util/u_pretty_print.h"
@@ -18,6 +19,8 @@
 #include "util/u_windows.h"
 #endif
 
+#include <string.h>
+
 
 /*
  *
@@ -56,6 +59,23 @@ ipc_print_result(enum u_logging_level cond_level,
 	u_log(file, line, calling_fn, level, "%s", sink.buffer);
 }
 
+bool
+ipc_layer_slot_copy(const struct ipc_layer_slot *slot,
+                    const struct ipc_layer_entry *layers,
+                    struct ipc_layer_slot *out_slot,
+                    struct ipc_layer_entry *out_layers)
+{
+	*out_slot = *slot;
+
+	if (out_slot->layer_count > IPC_MAX_LAYERS) {
+		return false;
+	}
+
+	memcpy(out_layers, layers, sizeof(*layers) * out_slot->layer_count);
+
+	return true;
+}
+
 #ifdef XRT_OS_WINDOWS
 const char *
 ipc_winerror(DWORD err)
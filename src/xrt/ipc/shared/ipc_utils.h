@@ -26,6 +26,9 @@ extern "C" {
 #endif
 
 
+struct ipc_layer_slot;
+struct ipc_layer_entry;
+
 /*
  *
  * Misc utils.
@@ -54,6 +57,29 @@ ipc_print_result(enum u_logging_level cond_level,
                  xrt_result_t xret,
                  const char *called_func);
 
+/*!
+ * Copy a layer submission out of the shared memory, the header of @p slot is
+ * copied first and only @ref ipc_layer_slot::layer_count entries of @p layers
+ * are then copied, so the cost follows the number of layers submitted. The
+ * count is validated after it has been copied so the client can not change it
+ * under our feet.
+ *
+ * @param slot       Slot in the shared memory.
+ * @param layers     Layers in the shared memory, @ref IPC_MAX_LAYERS long.
+ * @param out_slot   Where to put the header.
+ * @param out_layers Where to put the layers, @ref IPC_MAX_LAYERS long.
+ *
+ * @return False if the layer count was invalid, nothing is copied into
+ *         @p out_layers then.
+ *
+ * @ingroup ipc_shared
+ */
+bool
+ipc_layer_slot_copy(const struct ipc_layer_slot *slot,
+                    const struct ipc_layer_entry *layers,
+                    struct ipc_layer_slot *out_slot,
+                    struct ipc_layer_entry *out_layers);
+
 #if defined(XRT_OS_WINDOWS) || defined(XRT_DOXYGEN)
 /*!
  * Helper to convert windows error codes to human readable strings for logging.
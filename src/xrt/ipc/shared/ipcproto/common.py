@@ -93,10 +93,10 @@ def write_reply_struct(f, call, ident):
         f.write(ident + "struct ipc_result_reply _sync = {0};\n")
 
 
-def write_msg_send(f, ret, indent):
+def write_msg_send(f, ret, indent, imc='&ipc_c->imc'):
     # Prepare initial sending
     func = 'ipc_send'
-    args = ['&ipc_c->imc', '&_msg', 'sizeof(_msg)']
+    args = [imc, '&_msg', 'sizeof(_msg)']
 
     f.write("\n" + indent + "// Send our request")
     write_invocation(f, ret, func, args, indent=indent)
@@ -296,6 +296,7 @@ class Call:
         self.in_handles = None
         self.out_handles = None
         self.varlen = False
+        self.blocking = False
         for key, val in data.items():
             if key == 'id':
                 self.id = val
@@ -309,6 +310,8 @@ class Call:
                 self.in_handles = HandleType(val)
             elif key == 'varlen':
                 self.varlen = val
+            elif key == 'blocking':
+                self.blocking = val
             else:
                 raise RuntimeError("Unrecognized key")
         if not self.id:
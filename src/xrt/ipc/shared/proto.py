@@ -66,13 +66,14 @@ def write_call_definition(f, call):
     write_reply_struct(f, call, '\t')
 
     f.write("""
-\t// Other threads must not read/write the fd while we wait for reply
-\tos_mutex_lock(&ipc_c->mutex);
+\t// Other threads use the other channels while we wait for reply
+\tstruct ipc_message_channel *_imc = NULL;
+\tstruct os_mutex *_mutex = ipc_client_connection_acquire_channel(ipc_c, &_imc);
 """)
-    cleanup = "os_mutex_unlock(&ipc_c->mutex);"
+    cleanup = "os_mutex_unlock(_mutex);"
 
     # Prepare initial sending
-    write_msg_send(f, 'xrt_result_t ret', indent="\t")
+    write_msg_send(f, 'xrt_result_t ret', indent="\t", imc='_imc')
     write_result_handler(f, 'ret', cleanup, indent="\t")
 
     if call.in_handles:
@@ -84,7 +85,7 @@ def write_call_definition(f, call):
             'ret',
             'ipc_receive',
             (
-                '&ipc_c->imc',
+                '_imc',
                 '&_sync',
                 'sizeof(_sync)'
                 ),
@@ -104,7 +105,7 @@ def write_call_definition(f, call):
             'ret',
             'ipc_send_handles_' + call.in_handles.stem,
             (
-                '&ipc_c->imc',
+                '_imc',
                 "&_handle_msg",
                 "sizeof(_handle_msg)",
                 call.in_handles.arg_name,
@@ -117,7 +118,7 @@ def write_call_definition(f, call):
 
     f.write("\n\t// Await the reply")
     func = 'ipc_receive'
-    args = ['&ipc_c->imc', '&_reply', 'sizeof(_reply)']
+    args = ['_imc', '&_reply', 'sizeof(_reply)']
     if call.out_handles:
         func += '_handles_' + call.out_handles.stem
         args.extend(call.out_handles.arg_names)
@@ -281,7 +282,7 @@ def generate_server_c(file, p):
 
     f.write('''
 xrt_result_t
-ipc_dispatch(volatile struct ipc_client_state *ics, ipc_command_t *ipc_command)
+ipc_dispatch(volatile struct ipc_client_state *ics, struct ipc_message_channel *imc, ipc_command_t *ipc_command)
 {
 \tswitch (*ipc_command) {
 ''')
@@ -292,6 +293,12 @@ ipc_dispatch(volatile struct ipc_client_state *ics, ipc_command_t *ipc_command)
         f.write("\t\tIPC_TRACE(ics->server, \"Dispatching " + call.name +
                 "\");\n\n")
 
+        if call.varlen:
+            # The handlers use the main channel for the extra data.
+            f.write("\t\tif (imc != (struct ipc_message_channel *)&ics->imc) {\n")
+            f.write("\t\t\treturn XRT_ERROR_IPC_FAILURE;\n")
+            f.write("\t\t}\n\n")
+
         if call.needs_msg_struct:
             f.write(
                 "\t\tstruct ipc_{}_msg *msg = ".format(call.name))
@@ -330,7 +337,7 @@ ipc_dispatch(volatile struct ipc_client_state *ics, ipc_command_t *ipc_command)
                 'xrt_result_t sync_result',
                 'ipc_send',
                 (
-                    "(struct ipc_message_channel *)&ics->imc",
+                    "imc",
                     "&_sync",
                     "sizeof(_sync)"
                 ),
@@ -344,7 +351,7 @@ ipc_dispatch(volatile struct ipc_client_state *ics, ipc_command_t *ipc_command)
                 'xrt_result_t receive_handle_result',
                 'ipc_receive_handles_' + call.in_handles.stem,
                 (
-                    "(struct ipc_message_channel *)&ics->imc",
+                    "imc",
                     "&_handle_msg",
                     "sizeof(_handle_msg)",
                     "in_" + call.in_handles.arg_name,
@@ -395,7 +402,7 @@ ipc_dispatch(volatile struct ipc_client_state *ics, ipc_command_t *ipc_command)
 
         if not call.varlen:
             func = 'ipc_send'
-            args = ["(struct ipc_message_channel *)&ics->imc",
+            args = ["imc",
                     "&reply",
                     "sizeof(reply)"]
             if call.out_handles:
@@ -433,6 +440,23 @@ ipc_command_size(const enum ipc_command cmd)
 \t}
 }
 
+''')
+
+    f.write('''
+bool
+ipc_command_is_blocking(const enum ipc_command cmd)
+{
+\tswitch (cmd) {
+''')
+
+    for call in p.calls:
+        if call.blocking:
+            f.write("\tcase " + call.id + ": return true;\n")
+
+    f.write('''\tdefault: return false;
+\t}
+}
+
 ''')
 
     f.close()
@@ -467,6 +491,7 @@ def generate_server_header(file, p):
         "ipc_dispatch",
         [
             "volatile struct ipc_client_state *ics",
+            "struct ipc_message_channel *imc",
             "ipc_command_t *ipc_command"
         ]
     )
@@ -482,6 +507,16 @@ def generate_server_header(file, p):
     )
     f.write(";\n")
 
+    write_decl(
+        f,
+        "bool",
+        "ipc_command_is_blocking",
+        [
+            "const enum ipc_command cmd"
+        ]
+    )
+    f.write(";\n")
+
     for call in p.calls:
         call.write_handler_decl(f)
         f.write(";\n")
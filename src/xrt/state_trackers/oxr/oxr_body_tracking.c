@@ -164,18 +164,23 @@ oxr_locate_body_joints_fb(struct oxr_logger *log,
 	locations->confidence = body_joint_set_fb->confidence;
 	locations->skeletonChangedCount = body_joint_set_fb->skeleton_changed_count;
 
+	// All joints go through the same body pose, so resolve them in one batch.
+	struct xrt_space_relation joints[XRT_BODY_JOINT_COUNT_FB];
+	for (size_t joint_index = 0; joint_index < XRT_BODY_JOINT_COUNT_FB; ++joint_index) {
+		joints[joint_index] = src_body_joints[joint_index].relation;
+	}
+
+	struct xrt_relation_chain chain = {0};
+	m_relation_chain_push_relation(&chain, &T_base_body);
+	m_relation_chain_resolve_batch(&chain, joints, XRT_BODY_JOINT_COUNT_FB, joints);
+
 	for (size_t joint_index = 0; joint_index < XRT_BODY_JOINT_COUNT_FB; ++joint_index) {
 		const struct xrt_body_joint_location_fb *src_joint = &src_body_joints[joint_index];
 		XrBodyJointLocationFB *dst_joint = &locations->jointLocations[joint_index];
 
 		dst_joint->locationFlags = xrt_to_xr_space_location_flags(src_joint->relation.relation_flags);
 
-		struct xrt_space_relation result;
-		struct xrt_relation_chain chain = {0};
-		m_relation_chain_push_relation(&chain, &src_joint->relation);
-		m_relation_chain_push_relation(&chain, &T_base_body);
-		m_relation_chain_resolve(&chain, &result);
-		OXR_XRT_POSE_TO_XRPOSEF(result.pose, dst_joint->pose);
+		OXR_XRT_POSE_TO_XRPOSEF(joints[joint_index].pose, dst_joint->pose);
 	}
 	return XR_SUCCESS;
 }
@@ -1811,13 +1811,9 @@ oxr_action_sync_data(struct oxr_logger *log,
 	// Synchronize outputs to this time.
 	int64_t now = time_state_get_now(sess->sys->inst->timekeeping);
 
-	// Loop over all xdev devices.
-	for (size_t i = 0; i < sess->sys->xsysd->xdev_count; i++) {
-		if (sess->sys->xsysd->xdevs[i]) {
-			xrt_result_t xret = xrt_device_update_inputs(sess->sys->xsysd->xdevs[i]);
-			OXR_CHECK_XRET(log, sess, xret, oxr_action_sync_data);
-		}
-	}
+	// Update all xdev devices, in one go when the system devices supports it.
+	xrt_result_t xret = xrt_system_devices_update_inputs(sess->sys->xsysd);
+	OXR_CHECK_XRET(log, sess, xret, oxr_action_sync_data);
 
 	// Reset all action set attachments.
 	for (size_t i = 0; i < sess->action_set_attachment_count; ++i) {
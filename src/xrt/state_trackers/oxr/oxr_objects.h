@@ -133,6 +133,7 @@ struct oxr_xdev_list;
 
 #define XRT_MAX_HANDLE_CHILDREN 256
 #define OXR_MAX_BINDINGS_PER_ACTION 32
+#define OXR_MAX_FRAME_END_SPACES 16
 
 struct time_state;
 
@@ -1857,6 +1858,27 @@ struct oxr_session
 	//! Extra sleep in wait frame.
 	uint32_t frame_timing_wait_sleep_ms;
 
+	/*!
+	 * Spaces located relative to the head device during the current
+	 * xrEndFrame, layers sharing a space and display time reuse the
+	 * relation instead of locating it again.
+	 */
+	struct
+	{
+		struct
+		{
+			struct oxr_space *spc;
+			XrTime time;
+			struct xrt_space_relation T_space_xdev;
+		} entries[OXR_MAX_FRAME_END_SPACES];
+
+		uint32_t entry_count;
+
+		//! Locates avoided and done, exposed through u_var.
+		uint64_t hits;
+		uint64_t misses;
+	} frame_end_spaces;
+
 	/*!
 	 * To pipe swapchain creation to right code.
 	 */
@@ -29,6 +29,7 @@
 
 #include "util/u_debug.h"
 #include "util/u_misc.h"
+#include "util/u_var.h"
 #include "util/u_time.h"
 #include "util/u_visibility_mask.h"
 #include "util/u_verify.h"
@@ -921,6 +922,8 @@ oxr_session_destroy(struct oxr_logger *log, struct oxr_handle_base *hb)
 {
 	struct oxr_session *sess = (struct oxr_session *)hb;
 
+	u_var_remove_root((void *)sess);
+
 	XrResult ret = oxr_event_remove_session_events(log, sess);
 
 	oxr_session_binding_destroy_all(log, sess);
@@ -985,6 +988,11 @@ oxr_session_allocate_and_init(struct oxr_logger *log,
 	u_hashmap_int_create(&sess->act_sets_attachments_by_key);
 	u_hashmap_int_create(&sess->act_attachments_by_key);
 
+	// Debug gui.
+	u_var_add_root((void *)sess, "XrSession", true);
+	u_var_add_ro_u64(sess, &sess->frame_end_spaces.hits, "Layer space cache hits");
+	u_var_add_ro_u64(sess, &sess->frame_end_spaces.misses, "Layer space cache misses");
+
 	// Done with basic init, set out variable.
 	*out_session = sess;
 
@@ -1348,18 +1356,25 @@ oxr_session_hand_joints(struct oxr_logger *log,
 	// We know we are active.
 	locations->isActive = true;
 
+	// Validated to be XR_HAND_JOINT_COUNT_EXT by the API function.
+	assert(locations->jointCount <= XRT_HAND_JOINT_COUNT);
+
+	// All joints go through the same hand pose, so resolve them in one batch.
+	struct xrt_space_relation joints[XRT_HAND_JOINT_COUNT];
+	for (uint32_t i = 0; i < locations->jointCount; i++) {
+		joints[i] = value.values.hand_joint_set_default[i].relation;
+	}
+
+	struct xrt_relation_chain chain = {0};
+	m_relation_chain_push_relation(&chain, &T_base_hand);
+	m_relation_chain_resolve_batch(&chain, joints, locations->jointCount, joints);
+
 	for (uint32_t i = 0; i < locations->jointCount; i++) {
 		locations->jointLocations[i].locationFlags =
 		    xrt_to_xr_space_location_flags(value.values.hand_joint_set_default[i].relation.relation_flags);
 		locations->jointLocations[i].radius = value.values.hand_joint_set_default[i].radius;
 
-		struct xrt_space_relation r = value.values.hand_joint_set_default[i].relation;
-
-		struct xrt_space_relation result;
-		struct xrt_relation_chain chain = {0};
-		m_relation_chain_push_relation(&chain, &r);
-		m_relation_chain_push_relation(&chain, &T_base_hand);
-		m_relation_chain_resolve(&chain, &result);
+		const struct xrt_space_relation result = joints[i];
 
 		xrt_to_xr_pose(&result.pose, &locations->jointLocations[i].pose);
 
@@ -1165,6 +1165,46 @@ verify_passthrough_layer(struct xrt_compositor *xc,
  *
  */
 
+/*!
+ * Locates @p spc relative to the head device, each distinct space and time is
+ * only located once per xrEndFrame as that can be a round trip to the service.
+ */
+static bool
+locate_space_cached(struct oxr_logger *log,
+                    struct oxr_session *sess,
+                    struct oxr_space *spc,
+                    XrTime time,
+                    struct xrt_space_relation *out_T_space_xdev)
+{
+	for (uint32_t i = 0; i < sess->frame_end_spaces.entry_count; i++) {
+		if (sess->frame_end_spaces.entries[i].spc == spc && sess->frame_end_spaces.entries[i].time == time) {
+			*out_T_space_xdev = sess->frame_end_spaces.entries[i].T_space_xdev;
+			sess->frame_end_spaces.hits++;
+			return true;
+		}
+	}
+
+	struct xrt_device *head_xdev = GET_XDEV_BY_ROLE(sess->sys, head);
+
+	XrResult ret = oxr_space_locate_device(log, head_xdev, spc, time, out_T_space_xdev);
+	if (ret != XR_SUCCESS) {
+		return false;
+	}
+
+	sess->frame_end_spaces.misses++;
+
+	// When full the relation is still correct, just not reused.
+	uint32_t index = sess->frame_end_spaces.entry_count;
+	if (index < ARRAY_SIZE(sess->frame_end_spaces.entries)) {
+		sess->frame_end_spaces.entries[index].spc = spc;
+		sess->frame_end_spaces.entries[index].time = time;
+		sess->frame_end_spaces.entries[index].T_space_xdev = *out_T_space_xdev;
+		sess->frame_end_spaces.entry_count++;
+	}
+
+	return true;
+}
+
 /**
  * Turn the poses supplied with a composition layer into the poses the compositor wants.
  *
@@ -1208,11 +1248,8 @@ handle_space(struct oxr_logger *log,
 	}
 
 	// The compositor doesn't know about spaces, so we want the space in the xdev's "space".
-	struct xrt_device *head_xdev = GET_XDEV_BY_ROLE(sess->sys, head);
 	struct xrt_space_relation T_space_xdev = XRT_SPACE_RELATION_ZERO;
-
-	XrResult ret = oxr_space_locate_device(log, head_xdev, spc, timestamp, &T_space_xdev);
-	if (ret != XR_SUCCESS) {
+	if (!locate_space_cached(log, sess, spc, timestamp, &T_space_xdev)) {
 		return false;
 	}
 	if (T_space_xdev.relation_flags == 0) {
@@ -1796,6 +1833,9 @@ oxr_session_frame_end(struct oxr_logger *log, struct oxr_session *sess, const Xr
 	    .env_blend_mode = blend_mode,
 	};
 
+	// Spaces may have moved since the last frame.
+	sess->frame_end_spaces.entry_count = 0;
+
 	xrt_result_t xret;
 	xret = xrt_comp_layer_begin(xc, &data);
 	OXR_CHECK_XRET(log, sess, xret, xrt_comp_layer_begin);
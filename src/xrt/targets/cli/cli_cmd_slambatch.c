@@ -8,19 +8,46 @@
 
 #include "euroc/euroc_interface.h"
 #include "os/os_threading.h"
+#include "util/u_json.h"
 #include "util/u_logging.h"
+#include "util/u_misc.h"
 #include "xrt/xrt_config_build.h"
 #include "xrt/xrt_config_have.h"
 #include "xrt/xrt_config_drivers.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define P(...) fprintf(stderr, __VA_ARGS__)
 #define I(...) U_LOG(U_LOGGING_INFO, __VA_ARGS__)
 
 #if defined(XRT_FEATURE_SLAM) && defined(XRT_BUILD_DRIVER_EUROC)
 
-static bool should_exit = false;
+#include <signal.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+//! State of a single dataset run.
+struct slambatch_run
+{
+	const char *dataset_path;
+	const char *slam_config;
+	const char *output_path;
+
+	pid_t pid;             //!< Process running the dataset, 0 if not started or finished
+	bool started;          //!< Whether the dataset was launched
+	bool interrupted;      //!< Whether the process was still running when the batch was interrupted
+	int status;            //!< Exit status of the process, -1 if it did not exit normally
+	timepoint_ns start_ns; //!< When the process was launched
+	timepoint_ns end_ns;   //!< When the process was reaped
+};
+
+static volatile bool should_exit = false;
 
 static void *
 wait_for_exit_key(void *ptr)
@@ -29,6 +56,264 @@ wait_for_exit_key(void *ptr)
 	should_exit = true;
 	return NULL;
 }
+
+static void
+print_usage(const char **argv)
+{
+	P("Batch evaluator of SLAM datasets.\n");
+	P("Usage: %s %s [-j <jobs>] [-r <report>] [<euroc_path> <slam_config> <output_path>]...\n", argv[0], argv[1]);
+	P("  -j <jobs>    Number of datasets to run in parallel processes (default 1).\n");
+	P("  -r <report>  Write <report>.json and <report>.csv with the throughput, latency\n");
+	P("               and ground truth errors of each run (default slambatch_report).\n");
+}
+
+/*
+ *
+ * Report.
+ *
+ */
+
+//! Reads the summary.json the SLAM tracker writes into the output path.
+static cJSON *
+load_summary(const struct slambatch_run *run)
+{
+	char path[1024];
+	(void)snprintf(path, sizeof(path), "%s/summary.json", run->output_path);
+
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		return NULL;
+	}
+
+	(void)fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	(void)fseek(file, 0, SEEK_SET);
+
+	char *str = U_TYPED_ARRAY_CALLOC(char, size + 1);
+	size_t read = fread(str, 1, size, file);
+	(void)fclose(file);
+	str[read] = '\0';
+
+	cJSON *summary = cJSON_Parse(str);
+	free(str);
+
+	return summary;
+}
+
+static double
+get_number(const cJSON *summary, const char *object, const char *field)
+{
+	const cJSON *obj = object != NULL ? cJSON_GetObjectItemCaseSensitive(summary, object) : summary;
+	const cJSON *item = cJSON_GetObjectItemCaseSensitive(obj, field);
+	return cJSON_IsNumber(item) ? item->valuedouble : 0;
+}
+
+static void
+write_report(struct slambatch_run *runs, int run_count, const char *report, timepoint_ns total_ns)
+{
+	char path[1024];
+
+	(void)snprintf(path, sizeof(path), "%s.csv", report);
+	FILE *csv = fopen(path, "w");
+	if (csv == NULL) {
+		U_LOG_E("Could not open '%s'", path);
+		return;
+	}
+
+	fprintf(csv,
+	        "dataset,slam_config,output,status,wall_s,frames,poses,throughput_fps,"
+	        "latency_ms_mean,latency_ms_median,latency_ms_p90,latency_ms_p99,latency_ms_max,"
+	        "ate_m_rmse,ate_m_max,rpe_m_rmse,rpe_m_max\n");
+
+	cJSON *root = cJSON_CreateObject();
+	cJSON_AddNumberToObject(root, "total_wall_s", (double)total_ns / U_TIME_1S_IN_NS);
+	cJSON *datasets = cJSON_AddArrayToObject(root, "datasets");
+
+	for (int i = 0; i < run_count; i++) {
+		struct slambatch_run *run = &runs[i];
+		if (!run->started || run->interrupted) {
+			continue;
+		}
+
+		double wall_s = (double)(run->end_ns - run->start_ns) / U_TIME_1S_IN_NS;
+		cJSON *summary = load_summary(run);
+		if (summary == NULL) {
+			U_LOG_W("No summary.json in '%s', was SLAM_WRITE_CSVS disabled?", run->output_path);
+			summary = cJSON_CreateObject();
+		}
+
+		fprintf(csv, "%s,%s,%s,%d,%f,%.0f,%.0f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f\n", //
+		        run->dataset_path, run->slam_config, run->output_path, run->status, wall_s,
+		        get_number(summary, NULL, "frames"), get_number(summary, NULL, "poses"),
+		        get_number(summary, NULL, "throughput_fps"), get_number(summary, "latency_ms", "mean"),
+		        get_number(summary, "latency_ms", "median"), get_number(summary, "latency_ms", "p90"),
+		        get_number(summary, "latency_ms", "p99"), get_number(summary, "latency_ms", "max"),
+		        get_number(summary, "ate_m", "rmse"), get_number(summary, "ate_m", "max"),
+		        get_number(summary, "rpe_m", "rmse"), get_number(summary, "rpe_m", "max"));
+
+		cJSON_AddStringToObject(summary, "dataset", run->dataset_path);
+		cJSON_AddStringToObject(summary, "slam_config", run->slam_config);
+		cJSON_AddStringToObject(summary, "output", run->output_path);
+		cJSON_AddNumberToObject(summary, "status", run->status);
+		cJSON_AddNumberToObject(summary, "wall_s", wall_s);
+		cJSON_AddItemToArray(datasets, summary);
+	}
+
+	(void)fclose(csv);
+	I("Wrote report to %s", path);
+
+	(void)snprintf(path, sizeof(path), "%s.json", report);
+	FILE *json = fopen(path, "w");
+	if (json == NULL) {
+		U_LOG_E("Could not open '%s'", path);
+		cJSON_Delete(root);
+		return;
+	}
+
+	char *str = cJSON_Print(root);
+	fprintf(json, "%s\n", str);
+	cJSON_free(str);
+	cJSON_Delete(root);
+
+	(void)fclose(json);
+	I("Wrote report to %s", path);
+}
+
+
+/*
+ *
+ * Running.
+ *
+ */
+
+static void
+handle_sigterm(int signum)
+{
+	(void)signum;
+	should_exit = true;
+}
+
+/*!
+ * Runs a single dataset in this process, used by the processes spawned by
+ * @ref spawn_run. SIGTERM stops the dataset the same way the exit key does.
+ */
+static int
+run_single(const char *dataset_path, const char *slam_config, const char *output_path)
+{
+	struct sigaction sa = {0};
+	sa.sa_handler = handle_sigterm;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGTERM, &sa, NULL);
+
+	euroc_run_dataset(dataset_path, slam_config, output_path, &should_exit);
+	return EXIT_SUCCESS;
+}
+
+/*!
+ * Launches a fresh cli process running the dataset, forking this process
+ * would copy the exit key thread's state into a child that doesn't run it.
+ */
+static bool
+spawn_run(struct slambatch_run *run)
+{
+	char *const child_argv[] = {
+	    (char *)"monado-cli",      //
+	    (char *)"slambatch",       //
+	    (char *)"--run",           //
+	    (char *)run->dataset_path, //
+	    (char *)run->slam_config,  //
+	    (char *)run->output_path,  //
+	    NULL,                      //
+	};
+
+	pid_t pid = 0;
+	int ret = posix_spawn(&pid, "/proc/self/exe", NULL, NULL, child_argv, environ);
+	if (ret != 0) {
+		U_LOG_E("Failed to spawn process for dataset '%s': %s", run->dataset_path, strerror(ret));
+		return false;
+	}
+
+	run->pid = pid;
+	return true;
+}
+
+static void
+reap_finished(struct slambatch_run *runs, int run_count, int *running)
+{
+	int status = 0;
+	pid_t pid = 0;
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+		for (int i = 0; i < run_count; i++) {
+			struct slambatch_run *run = &runs[i];
+			if (run->pid != pid) {
+				continue;
+			}
+
+			run->pid = 0;
+			run->end_ns = os_monotonic_get_ns();
+			run->status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+			(*running)--;
+
+			I("Finished dataset %d out of %d in %.2fs: %s", i + 1, run_count,
+			  (double)(run->end_ns - run->start_ns) / U_TIME_1S_IN_NS, run->dataset_path);
+		}
+	}
+}
+
+static void
+run_all(struct slambatch_run *runs, int run_count, int jobs, const char *report)
+{
+	timepoint_ns start_ns = os_monotonic_get_ns();
+	bool interrupted = false;
+
+	int next = 0;
+	int running = 0;
+
+	while ((next < run_count && !should_exit) || running > 0) {
+		while (running < jobs && next < run_count && !should_exit) {
+			struct slambatch_run *run = &runs[next++];
+
+			I("Running dataset %d out of %d", next, run_count);
+			I("Dataset path: %s", run->dataset_path);
+			I("SLAM config path: %s", run->slam_config);
+			I("Output path: %s", run->output_path);
+
+			run->start_ns = os_monotonic_get_ns();
+			if (!spawn_run(run)) {
+				continue;
+			}
+
+			run->started = true;
+			running++;
+		}
+
+		os_nanosleep(100 * U_TIME_1MS_IN_NS);
+		reap_finished(runs, run_count, &running);
+
+		if (should_exit && !interrupted) {
+			interrupted = true;
+
+			for (int i = 0; i < run_count; i++) {
+				runs[i].interrupted = runs[i].pid > 0;
+			}
+
+			// Keep what has finished even if the rest take long to stop.
+			write_report(runs, run_count, report, os_monotonic_get_ns() - start_ns);
+
+			for (int i = 0; i < run_count; i++) {
+				if (runs[i].pid > 0) {
+					kill(runs[i].pid, SIGTERM);
+				}
+			}
+		}
+	}
+
+	if (!interrupted) {
+		write_report(runs, run_count, report, os_monotonic_get_ns() - start_ns);
+	}
+}
+
+
 #endif
 
 int
@@ -46,31 +331,46 @@ cli_cmd_slambatch(int argc, const char **argv)
 	int nof_args = argc - 2;
 	const char **args = &argv[2];
 
-	if (nof_args == 0 || nof_args % 3 != 0) {
-		P("Batch evaluator of SLAM datasets.\n");
-		P("Usage: %s %s [<euroc_path> <slam_config> <output_path>]...\n", argv[0], argv[1]);
+	// A single dataset launched by another slambatch.
+	if (nof_args == 4 && strcmp(args[0], "--run") == 0) {
+		return run_single(args[1], args[2], args[3]);
+	}
+
+	int jobs = 1;
+	const char *report = "slambatch_report";
+	while (nof_args >= 2 && args[0][0] == '-') {
+		if (strcmp(args[0], "-j") == 0) {
+			jobs = atoi(args[1]);
+		} else if (strcmp(args[0], "-r") == 0) {
+			report = args[1];
+		} else {
+			break;
+		}
+		nof_args -= 2;
+		args += 2;
+	}
+
+	if (nof_args == 0 || nof_args % 3 != 0 || jobs < 1) {
+		print_usage(argv);
 		return EXIT_FAILURE;
 	}
 
+	int nof_datasets = nof_args / 3;
+	struct slambatch_run *runs = U_TYPED_ARRAY_CALLOC(struct slambatch_run, nof_datasets);
+	for (int i = 0; i < nof_datasets; i++) {
+		runs[i].dataset_path = args[i * 3];
+		runs[i].slam_config = args[i * 3 + 1];
+		runs[i].output_path = args[i * 3 + 2];
+		runs[i].status = -1;
+	}
+
 	// Allow pressing enter to quit the program by launching a new thread
 	struct os_thread_helper wfk_thread;
 	os_thread_helper_init(&wfk_thread);
 	os_thread_helper_start(&wfk_thread, wait_for_exit_key, NULL);
 
 	timepoint_ns start_time = os_monotonic_get_ns();
-	int nof_datasets = nof_args / 3;
-	for (int i = 0; i < nof_datasets && !should_exit; i++) {
-		const char *dataset_path = args[i * 3];
-		const char *slam_config = args[i * 3 + 1];
-		const char *output_path = args[i * 3 + 2];
-
-		I("Running dataset %d out of %d", i + 1, nof_datasets);
-		I("Dataset path: %s", dataset_path);
-		I("SLAM config path: %s", slam_config);
-		I("Output path: %s", output_path);
-
-		euroc_run_dataset(dataset_path, slam_config, output_path, &should_exit);
-	}
+	run_all(runs, nof_datasets, jobs, report);
 	timepoint_ns end_time = os_monotonic_get_ns();
 
 	pthread_cancel(wfk_thread.thread);
@@ -78,6 +378,8 @@ cli_cmd_slambatch(int argc, const char **argv)
 	// Destroy also stops the thread.
 	os_thread_helper_destroy(&wfk_thread);
 
+	free(runs);
+
 	printf("Done in %.2fs.\n", (double)(end_time - start_time) / U_TIME_1S_IN_NS);
 #endif
 	return EXIT_SUCCESS;
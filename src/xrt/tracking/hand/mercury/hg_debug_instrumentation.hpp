@@ -48,6 +48,25 @@ struct hg_tuneable_values
 	bool detection_model_in_both_views = false;
 };
 
+/*!
+ * Wall clock time of the stages of the last frame, in milliseconds.
+ */
+struct hg_stage_timings
+{
+	float detection_ms;
+
+	//! Whole keypoint stage, from preparing the inputs to interpreting the outputs.
+	float keypoint_ms;
+
+	//! Preparing the keypoint model inputs, only measured in batched mode.
+	float keypoint_prepare_ms;
+
+	//! The keypoint model call, only measured in batched mode.
+	float keypoint_model_ms;
+
+	float optimizer_ms;
+};
+
 struct hg_tuneable_values *
 t_hand_tracking_sync_mercury_get_tuneable_values_pointer(struct t_hand_tracking_sync *ht_sync);
 
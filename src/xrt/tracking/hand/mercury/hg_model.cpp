@@ -14,11 +14,16 @@
 #include "hg_numerics_checker.hpp"
 
 
+#include "os/os_time.h"
+
 #include <filesystem>
 #include <array>
 
 namespace xrt::tracking::hand::mercury {
 
+static constexpr const char *kDetectionModelFile = "grayscale_detection_160x160.onnx";
+static constexpr const char *kKeypointModelFile = "grayscale_keypoint_jan18.onnx";
+
 #define ORT(expr)                                                                                                      \
 	do {                                                                                                           \
 		OrtStatus *status = wrap->api->expr;                                                                   \
@@ -263,6 +268,23 @@ normalizeGrayscaleImage(cv::Mat &data_in, cv::Mat &data_out)
 	return true;
 }
 
+static void
+append_execution_provider(HandTracking *hgt, onnx_wrap *wrap, OrtSessionOptions *opts)
+{
+	const char *provider = hgt->inference.provider;
+	if (provider == nullptr || strcmp(provider, "CPU") == 0) {
+		return;
+	}
+
+	// Not fatal, ORT falls back to the CPU provider.
+	OrtStatus *status = wrap->api->SessionOptionsAppendExecutionProvider(opts, provider, nullptr, nullptr, 0);
+	if (status != nullptr) {
+		HG_WARN(hgt, "Could not use execution provider '%s', using CPU: %s", provider,
+		        wrap->api->GetErrorMessage(status));
+		wrap->api->ReleaseStatus(status);
+	}
+}
+
 void
 setup_ort_api(HandTracking *hgt, onnx_wrap *wrap, std::filesystem::path path)
 {
@@ -272,7 +294,8 @@ setup_ort_api(HandTracking *hgt, onnx_wrap *wrap, std::filesystem::path path)
 	ORT(CreateSessionOptions(&opts));
 
 	ORT(SetSessionGraphOptimizationLevel(opts, ORT_ENABLE_ALL));
-	ORT(SetIntraOpNumThreads(opts, 1));
+	ORT(SetIntraOpNumThreads(opts, hgt->inference.intra_op_threads));
+	append_execution_provider(hgt, wrap, opts);
 
 	ORT(CreateEnv(ORT_LOGGING_LEVEL_FATAL, "monado_ht", &wrap->env));
 
@@ -317,7 +340,7 @@ init_hand_detection(HandTracking *hgt, onnx_wrap *wrap)
 {
 	std::filesystem::path path = hgt->models_folder;
 
-	path /= "grayscale_detection_160x160.onnx";
+	path /= kDetectionModelFile;
 
 	wrap->wraps.clear();
 
@@ -327,58 +350,46 @@ init_hand_detection(HandTracking *hgt, onnx_wrap *wrap)
 }
 
 
-void
-run_hand_detection(void *ptr)
+static void
+prepare_hand_detection(hand_detection_run_info *info)
 {
 	XRT_TRACE_MARKER();
 
-	hand_detection_run_info *info = (hand_detection_run_info *)ptr;
 	ht_view *view = info->view;
-	HandTracking *hgt = view->hgt;
-	onnx_wrap *wrap = &view->detection;
 
 	cv::Mat &orig_data = view->run_model_on_this;
 
-	cv::Mat binned_uint8;
-
 	xrt_size desired_bin_size;
 	desired_bin_size.h = kDetectionInputSize;
 	desired_bin_size.w = kDetectionInputSize;
 
-	cv::Matx23f go_back = blackbar(orig_data, view->camera_info.camera_orientation, binned_uint8, desired_bin_size);
+	info->go_back =
+	    blackbar(orig_data, view->camera_info.camera_orientation, info->binned_uint8, desired_bin_size);
 
 	cv::Mat binned_float_wrapper_mat(cv::Size(kDetectionInputSize, kDetectionInputSize),
-	                                 CV_32FC1,            //
-	                                 wrap->wraps[0].data, //
+	                                 CV_32FC1,    //
+	                                 info->input, //
 	                                 kDetectionInputSize * sizeof(float));
 
-	normalizeGrayscaleImage(binned_uint8, binned_float_wrapper_mat);
-
-	const OrtValue *inputs[] = {wrap->wraps[0].tensor};
-	const char *input_names[] = {wrap->wraps[0].name};
-
-	OrtValue *output_tensors[] = {nullptr, nullptr, nullptr, nullptr};
-	const char *output_names[] = {"hand_exists", "cx", "cy", "size"};
-
-	{
-		XRT_TRACE_IDENT(model);
-		static_assert(ARRAY_SIZE(input_names) == ARRAY_SIZE(inputs));
-		static_assert(ARRAY_SIZE(output_names) == ARRAY_SIZE(output_tensors));
-		ORT(Run(wrap->session, nullptr, input_names, inputs, ARRAY_SIZE(input_names), output_names,
-		        ARRAY_SIZE(output_names), output_tensors));
-	}
-
-	float *hand_exists = nullptr;
-	float *cx = nullptr;
-	float *cy = nullptr;
-	float *sizee = nullptr;
-
-	ORT(GetTensorMutableData(output_tensors[0], (void **)&hand_exists));
-	ORT(GetTensorMutableData(output_tensors[1], (void **)&cx));
-	ORT(GetTensorMutableData(output_tensors[2], (void **)&cy));
-	ORT(GetTensorMutableData(output_tensors[3], (void **)&sizee));
+	normalizeGrayscaleImage(info->binned_uint8, binned_float_wrapper_mat);
+}
 
+static void
+prepare_hand_detection_job(void *ptr)
+{
+	prepare_hand_detection((hand_detection_run_info *)ptr);
+}
 
+static void
+process_hand_detection(hand_detection_run_info *info,
+                       const float *hand_exists,
+                       const float *cx,
+                       const float *cy,
+                       const float *sizee)
+{
+	ht_view *view = info->view;
+	HandTracking *hgt = view->hgt;
+	const cv::Matx23f &go_back = info->go_back;
 
 	for (int hand_idx = 0; hand_idx < 2; hand_idx++) {
 		hand_region_of_interest &output = info->outputs[hand_idx];
@@ -420,9 +431,49 @@ run_hand_detection(void *ptr)
 			int start_y = top_of_rect_y + ((kDetectionInputSize + kVisSpacerSize) * view->view);
 			cv::Rect p = cv::Rect(left_of_rect_x, start_y, kDetectionInputSize, kDetectionInputSize);
 
-			binned_uint8.copyTo(hgt->visualizers.mat(p));
+			info->binned_uint8.copyTo(hgt->visualizers.mat(p));
 		}
 	}
+}
+
+void
+run_hand_detection(void *ptr)
+{
+	XRT_TRACE_MARKER();
+
+	hand_detection_run_info *info = (hand_detection_run_info *)ptr;
+	ht_view *view = info->view;
+	HandTracking *hgt = view->hgt;
+	onnx_wrap *wrap = &view->detection;
+
+	info->input = wrap->wraps[0].data;
+	prepare_hand_detection(info);
+
+	const OrtValue *inputs[] = {wrap->wraps[0].tensor};
+	const char *input_names[] = {wrap->wraps[0].name};
+
+	OrtValue *output_tensors[] = {nullptr, nullptr, nullptr, nullptr};
+	const char *output_names[] = {"hand_exists", "cx", "cy", "size"};
+
+	{
+		XRT_TRACE_IDENT(model);
+		static_assert(ARRAY_SIZE(input_names) == ARRAY_SIZE(inputs));
+		static_assert(ARRAY_SIZE(output_names) == ARRAY_SIZE(output_tensors));
+		ORT(Run(wrap->session, nullptr, input_names, inputs, ARRAY_SIZE(input_names), output_names,
+		        ARRAY_SIZE(output_names), output_tensors));
+	}
+
+	float *hand_exists = nullptr;
+	float *cx = nullptr;
+	float *cy = nullptr;
+	float *sizee = nullptr;
+
+	ORT(GetTensorMutableData(output_tensors[0], (void **)&hand_exists));
+	ORT(GetTensorMutableData(output_tensors[1], (void **)&cx));
+	ORT(GetTensorMutableData(output_tensors[2], (void **)&cy));
+	ORT(GetTensorMutableData(output_tensors[3], (void **)&sizee));
+
+	process_hand_detection(info, hand_exists, cx, cy, sizee);
 
 	for (size_t i = 0; i < ARRAY_SIZE(output_tensors); i++) {
 		wrap->api->ReleaseValue(output_tensors[i]);
@@ -430,34 +481,55 @@ run_hand_detection(void *ptr)
 }
 
 void
-init_keypoint_estimation(HandTracking *hgt, onnx_wrap *wrap)
+run_hand_detection_batched(HandTracking *hgt, hand_detection_run_info *infos, uint32_t count)
 {
+	XRT_TRACE_MARKER();
 
-	std::filesystem::path path = hgt->models_folder;
+	assert(count > 0 && count <= kMaxInferenceBatch);
 
-	path /= "grayscale_keypoint_jan18.onnx";
+	onnx_batched_wrap *bw = &hgt->detection_batched;
+	onnx_wrap *wrap = &bw->wrap;
 
-	wrap->wraps.clear();
+	const batched_tensor &input = bw->input("inputImg");
+	for (uint32_t i = 0; i < count; i++) {
+		infos[i].input = input.item(i);
+	}
 
+	if (count == 1) {
+		prepare_hand_detection(&infos[0]);
+	} else {
+		for (uint32_t i = 0; i < count; i++) {
+			u_worker_group_push(hgt->group, prepare_hand_detection_job, &infos[i]);
+		}
+		u_worker_group_wait_all(hgt->group);
+	}
 
-	wrap->api = OrtGetApiBase()->GetApi(ORT_API_VERSION);
+	{
+		XRT_TRACE_IDENT(model);
+		ORT(RunWithBinding(wrap->session, nullptr, bw->bindings[count - 1]));
+	}
 
+	const batched_tensor &hand_exists = bw->output("hand_exists");
+	const batched_tensor &cx = bw->output("cx");
+	const batched_tensor &cy = bw->output("cy");
+	const batched_tensor &sizee = bw->output("size");
 
-	OrtSessionOptions *opts = nullptr;
-	ORT(CreateSessionOptions(&opts));
+	for (uint32_t i = 0; i < count; i++) {
+		process_hand_detection(&infos[i], hand_exists.item(i), cx.item(i), cy.item(i), sizee.item(i));
+	}
+}
 
-	// TODO review options, config for threads?
-	ORT(SetSessionGraphOptimizationLevel(opts, ORT_ENABLE_ALL));
-	ORT(SetIntraOpNumThreads(opts, 1));
+void
+init_keypoint_estimation(HandTracking *hgt, onnx_wrap *wrap)
+{
 
+	std::filesystem::path path = hgt->models_folder;
 
-	ORT(CreateEnv(ORT_LOGGING_LEVEL_FATAL, "monado_ht", &wrap->env));
+	path /= kKeypointModelFile;
 
-	ORT(CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &wrap->meminfo));
+	wrap->wraps.clear();
 
-	// HG_DEBUG(this->device, "Loading hand detection model from file '%s'", path.c_str());
-	ORT(CreateSession(wrap->env, path.c_str(), opts, &wrap->session));
-	assert(wrap->session != NULL);
+	setup_ort_api(hgt, wrap, path);
 
 	// size_t input_size = wrap->input_shape[0] * wrap->input_shape[1] * wrap->input_shape[2] *
 	// wrap->input_shape[3];
@@ -542,9 +614,6 @@ init_keypoint_estimation(HandTracking *hgt, onnx_wrap *wrap)
 		assert(is_tensor);
 		wrap->wraps.push_back(inputimg);
 	}
-
-
-	wrap->api->ReleaseSessionOptions(opts);
 }
 
 enum xrt_hand_joint joints_ml_to_xr[21]{
@@ -633,24 +702,20 @@ set_predicted_zero(float *data)
 	}
 }
 
-void
-run_keypoint_estimation(void *ptr)
+static void
+prepare_keypoint_estimation(keypoint_estimation_run_info &info)
 {
 	XRT_TRACE_MARKER();
-	keypoint_estimation_run_info info = *(keypoint_estimation_run_info *)ptr;
 
-	onnx_wrap *wrap = &info.view->keypoint[info.hand_idx];
 	struct HandTracking *hgt = info.view->hgt;
 
 	int view_idx = info.view->view;
 	int hand_idx = info.hand_idx;
 	one_frame_one_view &this_output = hgt->keypoint_outputs[hand_idx].views[view_idx];
-	MLOutput2D &px_coord = this_output.keypoints_in_scaled_stereographic;
-	// Factor out starting here
 
 	hand_region_of_interest &output = info.view->regions_of_interest_this_frame[hand_idx];
 
-	cv::Mat data_128x128_uint8;
+	cv::Mat &data_128x128_uint8 = info.input_uint8;
 
 	projection_instructions instr(info.view->hgdist);
 	instr.rot_quat = Eigen::Quaternionf::Identity();
@@ -709,8 +774,8 @@ run_keypoint_estimation(void *ptr)
 		make_projection_instructions_angular(center, hand_idx, angle,
 		                                     hgt->tuneable_values.after_detection_fac.val, twist, instr);
 
-		wrap->wraps[2].data[0] = 0.0f;
-		set_predicted_zero(wrap->wraps[1].data);
+		info.input_use_last_keypoints[0] = 0.0f;
+		set_predicted_zero(info.input_last_keypoints);
 	} else {
 		Eigen::Array<float, 3, 21> keypoints_in_camera;
 
@@ -736,17 +801,17 @@ run_keypoint_estimation(void *ptr)
 
 		if (hgt->tuneable_values.enable_pose_predicted_input) {
 			for (int ml_joint_idx = 0; ml_joint_idx < 21; ml_joint_idx++) {
-				float *data = wrap->wraps[1].data;
+				float *data = info.input_last_keypoints;
 				data[(ml_joint_idx * 2) + 0] = bleh[ml_joint_idx].pos_2d.x;
 				data[(ml_joint_idx * 2) + 1] = bleh[ml_joint_idx].pos_2d.y;
 				// data[(ml_joint_idx * 2) + 2] = bleh[ml_joint_idx].depth_relative_to_midpxm;
 			}
 
 
-			wrap->wraps[2].data[0] = 1.0f;
+			info.input_use_last_keypoints[0] = 1.0f;
 		} else {
-			wrap->wraps[2].data[0] = 0.0f;
-			set_predicted_zero(wrap->wraps[1].data);
+			info.input_use_last_keypoints[0] = 0.0f;
+			set_predicted_zero(info.input_last_keypoints);
 		}
 	}
 
@@ -758,44 +823,40 @@ run_keypoint_estimation(void *ptr)
 	xrt::auxiliary::math::map_quat(this_output.look_dir) = instr.rot_quat;
 	this_output.stereographic_radius = instr.stereographic_radius;
 
-	bool is_hand = true;
-
 	{
 		XRT_TRACE_IDENT(convert_format);
 
-		// here!
-		cv::Mat data_128x128_float(cv::Size(128, 128), CV_32FC1, wrap->wraps[0].data, 128 * sizeof(float));
+		cv::Mat data_128x128_float(cv::Size(128, 128), CV_32FC1, info.input_img, 128 * sizeof(float));
 
-		is_hand = is_hand && normalizeGrayscaleImage(data_128x128_uint8, data_128x128_float);
+		info.input_ok = normalizeGrayscaleImage(data_128x128_uint8, data_128x128_float);
 	}
+}
 
+static void
+prepare_keypoint_estimation_job(void *ptr)
+{
+	prepare_keypoint_estimation(*(keypoint_estimation_run_info *)ptr);
+}
 
-	// Ending here
-
-
-	const OrtValue *inputs[] = {wrap->wraps[0].tensor, wrap->wraps[1].tensor, wrap->wraps[2].tensor};
-	const char *input_names[] = {wrap->wraps[0].name, wrap->wraps[1].name, wrap->wraps[2].name};
-
-	OrtValue *output_tensors[] = {nullptr, nullptr, nullptr, nullptr};
-	const char *output_names[] = {"heatmap_xy", "heatmap_depth", "scalar_extras", "curls"};
-
-	{
-		XRT_TRACE_IDENT(model);
-		assert(ARRAY_SIZE(input_names) == ARRAY_SIZE(inputs));
-		assert(ARRAY_SIZE(output_names) == ARRAY_SIZE(output_tensors));
-		ORT(Run(wrap->session, nullptr, input_names, inputs, ARRAY_SIZE(input_names), output_names,
-		        ARRAY_SIZE(output_names), output_tensors));
-	}
-
-	// To here
-
-	// Interpret model outputs!
-
+// Interpret model outputs!
+static void
+process_keypoint_estimation(keypoint_estimation_run_info &info,
+                            float *out_data,
+                            float *out_data_depth,
+                            const float *out_data_extras,
+                            const float *out_data_curls)
+{
+	XRT_TRACE_MARKER();
 
-	float *out_data = nullptr;
+	struct HandTracking *hgt = info.view->hgt;
 
+	int view_idx = info.view->view;
+	int hand_idx = info.hand_idx;
+	one_frame_one_view &this_output = hgt->keypoint_outputs[hand_idx].views[view_idx];
+	MLOutput2D &px_coord = this_output.keypoints_in_scaled_stereographic;
 
-	ORT(GetTensorMutableData(output_tensors[0], (void **)&out_data));
+	cv::Mat &data_128x128_uint8 = info.input_uint8;
+	bool is_hand = info.input_ok;
 
 	// I don't know why this was added
 	// float *confidences = info.view->keypoint_outputs.views[hand_idx].confidences;
@@ -839,9 +900,6 @@ run_keypoint_estimation(void *ptr)
 	}
 
 
-	float *out_data_depth = nullptr;
-	ORT(GetTensorMutableData(output_tensors[1], (void **)&out_data_depth));
-
 	for (int joint_idx = 0; joint_idx < 21; joint_idx++) {
 		float *p_ptr = &out_data_depth[(joint_idx * 22)];
 
@@ -860,9 +918,6 @@ run_keypoint_estimation(void *ptr)
 		}
 	}
 
-	float *out_data_extras = nullptr;
-	ORT(GetTensorMutableData(output_tensors[2], (void **)&out_data_extras));
-
 	float is_hand_explicit = out_data_extras[0];
 
 	is_hand_explicit = (1.0) / (1.0 + powf(2.71828182845904523536, -is_hand_explicit));
@@ -878,9 +933,6 @@ run_keypoint_estimation(void *ptr)
 	this_output.active = is_hand;
 
 
-	float *out_data_curls = nullptr;
-	ORT(GetTensorMutableData(output_tensors[3], (void **)&out_data_curls));
-
 	for (int i = 0; i < 5; i++) {
 		float curl = out_data_curls[i];
 		float variance = out_data_curls[5 + i];
@@ -965,22 +1017,371 @@ run_keypoint_estimation(void *ptr)
 			cv::line(hgt->visualizers.mat, center, pt2, {0}, 1);
 		}
 	}
+}
+
+void
+run_keypoint_estimation(void *ptr)
+{
+	XRT_TRACE_MARKER();
+
+	keypoint_estimation_run_info &info = *(keypoint_estimation_run_info *)ptr;
+
+	onnx_wrap *wrap = &info.view->keypoint[info.hand_idx];
+	struct HandTracking *hgt = info.view->hgt;
+
+	info.input_img = wrap->wraps[0].data;
+	info.input_last_keypoints = wrap->wraps[1].data;
+	info.input_use_last_keypoints = wrap->wraps[2].data;
+	prepare_keypoint_estimation(info);
+
+	const OrtValue *inputs[] = {wrap->wraps[0].tensor, wrap->wraps[1].tensor, wrap->wraps[2].tensor};
+	const char *input_names[] = {wrap->wraps[0].name, wrap->wraps[1].name, wrap->wraps[2].name};
+
+	OrtValue *output_tensors[] = {nullptr, nullptr, nullptr, nullptr};
+	const char *output_names[] = {"heatmap_xy", "heatmap_depth", "scalar_extras", "curls"};
+
+	{
+		XRT_TRACE_IDENT(model);
+		static_assert(ARRAY_SIZE(input_names) == ARRAY_SIZE(inputs));
+		static_assert(ARRAY_SIZE(output_names) == ARRAY_SIZE(output_tensors));
+		ORT(Run(wrap->session, nullptr, input_names, inputs, ARRAY_SIZE(input_names), output_names,
+		        ARRAY_SIZE(output_names), output_tensors));
+	}
+
+	float *out_data = nullptr;
+	float *out_data_depth = nullptr;
+	float *out_data_extras = nullptr;
+	float *out_data_curls = nullptr;
+
+	ORT(GetTensorMutableData(output_tensors[0], (void **)&out_data));
+	ORT(GetTensorMutableData(output_tensors[1], (void **)&out_data_depth));
+	ORT(GetTensorMutableData(output_tensors[2], (void **)&out_data_extras));
+	ORT(GetTensorMutableData(output_tensors[3], (void **)&out_data_curls));
+
+	process_keypoint_estimation(info, out_data, out_data_depth, out_data_extras, out_data_curls);
 
 	for (size_t i = 0; i < ARRAY_SIZE(output_tensors); i++) {
 		wrap->api->ReleaseValue(output_tensors[i]);
 	}
 }
 
+void
+run_keypoint_estimation_batched(HandTracking *hgt, keypoint_estimation_run_info **infos, uint32_t count)
+{
+	XRT_TRACE_MARKER();
+
+	assert(count > 0 && count <= kMaxInferenceBatch);
+
+	onnx_batched_wrap *bw = &hgt->keypoint_batched;
+	onnx_wrap *wrap = &bw->wrap;
+
+	int64_t prepare_ns = os_monotonic_get_ns();
+
+	const batched_tensor &img = bw->input("inputImg");
+	const batched_tensor &last_keypoints = bw->input("lastKeypoints");
+	const batched_tensor &use_last_keypoints = bw->input("useLastKeypoints");
+
+	// The projections are the expensive part, do them in parallel.
+	for (uint32_t i = 0; i < count; i++) {
+		infos[i]->input_img = img.item(i);
+		infos[i]->input_last_keypoints = last_keypoints.item(i);
+		infos[i]->input_use_last_keypoints = use_last_keypoints.item(i);
+		u_worker_group_push(hgt->group, prepare_keypoint_estimation_job, infos[i]);
+	}
+	u_worker_group_wait_all(hgt->group);
+
+	int64_t model_ns = os_monotonic_get_ns();
+
+	{
+		XRT_TRACE_IDENT(model);
+		ORT(RunWithBinding(wrap->session, nullptr, bw->bindings[count - 1]));
+	}
+
+	int64_t process_ns = os_monotonic_get_ns();
+
+	const batched_tensor &heatmap_xy = bw->output("heatmap_xy");
+	const batched_tensor &heatmap_depth = bw->output("heatmap_depth");
+	const batched_tensor &scalar_extras = bw->output("scalar_extras");
+	const batched_tensor &curls = bw->output("curls");
+
+	for (uint32_t i = 0; i < count; i++) {
+		process_keypoint_estimation(*infos[i], heatmap_xy.item(i), heatmap_depth.item(i),
+		                            scalar_extras.item(i), curls.item(i));
+	}
+
+	hgt->timings.keypoint_prepare_ms = (float)time_ns_to_ms_f(model_ns - prepare_ns);
+	hgt->timings.keypoint_model_ms = (float)time_ns_to_ms_f(process_ns - model_ns);
+}
+
+
+/*
+ *
+ * Batched model setup.
+ *
+ */
+
+// Like ORT but for setup that may fail, the caller cleans up.
+#define ORT_CHECK(expr)                                                                                                \
+	do {                                                                                                           \
+		OrtStatus *status = wrap->api->expr;                                                                   \
+		if (status != nullptr) {                                                                               \
+			HG_WARN(hgt, "[%s:%d]: %s", __FILE__, __LINE__, wrap->api->GetErrorMessage(status));           \
+			wrap->api->ReleaseStatus(status);                                                              \
+			return false;                                                                                  \
+		}                                                                                                      \
+	} while (0)
+
+static bool
+make_batched_tensor(HandTracking *hgt, onnx_wrap *wrap, const char *name, OrtTypeInfo *type_info, batched_tensor &out)
+{
+	const OrtTensorTypeAndShapeInfo *tensor_info = nullptr;
+	ORT_CHECK(CastTypeInfoToTensorInfo(type_info, &tensor_info));
+	if (tensor_info == nullptr) {
+		HG_WARN(hgt, "'%s' is not a tensor!", name);
+		return false;
+	}
+
+	ONNXTensorElementDataType type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+	ORT_CHECK(GetTensorElementType(tensor_info, &type));
+	if (type != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
+		HG_WARN(hgt, "'%s' is not a float tensor!", name);
+		return false;
+	}
+
+	size_t dimension_count = 0;
+	ORT_CHECK(GetDimensionsCount(tensor_info, &dimension_count));
+	if (dimension_count == 0) {
+		HG_WARN(hgt, "'%s' is a scalar, can't batch it!", name);
+		return false;
+	}
+
+	out.name = name;
+	out.dimensions.resize(dimension_count);
+	ORT_CHECK(GetDimensions(tensor_info, out.dimensions.data(), dimension_count));
+
+	// Models exported with a fixed batch size of one report 1 here instead of -1.
+	if (out.dimensions[0] >= 0) {
+		HG_DEBUG(hgt, "'%s' has a fixed batch size of %d", name, (int)out.dimensions[0]);
+		return false;
+	}
+
+	out.item_size = 1;
+	for (size_t i = 1; i < dimension_count; i++) {
+		if (out.dimensions[i] <= 0) {
+			HG_WARN(hgt, "'%s' has more than one dynamic dimension!", name);
+			return false;
+		}
+		out.item_size *= (size_t)out.dimensions[i];
+	}
+
+	out.data = (float *)calloc(kMaxInferenceBatch * out.item_size, sizeof(float));
+
+	return true;
+}
+
+static bool
+query_batched_tensors(HandTracking *hgt, onnx_batched_wrap *bw, OrtAllocator *allocator, bool outputs)
+{
+	onnx_wrap *wrap = &bw->wrap;
+	std::vector<batched_tensor> &tensors = outputs ? bw->outputs : bw->inputs;
+
+	size_t count = 0;
+	if (outputs) {
+		ORT_CHECK(SessionGetOutputCount(wrap->session, &count));
+	} else {
+		ORT_CHECK(SessionGetInputCount(wrap->session, &count));
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		char *name = nullptr;
+		OrtTypeInfo *type_info = nullptr;
+
+		if (outputs) {
+			ORT_CHECK(SessionGetOutputName(wrap->session, i, allocator, &name));
+			ORT_CHECK(SessionGetOutputTypeInfo(wrap->session, i, &type_info));
+		} else {
+			ORT_CHECK(SessionGetInputName(wrap->session, i, allocator, &name));
+			ORT_CHECK(SessionGetInputTypeInfo(wrap->session, i, &type_info));
+		}
+
+		batched_tensor tensor = {};
+		bool ok = make_batched_tensor(hgt, wrap, name, type_info, tensor);
+
+		wrap->api->ReleaseTypeInfo(type_info);
+		ORT_CHECK(AllocatorFree(allocator, name));
+
+		if (!ok) {
+			return false;
+		}
+
+		tensors.push_back(tensor);
+	}
+
+	return true;
+}
+
+static bool
+bind_batched_tensors(HandTracking *hgt, onnx_batched_wrap *bw, OrtIoBinding *binding, uint32_t batch_size, bool outputs)
+{
+	onnx_wrap *wrap = &bw->wrap;
+
+	for (const batched_tensor &t : outputs ? bw->outputs : bw->inputs) {
+		std::vector<int64_t> dimensions = t.dimensions;
+		dimensions[0] = batch_size;
+
+		size_t data_size = batch_size * t.item_size * sizeof(float);
+
+		OrtValue *value = nullptr;
+		ORT_CHECK(CreateTensorWithDataAsOrtValue(wrap->meminfo,                       //
+		                                         t.data,                              //
+		                                         data_size,                           //
+		                                         dimensions.data(),                   //
+		                                         dimensions.size(),                   //
+		                                         ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, //
+		                                         &value));
+		bw->values.push_back(value);
+
+		if (outputs) {
+			ORT_CHECK(BindOutput(binding, t.name.c_str(), value));
+		} else {
+			ORT_CHECK(BindInput(binding, t.name.c_str(), value));
+		}
+	}
+
+	return true;
+}
+
+static bool
+has_tensor(HandTracking *hgt, const std::vector<batched_tensor> &tensors, const char *name, size_t min_item_size)
+{
+	for (const batched_tensor &t : tensors) {
+		if (t.name != name) {
+			continue;
+		}
+		if (t.item_size < min_item_size) {
+			HG_WARN(hgt, "'%s' is too small, %zu < %zu!", name, t.item_size, min_item_size);
+			return false;
+		}
+		return true;
+	}
+
+	HG_WARN(hgt, "Model has no '%s'!", name);
+	return false;
+}
+
+static bool
+setup_batched_model(HandTracking *hgt, onnx_batched_wrap *bw, const char *file)
+{
+	onnx_wrap *wrap = &bw->wrap;
+
+	std::filesystem::path path = hgt->models_folder;
+
+	path /= file;
+
+	setup_ort_api(hgt, wrap, path);
+
+	OrtAllocator *allocator = nullptr;
+	ORT_CHECK(GetAllocatorWithDefaultOptions(&allocator));
+
+	if (!query_batched_tensors(hgt, bw, allocator, false) || //
+	    !query_batched_tensors(hgt, bw, allocator, true)) {
+		return false;
+	}
+
+	// Every batch size gets its own binding, they all share the same memory.
+	for (uint32_t n = 1; n <= kMaxInferenceBatch; n++) {
+		ORT_CHECK(CreateIoBinding(wrap->session, &bw->bindings[n - 1]));
+
+		if (!bind_batched_tensors(hgt, bw, bw->bindings[n - 1], n, false) ||
+		    !bind_batched_tensors(hgt, bw, bw->bindings[n - 1], n, true)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+#undef ORT_CHECK
+
+bool
+init_batched_models(HandTracking *hgt)
+{
+	const size_t detection_size = kDetectionInputSize * kDetectionInputSize;
+	const size_t keypoint_size = kKeypointInputSize * kKeypointInputSize;
+	const size_t heatmap_size = kKeypointOutputHeatmapSize * kKeypointOutputHeatmapSize;
+
+	onnx_batched_wrap *detection = &hgt->detection_batched;
+	onnx_batched_wrap *keypoint = &hgt->keypoint_batched;
+
+	bool ok = setup_batched_model(hgt, detection, kDetectionModelFile) &&
+	          has_tensor(hgt, detection->inputs, "inputImg", detection_size) &&
+	          has_tensor(hgt, detection->outputs, "hand_exists", 2) &&
+	          has_tensor(hgt, detection->outputs, "cx", 2) &&
+	          has_tensor(hgt, detection->outputs, "cy", 2) &&
+	          has_tensor(hgt, detection->outputs, "size", 2);
+
+	ok = ok && setup_batched_model(hgt, keypoint, kKeypointModelFile) &&
+	     has_tensor(hgt, keypoint->inputs, "inputImg", keypoint_size) &&
+	     has_tensor(hgt, keypoint->inputs, "lastKeypoints", 42) &&
+	     has_tensor(hgt, keypoint->inputs, "useLastKeypoints", 1) &&
+	     has_tensor(hgt, keypoint->outputs, "heatmap_xy", 21 * heatmap_size) &&
+	     has_tensor(hgt, keypoint->outputs, "heatmap_depth", 21 * kKeypointOutputHeatmapSize) &&
+	     has_tensor(hgt, keypoint->outputs, "scalar_extras", 1) &&
+	     has_tensor(hgt, keypoint->outputs, "curls", 10);
+
+	if (!ok) {
+		release_onnx_batched_wrap(detection);
+		release_onnx_batched_wrap(keypoint);
+	}
+
+	return ok;
+}
+
+void
+release_onnx_batched_wrap(onnx_batched_wrap *bw)
+{
+	onnx_wrap *wrap = &bw->wrap;
+	if (wrap->api == nullptr) {
+		return;
+	}
+
+	for (OrtIoBinding *&binding : bw->bindings) {
+		wrap->api->ReleaseIoBinding(binding);
+		binding = nullptr;
+	}
+	for (OrtValue *value : bw->values) {
+		wrap->api->ReleaseValue(value);
+	}
+	bw->values.clear();
+
+	for (batched_tensor &t : bw->inputs) {
+		free(t.data);
+	}
+	for (batched_tensor &t : bw->outputs) {
+		free(t.data);
+	}
+	bw->inputs.clear();
+	bw->outputs.clear();
+
+	release_onnx_wrap(wrap);
+}
+
 void
 release_onnx_wrap(onnx_wrap *wrap)
 {
+	if (wrap->api == nullptr) {
+		return;
+	}
+
 	wrap->api->ReleaseMemoryInfo(wrap->meminfo);
 	wrap->api->ReleaseSession(wrap->session);
 	for (model_input_wrap &a : wrap->wraps) {
 		wrap->api->ReleaseValue(a.tensor);
 		free(a.data);
 	}
+	wrap->wraps.clear();
 	wrap->api->ReleaseEnv(wrap->env);
+	wrap->api = nullptr;
 }
 
 } // namespace xrt::tracking::hand::mercury
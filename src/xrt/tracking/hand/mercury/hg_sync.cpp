@@ -16,6 +16,7 @@
 #include "util/u_hand_tracking.h"
 #include "math/m_vec2.h"
 #include "util/u_misc.h"
+#include "os/os_time.h"
 #include "xrt/xrt_defines.h"
 #include "xrt/xrt_frame.h"
 #include "xrt/xrt_tracking.h"
@@ -30,6 +31,10 @@ namespace xrt::tracking::hand::mercury {
 DEBUG_GET_ONCE_LOG_OPTION(mercury_log, "MERCURY_LOG", U_LOGGING_WARN)
 DEBUG_GET_ONCE_BOOL_OPTION(mercury_optimize_hand_size, "MERCURY_optimize_hand_size", true)
 DEBUG_GET_ONCE_FLOAT_OPTION(mercury_min_detection_confidence, "MERCURY_MIN_DETECTION_CONFIDENCE", 0.3)
+DEBUG_GET_ONCE_NUM_OPTION(mercury_ort_threads, "MERCURY_ORT_THREADS", 0)
+DEBUG_GET_ONCE_OPTION(mercury_ort_provider, "MERCURY_ORT_PROVIDER", "CPU")
+DEBUG_GET_ONCE_BOOL_OPTION(mercury_batched_inference, "MERCURY_BATCHED_INFERENCE", true)
+DEBUG_GET_ONCE_NUM_OPTION(mercury_worker_threads, "MERCURY_WORKER_THREADS", 4)
 
 // Flags to tell state tracker that these are indeed valid joints
 static const enum xrt_space_relation_flags valid_flags_ht = (enum xrt_space_relation_flags)(
@@ -411,8 +416,18 @@ dispatch_and_process_hand_detections(struct HandTracking *hgt)
 
 	int num_views = 0;
 
-	if (hgt->tuneable_values.always_run_detection_model || hgt->refinement.optimizing ||
-	    hgt->tuneable_values.detection_model_in_both_views) {
+	if (hgt->inference.batched) {
+		bool both_views = hgt->tuneable_values.always_run_detection_model || hgt->refinement.optimizing ||
+		                  hgt->tuneable_values.detection_model_in_both_views;
+		if (both_views) {
+			run_hand_detection_batched(hgt, infos, 2);
+			num_views = 2;
+		} else {
+			run_hand_detection_batched(hgt, &infos[active_camera], 1);
+			num_views = 1;
+		}
+	} else if (hgt->tuneable_values.always_run_detection_model || hgt->refinement.optimizing ||
+	           hgt->tuneable_values.detection_model_in_both_views) {
 		u_worker_group_push(hgt->group, run_hand_detection, &infos[0]);
 		u_worker_group_push(hgt->group, run_hand_detection, &infos[1]);
 		num_views = 2;
@@ -686,6 +701,9 @@ HandTracking::~HandTracking()
 	release_onnx_wrap(&this->views[1].keypoint[1]);
 	release_onnx_wrap(&this->views[1].detection);
 
+	release_onnx_batched_wrap(&this->detection_batched);
+	release_onnx_batched_wrap(&this->keypoint_batched);
+
 	u_worker_group_reference(&this->group, NULL);
 
 	t_stereo_camera_calibration_reference(&this->calib, NULL);
@@ -804,9 +822,11 @@ HandTracking::cCallbackProcess(struct t_hand_tracking_sync *ht_sync,
 
 	// Every now and then if we're not already tracking both hands, try to detect new hands.
 	bool saw_both_hands_last_frame = hgt->last_frame_hand_detected[0] && hgt->last_frame_hand_detected[1];
+	int64_t detection_start_ns = os_monotonic_get_ns();
 	if (!saw_both_hands_last_frame) {
 		dispatch_and_process_hand_detections(hgt);
 	}
+	hgt->timings.detection_ms = (float)time_ns_to_ms_f(os_monotonic_get_ns() - detection_start_ns);
 
 	stop_everything_if_hands_are_overlapping(hgt);
 
@@ -822,6 +842,10 @@ HandTracking::cCallbackProcess(struct t_hand_tracking_sync *ht_sync,
 
 
 	// Dispatch keypoint estimator neural nets
+	int64_t keypoint_start_ns = os_monotonic_get_ns();
+	keypoint_estimation_run_info *batch[kMaxInferenceBatch];
+	uint32_t batch_count = 0;
+
 	for (int hand_idx = 0; hand_idx < 2; hand_idx++) {
 		for (int view_idx = 0; view_idx < 2; view_idx++) {
 			if (!hgt->views[view_idx].regions_of_interest_this_frame[hand_idx].found) {
@@ -831,11 +855,20 @@ HandTracking::cCallbackProcess(struct t_hand_tracking_sync *ht_sync,
 			struct keypoint_estimation_run_info &inf = hgt->views[view_idx].run_info[hand_idx];
 			inf.view = &hgt->views[view_idx];
 			inf.hand_idx = hand_idx;
-			u_worker_group_push(hgt->group, hgt->keypoint_estimation_run_func,
-			                    &hgt->views[view_idx].run_info[hand_idx]);
+
+			if (hgt->inference.batched) {
+				batch[batch_count++] = &inf;
+			} else {
+				u_worker_group_push(hgt->group, hgt->keypoint_estimation_run_func, &inf);
+			}
 		}
 	}
+
+	if (batch_count > 0) {
+		run_keypoint_estimation_batched(hgt, batch, batch_count);
+	}
 	u_worker_group_wait_all(hgt->group);
+	hgt->timings.keypoint_ms = (float)time_ns_to_ms_f(os_monotonic_get_ns() - keypoint_start_ns);
 
 	// Spaghetti logic for optimizing hand size
 	bool any_hands_are_only_visible_in_one_view = false;
@@ -881,6 +914,7 @@ HandTracking::cCallbackProcess(struct t_hand_tracking_sync *ht_sync,
 	float avg_hand_size = 0;
 
 	// Dispatch the optimizers!
+	int64_t optimizer_start_ns = os_monotonic_get_ns();
 	for (int hand_idx = 0; hand_idx < 2; hand_idx++) {
 
 
@@ -1004,6 +1038,8 @@ HandTracking::cCallbackProcess(struct t_hand_tracking_sync *ht_sync,
 		hgt->hand_tracked_for_num_frames[hand_idx]++;
 	}
 
+	hgt->timings.optimizer_ms = (float)time_ns_to_ms_f(os_monotonic_get_ns() - optimizer_start_ns);
+
 	// Push our timestamp back as well
 	hgt->history_timestamps.push_back(hgt->current_frame_timestamp);
 
@@ -1121,20 +1157,40 @@ t_hand_tracking_sync_mercury_create(struct t_stereo_camera_calibration *calib,
 	hgt->views[0].camera_info = extra_camera_info.views[0];
 	hgt->views[1].camera_info = extra_camera_info.views[1];
 
-	init_hand_detection(hgt, &hgt->views[0].detection);
-	init_hand_detection(hgt, &hgt->views[1].detection);
+	// The threads only prepare model inputs when batched, the caller is one of them.
+	int num_threads = std::max(2, (int)debug_get_num_option_mercury_worker_threads());
+	int ort_threads = (int)debug_get_num_option_mercury_ort_threads();
+
+	hgt->inference.provider = debug_get_option_mercury_ort_provider();
+	hgt->inference.batched = debug_get_bool_option_mercury_batched_inference();
+
+	// One batched call replaces the per image calls that ran in parallel on the workers, so by default
+	// it gets as many threads as they had.
+	hgt->inference.intra_op_threads = ort_threads > 0 ? ort_threads : num_threads;
+
+	if (hgt->inference.batched && !init_batched_models(hgt)) {
+		HG_WARN(hgt, "Models can't be batched, running them once per view and hand.");
+		hgt->inference.batched = false;
+	}
+
+	if (!hgt->inference.batched) {
+		// The per image calls already run in parallel on the workers.
+		hgt->inference.intra_op_threads = ort_threads > 0 ? ort_threads : 1;
 
-	init_keypoint_estimation(hgt, &hgt->views[0].keypoint[0]);
-	init_keypoint_estimation(hgt, &hgt->views[0].keypoint[1]);
+		init_hand_detection(hgt, &hgt->views[0].detection);
+		init_hand_detection(hgt, &hgt->views[1].detection);
 
-	init_keypoint_estimation(hgt, &hgt->views[1].keypoint[0]);
-	init_keypoint_estimation(hgt, &hgt->views[1].keypoint[1]);
+		init_keypoint_estimation(hgt, &hgt->views[0].keypoint[0]);
+		init_keypoint_estimation(hgt, &hgt->views[0].keypoint[1]);
+
+		init_keypoint_estimation(hgt, &hgt->views[1].keypoint[0]);
+		init_keypoint_estimation(hgt, &hgt->views[1].keypoint[1]);
+	}
 	hgt->keypoint_estimation_run_func = xrt::tracking::hand::mercury::run_keypoint_estimation;
 
 	hgt->views[0].view = 0;
 	hgt->views[1].view = 1;
 
-	int num_threads = 4;
 	hgt->pool = u_worker_thread_pool_create(num_threads - 1, num_threads, "Hand Tracking");
 	hgt->group = u_worker_group_create(hgt->pool);
 
@@ -1148,6 +1204,11 @@ t_hand_tracking_sync_mercury_create(struct t_stereo_camera_calibration *calib,
 
 	u_var_add_ro_f32(hgt, &hgt->ft_widget.fps, "FPS!");
 	u_var_add_f32_timing(hgt, hgt->ft_widget.debug_var, "Frame timing!");
+	u_var_add_ro_f32(hgt, &hgt->timings.detection_ms, "Detection (ms)");
+	u_var_add_ro_f32(hgt, &hgt->timings.keypoint_ms, "Keypoint estimation (ms)");
+	u_var_add_ro_f32(hgt, &hgt->timings.keypoint_prepare_ms, "Keypoint input prep, batched (ms)");
+	u_var_add_ro_f32(hgt, &hgt->timings.keypoint_model_ms, "Keypoint model, batched (ms)");
+	u_var_add_ro_f32(hgt, &hgt->timings.optimizer_ms, "Optimizers (ms)");
 
 	u_var_add_f32(hgt, &hgt->target_hand_size, "Hand size (Meters between wrist and middle-proximal joint)");
 	u_var_add_ro_f32(hgt, &hgt->refinement.hand_size_refinement_schedule_x, "Schedule (X value)");
@@ -42,6 +42,9 @@
 #include <string.h>
 #include <stdint.h>
 
+#include <string>
+#include <vector>
+
 #include <opencv2/opencv.hpp>
 #include <onnxruntime_c_api.h>
 
@@ -66,6 +69,9 @@ static constexpr uint16_t kKeypointInputSize = 128;
 static constexpr uint16_t kKeypointOutputHeatmapSize = 22;
 static constexpr uint16_t kVisSpacerSize = 8;
 
+//! Most images run through one batched model call, both views times both hands.
+static constexpr uint32_t kMaxInferenceBatch = 4;
+
 static const cv::Scalar RED(255, 30, 30);
 static const cv::Scalar YELLOW(255, 255, 0);
 static const cv::Scalar PINK(255, 0, 255);
@@ -163,6 +169,81 @@ struct onnx_wrap
 	std::vector<model_input_wrap> wraps = {};
 };
 
+//! One input or output of a @ref onnx_batched_wrap, sized for @ref kMaxInferenceBatch items.
+struct batched_tensor
+{
+	std::string name = {};
+	float *data = nullptr;
+
+	//! As reported by the model, the first is the batch dimension.
+	std::vector<int64_t> dimensions = {};
+
+	//! Number of floats for one item in the batch.
+	size_t item_size = 0;
+
+	float *
+	item(uint32_t index) const
+	{
+		return data + index * item_size;
+	}
+};
+
+/*!
+ * A session whose model has a dynamic batch dimension, with tensors for all
+ * inputs and outputs preallocated and bound with IoBinding for every batch
+ * size up to @ref kMaxInferenceBatch, so running it never allocates.
+ */
+struct onnx_batched_wrap
+{
+	onnx_wrap wrap = {};
+
+	std::vector<batched_tensor> inputs = {};
+	std::vector<batched_tensor> outputs = {};
+
+	//! Indexed by batch size minus one.
+	OrtIoBinding *bindings[kMaxInferenceBatch] = {};
+
+	//! All tensors created for the bindings, they only reference @ref batched_tensor::data.
+	std::vector<OrtValue *> values = {};
+
+	const batched_tensor &
+	input(const char *name) const
+	{
+		for (const batched_tensor &t : inputs) {
+			if (t.name == name) {
+				return t;
+			}
+		}
+		assert(false);
+		return inputs[0];
+	}
+
+	const batched_tensor &
+	output(const char *name) const
+	{
+		for (const batched_tensor &t : outputs) {
+			if (t.name == name) {
+				return t;
+			}
+		}
+		assert(false);
+		return outputs[0];
+	}
+};
+
+//! ONNX Runtime settings, from the environment.
+struct inference_config
+{
+	//! Threads ORT may use inside one model call, by default the worker count when batched and 1 otherwise.
+	int intra_op_threads = 1;
+
+	//! Execution provider, "CPU" uses ORT's default.
+	const char *provider = "CPU";
+
+	//! Run all views and hands in one call per model, if the models allow it.
+	bool batched = true;
+};
+
 // Multipurpose.
 // * Hand detector writes into center_px, size_px, found and hand_detection_confidence
 // * Keypoint estimator operates on this to a direction/radius for the stereographic projection, and for the associated
@@ -188,6 +269,13 @@ struct hand_detection_run_info
 	// If some hands are already tracked, we have logic that only copies new ROIs to this frame's regions of
 	// interest.
 	hand_region_of_interest outputs[2];
+
+	// Kept from preparing the model input to interpreting its output.
+	cv::Matx23f go_back;
+	cv::Mat binned_uint8;
+
+	// Where the model input goes, a slice of the batch or the view's own tensor.
+	float *input;
 };
 
 
@@ -195,6 +283,15 @@ struct keypoint_estimation_run_info
 {
 	ht_view *view;
 	bool hand_idx;
+
+	// Kept from preparing the model input to interpreting its output.
+	cv::Mat input_uint8;
+	bool input_ok;
+
+	// Where the model inputs go, a slice of the batch or the wrap's own tensors.
+	float *input_img;
+	float *input_last_keypoints;
+	float *input_use_last_keypoints;
 };
 
 struct ht_view
@@ -274,6 +371,14 @@ public:
 
 	u_worker_group *group;
 
+	struct inference_config inference = {};
+
+	// Only used in batched mode, then the per view wraps are left empty.
+	onnx_batched_wrap detection_batched = {};
+	onnx_batched_wrap keypoint_batched = {};
+
+	struct hg_stage_timings timings = {};
+
 
 	float baseline = {};
 	xrt_pose hand_pose_camera_offset = {};
@@ -377,6 +482,25 @@ run_keypoint_estimation(void *ptr);
 void
 release_onnx_wrap(onnx_wrap *wrap);
 
+/*!
+ * Sets up @ref HandTracking::detection_batched and
+ * @ref HandTracking::keypoint_batched, returns false and leaves them empty if
+ * the models don't have a dynamic batch dimension.
+ */
+bool
+init_batched_models(HandTracking *hgt);
+
+//! Runs the detection model on @p count views in one call.
+void
+run_hand_detection_batched(HandTracking *hgt, hand_detection_run_info *infos, uint32_t count);
+
+//! Runs the keypoint model on @p count view and hand pairs in one call.
+void
+run_keypoint_estimation_batched(HandTracking *hgt, keypoint_estimation_run_info **infos, uint32_t count);
+
+void
+release_onnx_batched_wrap(onnx_batched_wrap *bw);
+
 
 void
 make_projection_instructions(t_camera_model_params &dist,
@@ -0,0 +1,232 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Test u_distortion_mesh generation and caching.
+ */
+
+#include "xrt/xrt_config_os.h"
+#include "xrt/xrt_device.h"
+
+#include "util/u_distortion_mesh.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef XRT_OS_LINUX
+#include <unistd.h>
+#endif
+
+
+/*
+ *
+ * Fake device.
+ *
+ */
+
+struct fake_hmd
+{
+	struct xrt_device base;
+	struct xrt_hmd_parts hmd;
+
+	//! Number of calls to compute_distortion, called from many threads.
+	std::atomic<uint32_t> calls;
+
+	//! Changes the distortion, like a parameter from the config would.
+	float scale;
+
+	//! Changes the distortion only in between the points used for the cache key.
+	bool wobble;
+};
+
+static void
+fake_distortion(const fake_hmd *fh, uint32_t view, float u, float v, struct xrt_uv_triplet *result)
+{
+	float offset = view == 0 ? 0.01f : -0.01f;
+	if (fh->wobble && u * 8.0f != floorf(u * 8.0f)) {
+		offset += 0.001f;
+	}
+	float r2 = (u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f);
+	float k = 1.0f + fh->scale * r2;
+
+	result->r = {u * k + offset, v * k};
+	result->g = {u * k * 1.01f + offset, v * k * 1.01f};
+	result->b = {u * k * 1.02f + offset, v * k * 1.02f};
+}
+
+static bool
+fake_compute_distortion(struct xrt_device *xdev, uint32_t view, float u, float v, struct xrt_uv_triplet *result)
+{
+	fake_hmd *fh = (fake_hmd *)xdev;
+	fh->calls++;
+	fake_distortion(fh, view, u, v, result);
+	return true;
+}
+
+static void
+fake_hmd_init(fake_hmd *fh, float scale)
+{
+	memset((void *)fh, 0, sizeof(*fh));
+	fh->base.hmd = &fh->hmd;
+	fh->base.compute_distortion = fake_compute_distortion;
+	fh->hmd.view_count = 2;
+	fh->calls = 0;
+	fh->scale = scale;
+}
+
+static void
+fake_hmd_fini(fake_hmd *fh)
+{
+	free(fh->hmd.distortion.mesh.vertices);
+	free(fh->hmd.distortion.mesh.indices);
+}
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+//! Checks every vertex against the distortion function and the index layout.
+static void
+check_mesh(const fake_hmd *fh)
+{
+	const auto &mesh = fh->hmd.distortion.mesh;
+	REQUIRE(mesh.vertices != nullptr);
+	REQUIRE(mesh.indices != nullptr);
+	REQUIRE(mesh.uv_channels_count == 3);
+
+	uint32_t stride_in_floats = mesh.stride / sizeof(float);
+	uint32_t vertex_count_per_view = mesh.vertex_count / 2;
+	uint32_t vert_cols = 1;
+	while (vert_cols * vert_cols < vertex_count_per_view) {
+		vert_cols++;
+	}
+	REQUIRE(vert_cols * vert_cols == vertex_count_per_view);
+	uint32_t cells = vert_cols - 1;
+
+	uint32_t bad = 0;
+	for (uint32_t view = 0; view < 2; view++) {
+		for (uint32_t r = 0; r < vert_cols; r++) {
+			for (uint32_t c = 0; c < vert_cols; c++) {
+				float u = (float)c / (float)cells;
+				float v = (float)r / (float)cells;
+
+				struct xrt_uv_triplet expected;
+				fake_distortion(fh, view, u, v, &expected);
+
+				const float *vert = &mesh.vertices[(view * vertex_count_per_view + r * vert_cols + c) *
+				                                   stride_in_floats];
+				if (vert[0] != u * 2.0f - 1.0f || vert[1] != v * 2.0f - 1.0f ||
+				    memcmp(&vert[2], &expected, sizeof(expected)) != 0) {
+					bad++;
+				}
+			}
+		}
+	}
+	CHECK(bad == 0);
+
+	// Triangle strips, first and last index of each row are degenerate.
+	CHECK(mesh.index_count_total == mesh.index_counts[0] + mesh.index_counts[1]);
+	CHECK(mesh.index_offsets[1] == mesh.index_counts[0]);
+	CHECK(mesh.indices[mesh.index_offsets[1]] == (int)vertex_count_per_view);
+	CHECK(mesh.indices[mesh.index_count_total - 1] == (int)(mesh.vertex_count - 1));
+}
+
+
+/*
+ *
+ * Tests.
+ *
+ */
+
+TEST_CASE("u_distortion_mesh")
+{
+#ifdef XRT_OS_LINUX
+	// Keep the cache out of the real config dir.
+	char dir[] = "/tmp/tests_distortion_mesh_XXXXXX";
+	REQUIRE(mkdtemp(dir) != nullptr);
+	setenv("XDG_CONFIG_HOME", dir, 1);
+
+	// The fake distortion is safe to call concurrently, exercise the worker pool.
+	setenv("XRT_MESH_THREADS", "4", 1);
+#endif
+
+	fake_hmd first;
+	fake_hmd_init(&first, 0.25f);
+	u_distortion_mesh_fill_in_compute(&first.base);
+
+	check_mesh(&first);
+	CHECK((first.hmd.distortion.models & XRT_DISTORTION_MODEL_MESHUV) != 0);
+	CHECK(first.calls.load() >= first.hmd.distortion.mesh.vertex_count);
+
+#ifdef XRT_OS_LINUX
+	SECTION("same parameters are loaded from the cache")
+	{
+		fake_hmd second;
+		fake_hmd_init(&second, 0.25f);
+		u_distortion_mesh_fill_in_compute(&second.base);
+
+		check_mesh(&second);
+		CHECK(second.calls.load() < second.hmd.distortion.mesh.vertex_count);
+		CHECK(memcmp(first.hmd.distortion.mesh.vertices, second.hmd.distortion.mesh.vertices,
+		             first.hmd.distortion.mesh.vertex_count * first.hmd.distortion.mesh.stride) == 0);
+
+		fake_hmd_fini(&second);
+	}
+
+	SECTION("different parameters are not loaded from the cache")
+	{
+		fake_hmd second;
+		fake_hmd_init(&second, 0.5f);
+		u_distortion_mesh_fill_in_compute(&second.base);
+
+		check_mesh(&second);
+		CHECK(second.calls.load() >= second.hmd.distortion.mesh.vertex_count);
+
+		fake_hmd_fini(&second);
+	}
+
+	SECTION("a cached mesh with the same key but different distortion is regenerated")
+	{
+		fake_hmd second;
+		fake_hmd_init(&second, 0.25f);
+		second.wobble = true;
+		u_distortion_mesh_fill_in_compute(&second.base);
+
+		check_mesh(&second);
+		CHECK(second.calls.load() >= second.hmd.distortion.mesh.vertex_count);
+
+		fake_hmd_fini(&second);
+	}
+
+	SECTION("old meshes are evicted")
+	{
+		for (uint32_t i = 0; i < 12; i++) {
+			fake_hmd other;
+			fake_hmd_init(&other, 1.0f + (float)i);
+			u_distortion_mesh_fill_in_compute(&other.base);
+			fake_hmd_fini(&other);
+		}
+
+		uint32_t file_count = 0;
+		for (const auto &entry : std::filesystem::directory_iterator(std::string(dir) + "/monado/distortion_cache")) {
+			(void)entry;
+			file_count++;
+		}
+		CHECK(file_count == 8);
+	}
+#endif
+
+	fake_hmd_fini(&first);
+
+#ifdef XRT_OS_LINUX
+	std::filesystem::remove_all(dir);
+#endif
+}
@@ -0,0 +1,222 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief u_format_convert kernel and sink converter tests and benchmarks.
+ *
+ * The benchmarks are hidden, run them with `tests_format_convert "[benchmark]"`.
+ */
+
+#include "util/u_format_convert.h"
+#include "util/u_frame.h"
+#include "util/u_sink.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+namespace {
+
+struct Image
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	size_t stride = 0;
+	std::vector<uint8_t> data;
+
+	Image(uint32_t w, uint32_t h, size_t bytes_per_pixel, size_t padding)
+	    : width(w), height(h), stride(w * bytes_per_pixel + padding), data(stride * h)
+	{}
+};
+
+Image
+make_random(uint32_t w, uint32_t h, size_t bytes_per_pixel, size_t padding, uint32_t seed)
+{
+	Image img(w, h, bytes_per_pixel, padding);
+	std::mt19937 rng(seed);
+	std::generate(img.data.begin(), img.data.end(), [&] { return (uint8_t)rng(); });
+	return img;
+}
+
+//! Straight from the BT.601 integer approximation the converters implement.
+void
+reference_yuv(int y, int u, int v, uint8_t *dst)
+{
+	int c = y - 16;
+	int d = u - 128;
+	int e = v - 128;
+	dst[0] = (uint8_t)std::clamp((298 * c + 409 * e + 128) >> 8, 0, 255);
+	dst[1] = (uint8_t)std::clamp((298 * c - 100 * d - 209 * e + 128) >> 8, 0, 255);
+	dst[2] = (uint8_t)std::clamp((298 * c + 516 * d + 128) >> 8, 0, 255);
+}
+
+using Member = u_format_convert_func_t u_format_convert_funcs::*;
+
+struct Kernel
+{
+	const char *name;
+	Member member;
+	size_t src_bytes_per_pixel;
+	size_t dst_bytes_per_pixel;
+	uint32_t src_rows_per_row;
+};
+
+const Kernel kernels[] = {
+    {"L8 to R8G8B8", &u_format_convert_funcs::l8_to_r8g8b8, 1, 3, 1},
+    {"YUYV422 to R8G8B8", &u_format_convert_funcs::yuyv422_to_r8g8b8, 2, 3, 1},
+    {"YUYV422 to L8", &u_format_convert_funcs::yuyv422_to_l8, 2, 1, 1},
+    {"UYVY422 to R8G8B8", &u_format_convert_funcs::uyvy422_to_r8g8b8, 2, 3, 1},
+    {"YUV888 to R8G8B8", &u_format_convert_funcs::yuv888_to_r8g8b8, 3, 3, 1},
+    {"BAYER_GR8 to R8G8B8", &u_format_convert_funcs::bayer_gr8_to_r8g8b8, 2, 3, 2},
+};
+
+//! Runs the kernel, returns only the pixels and not the padding.
+std::vector<uint8_t>
+run(const u_format_convert_funcs *funcs, const Kernel &k, const Image &src)
+{
+	uint32_t h = src.height / k.src_rows_per_row;
+	Image dst(src.width, h, k.dst_bytes_per_pixel, 5);
+
+	(funcs->*k.member)(src.data.data(), src.stride, dst.data.data(), dst.stride, src.width, h);
+
+	std::vector<uint8_t> out;
+	for (uint32_t y = 0; y < h; y++) {
+		const uint8_t *row = dst.data.data() + y * dst.stride;
+		out.insert(out.end(), row, row + src.width * k.dst_bytes_per_pixel);
+	}
+	return out;
+}
+
+struct CaptureSink
+{
+	xrt_frame_sink base = {};
+	xrt_frame *frame = nullptr;
+
+	CaptureSink()
+	{
+		base.push_frame = [](xrt_frame_sink *xs, xrt_frame *xf) {
+			xrt_frame_reference(&reinterpret_cast<CaptureSink *>(xs)->frame, xf);
+		};
+	}
+
+	~CaptureSink()
+	{
+		xrt_frame_reference(&frame, nullptr);
+	}
+};
+
+} // namespace
+
+
+/*
+ *
+ * Tests.
+ *
+ */
+
+TEST_CASE("u_format_convert scalar matches the reference")
+{
+	const u_format_convert_funcs *scalar = u_format_convert_get_scalar();
+
+	Image src = make_random(34, 3, 2, 0, 1);
+	std::vector<uint8_t> out = run(scalar, kernels[1], src);
+
+	for (uint32_t y = 0; y < src.height; y++) {
+		for (uint32_t x = 0; x < src.width; x += 2) {
+			const uint8_t *s = src.data.data() + y * src.stride + x * 2;
+			uint8_t expected[6];
+			reference_yuv(s[0], s[1], s[3], expected + 0);
+			reference_yuv(s[2], s[1], s[3], expected + 3);
+
+			const uint8_t *got = out.data() + (y * src.width + x) * 3;
+			CHECK(std::equal(expected, expected + 6, got));
+		}
+	}
+}
+
+TEST_CASE("u_format_convert best is bit exact to scalar")
+{
+	const u_format_convert_funcs *scalar = u_format_convert_get_scalar();
+	const u_format_convert_funcs *best = u_format_convert_get_best();
+	INFO("Best implementation: " << best->name);
+
+	// Widths around the vector sizes to cover the scalar tails.
+	const uint32_t widths[] = {2, 8, 16, 30, 32, 46, 64, 126, 640};
+
+	for (const Kernel &k : kernels) {
+		for (uint32_t w : widths) {
+			INFO(k.name << " width " << w);
+			Image src = make_random(w, 6, k.src_bytes_per_pixel, 7, w);
+			CHECK(run(scalar, k, src) == run(best, k, src));
+		}
+	}
+}
+
+TEST_CASE("u_sink_converter splits large frames without changing the result")
+{
+	const uint32_t w = 1280;
+	const uint32_t h = 962;
+
+	Image src = make_random(w, h, 2, 0, 42);
+	std::vector<uint8_t> expected = run(u_format_convert_get_scalar(), kernels[1], src);
+
+	xrt_frame_context xfctx = {};
+	CaptureSink capture;
+	xrt_frame_sink *converter = nullptr;
+	u_sink_create_format_converter(&xfctx, XRT_FORMAT_R8G8B8, &capture.base, &converter);
+	REQUIRE(converter != nullptr);
+
+	xrt_frame *xf = nullptr;
+	u_frame_create_one_off(XRT_FORMAT_YUYV422, w, h, &xf);
+	REQUIRE(xf != nullptr);
+	for (uint32_t y = 0; y < h; y++) {
+		std::copy_n(src.data.data() + y * src.stride, w * 2, xf->data + y * xf->stride);
+	}
+
+	xrt_sink_push_frame(converter, xf);
+	REQUIRE(capture.frame != nullptr);
+	CHECK(capture.frame->format == XRT_FORMAT_R8G8B8);
+
+	std::vector<uint8_t> got;
+	for (uint32_t y = 0; y < h; y++) {
+		const uint8_t *row = capture.frame->data + y * capture.frame->stride;
+		got.insert(got.end(), row, row + w * 3);
+	}
+	CHECK(got == expected);
+
+	xrt_frame_reference(&xf, nullptr);
+	xrt_frame_reference(&capture.frame, nullptr);
+	xrt_frame_context_destroy_nodes(&xfctx);
+}
+
+TEST_CASE("u_format_convert benchmark", "[.][benchmark]")
+{
+	const u_format_convert_funcs *scalar = u_format_convert_get_scalar();
+	const u_format_convert_funcs *best = u_format_convert_get_best();
+
+	for (const Kernel &k : kernels) {
+		Image src = make_random(1280, 960, k.src_bytes_per_pixel, 0, 3);
+		uint32_t h = src.height / k.src_rows_per_row;
+		Image dst(src.width, h, k.dst_bytes_per_pixel, 0);
+
+		BENCHMARK(std::string(k.name) + " scalar")
+		{
+			(scalar->*k.member)(src.data.data(), src.stride, dst.data.data(), dst.stride, src.width, h);
+			return dst.data[0];
+		};
+		BENCHMARK(std::string(k.name) + " " + best->name)
+		{
+			(best->*k.member)(src.data.data(), src.stride, dst.data.data(), dst.stride, src.width, h);
+			return dst.data[0];
+		};
+	}
+}
@@ -0,0 +1,120 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Test u_frame_pool recycling and lifetime.
+ */
+
+#include "util/u_frame_pool.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <cstring>
+
+
+static u_frame_pool_stats
+get_stats(u_frame_pool *pool)
+{
+	u_frame_pool_stats stats = {};
+	u_frame_pool_get_stats(pool, &stats);
+	return stats;
+}
+
+TEST_CASE("u_frame_pool")
+{
+	u_frame_pool *pool = u_frame_pool_create(2);
+	REQUIRE(pool != nullptr);
+
+	SECTION("Frames are reused for the same layout")
+	{
+		xrt_frame *a = nullptr;
+		u_frame_pool_create_frame(pool, XRT_FORMAT_L8, 64, 32, &a);
+		REQUIRE(a != nullptr);
+		CHECK(a->width == 64);
+		CHECK(a->height == 32);
+		CHECK(a->stride >= 64);
+		CHECK(a->size >= a->stride * 32);
+
+		uint8_t *data = a->data;
+		a->timestamp = 42;
+		xrt_frame_reference(&a, nullptr);
+		CHECK(get_stats(pool).free == 1);
+
+		xrt_frame *b = nullptr;
+		u_frame_pool_create_frame(pool, XRT_FORMAT_L8, 64, 32, &b);
+		CHECK(b->data == data);
+		CHECK(b->timestamp == 0);
+
+		u_frame_pool_stats stats = get_stats(pool);
+		CHECK(stats.allocated == 1);
+		CHECK(stats.reused == 1);
+		CHECK(stats.in_use == 1);
+		CHECK(stats.free == 0);
+
+		xrt_frame_reference(&b, nullptr);
+	}
+
+	SECTION("Different layouts are not mixed up")
+	{
+		xrt_frame *a = nullptr;
+		u_frame_pool_create_frame(pool, XRT_FORMAT_L8, 64, 32, &a);
+		xrt_frame_reference(&a, nullptr);
+
+		xrt_frame *b = nullptr;
+		u_frame_pool_create_frame(pool, XRT_FORMAT_R8G8B8, 64, 32, &b);
+		CHECK(b->format == XRT_FORMAT_R8G8B8);
+		CHECK(get_stats(pool).allocated == 2);
+		CHECK(get_stats(pool).reused == 0);
+
+		xrt_frame_reference(&b, nullptr);
+	}
+
+	SECTION("Free list is bounded")
+	{
+		xrt_frame *frames[3] = {};
+		for (xrt_frame *&xf : frames) {
+			u_frame_pool_create_frame(pool, XRT_FORMAT_L8, 16, 16, &xf);
+		}
+		for (xrt_frame *&xf : frames) {
+			xrt_frame_reference(&xf, nullptr);
+		}
+
+		u_frame_pool_stats stats = get_stats(pool);
+		CHECK(stats.in_use == 0);
+		CHECK(stats.free == 2);
+		CHECK(stats.freed == 1);
+	}
+
+	SECTION("Clone copies data and metadata")
+	{
+		xrt_frame *src = nullptr;
+		u_frame_pool_create_frame(pool, XRT_FORMAT_L8, 8, 8, &src);
+		memset(src->data, 0x5a, src->size);
+		src->timestamp = 1234;
+		src->source_sequence = 7;
+
+		xrt_frame *copy = nullptr;
+		u_frame_pool_clone(pool, src, &copy);
+		CHECK(copy->data != src->data);
+		CHECK(copy->timestamp == 1234);
+		CHECK(copy->source_sequence == 7);
+		CHECK(memcmp(copy->data, src->data, src->size) == 0);
+
+		xrt_frame_reference(&copy, nullptr);
+		xrt_frame_reference(&src, nullptr);
+	}
+
+	SECTION("Frames outlive the pool reference")
+	{
+		xrt_frame *a = nullptr;
+		u_frame_pool_create_frame(pool, XRT_FORMAT_L8, 16, 16, &a);
+
+		// The frame keeps the pool alive, releasing it last frees everything.
+		u_frame_pool_reference(&pool, nullptr);
+		CHECK(a->data != nullptr);
+		xrt_frame_reference(&a, nullptr);
+		return;
+	}
+
+	u_frame_pool_reference(&pool, nullptr);
+}
@@ -0,0 +1,144 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief IPC layer slot copy tests and benchmarks.
+ *
+ * The benchmarks are hidden, run them with `tests_ipc_layers "[benchmark]"`.
+ */
+
+#include "shared/ipc_protocol.h"
+#include "shared/ipc_utils.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <memory>
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+namespace {
+
+/*!
+ * How a slot used to look, with room for every layer in it, copied whole on
+ * every commit.
+ */
+struct full_layer_slot
+{
+	xrt_layer_frame_data data;
+	uint32_t layer_count;
+	ipc_layer_entry layers[IPC_MAX_LAYERS];
+};
+
+/*!
+ * The parts of the shared memory that are touched by a commit.
+ */
+struct shared_layers
+{
+	ipc_layer_slot slot;
+	ipc_layer_entry layers[IPC_MAX_LAYERS];
+
+	full_layer_slot full_slot;
+};
+
+/*!
+ * Where the server copies the commit to.
+ */
+struct server_layers
+{
+	ipc_layer_slot slot;
+	ipc_layer_entry layers[IPC_MAX_LAYERS];
+
+	full_layer_slot full_slot;
+};
+
+void
+fill_layer(ipc_layer_entry *layer, uint32_t i)
+{
+	layer->xdev_id = i;
+	layer->swapchain_ids[0] = i;
+	layer->data.type = XRT_LAYER_QUAD;
+	layer->data.quad.pose.orientation.w = 1.0f;
+}
+
+} // namespace
+
+
+/*
+ *
+ * Tests.
+ *
+ */
+
+TEST_CASE("ipc_layer_slot_copy")
+{
+	auto shared = std::make_unique<shared_layers>();
+	auto server = std::make_unique<server_layers>();
+
+	for (uint32_t i = 0; i < IPC_MAX_LAYERS; i++) {
+		fill_layer(&shared->layers[i], i);
+	}
+
+	SECTION("only copies the submitted layers")
+	{
+		for (uint32_t count : {0u, 1u, 16u, (uint32_t)IPC_MAX_LAYERS}) {
+			INFO("count " << count);
+
+			*server = {};
+			shared->slot.layer_count = count;
+			shared->slot.data.display_time_ns = 42;
+
+			CHECK(ipc_layer_slot_copy(&shared->slot, shared->layers, &server->slot, server->layers));
+			CHECK(server->slot.layer_count == count);
+			CHECK(server->slot.data.display_time_ns == 42);
+
+			for (uint32_t i = 0; i < IPC_MAX_LAYERS; i++) {
+				CHECK(server->layers[i].xdev_id == (i < count ? i : 0));
+			}
+		}
+	}
+
+	SECTION("rejects a too large layer count")
+	{
+		shared->slot.layer_count = IPC_MAX_LAYERS + 1;
+
+		CHECK_FALSE(ipc_layer_slot_copy(&shared->slot, shared->layers, &server->slot, server->layers));
+		CHECK(server->layers[0].xdev_id == 0);
+	}
+}
+
+TEST_CASE("ipc layer commit benchmark", "[.][benchmark]")
+{
+	auto shared = std::make_unique<shared_layers>();
+	auto server = std::make_unique<server_layers>();
+
+	for (uint32_t count : {1u, 16u, (uint32_t)IPC_MAX_LAYERS}) {
+		const std::string suffix = " " + std::to_string(count) + " layers";
+
+		BENCHMARK("full slot copy" + suffix)
+		{
+			for (uint32_t i = 0; i < count; i++) {
+				fill_layer(&shared->full_slot.layers[i], i);
+			}
+			shared->full_slot.layer_count = count;
+
+			server->full_slot = shared->full_slot;
+			return server->full_slot.layers[count - 1].xdev_id;
+		};
+
+		BENCHMARK("ipc_layer_slot_copy" + suffix)
+		{
+			for (uint32_t i = 0; i < count; i++) {
+				fill_layer(&shared->layers[i], i);
+			}
+			shared->slot.layer_count = count;
+
+			ipc_layer_slot_copy(&shared->slot, shared->layers, &server->slot, server->layers);
+			return server->layers[count - 1].xdev_id;
+		};
+	}
+}
@@ -0,0 +1,110 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief u_live_stats histogram tests.
+ */
+
+#include "util/u_live_stats.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <thread>
+#include <vector>
+
+
+TEST_CASE("u_ls_hist empty")
+{
+	u_live_stats_hist *ulh = nullptr;
+	u_ls_hist_create("empty", &ulh);
+	REQUIRE(ulh != nullptr);
+
+	u_live_stats_hist_report report = {};
+	u_ls_hist_get_and_reset(ulh, nullptr, nullptr, 0, &report);
+	CHECK(report.count == 0);
+	CHECK(report.mean == 0);
+	CHECK(report.p99 == 0);
+	CHECK(report.worst == 0);
+
+	u_ls_hist_destroy(&ulh);
+	CHECK(ulh == nullptr);
+}
+
+TEST_CASE("u_ls_hist quantiles")
+{
+	u_live_stats_hist *ulh = nullptr;
+	u_ls_hist_create("quantiles", &ulh);
+
+	// 1us to 10ms in 1us steps.
+	const uint64_t count = 10000;
+	for (uint64_t i = 1; i <= count; i++) {
+		u_ls_hist_add(ulh, i * 1000);
+	}
+
+	const double quantiles[] = {0.0, 0.25, 0.75, 1.0};
+	uint64_t values[4] = {};
+	u_live_stats_hist_report report = {};
+	u_ls_hist_get_and_reset(ulh, quantiles, values, 4, &report);
+
+	CHECK(report.count == count);
+	CHECK(report.worst == count * 1000);
+	CHECK(report.mean == (count + 1) * 1000 / 2);
+
+	// Buckets are at most 1/32 of the value wide, and we report the top of the bucket.
+	auto within = [](uint64_t got, uint64_t expected) {
+		INFO(got << " vs " << expected);
+		CHECK(got >= expected);
+		CHECK(got <= expected + expected / 32);
+	};
+	within(report.p50, 5000 * 1000);
+	within(report.p90, 9000 * 1000);
+	within(report.p99, 9900 * 1000);
+	within(report.p999, 9990 * 1000);
+	within(values[0], 1000);
+	within(values[1], 2500 * 1000);
+	within(values[2], 7500 * 1000);
+	CHECK(values[3] == report.worst);
+
+	// Reset.
+	u_ls_hist_get_and_reset(ulh, nullptr, nullptr, 0, &report);
+	CHECK(report.count == 0);
+
+	// Small values are exact, huge ones are clamped but worst is still exact.
+	u_ls_hist_add(ulh, 7);
+	u_ls_hist_add(ulh, UINT64_MAX / 2);
+	u_ls_hist_get_and_reset(ulh, nullptr, nullptr, 0, &report);
+	CHECK(report.count == 2);
+	CHECK(report.p50 == 7);
+	CHECK(report.worst == UINT64_MAX / 2);
+	CHECK(report.p999 <= report.worst);
+
+	u_ls_hist_destroy(&ulh);
+}
+
+TEST_CASE("u_ls_hist threaded add")
+{
+	u_live_stats_hist *ulh = nullptr;
+	u_ls_hist_create("threaded", &ulh);
+
+	const uint32_t thread_count = U_LIVE_STATS_HIST_SHARD_COUNT * 2;
+	const uint64_t per_thread = 20000;
+
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < thread_count; t++) {
+		threads.emplace_back([=] {
+			for (uint64_t i = 0; i < per_thread; i++) {
+				u_ls_hist_add(ulh, 1000 + t);
+			}
+		});
+	}
+	for (std::thread &t : threads) {
+		t.join();
+	}
+
+	u_live_stats_hist_report report = {};
+	u_ls_hist_get_and_reset(ulh, nullptr, nullptr, 0, &report);
+	CHECK(report.count == thread_count * per_thread);
+	CHECK(report.worst == 1000 + thread_count - 1);
+
+	u_ls_hist_destroy(&ulh);
+}
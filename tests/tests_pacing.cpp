@@ -146,7 +146,8 @@ doFrame(SimulatedDisplayTimingQueue &display_timing_queue,
         unanoseconds begin_delay,
         unanoseconds draw_delay,
         unanoseconds submit_delay,
-        unanoseconds gpu_time_after_submit)
+        unanoseconds gpu_time_after_submit,
+        bool mark_latch = false)
 {
 	REQUIRE(clock.now() <= wake_time_ns);
 	// wake up (after delay)
@@ -162,6 +163,12 @@ doFrame(SimulatedDisplayTimingQueue &display_timing_queue,
 
 	// spend cpu time drawing
 	clock.advance(draw_delay);
+
+	// sample the head pose again just before submitting, like the compositor
+	if (mark_latch) {
+		u_pc_mark_point(upc, U_TIMING_POINT_LATCH, frame_id, clock.now());
+	}
+
 	u_pc_mark_point(upc, U_TIMING_POINT_SUBMIT_BEGIN, frame_id, clock.now());
 
 	// spend cpu time before submit
@@ -402,3 +409,47 @@ TEST_CASE("u_pacing_compositor_fake")
 	}
 	u_pc_destroy(&upc);
 }
+
+TEST_CASE("u_pacing_compositor_latch")
+{
+	MockClock clock;
+	u_pacing_compositor *upc = nullptr;
+
+	SECTION("display timing")
+	{
+		REQUIRE(XRT_SUCCESS == u_pc_display_timing_create(frame_interval_ns.count(),
+		                                                  &U_PC_DISPLAY_TIMING_CONFIG_DEFAULT, &upc));
+	}
+	SECTION("fake")
+	{
+		REQUIRE(XRT_SUCCESS == u_pc_fake_create(frame_interval_ns.count(), clock.now(), &upc));
+	}
+	REQUIRE(upc != nullptr);
+
+	clock.advance(1ms);
+
+	SimulatedDisplayTimingQueue queue;
+	for (int i = 0; i < 20; ++i) {
+		CompositorPredictions predictions;
+		u_pc_predict(upc, clock.now(), &predictions.frame_id, &predictions.wake_up_time_ns,
+		             &predictions.desired_present_time_ns, &predictions.present_slop_ns,
+		             &predictions.predicted_display_time_ns, &predictions.predicted_display_period_ns,
+		             &predictions.min_display_period_ns);
+		INFO(predictions.frame_id);
+		INFO(clock.now());
+		basicPredictionConsistencyChecks(clock.now(), predictions);
+		doFrame(queue, upc, clock, predictions.wake_up_time_ns, predictions.desired_present_time_ns,
+		        predictions.frame_id, wakeDelay, shortBeginDelay, shortDrawDelay, shortSubmitDelay,
+		        shortGpuTime, true);
+	}
+	drainDisplayTimingQueue(queue, clock.now(), upc);
+
+	// The latch is only a measurement, predictions must keep working.
+	CompositorPredictions newPred;
+	u_pc_predict(upc, clock.now(), &newPred.frame_id, &newPred.wake_up_time_ns, &newPred.desired_present_time_ns,
+	             &newPred.present_slop_ns, &newPred.predicted_display_time_ns,
+	             &newPred.predicted_display_period_ns, &newPred.min_display_period_ns);
+	basicPredictionConsistencyChecks(clock.now(), newPred);
+
+	u_pc_destroy(&upc);
+}
@@ -0,0 +1,236 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Batched pose transform and relation chain resolve tests and benchmarks.
+ *
+ * The benchmarks are hidden, run them with `tests_pose_batch "[benchmark]"`.
+ */
+
+#include "math/m_api.h"
+#include "math/m_space.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <random>
+#include <vector>
+
+using Catch::Approx;
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+namespace {
+
+constexpr xrt_space_relation_flags kFlagsAll = (xrt_space_relation_flags)( //
+    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT |                             //
+    XRT_SPACE_RELATION_POSITION_VALID_BIT |                                //
+    XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT |                         //
+    XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT |                        //
+    XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT |                           //
+    XRT_SPACE_RELATION_POSITION_TRACKED_BIT);                              //
+
+struct Random
+{
+	std::mt19937 rng;
+	std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+
+	explicit Random(uint32_t seed) : rng(seed) {}
+
+	xrt_vec3
+	vec3()
+	{
+		return {dist(rng), dist(rng), dist(rng)};
+	}
+
+	xrt_pose
+	pose()
+	{
+		xrt_pose p = {{dist(rng), dist(rng), dist(rng), dist(rng)}, vec3()};
+		math_quat_normalize(&p.orientation);
+		return p;
+	}
+
+	xrt_space_relation
+	relation()
+	{
+		return {kFlagsAll, pose(), vec3(), vec3()};
+	}
+};
+
+void
+check_pose(const xrt_pose &got, const xrt_pose &expected)
+{
+	// Both q and -q are the same rotation, but the batch should not flip the sign.
+	CHECK(got.orientation.x == Approx(expected.orientation.x).margin(1e-5));
+	CHECK(got.orientation.y == Approx(expected.orientation.y).margin(1e-5));
+	CHECK(got.orientation.z == Approx(expected.orientation.z).margin(1e-5));
+	CHECK(got.orientation.w == Approx(expected.orientation.w).margin(1e-5));
+	CHECK(got.position.x == Approx(expected.position.x).margin(1e-5));
+	CHECK(got.position.y == Approx(expected.position.y).margin(1e-5));
+	CHECK(got.position.z == Approx(expected.position.z).margin(1e-5));
+}
+
+void
+check_vec3(const xrt_vec3 &got, const xrt_vec3 &expected)
+{
+	CHECK(got.x == Approx(expected.x).margin(1e-4));
+	CHECK(got.y == Approx(expected.y).margin(1e-4));
+	CHECK(got.z == Approx(expected.z).margin(1e-4));
+}
+
+} // namespace
+
+
+/*
+ *
+ * Tests.
+ *
+ */
+
+TEST_CASE("math_pose_transform_batch matches math_pose_transform")
+{
+	Random r(1);
+	const xrt_pose transform = r.pose();
+
+	// Sizes around the chunking and a full body.
+	for (uint32_t count : {0u, 1u, 3u, 26u, 31u, 32u, 33u, 70u}) {
+		INFO("count " << count);
+
+		std::vector<xrt_pose> poses(count);
+		for (xrt_pose &p : poses) {
+			p = r.pose();
+		}
+
+		// One extra pose past the end, checks that the position store does not overrun.
+		std::vector<xrt_pose> out(count + 1);
+		out[count] = transform;
+
+		math_pose_transform_batch(&transform, poses.data(), out.data(), count);
+
+		for (uint32_t i = 0; i < count; i++) {
+			xrt_pose expected;
+			math_pose_transform(&transform, &poses[i], &expected);
+			check_pose(out[i], expected);
+		}
+		check_pose(out[count], transform);
+
+		// In place.
+		math_pose_transform_batch(&transform, poses.data(), poses.data(), count);
+		for (uint32_t i = 0; i < count; i++) {
+			check_pose(poses[i], out[i]);
+		}
+	}
+}
+
+TEST_CASE("m_relation_chain_resolve_batch matches m_relation_chain_resolve")
+{
+	Random r(2);
+
+	std::vector<xrt_space_relation> joints(70);
+	for (xrt_space_relation &j : joints) {
+		j = r.relation();
+	}
+	joints[3].relation_flags = {};
+	joints[4].relation_flags = XRT_SPACE_RELATION_ORIENTATION_VALID_BIT;
+
+	xrt_relation_chain xrc = {};
+
+	SECTION("empty chain") {}
+
+	SECTION("single pose")
+	{
+		xrt_pose pose = r.pose();
+		m_relation_chain_push_pose(&xrc, &pose);
+	}
+
+	SECTION("moving chain")
+	{
+		xrt_space_relation a = r.relation();
+		xrt_space_relation b = r.relation();
+		m_relation_chain_push_relation(&xrc, &a);
+		m_relation_chain_push_relation(&xrc, &b);
+	}
+
+	SECTION("chain with no pose")
+	{
+		xrt_space_relation a = r.relation();
+		a.relation_flags = {};
+		m_relation_chain_push_relation(&xrc, &a);
+	}
+
+	std::vector<xrt_space_relation> out(joints.size());
+	m_relation_chain_resolve_batch(&xrc, joints.data(), (uint32_t)joints.size(), out.data());
+
+	for (size_t i = 0; i < joints.size(); i++) {
+		INFO("joint " << i);
+
+		xrt_relation_chain single = {};
+		m_relation_chain_push_relation(&single, &joints[i]);
+		for (uint32_t s = 0; s < xrc.step_count; s++) {
+			m_relation_chain_push_relation(&single, &xrc.steps[s]);
+		}
+
+		xrt_space_relation expected;
+		m_relation_chain_resolve(&single, &expected);
+
+		CHECK(out[i].relation_flags == expected.relation_flags);
+		check_pose(out[i].pose, expected.pose);
+		check_vec3(out[i].linear_velocity, expected.linear_velocity);
+		check_vec3(out[i].angular_velocity, expected.angular_velocity);
+	}
+}
+
+TEST_CASE("pose batch benchmark", "[.][benchmark]")
+{
+	Random r(3);
+	const xrt_pose transform = r.pose();
+
+	// Roughly a full FB body.
+	std::vector<xrt_pose> poses(70);
+	std::vector<xrt_space_relation> joints(poses.size());
+	for (size_t i = 0; i < poses.size(); i++) {
+		poses[i] = r.pose();
+		joints[i] = r.relation();
+	}
+	std::vector<xrt_pose> out(poses.size());
+	std::vector<xrt_space_relation> out_relations(poses.size());
+
+	xrt_relation_chain xrc = {};
+	xrt_space_relation base = r.relation();
+	m_relation_chain_push_pose(&xrc, &transform);
+	m_relation_chain_push_relation(&xrc, &base);
+
+	BENCHMARK("math_pose_transform loop")
+	{
+		for (size_t i = 0; i < poses.size(); i++) {
+			math_pose_transform(&transform, &poses[i], &out[i]);
+		}
+		return out[0].position.x;
+	};
+	BENCHMARK("math_pose_transform_batch")
+	{
+		math_pose_transform_batch(&transform, poses.data(), out.data(), (uint32_t)poses.size());
+		return out[0].position.x;
+	};
+	BENCHMARK("m_relation_chain_resolve loop")
+	{
+		for (size_t i = 0; i < joints.size(); i++) {
+			xrt_relation_chain single = {};
+			m_relation_chain_push_relation(&single, &joints[i]);
+			m_relation_chain_push_pose(&single, &transform);
+			m_relation_chain_push_relation(&single, &base);
+			m_relation_chain_resolve(&single, &out_relations[i]);
+		}
+		return out_relations[0].pose.position.x;
+	};
+	BENCHMARK("m_relation_chain_resolve_batch")
+	{
+		m_relation_chain_resolve_batch(&xrc, joints.data(), (uint32_t)joints.size(), out_relations.data());
+		return out_relations[0].pose.position.x;
+	};
+}
@@ -0,0 +1,301 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief m_relation_history concurrency tests and benchmarks.
+ *
+ * The benchmarks are hidden, run them with `tests_relation_history "[benchmark]"`.
+ */
+
+#include "math/m_relation_history.h"
+#include "util/u_time.h"
+#include "util/u_template_historybuf.hpp"
+
+#include "catch_amalgamated.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+using xrt::auxiliary::util::HistoryBuffer;
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+constexpr int64_t kStepNs = U_TIME_1MS_IN_NS;
+constexpr int64_t kT0 = 20 * (int64_t)U_TIME_1S_IN_NS;
+
+//! Position x is the number of steps since kT0, so interpolated values are easy to check.
+static xrt_space_relation
+make_relation(int64_t timestamp_ns)
+{
+	xrt_space_relation relation = XRT_SPACE_RELATION_ZERO;
+	relation.relation_flags = (xrt_space_relation_flags)( //
+	    XRT_SPACE_RELATION_POSITION_TRACKED_BIT |         //
+	    XRT_SPACE_RELATION_POSITION_VALID_BIT |           //
+	    XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT |      //
+	    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT);        //
+	relation.pose.orientation.w = 1.f;
+	relation.pose.position.x = (float)((double)(timestamp_ns - kT0) / (double)kStepNs);
+
+	return relation;
+}
+
+/*!
+ * The previous implementation, a mutex around a @ref HistoryBuffer with a
+ * std::lower_bound for every lookup, kept here to compare against.
+ */
+struct BaselineHistory
+{
+	struct Entry
+	{
+		xrt_space_relation relation;
+		int64_t timestamp;
+	};
+
+	HistoryBuffer<Entry, 4096> impl;
+	std::mutex mutex;
+
+	bool
+	push(const xrt_space_relation &relation, int64_t timestamp)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!impl.empty() && timestamp <= impl.back().timestamp) {
+			return false;
+		}
+		impl.push_back(Entry{relation, timestamp});
+		return true;
+	}
+
+	float
+	get_x(int64_t at_timestamp_ns)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (impl.empty()) {
+			return 0.f;
+		}
+
+		auto b = impl.begin();
+		auto e = impl.end();
+		auto it = std::lower_bound(b, e, at_timestamp_ns,
+		                           [](const Entry &entry, int64_t timestamp) { return entry.timestamp < timestamp; });
+		if (it == e) {
+			return impl.back().relation.pose.position.x;
+		}
+		if (it == b || it->timestamp == at_timestamp_ns) {
+			return it->relation.pose.position.x;
+		}
+
+		const Entry &before = *(it - 1);
+		float t = (float)(at_timestamp_ns - before.timestamp) / (float)(it->timestamp - before.timestamp);
+		return before.relation.pose.position.x + (it->relation.pose.position.x - before.relation.pose.position.x) * t;
+	}
+};
+
+/*!
+ * Pushes a sample every @p period until stopped, like a driver thread does.
+ */
+template <typename PushFunc>
+static std::thread
+start_writer(std::atomic<bool> &running, std::chrono::microseconds period, PushFunc push)
+{
+	return std::thread([&running, period, push] {
+		int64_t ts = kT0 + 4096 * kStepNs;
+		while (running.load()) {
+			push(ts);
+			ts += kStepNs;
+			if (period.count() > 0) {
+				std::this_thread::sleep_for(period);
+			}
+		}
+	});
+}
+
+
+/*
+ *
+ * Tests.
+ *
+ */
+
+TEST_CASE("m_relation_history concurrent readers")
+{
+	m_relation_history *rh = nullptr;
+	m_relation_history_create(&rh);
+
+	// Fill the history so that readers always have something.
+	for (int64_t i = 0; i < 4096; i++) {
+		int64_t ts = kT0 + i * kStepNs;
+		xrt_space_relation relation = make_relation(ts);
+		REQUIRE(m_relation_history_push(rh, &relation, ts));
+	}
+
+	std::atomic<bool> running{true};
+	std::thread writer = start_writer(running, std::chrono::microseconds(0), [rh](int64_t ts) {
+		xrt_space_relation relation = make_relation(ts);
+		m_relation_history_push(rh, &relation, ts);
+	});
+
+	/*
+	 * Query half way between samples near the newest, every interpolation
+	 * must be clean. The writer is fast enough that a preempted reader can
+	 * fall off the end of the history, so other results are not errors.
+	 */
+	std::atomic<uint32_t> bad_results{0};
+	std::atomic<uint32_t> interpolated_results{0};
+	std::vector<std::thread> readers;
+	for (int r = 0; r < 2; r++) {
+		readers.emplace_back([rh, &bad_results, &interpolated_results] {
+			for (int i = 0; i < 20000; i++) {
+				int64_t latest_ns = 0;
+				xrt_space_relation latest;
+				m_relation_history_get_latest(rh, &latest_ns, &latest);
+
+				int64_t at_ns = latest_ns - (i % 16) * kStepNs - kStepNs / 2;
+				xrt_space_relation out = XRT_SPACE_RELATION_ZERO;
+				m_relation_history_result result = m_relation_history_get(rh, at_ns, &out);
+
+				if (result == M_RELATION_HISTORY_RESULT_INVALID) {
+					bad_results++;
+				}
+				if (result != M_RELATION_HISTORY_RESULT_INTERPOLATED) {
+					continue;
+				}
+
+				interpolated_results++;
+
+				float expected = make_relation(at_ns).pose.position.x;
+				if (std::abs(out.pose.position.x - expected) > 0.01f) {
+					bad_results++;
+				}
+			}
+		});
+	}
+
+	for (std::thread &reader : readers) {
+		reader.join();
+	}
+
+	running = false;
+	writer.join();
+
+	CHECK(bad_results.load() == 0);
+	CHECK(interpolated_results.load() > 0);
+	CHECK(m_relation_history_get_size(rh) == 4096);
+
+	m_relation_history_destroy(&rh);
+}
+
+TEST_CASE("m_relation_history benchmark", "[.][benchmark]")
+{
+	m_relation_history *rh = nullptr;
+	m_relation_history_create(&rh);
+	BaselineHistory baseline;
+
+	for (int64_t i = 0; i < 4096; i++) {
+		int64_t ts = kT0 + i * kStepNs;
+		xrt_space_relation relation = make_relation(ts);
+		m_relation_history_push(rh, &relation, ts);
+		baseline.push(relation, ts);
+	}
+
+	// Near the newest sample, where the compositor and apps query.
+	int64_t near_newest_ns = kT0 + 4090 * kStepNs + kStepNs / 2;
+	// Far back in the history, needs a full search.
+	int64_t far_back_ns = kT0 + 100 * kStepNs + kStepNs / 2;
+
+	SECTION("uncontended")
+	{
+		BENCHMARK("baseline get near newest")
+		{
+			return baseline.get_x(near_newest_ns);
+		};
+		BENCHMARK("m_relation_history get near newest")
+		{
+			xrt_space_relation out;
+			m_relation_history_get(rh, near_newest_ns, &out);
+			return out.pose.position.x;
+		};
+		BENCHMARK("baseline get far back")
+		{
+			return baseline.get_x(far_back_ns);
+		};
+		BENCHMARK("m_relation_history get far back")
+		{
+			xrt_space_relation out;
+			m_relation_history_get(rh, far_back_ns, &out);
+			return out.pose.position.x;
+		};
+	}
+
+	SECTION("with a 1kHz writer")
+	{
+		std::atomic<bool> running{true};
+		std::thread baseline_writer =
+		    start_writer(running, std::chrono::microseconds(1000), [&baseline](int64_t ts) {
+			    baseline.push(make_relation(ts), ts);
+		    });
+		std::thread writer = start_writer(running, std::chrono::microseconds(1000), [rh](int64_t ts) {
+			xrt_space_relation relation = make_relation(ts);
+			m_relation_history_push(rh, &relation, ts);
+		});
+
+		BENCHMARK("baseline get near newest")
+		{
+			return baseline.get_x(near_newest_ns);
+		};
+		BENCHMARK("m_relation_history get near newest")
+		{
+			xrt_space_relation out;
+			m_relation_history_get(rh, near_newest_ns, &out);
+			return out.pose.position.x;
+		};
+
+		running = false;
+		baseline_writer.join();
+		writer.join();
+	}
+
+	SECTION("push with 4 readers")
+	{
+		std::atomic<bool> running{true};
+		std::vector<std::thread> readers;
+		for (int r = 0; r < 4; r++) {
+			readers.emplace_back([&] {
+				while (running.load()) {
+					xrt_space_relation out;
+					m_relation_history_get(rh, near_newest_ns, &out);
+					baseline.get_x(near_newest_ns);
+				}
+			});
+		}
+
+		int64_t ts = kT0 + 4096 * kStepNs;
+		BENCHMARK("baseline push")
+		{
+			ts += kStepNs;
+			return baseline.push(make_relation(ts), ts);
+		};
+		BENCHMARK("m_relation_history push")
+		{
+			ts += kStepNs;
+			xrt_space_relation relation = make_relation(ts);
+			return m_relation_history_push(rh, &relation, ts);
+		};
+
+		running = false;
+		for (std::thread &reader : readers) {
+			reader.join();
+		}
+	}
+
+	m_relation_history_destroy(&rh);
+}
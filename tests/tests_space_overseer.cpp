@@ -0,0 +1,257 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Test u_space_overseer locate functions.
+ */
+
+#include "xrt/xrt_device.h"
+#include "xrt/xrt_space.h"
+#include "xrt/xrt_tracking.h"
+
+#include "math/m_api.h"
+#include "math/m_relation_history.h"
+
+#include "os/os_time.h"
+
+#include "util/u_space_overseer.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <vector>
+
+
+/*
+ *
+ * Fake device.
+ *
+ */
+
+struct fake_device
+{
+	struct xrt_device base;
+
+	//! Number of calls to get_tracked_pose.
+	uint32_t pose_calls;
+
+	//! Position returned, moves with the timestamp.
+	struct xrt_vec3 position;
+
+	//! Optional history that is read on every call, like a real driver would.
+	struct m_relation_history *rh;
+};
+
+static void
+fake_get_tracked_pose(struct xrt_device *xdev,
+                      enum xrt_input_name name,
+                      int64_t at_timestamp_ns,
+                      struct xrt_space_relation *out_relation)
+{
+	fake_device *fd = (fake_device *)xdev;
+	fd->pose_calls++;
+
+	if (fd->rh != NULL) {
+		struct xrt_space_relation unused;
+		m_relation_history_get(fd->rh, at_timestamp_ns, &unused);
+	}
+
+	float t = (float)at_timestamp_ns / 1000000000.0f;
+
+	struct xrt_space_relation rel = XRT_SPACE_RELATION_ZERO;
+	rel.relation_flags = (enum xrt_space_relation_flags)( //
+	    XRT_SPACE_RELATION_ORIENTATION_VALID_BIT |        //
+	    XRT_SPACE_RELATION_POSITION_VALID_BIT |           //
+	    XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT |      //
+	    XRT_SPACE_RELATION_POSITION_TRACKED_BIT);         //
+	rel.pose.position = fd->position;
+	rel.pose.position.x += t;
+
+	struct xrt_vec3 axis = {0.0f, 1.0f, 0.0f};
+	math_quat_from_angle_vector(0.3f + t, &axis, &rel.pose.orientation);
+
+	*out_relation = rel;
+}
+
+static void
+fake_device_init(fake_device *fd, struct xrt_tracking_origin *xto, struct xrt_vec3 position)
+{
+	*fd = {};
+	fd->base.tracking_origin = xto;
+	fd->base.get_tracked_pose = fake_get_tracked_pose;
+	fd->position = position;
+}
+
+
+/*
+ *
+ * Helpers.
+ *
+ */
+
+static void
+check_relation_equal(const struct xrt_space_relation &a, const struct xrt_space_relation &b)
+{
+	CHECK(a.relation_flags == b.relation_flags);
+	CHECK(a.pose.position.x == Catch::Approx(b.pose.position.x).margin(0.0001));
+	CHECK(a.pose.position.y == Catch::Approx(b.pose.position.y).margin(0.0001));
+	CHECK(a.pose.position.z == Catch::Approx(b.pose.position.z).margin(0.0001));
+	CHECK(a.pose.orientation.x == Catch::Approx(b.pose.orientation.x).margin(0.0001));
+	CHECK(a.pose.orientation.y == Catch::Approx(b.pose.orientation.y).margin(0.0001));
+	CHECK(a.pose.orientation.z == Catch::Approx(b.pose.orientation.z).margin(0.0001));
+	CHECK(a.pose.orientation.w == Catch::Approx(b.pose.orientation.w).margin(0.0001));
+}
+
+
+/*
+ *
+ * Tests.
+ *
+ */
+
+TEST_CASE("u_space_overseer")
+{
+	struct xrt_tracking_origin xto = {};
+	xto.initial_offset = {XRT_QUAT_IDENTITY, {0.0f, 0.5f, 1.0f}};
+
+	fake_device head;
+	fake_device controller;
+	fake_device_init(&head, &xto, {0.0f, 1.6f, 0.0f});
+	fake_device_init(&controller, &xto, {0.2f, 1.0f, -0.3f});
+
+	struct xrt_device *xdevs[2] = {&head.base, &controller.base};
+	struct xrt_pose local_offset = {XRT_QUAT_IDENTITY, {0.0f, 1.0f, 0.0f}};
+
+	struct u_space_overseer *uso = u_space_overseer_create(NULL);
+	u_space_overseer_legacy_setup(uso, xdevs, 2, &head.base, &local_offset, false, false);
+	struct xrt_space_overseer *xso = (struct xrt_space_overseer *)uso;
+
+	struct xrt_space *grip = NULL;
+	struct xrt_space *aim = NULL;
+	u_space_overseer_create_pose_space(uso, &controller.base, XRT_INPUT_SIMPLE_GRIP_POSE, &grip);
+	u_space_overseer_create_pose_space(uso, &controller.base, XRT_INPUT_SIMPLE_AIM_POSE, &aim);
+
+	const struct xrt_pose identity = XRT_POSE_IDENTITY;
+	const struct xrt_pose offset_a = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.1f, 0.0f, 0.0f}};
+	const struct xrt_pose offset_b = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.2f}};
+	const int64_t at_timestamp_ns = 1500000000;
+
+	SECTION("locate_spaces matches locate_space")
+	{
+		struct xrt_space *base = xso->semantic.local;
+		struct xrt_pose base_offset = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.3f, 0.0f}};
+
+		std::vector<struct xrt_space *> spaces = {
+		    grip, aim, xso->semantic.view, base, grip, aim, xso->semantic.stage, grip,
+		};
+		std::vector<struct xrt_pose> offsets = {
+		    identity, offset_a, identity, offset_b, offset_a, offset_a, identity, identity,
+		};
+		std::vector<struct xrt_space_relation> relations(spaces.size());
+
+		xrt_space_overseer_locate_spaces(xso, base, &base_offset, at_timestamp_ns, spaces.data(),
+		                                 (uint32_t)spaces.size(), offsets.data(), relations.data());
+
+		for (size_t i = 0; i < spaces.size(); i++) {
+			CAPTURE(i);
+			struct xrt_space_relation expected = XRT_SPACE_RELATION_ZERO;
+			xrt_space_overseer_locate_space(xso, base, &base_offset, at_timestamp_ns, spaces[i], &offsets[i],
+			                                &expected);
+			check_relation_equal(relations[i], expected);
+		}
+	}
+
+	SECTION("locate_spaces queries each device pose once")
+	{
+		struct xrt_space *base = xso->semantic.view;
+
+		std::vector<struct xrt_space *> spaces;
+		std::vector<struct xrt_pose> offsets;
+		for (uint32_t i = 0; i < 52; i++) {
+			struct xrt_pose offset = identity;
+			offset.position.y = (float)i * 0.01f;
+			spaces.push_back((i % 2) == 0 ? grip : aim);
+			offsets.push_back(offset);
+		}
+		std::vector<struct xrt_space_relation> relations(spaces.size());
+
+		head.pose_calls = 0;
+		controller.pose_calls = 0;
+
+		xrt_space_overseer_locate_spaces(xso, base, &identity, at_timestamp_ns, spaces.data(),
+		                                 (uint32_t)spaces.size(), offsets.data(), relations.data());
+
+		CHECK(head.pose_calls == 1);
+		CHECK(controller.pose_calls == 2);
+	}
+
+	SECTION("locate_spaces handles NULL spaces")
+	{
+		struct xrt_space *spaces[3] = {grip, NULL, grip};
+		struct xrt_pose offsets[3] = {identity, identity, identity};
+		struct xrt_space_relation relations[3] = {};
+		relations[1].relation_flags = XRT_SPACE_RELATION_POSITION_VALID_BIT;
+
+		xrt_space_overseer_locate_spaces(xso, xso->semantic.local, &identity, at_timestamp_ns, spaces, 3,
+		                                 offsets, relations);
+
+		CHECK(relations[0].relation_flags != XRT_SPACE_RELATION_BITMASK_NONE);
+		CHECK(relations[1].relation_flags == XRT_SPACE_RELATION_BITMASK_NONE);
+		check_relation_equal(relations[2], relations[0]);
+	}
+
+	SECTION("pose memo is invalidated by relation history pushes")
+	{
+		struct xrt_space *base = xso->semantic.local;
+		struct xrt_space_relation first = XRT_SPACE_RELATION_ZERO;
+		struct xrt_space_relation second = XRT_SPACE_RELATION_ZERO;
+
+		struct m_relation_history *other = NULL;
+		m_relation_history_create(&head.rh);
+		m_relation_history_create(&other);
+
+		head.pose_calls = 0;
+
+		uint64_t start_ns = os_monotonic_get_ns();
+		xrt_space_overseer_locate_space(xso, base, &identity, at_timestamp_ns, xso->semantic.view, &identity,
+		                                &first);
+		xrt_space_overseer_locate_space(xso, base, &identity, at_timestamp_ns, xso->semantic.view, &identity,
+		                                &second);
+		uint64_t elapsed_ns = os_monotonic_get_ns() - start_ns;
+
+		check_relation_equal(first, second);
+
+		// Entries have a short max age, only check for the hit if we were fast enough.
+		if (elapsed_ns < 1000000) {
+			CHECK(head.pose_calls == 1);
+		}
+
+		// A history the device didn't read doesn't invalidate the entry.
+		head.pose_calls = 0;
+		start_ns = os_monotonic_get_ns();
+		xrt_space_overseer_locate_space(xso, base, &identity, at_timestamp_ns, xso->semantic.view, &identity,
+		                                &second);
+		uint32_t calls = head.pose_calls;
+		m_relation_history_push(other, &first, at_timestamp_ns);
+		xrt_space_overseer_locate_space(xso, base, &identity, at_timestamp_ns, xso->semantic.view, &identity,
+		                                &second);
+		elapsed_ns = os_monotonic_get_ns() - start_ns;
+		if (elapsed_ns < 1000000) {
+			CHECK(head.pose_calls == calls);
+		}
+
+		// The history the device read does.
+		m_relation_history_push(head.rh, &first, at_timestamp_ns);
+
+		head.pose_calls = 0;
+		xrt_space_overseer_locate_space(xso, base, &identity, at_timestamp_ns, xso->semantic.view, &identity,
+		                                &second);
+		CHECK(head.pose_calls == 1);
+
+		m_relation_history_destroy(&other);
+		m_relation_history_destroy(&head.rh);
+	}
+
+	xrt_space_reference(&grip, NULL);
+	xrt_space_reference(&aim, NULL);
+	xrt_space_overseer_destroy(&xso);
+}
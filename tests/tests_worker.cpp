@@ -10,8 +10,10 @@
 
 #include "catch_amalgamated.hpp"
 
+#include <atomic>
 #include <thread>
 #include <chrono>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -130,3 +132,106 @@ TEST_CASE("TaskCollection")
 		CHECK(calledA[2]);
 	}
 }
+
+TEST_CASE("u_worker_group many tasks")
+{
+	// Way more tasks than fit in the queue of the old pool.
+	const size_t count = 10000;
+
+	SharedThreadPool pool{3, 4, "Test"};
+	SharedThreadGroup group{pool};
+
+	std::vector<int> called(count, 0);
+	parallel_for(group, 0, count, 1, [&](size_t i) { called[i]++; });
+
+	for (size_t i = 0; i < count; i++) {
+		INFO("index " << i);
+		CHECK(called[i] == 1);
+	}
+}
+
+TEST_CASE("u_worker_group nested wait")
+{
+	// Only one worker, nested waits must run the inner tasks themselves.
+	uint32_t workers = GENERATE(0u, 1u, 3u);
+	INFO("workers " << workers);
+
+	SharedThreadPool pool{workers, workers + 1, "Test"};
+	SharedThreadGroup outer{pool};
+	SharedThreadGroup inner{pool};
+
+	std::atomic<int> sum{0};
+	parallel_for(outer, 0, 8, 1, [&](size_t i) {
+		parallel_for(inner, 0, 100, 10, [&](size_t j) { sum += (int)j; });
+	});
+
+	CHECK(sum == 8 * (99 * 100 / 2));
+}
+
+TEST_CASE("parallel_for ranges")
+{
+	SharedThreadPool pool{2, 3, "Test"};
+	SharedThreadGroup group{pool};
+
+	std::atomic<size_t> calls{0};
+	std::atomic<size_t> sum{0};
+	auto func = [&](size_t i) {
+		calls++;
+		sum += i;
+	};
+
+	SECTION("Empty")
+	{
+		parallel_for(group, 5, 5, 1, func);
+		CHECK(calls == 0);
+	}
+
+	SECTION("Grain does not divide range")
+	{
+		parallel_for(group, 10, 47, 8, func);
+		CHECK(calls == 37);
+		CHECK(sum == (46 * 47 / 2) - (9 * 10 / 2));
+	}
+
+	SECTION("Zero grain")
+	{
+		parallel_for(group, 0, 10, 0, func);
+		CHECK(calls == 10);
+	}
+}
+
+TEST_CASE("u_worker benchmark", "[.][benchmark]")
+{
+	SharedThreadPool pool{3, 4, "Bench"};
+	SharedThreadGroup group{pool};
+
+	std::vector<float> data(1 << 16, 1.0f);
+	auto work = [&](size_t i) { data[i] = data[i] * 1.0001f + 0.5f; };
+
+	BENCHMARK("serial")
+	{
+		for (size_t i = 0; i < data.size(); i++) {
+			work(i);
+		}
+		return data[0];
+	};
+	BENCHMARK("parallel_for, 256 chunks")
+	{
+		parallel_for(group, 0, data.size(), data.size() / 256, work);
+		return data[0];
+	};
+	BENCHMARK("parallel_for, 4096 chunks")
+	{
+		parallel_for(group, 0, data.size(), data.size() / 4096, work);
+		return data[0];
+	};
+	BENCHMARK("nested parallel_for, 16x16 chunks")
+	{
+		SharedThreadGroup inner{pool};
+		parallel_for(group, 0, 16, 1, [&](size_t outer) {
+			size_t base = outer * (data.size() / 16);
+			parallel_for(inner, base, base + data.size() / 16, data.size() / 256, work);
+		});
+		return data[0];
+	};
+}